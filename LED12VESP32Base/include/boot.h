@@ -0,0 +1,71 @@
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+#include <Arduino.h>
+
+// The tasks that run boot jobs. Jobs of different runners run at the same time, on different cores.
+enum BootRunner : uint8_t
+{
+    BOOT_RUNNER_SETUP,   // The Arduino setup task, brings up the control path (LED strip, touch, sensors)
+    BOOT_RUNNER_NETWORK, // The network task, before it enters its loop
+    BOOT_RUNNER_COUNT
+};
+
+// At most this many jobs per boot (each one takes a bit of a FreeRTOS event group)
+static const uint8_t MAX_BOOT_JOBS = 16;
+
+typedef void (*BootCallback)();
+
+// One step of the startup
+struct BootJob
+{
+    const char *name;
+    BootRunner runner;
+    uint16_t dependsOn; // Bit set of the jobs (by index, see bootBit()) that have to be done before this one starts
+    BootCallback run;
+};
+
+// When a job ran, in us since the start of the application
+struct BootTiming
+{
+    bool done;
+    uint32_t reachedUs;  // The runner got to the job
+    uint32_t startUs;    // Started, after waiting for the jobs of other runners it depends on
+    uint32_t durationUs;
+};
+
+// Bit of a job (its index in the table) in BootJob::dependsOn
+static constexpr uint16_t bootBit(uint8_t job) { return 1 << job; }
+
+// Whether a job table can be run: not too many jobs, and each job only depends on jobs before it in the table. The
+// table order is a valid order then, and the runners can never wait for each other in a circle.
+static constexpr bool bootJobsValid(const BootJob *jobs, uint8_t count, uint8_t index = 0)
+{
+    return count <= MAX_BOOT_JOBS &&
+           (index >= count ||
+            ((jobs[index].dependsOn >> index) == 0 && jobs[index].runner < BOOT_RUNNER_COUNT &&
+             bootJobsValid(jobs, count, index + 1)));
+}
+
+// Take over the job table, call once before any runner starts. The table has to stay in place.
+void bootSetup(const BootJob *jobs, uint8_t count);
+// Run the jobs of a runner in table order. A job waits until the jobs it depends on are done, whichever task runs
+// them. Returns when all jobs of the runner are done.
+void bootRun(BootRunner runner);
+// Wait until the jobs of all runners are done
+void bootWait();
+
+// The timeline of this boot, see bootTiming()
+uint8_t bootJobCount();
+const BootJob &bootJob(uint8_t job);
+BootTiming bootTiming(uint8_t job);
+// Whether all jobs are done
+bool bootComplete();
+// Time when the last job was done, in us since the start of the application. 0 while the boot is going on.
+uint32_t bootCompleteUs();
+const char *bootRunnerName(BootRunner runner);
+
+// Print the timeline as a table
+void bootReport(Stream &terminalStream);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
+#include <Arduino.h>
+
+// Returns the time in ms, like millis()
+typedef unsigned long (*ClockSource)();
+
+// Time base of the lamp logic: state machine, LED strip, sensors and schedulers. Runs on millis() unless another
+// source is plugged in, e.g. a virtual clock to replay a night at many times real speed.
+unsigned long clockMillis();
+// Let the lamp logic run on another time source, call before any setup. nullptr switches back to millis().
+void clockUseSource(ClockSource source);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef _COMMANDS_H_
+#define _COMMANDS_H_
+
+#include <Arduino.h>
+
+// The settings of the device that can be changed from outside the control task (web api, web interface)
+enum DeviceParameter : uint8_t
+{
+    PARAM_ALLOW_NIGHT_LIGHT,
+    PARAM_NIGHT_LIGHT_ON_DURATION,
+    PARAM_NIGHT_LIGHT_BRIGHTNESS,
+    PARAM_NIGHT_LIGHT_THRESHOLD,
+    PARAM_MAX_NIGHT_LIGHT_BRIGHTNESS,
+    PARAM_ON_BRIGHTNESS,
+    PARAM_MAX_BRIGHTNESS,
+    PARAM_BRIGHTNESS_STEP,
+    PARAM_TRANSITION_DURATION,
+    PARAM_ON_EASING_CURVE,
+    PARAM_NIGHT_LIGHT_EASING_CURVE,
+    PARAM_MAX_MOVING_TARGET_DISTANCE,
+    PARAM_MIN_MOVING_TARGET_DISTANCE,
+    PARAM_MAX_MOVING_TARGET_ENERGY,
+    PARAM_MIN_MOVING_TARGET_ENERGY,
+    PARAM_MAX_STATIONARY_TARGET_DISTANCE,
+    PARAM_MIN_STATIONARY_TARGET_DISTANCE,
+    PARAM_MAX_STATIONARY_TARGET_ENERGY,
+    PARAM_MIN_STATIONARY_TARGET_ENERGY,
+    PARAM_STRIP_POWER, // Only known as a preference
+    PARAM_RULE_CONDITIONS, // The rule gets saved as a whole: saving a rule parameter also changes it right away
+    PARAM_RULE_LDR_MIN,
+    PARAM_RULE_WINDOW_START,
+    PARAM_RULE_WINDOW_END,
+    PARAM_RULE_LDR_HYSTERESIS,
+    PARAM_RULE_DARK_DWELL,
+    PARAM_RULE_PRESENCE_DEBOUNCE,
+    PARAM_RULE_OVERRIDE, // Never saved
+    PARAM_TIME_OF_DAY,   // Never saved
+    PARAM_LDR_CALIBRATION, // Start (!= 0) or cancel learning the LDR compensation, never saved
+    DEVICE_PARAMETER_COUNT
+};
+
+enum CommandType : uint8_t
+{
+    COMMAND_SET_PARAMETER,  // Change a parameter until the next restart
+    COMMAND_SAVE_PARAMETER, // Save a parameter as preference, takes effect with the next restart
+    COMMAND_SET_LIGHT_STATE // Switch the lamp on (value != 0) or off
+};
+
+struct Command
+{
+    CommandType type;
+    DeviceParameter parameter; // Not used by COMMAND_SET_LIGHT_STATE
+    uint16_t value;
+};
+
+// Hand a command over to the control task. Safe to call from any task, never blocks. Returns false when the queue is
+// full and the command got dropped.
+bool postCommand(const Command &command);
+// Set a parameter, or save it as preference
+bool postParameter(DeviceParameter parameter, uint16_t value, bool saveAsPreference);
+// Switch the lamp on or off
+bool postLightState(bool lampOn);
+// Number of commands dropped because the queue was full
+uint32_t droppedCommands();
+
+// Set up the queue, call before any task posts commands
+void commandsSetup();
+// Apply all commands posted since the last call. Only one change per parameter (the last one) gets applied, so a burst
+// of commands ends up in one pass. Call from the control task only.
+void commandsLoop();
+
+#endif
@@ -2,6 +2,13 @@
 #define _CONFIG_H_
 
 #include <Arduino.h>
+#include <esp_wifi_types.h>
+#include <easing.h>
+#include <fixed_string.h>
+#include <ldr.h>
+#include <led_strip.h>
+#include <mqtt_handler.h>
+#include <rules.h>
 
 /*
     Parameter names for Preference and for the web API
@@ -9,6 +16,8 @@
 
 static const char *PrefBrightnessStep = "stbr";
 static const char *PrefTransitionDurationMs = "ptdm";
+static const char *PrefOnEasingCurve = "oecv";
+static const char *PrefNightLightEasingCurve = "necv";
 static const char *PrefMaxBrightness = "mbr";
 static const char *PrefOnBrightness = "obr";
 static const char *PrefNightLightOnDuration = "odu";
@@ -16,6 +25,15 @@ static const char *PrefNightLightBrightness = "nlbr";
 static const char *PrefMaxNightLightBrightness = "mnlb";
 static const char *PrefAllowNightLight = "alnl";
 static const char *PrefNightLightLdrThreshold = "nllt";
+static const char *PrefNightLightRule = "nlru";
+static const char *PrefRuleConditions = "nlrc";
+static const char *PrefRuleLdrMin = "nlrl";
+static const char *PrefRuleWindowStart = "nlws";
+static const char *PrefRuleWindowEnd = "nlwe";
+static const char *PrefRuleGating = "nlgt";
+static const char *PrefRuleLdrHysteresis = "nlhy";
+static const char *PrefRuleDarkDwell = "nldw";
+static const char *PrefRulePresenceDebounce = "nlpd";
 static const char *PrefMinMovingTargetDistance = "mimd";
 static const char *PrefMaxMovingTargetDistance = "mamd";
 static const char *PrefMinMovingTargetEnergy = "mime";
@@ -24,6 +42,9 @@ static const char *PrefMinStationaryTargetDistance = "misd";
 static const char *PrefMaxStationaryTargetDistance = "masd";
 static const char *PrefMinStationaryTargetEnergy = "mise";
 static const char *PrefMaxStationaryTargetEnergy = "mase";
+static const char *PrefStripPower = "stpw";
+static const char *PrefEnergyCounters = "enct";
+static const char *PrefLdrCompensation = "ldcm";
 
 static const char *PrefWifiHostname = "whon";
 static const char *PrefWifiApSsid = "wass";
@@ -46,6 +67,8 @@ static const char *PrefWebAuthPassword = "wapw";
 
 static const uint8_t DEFAULT_BRIGHTNESS_STEP = 8;
 static const uint16_t DEFAULT_TRANSITION_DURATION_MS = 1000;
+static const EasingCurve DEFAULT_ON_EASING_CURVE = EASE_IN_OUT;
+static const EasingCurve DEFAULT_NIGHTLIGHT_EASING_CURVE = EASE_PERCEPTUAL;
 static const uint8_t DEFAULT_MAX_BRIGHTNESS = 210;
 static const uint8_t DEFAULT_ON_BRIGHTNESS = 210;
 
@@ -64,6 +87,11 @@ static const uint16_t DEFAULT_MAX_STATIONARY_TARGET_DISTANCE = 300; // UINT16_MA
 static const uint8_t DEFAULT_MIN_STATIONARY_TARGET_ENERGY = 0;
 static const uint8_t DEFAULT_MAX_STATIONARY_TARGET_ENERGY = UINT8_MAX;
 
+static const uint16_t DEFAULT_STRIP_POWER_DW = 230; // 3.30 m at 9 W/m, measured 22 .. 23 W at full duty
+
+// The energy counters are written to flash at most this often (a power loss loses up to this much of counting)
+static const unsigned long ENERGY_SAVE_INTERVAL_MS = 60UL * 60UL * 1000UL;
+
 static const char DEFAULT_WIFI_HOSTNAME[] = "lamp";
 static const char DEFAULT_WIFI_AP_SSID[] = "esp32LEDStrip";
 static const char DEFAULT_WIFI_AP_PASSPHRASE[] = "";
@@ -72,14 +100,25 @@ static const uint32_t DEFAULT_WIFI_AP_NETMASK = IPAddress(255, 255, 255, 0);
 static const char DEFAULT_WIFI_STA_SSID[] = "";
 static const char DEFAULT_WIFI_STA_PASSPHRASE[] = "";
 
-static const String DEFAULT_WEB_AUTH_USERNAME = "admin";
-static const String DEFAULT_WEB_AUTH_PASSWORD = "lamp";
+static const char DEFAULT_WEB_AUTH_USERNAME[] = "admin";
+static const char DEFAULT_WEB_AUTH_PASSWORD[] = "lamp";
 
 static const char DEFAULT_MQTT_SERVER[] = "";
 static const char DEFAULT_MQTT_USER[] = "";
 static const char DEFAULT_MQTT_PASSWORD[] = "";
 
 static const uint8_t MAX_HOSTNAME_LEN = 32;
+static const uint8_t MAX_USERNAME_LENGTH = 8;
+
+// The string preferences, each one sized to the longest value it may hold
+typedef FixedString<MAX_USERNAME_LENGTH> WebAuthUsername;
+typedef FixedString<MAX_PASSPHRASE_LEN> WebAuthPassword;
+typedef FixedString<MAX_HOSTNAME_LEN> WifiHostname;
+typedef FixedString<MAX_SSID_LEN> WifiSsid;
+typedef FixedString<MAX_PASSPHRASE_LEN> WifiPassphrase;
+typedef FixedString<MAX_MQTT_SERVER_LENGTH> MqttServer;
+typedef FixedString<MAX_MQTT_USERNAME_LENGTH> MqttUsername;
+typedef FixedString<MAX_MQTT_PASSWORD_LENGTH> MqttPassword;
 
 /*
 Light
@@ -171,47 +210,50 @@ void setMaxMovingTargetEnergy(uint8_t value);
 /*
 Network
 */
+// The string getters read into a buffer of the caller (no heap), a stored value that does not fit gets replaced by the
+// default.
+
 // Web interface
 
 // Get preference: The password for accessing the web interface of the device
-String getWebAuthPassword();
+void getWebAuthPassword(WebAuthPassword &value);
 // Set preference: The password for accessing the web interface of the device
-void setWebAuthPassword(const String &value);
+void setWebAuthPassword(const char *value);
 
 // Get preference: The username for accessing the web interface of the device
-String getWebAuthUsername();
+void getWebAuthUsername(WebAuthUsername &value);
 // Set preference: The username for accessing the web interface of the device. Set to empty String for no password
-void setWebAuthUsername(const String &value);
+void setWebAuthUsername(const char *value);
 
 
 // WiFi Access
 
 // Get preference: The device will try to connect to this SSID in STAtion mode.
-String getWifiStaSsid();
+void getWifiStaSsid(WifiSsid &value);
 // Set preference: The device will try to connect to this SSID in STAtion mode.
-void setWifiStaSsid(const String &value);
+void setWifiStaSsid(const char *value);
 
 // Get preference: The device will try to connect to an existing WLAN with this passphrase in STAtion mode.
-String getWifiStaPassphrase();
+void getWifiStaPassphrase(WifiPassphrase &value);
 // Set preference: The device will try to connect to an existing WLAN with this passphrase in STAtion mode.
-void setWifiStaPassphrase(const String &value);
+void setWifiStaPassphrase(const char *value);
 
 // Get preference: Hostname of the lamp device
-String getWifiHostname();
+void getWifiHostname(WifiHostname &value);
 // Set preference: Hostname of the lamp device
-void setWifiHostname(const String &value);
+void setWifiHostname(const char *value);
 
 // Access Point
 
 // Get preference: SSID of the access point when the lamp device opens up an AP
-String getWifiApSsid(); // size_t getWifiApSsid(char *value, uint8_t maxLen);
+void getWifiApSsid(WifiSsid &value);
 // Set preference: SSID of the access point when the lamp device opens up an AP
-void setWifiApSsid(const String &value); // void setWifiApSsid(const char *value, uint8_t maxLen);
+void setWifiApSsid(const char *value);
 
 // Get preference: Passphrase of the access point when the lamp device opens up an AP (might be an empty string)
-String getWifiApPassphrase(); // size_t getWifiApPassphrase(char *value, uint8_t maxLen);
+void getWifiApPassphrase(WifiPassphrase &value);
 // Set preference: Passphrase of the access point. A valid passphrase must have at least eight characters. Will set the value and return true when the requirement is met. Will not save the value and return false otherwise.
-void setWifiApPassphrase(const String &value); // bool setWifiApPassphrase(const char *value, uint8_t maxLen);
+void setWifiApPassphrase(const char *value);
 
 // Get preference: IPv4 address of the access point when the lamp device opens up an AP
 uint32_t wifiApIPv4Address();
@@ -226,19 +268,19 @@ void setWifiAPpIPv4Netmask(uint32_t value);
 // MQTT
 
 // Get preference: The MQTT server to connect to
-String getMqttServer();
+void getMqttServer(MqttServer &value);
 // Set preference: The MQTT server to connect to
-void setMqttServer(const String &value);
+void setMqttServer(const char *value);
 
 // Get preference: The username to connect to the MQTT server with
-String getMqttUsername();
+void getMqttUsername(MqttUsername &value);
 // Set preference: The username to connect to the MQTT server with
-void setMqttUsername(const String &value);
+void setMqttUsername(const char *value);
 
 // Get preference: The password to connect to the MQTT server with
-String getMqttPassword();
+void getMqttPassword(MqttPassword &value);
 // Set preference: The password to connect to the MQTT server with
-void setMqttPassword(const String &value);
+void setMqttPassword(const char *value);
 
 /*
 System
@@ -249,6 +291,41 @@ uint16_t transitionDurationMs();
 // Set preference: The duration of a transition between two LED strip brightness states
 void setTransitionDurationMs(uint16_t value);
 
+// Get preference: The curve transitions follow when the light is switched on, off or its brightness is changed
+EasingCurve onEasingCurve();
+// Set preference: The curve transitions follow when the light is switched on, off or its brightness is changed
+void setOnEasingCurve(EasingCurve value);
+
+// Get preference: The curve transitions follow when the night light is switched on, off or its brightness is changed
+EasingCurve nightLightEasingCurve();
+// Set preference: The curve transitions follow when the night light is switched on, off or its brightness is changed
+void setNightLightEasingCurve(EasingCurve value);
+
+// Get preference: The power the LED strip draws at full duty (in 0.1 W)
+uint16_t stripPowerDeciWatts();
+// Set preference: The power the LED strip draws at full duty (in 0.1 W)
+void setStripPowerDeciWatts(uint16_t value);
+
+// Get the saved energy counters of the LED strip. Returns false (and leaves value untouched) when there are none.
+bool energyCounters(LedStripEnergy &value);
+// Hand over the energy counters of the LED strip for saving. To spare the flash, a job writes them at most every
+// ENERGY_SAVE_INTERVAL_MS.
+void setEnergyCounters(const LedStripEnergy &value);
+
+// Get the saved night light rule. Returns false (and leaves value untouched) when there is none.
+bool nightLightRule(NightLightRule &value);
+// Set preference: The night light rule (see rules.h)
+void setNightLightRule(const NightLightRule &value);
+// Get the saved gating of the night light rule. Returns false (and leaves value untouched) when there is none.
+bool nightLightGating(NightLightGating &value);
+// Set preference: Hysteresis, dwell time and debounce window of the night light rule (see rules.h)
+void setNightLightGating(const NightLightGating &value);
+
+// Get the saved LDR compensation table. Returns false (and leaves value untouched) when there is none.
+bool ldrCompensationTable(LdrCompensation &value);
+// Set preference: The LDR compensation table (see ldr.h)
+void setLdrCompensationTable(const LdrCompensation &value);
+
 // Get preference: Brightness will be increased and decreased by this value (possible values: 1 .. 255)
 uint8_t brightnessStep();
 // Set preference: Brightness will be increased and decreased by this value (possible values: 1 .. 255, 0 will be treated as 1)
@@ -262,7 +339,5 @@ void factoryReset();
 
 // Configure the handling of preferences and configurations
 void configSetup();
-// Does nothing as of yet
-void configLoop();
 
 #endif
\ No newline at end of file
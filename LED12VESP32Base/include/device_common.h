@@ -15,6 +15,10 @@ static const uint8_t RADAR_TX_PIN = 32; // green wire
 
 // LED-Strip is controlled by a MOSFET connected to gpio 2 = LED_BUILTIN
 static const uint8_t LED_STRIP_PIN = LED_BUILTIN;
+// All MOSFETs driving the LED strip, one PWM channel each. Add pins here for segments of a long strip or a warm/cool
+// white pair, all channels follow the same brightness (see led_output.h).
+static const uint8_t LED_STRIP_PINS[] = {LED_STRIP_PIN};
+static const uint8_t LED_STRIP_CHANNEL_COUNT = sizeof(LED_STRIP_PINS) / sizeof(LED_STRIP_PINS[0]);
 
 // Touch buttons
 static const uint8_t TOUCH1_PIN = 27; // green wire
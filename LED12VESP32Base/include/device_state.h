@@ -3,24 +3,12 @@
 
 #include <Arduino.h>
 #include <config.h>
-
-// The states the device may be in
-enum State
-{
-    OFF,                          // Light is off. Constantly checks whether condition for night light is met. This is the default state after power on.
-    START_TRANSIT_TO_ON,          // Initialize the transition to a new brightness (> 0). The new brightness is set in _targetBrightness. Next state is TRANSIT_TO_ON.
-    TRANSIT_TO_ON,                // Gradually increases or decreases the brightness to _targetBrightness, until _targetBrightness equals the actual brightness. The next state is then ON.
-    ON,                           // Light is on at the desired brightness. This state only changes by someone touch one of the touch buttons (or power loss).
-    START_TRANSIT_TO_OFF,         // Initialize the transition to OFF (brightness = 0). _targetBrightness is set t0 0. Next state is TRANSIT_TO_OFF.
-    TRANSIT_TO_OFF,               // Gradually decreases the brightness to 0 until the actual brightness is 0. The next state is then OFF.
-    START_TRANSIT_TO_NIGHT_LIGHT, // Initialize the transition to night light brightness. The new brightness is set in _targetBrightness. Next state is TRANSIT_TO_NIGHT_LIGHT.
-    TRANSIT_TO_NIGHT_LIGHT,       // Gradually increases or decreases the brightness to _targetBrightness, until _targetBrightness equals the actual brightness. The next state is then NIGHT_LIGHT_ON.
-    NIGHT_LIGHT_ON                // Night light is on at night light brightness. Constantly checks whether condition for night light is still met. If not, next state is START_TRANSIT_TO_OFF.
-};
+#include <state_table.h>
 
 struct DeviceStateInfo
 {
-    State state; // Current state of the device
+    uint32_t generation; // Number of the snapshot, one per pass of the control loop
+    State state;         // Current state of the device
 
     bool allowNightLightMode;           // Whether night light should be turned on when it is dark enough and presence is detected
     unsigned long nightLightOnDuration; // The duration the night light stays on even when presence is no longer detected
@@ -32,8 +20,11 @@ struct DeviceStateInfo
     uint8_t brightness;                 // The target brightness. When it differs from the actual brightness, the actual brightness will be gradually modified to be equal.
 
     uint16_t transitionDurationMs; // A smooth transition between the current and a target brightness will be finished within this duration.
+    EasingCurve onEasingCurve;         // The curve transitions of the light follow.
+    EasingCurve nightLightEasingCurve; // The curve transitions of the night light follow.
 
     uint16_t ldrValue;            // The current measurement coming from the ldr (dark 0 .. 4095 bright). Gets updated every loop cycle.
+    uint16_t ldrNoise;            // Noise of the ldr readings (mean absolute deviation, same scale as ldrValue)
     uint16_t nightLightThreshold; // LDR values equal or less than this value warrant switching the night light on.
 
     bool presenceDetected;
@@ -56,9 +47,15 @@ struct DeviceStateInfo
 
 void debugPrintStateText(Stream *stream, State state, bool addPrintln = false);
 
-// Query the current state, all at once
+// Query the current state, all at once. Returns the snapshot published at the end of the last control loop pass: a
+// consistent view, without locking. Safe to call from any task.
 DeviceStateInfo getDeviceState();
 
+// Keep the control task from running while other tasks (e.g. the web server) read state beyond the snapshot. Calls
+// nest. Changes go through the command queue instead (see commands.h).
+void lockDeviceState();
+void unlockDeviceState();
+
 // Set values (for web api and web interface)
 void modifyAllowNightLightMode(bool value = DEFAULT_ALLOW_NIGHTLIGHT);
 void modifyNightLightOnDurationSeconds(uint16_t value = DEFAULT_NIGHTLIGHT_ON_DURATION_S);
@@ -69,6 +66,8 @@ void modifyOnBrightness(uint8_t value = DEFAULT_ON_BRIGHTNESS);
 void modifyMaxBrightness(uint8_t value = DEFAULT_MAX_BRIGHTNESS);
 void modifyBrightnessStep(uint8_t value = DEFAULT_BRIGHTNESS_STEP);
 void modifyTransitionDurationMs(uint16_t value = DEFAULT_TRANSITION_DURATION_MS);
+void modifyOnEasingCurve(EasingCurve value = DEFAULT_ON_EASING_CURVE);
+void modifyNightLightEasingCurve(EasingCurve value = DEFAULT_NIGHTLIGHT_EASING_CURVE);
 void modifyMaxMovingTargetDistance(uint16_t value = DEFAULT_MAX_MOVING_TARGET_DISTANCE);
 void modifyMinMovingTargetDistance(uint16_t value = DEFAULT_MIN_MOVING_TARGET_DISTANCE);
 void modifyMaxMovingTargetEnergy(uint8_t value = DEFAULT_MAX_MOVING_TARGET_ENERGY);
@@ -79,6 +78,8 @@ void modifyMaxStationaryTargetEnergy(uint8_t value = DEFAULT_MAX_MOVING_TARGET_E
 void modifyMinStationaryTargetEnergy(uint8_t value = DEFAULT_MIN_MOVING_TARGET_ENERGY);
 
 void modifyLightState(bool lampOn);
+// Start (only while the lamp is off) or cancel learning the LDR compensation table
+void modifyLdrCalibration(bool start);
 
 void deviceSetup();
 void deviceLoop();
@@ -0,0 +1,70 @@
+#ifndef _DITHER_H_
+#define _DITHER_H_
+
+#include <stdint.h>
+
+// Fractional bits of a fine duty: the PWM count << DITHER_BITS plus the fraction dithered on top
+static const uint8_t DITHER_BITS = 3;
+static const uint8_t DITHER_ONE = 1 << DITHER_BITS;
+static const uint8_t DITHER_MASK = DITHER_ONE - 1;
+
+// The dithering steps once per millisecond, so the pattern of the smallest fraction repeats at only 125 Hz. Below this
+// PWM count one count more is a large step in light (1 to 2 doubles it) and that pattern shows as flicker: such fine
+// duties are shown as the nearest count instead, their fraction is lost.
+static const uint16_t DITHER_MIN_DUTY = 4;
+
+// Whether a fine duty gets dithered: it has a fraction and lies at or above DITHER_MIN_DUTY
+inline bool ditherable(uint16_t fineDuty)
+{
+    return (fineDuty & DITHER_MASK) != 0 && (fineDuty >> DITHER_BITS) >= DITHER_MIN_DUTY;
+}
+
+// The PWM count a fine duty is shown as when it is not dithered: the nearest one, but not off unless it is 0
+inline uint16_t unditheredDuty(uint16_t fineDuty)
+{
+    uint16_t duty = (fineDuty + DITHER_ONE / 2) >> DITHER_BITS;
+    return duty == 0 && fineDuty != 0 ? 1 : duty;
+}
+
+// The fine duty the LED strip actually shows on average for a fine duty
+inline uint16_t shownFineDuty(uint16_t fineDuty)
+{
+    return ditherable(fineDuty) ? fineDuty : unditheredDuty(fineDuty) << DITHER_BITS;
+}
+
+// The sigma-delta stage of the temporal dithering: shows a fine duty as a sequence of the two PWM counts next to it.
+// The fraction is accumulated each period, whenever it overflows the higher count is shown for that period. Over any
+// DITHER_ONE periods in a row the average duty is exact, the higher counts are spread as evenly as they can be.
+class SigmaDelta
+{
+public:
+    // Start over at a fine duty
+    void start(uint16_t fineDuty)
+    {
+        _baseDuty = fineDuty >> DITHER_BITS;
+        _fraction = fineDuty & DITHER_MASK;
+        _error = 0;
+    }
+
+    // The PWM count to show for the next period
+    uint16_t step()
+    {
+        _error += _fraction;
+        if (_error < DITHER_ONE)
+            return _baseDuty;
+        _error -= DITHER_ONE;
+        return _baseDuty + 1;
+    }
+
+    // The lower of the two counts
+    uint16_t baseDuty() const { return _baseDuty; }
+    // The higher count is shown this many out of DITHER_ONE periods
+    uint8_t fraction() const { return _fraction; }
+
+private:
+    uint16_t _baseDuty = 0;
+    uint8_t _fraction = 0;
+    uint8_t _error = 0; // The accumulator, 0 .. DITHER_ONE - 1
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef _EASING_H_
+#define _EASING_H_
+
+#include <Arduino.h>
+
+// The shapes a brightness transition can follow
+enum EasingCurve : uint8_t
+{
+    EASE_LINEAR,      // Constant speed in PWM duty.
+    EASE_IN_OUT,      // Starts slow, speeds up in the middle, ends slow.
+    EASE_EXPONENTIAL, // Starts very slow and speeds up exponentially towards the end.
+    EASE_PERCEPTUAL,  // Constant speed in perceived brightness (linear along the brightness curve of the LED strip).
+    EASING_CURVE_COUNT
+};
+
+// Progress values are fixed point numbers: 0 = start, EASING_ONE = end.
+static const uint16_t EASING_ONE = 1 << 15;
+// Curves are sampled in this many steps of equal duration. A transition is split into as many linear segments.
+static const uint8_t EASING_STEPS = 8;
+
+// Whether value is a valid EasingCurve
+bool isEasingCurve(uint8_t value);
+
+// The eased progress (0 .. EASING_ONE) of a curve at the point in time t (0 .. EASING_ONE).
+// EASE_PERCEPTUAL is linear here, the LED strip applies its brightness curve on top.
+uint16_t easingProgress(EasingCurve curve, uint16_t t);
+// The eased progress (0 .. EASING_ONE) of a curve at the end of step (0 .. EASING_STEPS).
+uint16_t easingStepProgress(EasingCurve curve, uint8_t step);
+
+void debugPrintEasingCurve(Stream *stream, EasingCurve curve, bool addPrintln = false);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef _EVENTS_H_
+#define _EVENTS_H_
+
+#include <Arduino.h>
+
+// Things the control loop gets woken up for
+enum DeviceEvent : uint8_t
+{
+    EVENT_TOUCH,      // A touch button changed its level
+    EVENT_LED_STRIP,  // The LED strip needs attention (e.g. a fade or a pattern step has ended)
+    EVENT_COMMAND,    // A command came in via the web API
+    DEVICE_EVENT_COUNT
+};
+
+// Bit of an event in the set returned by waitForEvents()
+static inline uint32_t eventBit(DeviceEvent event) { return 1UL << event; }
+
+// Post an event to the control loop. Safe to call from any task.
+void postEvent(DeviceEvent event);
+// Post an event to the control loop from an interrupt. Returns whether a higher priority task has been woken.
+bool postEventFromISR(DeviceEvent event);
+
+// Block until an event gets posted, but at most timeoutMs. Returns the set of all events posted meanwhile (see
+// eventBit()), 0 when the time ran out.
+uint32_t waitForEvents(uint32_t timeoutMs);
+
+// Wake up the network task, e.g. when WiFi reported an event. Safe to call from any task.
+void wakeNetworkTask();
+// Block the network task until wakeNetworkTask() gets called, but at most timeoutMs (UINT32_MAX: no limit).
+void waitForNetworkWake(uint32_t timeoutMs);
+
+// Create the event queue, call before any module posts events
+void eventsSetup();
+
+#endif
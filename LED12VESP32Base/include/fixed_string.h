@@ -0,0 +1,85 @@
+#ifndef _FIXED_STRING_H_
+#define _FIXED_STRING_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// A string of at most N characters kept in a buffer of its own, never on the heap. Everything that would not fit gets
+// rejected rather than cut off, so a too long value never ends up half applied.
+template <size_t N>
+class FixedString
+{
+public:
+    FixedString() { clear(); }
+    FixedString(const char *value)
+    {
+        clear();
+        assign(value);
+    }
+
+    // Maximum number of characters (without the terminating 0)
+    static constexpr size_t capacity() { return N; }
+
+    // Take over value. Returns false and keeps the current content when value is longer than the capacity.
+    bool assign(const char *value)
+    {
+        if (value == nullptr)
+        {
+            clear();
+            return true;
+        }
+        return assign(value, strlen(value));
+    }
+
+    // Take over the first len characters of value. Returns false and keeps the current content when len exceeds the
+    // capacity.
+    bool assign(const char *value, size_t len)
+    {
+        if (len > N)
+            return false;
+        memmove(_buffer, value, len);
+        _buffer[len] = 0;
+        _length = len;
+        return true;
+    }
+
+    void clear()
+    {
+        _buffer[0] = 0;
+        _length = 0;
+    }
+
+    // For C APIs that write into the buffer (at most bufferSize() bytes including the terminating 0), call sync()
+    // afterwards
+    char *buffer() { return _buffer; }
+    static constexpr size_t bufferSize() { return N + 1; }
+    // Pick up the length after the buffer got written to directly
+    void sync()
+    {
+        _buffer[N] = 0;
+        _length = strlen(_buffer);
+    }
+
+    const char *c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+
+    bool equals(const char *value) const { return value != nullptr && strcmp(_buffer, value) == 0; }
+    bool equalsIgnoreCase(const char *value) const { return value != nullptr && strcasecmp(_buffer, value) == 0; }
+    long toInt() const { return atol(_buffer); }
+
+    bool operator==(const char *value) const { return equals(value); }
+    bool operator!=(const char *value) const { return !equals(value); }
+    template <size_t M>
+    bool operator==(const FixedString<M> &other) const { return equals(other.c_str()); }
+    template <size_t M>
+    bool operator!=(const FixedString<M> &other) const { return !equals(other.c_str()); }
+
+private:
+    char _buffer[N + 1];
+    size_t _length;
+};
+
+#endif
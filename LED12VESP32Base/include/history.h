@@ -0,0 +1,94 @@
+#ifndef _HISTORY_H_
+#define _HISTORY_H_
+
+#include <Arduino.h>
+
+// What the device saw and did during one second
+struct HistorySample
+{
+    uint16_t ldr;      // Filtered LDR value (dark 0 .. 4095 bright)
+    uint16_t distance; // Distance of the target the radar reports (moving before stationary), 0 without a target
+    uint8_t energy;    // Energy of that target
+    uint8_t presence;  // 1: presence within the presence zone
+    uint8_t state;     // State of the device (see state_table.h), OFF is 0
+};
+
+// The fields of a sample, in the order of their bits in a record
+enum HistoryField : uint8_t
+{
+    HISTORY_LDR,
+    HISTORY_DISTANCE,
+    HISTORY_ENERGY,
+    HISTORY_PRESENCE,
+    HISTORY_STATE,
+    HISTORY_FIELD_COUNT
+};
+
+// The history keeps the last HISTORY_SECONDS (a block goes once all of its records are older). Runs of samples
+// within a small dead band of each other make one record (it holds the first sample of the run, the aggregates take
+// every sample as it is), records only hold the fields that changed (as delta to the record before, zigzag varint).
+// The records fill blocks of HISTORY_BLOCK_BYTES, each block starts from zero and the oldest block makes room for a
+// new one. A quiet day fits, a busy signal pushes the oldest blocks out earlier: historySeconds() tells how far back
+// the history actually reaches.
+static const uint32_t HISTORY_SECONDS = 24UL * 60 * 60;
+static const uint16_t HISTORY_BLOCK_BYTES = 240;
+static const uint8_t HISTORY_BLOCKS = 24;
+// An export line is never longer than this
+static const size_t HISTORY_MAX_LINE = 64;
+
+// The rolling windows aggregates are kept for
+enum HistoryWindow : uint8_t
+{
+    HISTORY_LAST_HOUR, // In buckets of 5 minutes
+    HISTORY_LAST_DAY,  // In buckets of an hour
+    HISTORY_WINDOW_COUNT
+};
+
+// Aggregates over a rolling window
+struct HistoryStats
+{
+    uint32_t seconds; // Samples within the window
+    uint16_t ldrMin;
+    uint16_t ldrMax;
+    uint16_t ldrAvg;
+    uint32_t presenceSeconds; // Samples with presence within the zone
+    uint32_t targetSeconds;   // Samples with a target, the distances are taken over these
+    uint16_t distanceMin;
+    uint16_t distanceMax;
+    uint16_t distanceAvg;
+    uint32_t lampOnSeconds; // Samples with the device not OFF
+};
+
+// Where an export has got to. The history keeps changing in between, blocks that were dropped meanwhile are skipped.
+struct HistoryCursor
+{
+    uint32_t block;                       // Sequence number of the block being read
+    uint16_t offset;                      // Next record within the block
+    uint32_t second;                      // Start of the next record
+    uint16_t values[HISTORY_FIELD_COUNT]; // Decoded up to offset
+    bool headerDone;
+    bool done;
+};
+
+// Add the sample of the current second. Call from the control task, about once per second, further samples within the
+// same second are ignored.
+void historyAppend(const HistorySample &sample);
+
+// The aggregates, updated with each sample
+HistoryStats historyStats(HistoryWindow window);
+const char *historyWindowName(HistoryWindow window);
+
+// Memory taken by the encoded records (of the blocks in use), the number of records and the seconds they cover
+uint32_t historyBytesUsed();
+uint32_t historyRecords();
+uint32_t historySeconds();
+
+// Export the history as CSV, oldest first: a header line, then one line "second,duration,ldr,distance,energy,presence,
+// state" per record (second: since power on, duration: seconds the values held). Start with historyStartExport(),
+// then call historyExport() until it returns 0.
+void historyStartExport(HistoryCursor &cursor);
+// Write the next whole lines into buffer, at most maxLen bytes (at least HISTORY_MAX_LINE). Returns the number of
+// bytes written, 0 when the export is done. Keep the device state locked during the call.
+size_t historyExport(HistoryCursor &cursor, char *buffer, size_t maxLen);
+
+#endif
@@ -5,13 +5,80 @@
 
 static const uint16_t MAX_BRIGHTNESS = 4095;
 
+// Returns a brightness sample (dark 0 .. MAX_BRIGHTNESS bright)
+typedef uint16_t (*LdrSampler)();
+
+// Where the readings come from
+enum LdrSource : uint8_t
+{
+    LDR_SOURCE_NONE,        // ldrSetup() has not been called yet
+    LDR_SOURCE_ADC_DMA,     // Bursts of the continuous ADC (DMA), calibrated to mV
+    LDR_SOURCE_ANALOG_READ, // One calibrated conversion per reading, in case the continuous ADC could not be set up
+    LDR_SOURCE_SAMPLER,     // The sampler given to ldrUseSampler()
+    LDR_SOURCE_COUNT
+};
+
+// The offset the lit LED strip adds to the readings, by brightness of the strip. Points are LDR_COMPENSATION_STEP
+// apart (0, 17, .. 255), values in between are interpolated.
+static const uint8_t LDR_COMPENSATION_POINTS = 16;
+static const uint8_t LDR_COMPENSATION_STEP = 255 / (LDR_COMPENSATION_POINTS - 1);
+struct LdrCompensation
+{
+    uint16_t offset[LDR_COMPENSATION_POINTS];
+};
+
+enum LdrCalibrationState : uint8_t
+{
+    LDR_CALIBRATION_IDLE,    // Never started since the last restart
+    LDR_CALIBRATION_RUNNING, // The strip gets stepped through its range
+    LDR_CALIBRATION_DONE,    // A new table has been saved
+    LDR_CALIBRATION_FAILED,  // Not started (strip on, too bright) or interrupted (strip changed, cancelled)
+    LDR_CALIBRATION_STATE_COUNT
+};
+
+// Take the samples from elsewhere (e.g. a scripted light level) instead of the LDR, call before ldrSetup().
+void ldrUseSampler(LdrSampler sampler);
+
+// Measures periodically by a job of the control task, never waits for the ADC. Loads the compensation table, call after
+// configSetup().
 void ldrSetup();
-void ldrLoop();
 
-// the averaged measured brightness
+// the filtered ambient brightness (median of the last readings, then an exponential moving average). MAX_BRIGHTNESS + 1
+// until the first reading is in. Readings lit up by the LED strip itself are taken while the strip is dark, or get
+// the offset of the compensation table subtracted. Without a table they are left out.
 uint16_t averagedBrightness();
-// the most recently measured brightness
+// the most recently measured ambient brightness, unfiltered
 uint16_t measuredBrightness();
+// Noise of the readings: their mean absolute deviation from the filtered brightness
+uint16_t ldrNoise();
+// Calibrated voltage of the most recent reading, 0 when the readings come from a sampler
+uint16_t ldrMillivolts();
+LdrSource ldrSource();
+// Number of readings taken with the LED strip blanked
+uint32_t ldrBlankCount();
+// The last reading taken with the LED strip blanked for a moment (MAX_BRIGHTNESS + 1 before the first one). The LDR
+// has not settled by then, so it does not go into the filter: compare it to averagedBrightness() to see how far off.
+uint16_t ldrBlankedBrightness();
+// Number of readings left out because the LED strip was on (changing, or no compensation table)
+uint32_t ldrSkippedCount();
+const char *ldrSourceName(LdrSource source);
+
+// Learn the compensation table: in the dark, with the strip off, step the strip through its range (up to
+// maxBrightness) and take the rise of the readings at each point. Takes about a minute, the strip is off again and
+// the table saved afterwards. Any other change of the strip meanwhile ends it. Returns false when it can not start.
+bool ldrStartCalibration(uint8_t maxBrightness);
+// End a running calibration and switch the strip off, the table stays as it was
+void ldrCancelCalibration();
+bool ldrCalibrating();
+LdrCalibrationState ldrCalibrationState();
+const char *ldrCalibrationStateName(LdrCalibrationState state);
+// Whether there is a compensation table (learned now or loaded from the preferences)
+bool ldrCompensated();
+LdrCompensation ldrCompensation();
+// Offset the strip adds to the readings at this brightness, 0 without a table
+uint16_t ldrCompensationOffset(uint8_t brightness);
+// Number of readings the offset was subtracted from
+uint32_t ldrCompensatedCount();
 
 // measure and calculate average brightness every x milliseconds
 uint32_t measurementDelayMs();
@@ -20,4 +87,4 @@ void setMeasurementDelayMs(uint32_t value);
 
 unsigned long lastMeasureTs();
 
-#endif
\ No newline at end of file
+#endif
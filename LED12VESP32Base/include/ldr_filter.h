@@ -0,0 +1,39 @@
+#ifndef _LDR_FILTER_H_
+#define _LDR_FILTER_H_
+
+#include <Arduino.h>
+
+// Smooths the LDR readings: the median of the last readings (drops single outliers, e.g. a flash of a passing car),
+// then an exponential moving average. Tracks the noise of the readings along. Plain integer math on fixed memory.
+class LdrFilter
+{
+public:
+    static const uint8_t MEDIAN_SIZE = 5; // Readings the median is taken of, odd
+    static const uint8_t EMA_SHIFT = 2;   // A new reading weighs 1 / 2^EMA_SHIFT in the moving average
+    static const uint8_t FIXED_SHIFT = 8; // Fractional bits of the moving averages
+
+    // Add a reading, returns the filtered value
+    uint16_t add(uint16_t reading);
+    // Forget all readings, the next one starts the filter over
+    void reset();
+
+    // Whether a reading has been added since the start (or the last reset)
+    bool primed() const { return _primed; }
+    // The filtered value, 0 before the first reading
+    uint16_t average() const { return round(_emaFixed); }
+    // Mean absolute deviation of the readings from the filtered value
+    uint16_t noise() const { return round(_noiseFixed); }
+
+private:
+    uint16_t median() const;
+    static uint16_t round(int32_t fixed) { return (fixed + (1 << (FIXED_SHIFT - 1))) >> FIXED_SHIFT; }
+
+    uint16_t _window[MEDIAN_SIZE] = {0};
+    uint8_t _fill = 0;
+    uint8_t _pos = 0;
+    int32_t _emaFixed = 0;   // Filtered value << FIXED_SHIFT
+    int32_t _noiseFixed = 0; // Mean absolute deviation << FIXED_SHIFT
+    bool _primed = false;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef _LED_OUTPUT_H_
+#define _LED_OUTPUT_H_
+
+#include <Arduino.h>
+
+// At most this many PWM channels can be driven (one LEDC channel group).
+static const uint8_t LED_OUTPUT_MAX_CHANNELS = 8;
+// Channel gains are fixed point numbers: 0 = off, LED_OUTPUT_GAIN_ONE = the duty as given.
+static const uint8_t LED_OUTPUT_GAIN_BITS = 15;
+static const uint16_t LED_OUTPUT_GAIN_ONE = 1 << LED_OUTPUT_GAIN_BITS;
+
+// Drives the MOSFET(s) of the LED strip. All channels show the same duty, each scaled by its gain: segments of a long
+// strip all run at full gain, for a warm/cool white pair the gains set the mix.
+class LedOutputDriver
+{
+public:
+    // Called from interrupt context when a fade has ended, returns whether a higher priority task has been woken.
+    typedef bool (*FadeDoneCallback)();
+
+    LedOutputDriver(uint8_t channelCount);
+    virtual ~LedOutputDriver() {}
+
+    // Set up the hardware, returns false when this failed.
+    virtual bool begin() = 0;
+    // Set the duty of all channels at once.
+    virtual void write(uint16_t duty) = 0;
+    // Query the duty currently output (the unscaled duty, as given to write() or fade()).
+    virtual uint16_t read() = 0;
+    // Fade all channels from fromDuty to toDuty within durationMs, done gets called when the fade has ended.
+    // Returns false when the fade could not be started.
+    virtual bool fade(uint16_t fromDuty, uint16_t toDuty, uint16_t durationMs, FadeDoneCallback done) = 0;
+    // Stop a running fade, the duty stays at the value the fade has reached.
+    virtual void stopFade() = 0;
+
+    // Number of channels driven.
+    uint8_t channelCount() const { return _channelCount; }
+    // Set the gain (0 .. LED_OUTPUT_GAIN_ONE) of a channel, takes effect with the next write or fade.
+    void setGain(uint8_t channel, uint16_t gain);
+    // Query the gain of a channel.
+    uint16_t gain(uint8_t channel) const;
+
+protected:
+    // The duty a channel outputs for the (unscaled) duty.
+    uint16_t scale(uint8_t channel, uint16_t duty) const;
+    // The unscaled duty for the duty a channel outputs.
+    uint16_t unscale(uint8_t channel, uint32_t channelDuty) const;
+
+    uint8_t _channelCount;
+    uint8_t _referenceChannel; // The channel with the highest gain, its duty is the most precise one
+    uint16_t _gain[LED_OUTPUT_MAX_CHANNELS];
+};
+
+// Drives the channels by the LEDC peripheral. All channels share one timer, so their PWM periods are in phase. Each
+// channel takes a new duty at the start of its next period, the channels are updated one after the other, so for a
+// single period they may show the old and the new duty side by side. Fades run on the hardware fade units.
+class LedcOutputDriver : public LedOutputDriver
+{
+public:
+    LedcOutputDriver(const uint8_t *pins, uint8_t channelCount, uint32_t frequencyHz, uint8_t resolutionBits);
+
+    bool begin() override;
+    void write(uint16_t duty) override;
+    uint16_t read() override;
+    bool fade(uint16_t fromDuty, uint16_t toDuty, uint16_t durationMs, FadeDoneCallback done) override;
+    void stopFade() override;
+
+private:
+    const uint8_t *_pins;
+    uint32_t _frequencyHz;
+    uint8_t _resolutionBits;
+};
+
+// Stands in for the hardware, e.g. for running the fade engine without an LED strip. Time only passes when update()
+// is called, so fades are reproducible.
+class FakeOutputDriver : public LedOutputDriver
+{
+public:
+    FakeOutputDriver(uint8_t channelCount);
+
+    bool begin() override { return true; }
+    void write(uint16_t duty) override;
+    uint16_t read() override;
+    bool fade(uint16_t fromDuty, uint16_t toDuty, uint16_t durationMs, FadeDoneCallback done) override;
+    void stopFade() override;
+
+    // Let the time advance to nowMs, a fade ending until then calls its done callback.
+    void update(unsigned long nowMs);
+    // Query the duty a channel currently outputs.
+    uint16_t channelDuty(uint8_t channel) const;
+    // Number of writes and fades started so far.
+    uint32_t writeCount() const { return _writeCount; }
+    uint32_t fadeCount() const { return _fadeCount; }
+
+private:
+    uint16_t dutyAt(unsigned long nowMs) const;
+
+    unsigned long _nowMs = 0;
+    uint16_t _duty = 0;
+    bool _fading = false;
+    uint16_t _fadeFromDuty = 0;
+    uint16_t _fadeToDuty = 0;
+    unsigned long _fadeStartMs = 0;
+    uint16_t _fadeDurationMs = 0;
+    FadeDoneCallback _fadeDone = nullptr;
+    uint32_t _writeCount = 0;
+    uint32_t _fadeCount = 0;
+};
+
+#endif
@@ -2,21 +2,89 @@
 #define _LED_STRIP_H_
 
 #include <Arduino.h>
+#include <easing.h>
+#include <led_output.h>
+
+// The LED strip PWM runs at this resolution, so duties range from 0 to
+// LED_STRIP_MAX_DUTY.
+static const uint8_t LED_STRIP_RESOLUTION_BITS = 13;
+static const uint16_t LED_STRIP_MAX_DUTY = (1 << LED_STRIP_RESOLUTION_BITS) - 1;
+
+// Drive the LED strip by another output (e.g. a FakeOutputDriver), call before ledStripSetup(). By default the pins in
+// LED_STRIP_PINS are driven by the LEDC peripheral.
+void ledStripUseOutput(LedOutputDriver &output);
 
 void ledStripSetup();
 void ledStripLoop();
 
+// Whether the LED strip has reached its target and shows no signal, i.e. ledStripLoop() has nothing to do.
+bool ledStripIdle();
+
+// Switch the output off for a moment without changing the target (e.g. to let the LDR see the ambient light), and back
+// on. Only blanks while the LED strip is idle, returns whether the output is blanked now. A transition or signal
+// starting ends the blanking.
+bool ledStripBlank(bool blank);
+// Whether the output is blanked right now.
+bool ledStripBlanked();
+
 // Query the brightness the LED strip is supposed to have.
 uint8_t ledStripTargetBrightness();
 // Query the brightness the LED strip currently has.
 uint8_t ledStripCurrentBrightness();
 
-// Set a new target brightness value.
-void ledStripSetTargetBrightness(uint8_t brightness);
+// Set a new target brightness value, the transition to it follows curve.
+void ledStripSetTargetBrightness(uint8_t brightness, EasingCurve curve = EASE_LINEAR);
+
+// Query the PWM duty the LED strip is supposed to have (0 .. LED_STRIP_MAX_DUTY).
+uint16_t ledStripTargetDuty();
+// Query the PWM duty the LED strip currently has (0 .. LED_STRIP_MAX_DUTY).
+uint16_t ledStripCurrentDuty();
+// Set a new target PWM duty (0 .. LED_STRIP_MAX_DUTY). Unlike the brightness this is not mapped through the brightness curve.
+void ledStripSetTargetDuty(uint16_t duty, EasingCurve curve = EASE_LINEAR);
+
+// Convert a brightness (0..255) to the PWM duty it is displayed with.
+uint16_t ledStripBrightnessToDuty(uint8_t brightness);
+// Convert a PWM duty to the highest brightness (0..255) not exceeding it.
+uint8_t ledStripDutyToBrightness(uint16_t duty);
+// Brightness bands of the on time statistics: band i covers the brightness from LED_ENERGY_BAND_START[i] up to the
+// start of the next band.
+static const uint8_t LED_ENERGY_BAND_COUNT = 4;
+static const uint8_t LED_ENERGY_BAND_START[LED_ENERGY_BAND_COUNT] = {1, 64, 128, 192};
+
+// What the LED strip has delivered so far.
+struct LedStripEnergy
+{
+    uint64_t fineDutyMs = 0;                          // PWM duty (incl. the dithered fraction) integrated over time
+    uint64_t bandMs[LED_ENERGY_BAND_COUNT] = {0};     // Time spent on within each brightness band (ms)
+    uint32_t transitions = 0;                         // Number of brightness transitions started
+};
+
+// Query the energy counters of the LED strip.
+LedStripEnergy ledStripEnergy();
+// The hours the LED strip would have needed at full duty to emit the same light, multiply by the strip power for Wh.
+double ledStripFullOnHours(const LedStripEnergy &energy);
+
 // Set a new transistion durcation
 void ledStripSetTransitionDuration(uint16_t value);
 uint16_t ledStripGetTransitionDuration();
 
+// Signals the LED strip can show. Each one is a pattern of brightness steps, the strip returns to what it did before
+// when the pattern is done.
+enum LedSignal : uint8_t
+{
+    LED_SIGNAL_CONFIRM,               // two short off-on-pulses
+    LED_SIGNAL_CONFIRM_ON,            // LED_SIGNAL_CONFIRM followed by a brief "on" period
+    LED_SIGNAL_CONFIRM_OFF,           // LED_SIGNAL_CONFIRM followed by a short "off" period
+    LED_SIGNAL_SAVED,                 // a setting has been saved
+    LED_SIGNAL_AP_MODE,               // the device switches to access point mode
+    LED_SIGNAL_FACTORY_RESET_WARNING, // one more step and the device gets reset to factory settings
+    LED_SIGNAL_ERROR,                 // something went wrong
+    LED_SIGNAL_COUNT
+};
+
+// Shows a signal pattern via the LED strip. Ignored while another signal is shown.
+void ledStripSignal(LedSignal signal);
+
 // Gives a visual confirmation via the LED strip (two short off-on-pulses).
 // Can also visualize "on" or "off" after the two blinks. Set alsoConfirmState to true for this and set alsoConfirmState.
 // The latter controls whether it show a brief "on" period or a short "off" period.
@@ -7,8 +7,8 @@
     #define MAX_MQTT_USERNAME_LENGTH 12
     #define MAX_MQTT_PASSWORD_LENGTH 24
 
-    void modifyMqttServer(const String &value);
-    void modifyMqttUsername(const String &value);
-    void modifyMqttPassword(const String &value);
+    void modifyMqttServer(const char *value);
+    void modifyMqttUsername(const char *value);
+    void modifyMqttPassword(const char *value);
 
 #endif
\ No newline at end of file
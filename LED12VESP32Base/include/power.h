@@ -0,0 +1,42 @@
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include <Arduino.h>
+
+// The power states of the controller, from the most to the least power hungry
+enum PowerState : uint8_t
+{
+    POWER_FULL_SPEED,    // The CPU runs at full clock: a fade runs or a web request is being handled
+    POWER_REDUCED_SPEED, // The CPU may drop to POWER_MIN_FREQ_MHZ, but must not sleep: the lamp is on or someone is near
+    POWER_LIGHT_SLEEP,   // The lamp is off and nobody is around: the CPU may sleep between ticks
+    POWER_STATE_COUNT
+};
+
+static const int POWER_MAX_FREQ_MHZ = 240;
+static const int POWER_MIN_FREQ_MHZ = 80;
+// A web request keeps the CPU at full clock for this long
+static const uint32_t POWER_BOOST_MS = 500;
+
+// Tell which power state the lamp allows. busy: the LED strip is changing or a button is touched. idle: the lamp is
+// off and nobody is in the room. Call from the control task.
+void powerUpdate(bool busy, bool idle);
+// Keep the CPU at full clock for POWER_BOOST_MS, e.g. while handling a web request. Safe to call from any task.
+void powerBoost();
+// Schedule the end of a boost, call from the network task on each pass. There is no job while no boost is held.
+void powerLoop();
+
+// The power state currently allowed. Safe to call from any task.
+PowerState powerState();
+// Name of a power state as used in reports
+const char *powerStateName(PowerState state);
+// Time a power state has been allowed since power on. Whether the CPU actually slowed down or slept meanwhile is up
+// to the power management (other locks, e.g. of the WiFi driver, may keep it awake). Safe to call from any task.
+uint64_t powerAllowedMs(PowerState state);
+// Whether frequency scaling and automatic light sleep could be enabled (needs the power management in the SDK)
+bool powerScalingEnabled();
+bool powerLightSleepEnabled();
+
+void powerDebug(Stream &terminalStream);
+void powerSetup();
+
+#endif
@@ -40,8 +40,10 @@ bool isConnected();
 bool requestFactoryReset();
 
 void presenceDebug(Stream &terminalStream);
+// Read the radar data from another stream (e.g. recorded frames) instead of RADAR_SERIAL, call before presenceSetup().
+void presenceUseStream(Stream &radarStream);
 
+// Reads the radar periodically by a job of the control task, the data waits in the UART buffer until then
 void presenceSetup();
-void presenceLoop();
 
 #endif
\ No newline at end of file
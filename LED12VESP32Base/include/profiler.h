@@ -0,0 +1,85 @@
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+#include <Arduino.h>
+
+// Set to 0 (e.g. build_flags = -DDEVICE_PROFILER=0) to compile the profiler out, PROFILED() then only runs the call.
+#ifndef DEVICE_PROFILER
+#define DEVICE_PROFILER 1
+#endif
+
+// The parts of the control and the network loop that get timed
+enum ProfiledSection : uint8_t
+{
+    PROFILE_WIFI,
+    PROFILE_CONTROL_JOBS, // Jobs run by controlJobs (ldr, radar, preferences, ...)
+    PROFILE_NETWORK_JOBS, // Jobs run by networkJobs
+    PROFILE_TOUCH,
+    PROFILE_COMMANDS,
+    PROFILE_STATE,
+    PROFILE_LED_STRIP,
+    PROFILE_WEB_API,
+    PROFILE_WEB_INTERFACE,
+    PROFILE_LOOP, // One whole pass of the control loop, without the time spent waiting for events
+    PROFILE_SECTION_COUNT
+};
+
+// Histogram bucket b counts the runs taking [2^(b-1), 2^b) µs, bucket 0 the ones below 1 µs, the last one all longer runs
+static const uint8_t PROFILE_HISTOGRAM_BUCKETS = 20;
+
+struct ProfileStats
+{
+    uint32_t count;   // Number of runs
+    uint64_t totalUs; // Time spent in all runs
+    uint32_t maxUs;   // Time of the longest run
+    uint32_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+#if DEVICE_PROFILER
+
+// Start timing a stretch of code, the start gets kept in the local variable name
+#define PROFILE_START(name) uint32_t name = profilerCycles()
+// Account the time since PROFILE_START(name) to a section
+#define PROFILE_STOP(section, name) profilerRecord(section, name)
+// Time a call, e.g. PROFILED(PROFILE_WIFI, wifiLoop());
+#define PROFILED(section, call)               \
+    do                                        \
+    {                                         \
+        PROFILE_START(_profileStart);         \
+        call;                                 \
+        PROFILE_STOP(section, _profileStart); \
+    } while (0)
+
+// The CPU cycle counter, runs at the CPU clock and wraps around every few seconds.
+uint32_t profilerCycles();
+// Account the cycles since startCycles to a section. They get converted to µs at the clock the CPU runs at right now.
+void profilerRecord(ProfiledSection section, uint32_t startCycles);
+
+#else
+
+#define PROFILE_START(name)
+#define PROFILE_STOP(section, name)
+#define PROFILED(section, call) call
+
+#endif
+
+// Name of a section as used in reports
+const char *profiledSectionName(ProfiledSection section);
+// Copy of the statistics of a section, consistent when read from any task
+ProfileStats profilerStats(ProfiledSection section);
+// Loop passes per second, measured over the last report interval
+float profilerLoopRateHz();
+// Share of the time the control loop is busy (not waiting for events), 0 .. 1, over the last report interval
+float profilerLoad();
+// Forget all statistics: the control task does so when it closes the current measuring interval, a new one starts
+// from there. Safe to call from any task.
+void profilerReset();
+// Print all statistics as a table
+void profilerReport(Stream &terminalStream);
+
+// Print a report (including the jobs of the schedulers) to this stream periodically
+void profilerDebug(Stream &terminalStream);
+
+void profilerSetup();
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef _RULES_H_
+#define _RULES_H_
+
+#include <Arduino.h>
+
+// The conditions the night light rule combines. Each one is a node that only gets evaluated again when one of its
+// inputs has changed.
+enum RuleCondition : uint8_t
+{
+    RULE_ALLOWED,     // Night light mode is allowed (the manual lock: OFF button, web api)
+    RULE_DARK,        // The LDR value is within the band ldrMin .. night light threshold (+ hysteresis while dark)
+    RULE_PRESENCE,    // Presence detected within the configured distances and energies (the presence zone), debounced
+    RULE_TIME_WINDOW, // The time of day is within the window. Holds as long as the time of day is unknown.
+    RULE_CONDITION_COUNT
+};
+
+// Forces the night light on or off, regardless of the conditions. Not saved, gone after a restart.
+enum RuleOverride : uint8_t
+{
+    RULE_OVERRIDE_NONE,
+    RULE_OVERRIDE_ON,
+    RULE_OVERRIDE_OFF,
+    RULE_OVERRIDE_COUNT
+};
+
+static const uint16_t MINUTES_PER_DAY = 24 * 60;
+
+// The configurable part of the rule, saved as preference
+struct NightLightRule
+{
+    uint8_t conditions;      // Bit set of the RuleConditions that all have to hold for the night light to go on
+    uint16_t ldrMin;         // Lower edge of the LDR band, darker values do not count as dark (e.g. a covered sensor)
+    uint16_t windowStartMin; // Start of the time window, in minutes after midnight
+    uint16_t windowEndMin;   // End of the time window (exclusive), may be less than the start to span midnight
+};
+
+// Keeps the dark and presence conditions from flapping near the threshold or at the edge of the radar range. Saved as
+// preference along with the rule.
+struct NightLightGating
+{
+    uint16_t ldrHysteresis;      // Once dark, it stays dark up to the night light threshold + this
+    uint16_t darkDwellMs;        // The LDR has to be on the other side of the threshold for this long to change dark
+    uint16_t presenceDebounceMs; // The presence sensor has to agree for this long to change presence
+};
+
+// No gating: the conditions follow their inputs right away, as they did before the gating was there
+static const NightLightGating DEFAULT_NIGHT_LIGHT_GATING = {0, 0, 0};
+
+// Changes of the conditions that did not come through: they were held back by the hysteresis or went back within the
+// dwell time or debounce window
+struct RuleSuppressed
+{
+    uint32_t hysteresis;
+    uint32_t darkDwell;
+    uint32_t presenceDebounce;
+};
+
+// Bit of a condition in NightLightRule::conditions
+static inline uint8_t ruleBit(RuleCondition condition) { return 1 << condition; }
+
+static const NightLightRule DEFAULT_NIGHT_LIGHT_RULE = {
+    (uint8_t)(ruleBit(RULE_ALLOWED) | ruleBit(RULE_DARK) | ruleBit(RULE_PRESENCE)), 0, 0, MINUTES_PER_DAY};
+
+// Inputs, call from the control task. A node only gets marked for evaluation when an input actually changes.
+void rulesSetAllowed(bool allowed);
+void rulesSetLdr(uint16_t ldrValue, uint16_t nightLightThreshold);
+void rulesSetPresence(bool presenceDetected);
+void rulesSetOverride(RuleOverride value);
+// Tell the time of day (minutes after midnight), the clock keeps running from there
+void rulesSetTimeOfDay(uint16_t minuteOfDay);
+
+// Change the rule until the next restart
+void rulesSetConditions(uint8_t conditions);
+void rulesSetLdrMin(uint16_t value);
+void rulesSetWindowStart(uint16_t minuteOfDay);
+void rulesSetWindowEnd(uint16_t minuteOfDay);
+void rulesSetLdrHysteresis(uint16_t value);
+void rulesSetDarkDwellMs(uint16_t value);
+void rulesSetPresenceDebounceMs(uint16_t value);
+// Save the rule and its gating as they are now as preference
+void rulesSave();
+
+// Evaluate the nodes marked since the last call. Call on every pass of the control task after handing over the inputs,
+// whatever the state, so a pending dwell sees each change of its input. A pending dwell has a job wake the control
+// task when its time is up.
+void rulesUpdate();
+// Whether the night light should be switched on. Evaluates the nodes marked since the last call only.
+bool rulesNightLight();
+// Whether a night light that is on may stay on, presence timeout aside: the override and the conditions other than
+// dark (the night light itself brightens the room) and presence (that one has its own timeout) still hold.
+bool rulesKeepNightLight();
+// The debounced presence (RULE_PRESENCE), whether or not the rule requires it
+bool rulesPresence();
+
+// Reporting, as of the last evaluation
+NightLightRule rulesConfig();
+NightLightGating rulesGating();
+RuleSuppressed rulesSuppressed();
+RuleOverride rulesOverride();
+bool rulesCondition(RuleCondition condition);
+const char *ruleConditionName(RuleCondition condition);
+const char *ruleOverrideName(RuleOverride value);
+// Minutes after midnight, -1 when the time of day has not been told yet
+int16_t rulesTimeOfDay();
+// Number of node evaluations since power on
+uint32_t rulesEvaluations();
+
+// Load the rule from the preferences, call after configSetup()
+void rulesSetup();
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+#include <Arduino.h>
+
+// A job, called from the task owning the scheduler
+typedef void (*JobCallback)();
+typedef int8_t JobId;
+
+static const JobId NO_JOB = -1;
+// At most this many jobs per scheduler
+static const uint8_t MAX_JOBS = 12;
+
+// The timer wheel has 3 levels of 64 slots: 1 ms, 64 ms and 4.096 s per slot. Jobs further out than the last level
+// reaches (about 4.4 min) get placed at its end and move on when their slot comes up. A bit per slot marks the slots
+// holding jobs, so the next occupied slot of a level is found without looking at the empty ones.
+static const uint8_t WHEEL_LEVELS = 3;
+static const uint8_t WHEEL_SLOT_BITS = 6;
+static const uint8_t WHEEL_SLOTS = 1 << WHEEL_SLOT_BITS;
+
+struct JobStats
+{
+    const char *name;     // Name of the job as given when scheduling it
+    bool active;          // Whether the job is still scheduled
+    uint32_t periodMs;    // 0 for a one-shot job
+    uint32_t runs;        // Number of runs
+    uint32_t totalLateMs; // Sum of how late the runs started (jitter)
+    uint32_t maxLateMs;   // Latest start of a run
+    uint32_t overruns;    // Periods skipped because a run started later than the next one was due
+    uint32_t maxRunUs;    // Longest run
+};
+
+// Runs periodic and one-shot jobs of the modules in the task calling run(). Not thread safe: schedule jobs from the
+// owning task or before it starts. Only the statistics may be read from any task.
+class Scheduler
+{
+public:
+    Scheduler(const char *name);
+
+    // Run a job every periodMs, the first time after firstDelayMs. Returns NO_JOB when there is no room left.
+    JobId every(const char *name, uint32_t periodMs, JobCallback callback, uint32_t firstDelayMs = 0);
+    // Run a job once after delayMs. Returns NO_JOB when there is no room left.
+    JobId once(const char *name, uint32_t delayMs, JobCallback callback);
+    // Change the period of a job, takes effect from now on
+    void setPeriod(JobId job, uint32_t periodMs);
+    // Stop a job, its slot gets reused. A job may cancel itself.
+    void cancel(JobId job);
+
+    // Run all jobs due by now. Returns the time in ms until the next job is due.
+    uint32_t run();
+    // Time in ms until the next job is due, UINT32_MAX when there is none
+    uint32_t msUntilNextDue() const;
+
+    // Name of the scheduler as given to the constructor
+    const char *name() const { return _name; }
+    // Statistics of a job (0 .. MAX_JOBS - 1), consistent when read from any task
+    JobStats stats(JobId job) const;
+    // Print the statistics of all jobs as a table
+    void report(Stream &terminalStream) const;
+
+private:
+    struct Job
+    {
+        JobCallback callback;
+        uint32_t dueMs;
+        int8_t next;  // Next job in the same wheel slot
+        int8_t level; // Wheel level the job is linked into, -1 when it is not linked
+        uint8_t slot;
+        JobStats stats;
+    };
+
+    JobId add(const char *name, uint32_t periodMs, uint32_t delayMs, JobCallback callback);
+    void place(JobId job);
+    void unlink(JobId job);
+    void cascade(uint8_t level);
+    void fire(JobId job);
+    void tick();
+    uint8_t nextOccupied(uint8_t level) const;
+    bool nextEvent(uint32_t &eventMs) const;
+
+    const char *_name;
+    bool _started = false;
+    uint32_t _now = 0; // Wheel time: all slots up to this ms have been handled
+    Job _jobs[MAX_JOBS];
+    int8_t _slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t _occupied[WHEEL_LEVELS] = {0}; // Bit per slot holding jobs
+    // Guards the statistics of the jobs: the owning task updates them, any task reads
+    mutable portMUX_TYPE _statsMux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Jobs of the control task (sensors, preferences, LED strip)
+extern Scheduler controlJobs;
+// Jobs of the network task
+extern Scheduler networkJobs;
+
+#endif
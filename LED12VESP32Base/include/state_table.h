@@ -0,0 +1,199 @@
+#ifndef _STATE_TABLE_H_
+#define _STATE_TABLE_H_
+
+#include <stdint.h>
+
+// The behavior of the lamp as a table: for every state and every event it tells which action to run and which state
+// comes next. Plain data without Arduino dependencies, so it can be checked at compile time and enumerated anywhere.
+
+// The states the device may be in
+enum State : uint8_t
+{
+    OFF,                          // Light is off. Constantly checks whether condition for night light is met. This is the default state after power on.
+    START_TRANSIT_TO_ON,          // Initialize the transition to a new brightness (> 0). The new brightness is set in _targetBrightness. Next state is TRANSIT_TO_ON.
+    TRANSIT_TO_ON,                // Gradually increases or decreases the brightness to _targetBrightness, until _targetBrightness equals the actual brightness. The next state is then ON.
+    ON,                           // Light is on at the desired brightness. This state only changes by someone touch one of the touch buttons (or power loss).
+    START_TRANSIT_TO_OFF,         // Initialize the transition to OFF (brightness = 0). _targetBrightness is set t0 0. Next state is TRANSIT_TO_OFF.
+    TRANSIT_TO_OFF,               // Gradually decreases the brightness to 0 until the actual brightness is 0. The next state is then OFF.
+    START_TRANSIT_TO_NIGHT_LIGHT, // Initialize the transition to night light brightness. The new brightness is set in _targetBrightness. Next state is TRANSIT_TO_NIGHT_LIGHT.
+    TRANSIT_TO_NIGHT_LIGHT,       // Gradually increases or decreases the brightness to _targetBrightness, until _targetBrightness equals the actual brightness. The next state is then NIGHT_LIGHT_ON.
+    NIGHT_LIGHT_ON,               // Night light is on at night light brightness. Constantly checks whether condition for night light is still met. If not, next state is START_TRANSIT_TO_OFF.
+    STATE_COUNT
+};
+
+// What the state machine reacts to
+enum StateEvent : uint8_t
+{
+    STATE_EVENT_TICK,            // One pass of the control loop
+    STATE_EVENT_SWITCH_ON,       // ON button clicked or lamp switched on via web
+    STATE_EVENT_SWITCH_OFF,      // Lamp switched off via web
+    STATE_EVENT_OFF_CLICK,       // OFF button clicked
+    STATE_EVENT_PLUS,            // PLUS button clicked or held
+    STATE_EVENT_MINUS,           // MINUS button clicked or held
+    STATE_EVENT_SAVE_BRIGHTNESS, // ON button held: keep the current brightness as default
+    STATE_EVENT_COUNT
+};
+
+// The actions of the transitions. Each one returns whether the transition takes place (next state) or not (otherwise
+// state). The functions behind them live in device_state.cpp.
+enum StateAction : uint8_t
+{
+    ACTION_NONE,                     // Nothing to do, always takes place
+    ACTION_CHECK_NIGHT_LIGHT,        // Whether the night light is allowed, it is dark and someone is present
+    ACTION_NIGHT_LIGHT_EXPIRED,      // Whether the night light has to go off (not allowed or nobody present long enough)
+    ACTION_START_FADE_ON,            // Fade to the target brightness
+    ACTION_START_FADE_OFF,           // Fade to 0
+    ACTION_START_FADE_NIGHT_LIGHT,   // Fade to the night light brightness
+    ACTION_REACHED_ON,               // Whether the fade to the target brightness is done
+    ACTION_REACHED_OFF,              // Whether the fade to 0 is done
+    ACTION_REACHED_NIGHT_LIGHT,      // Whether the fade to the night light brightness is done
+    ACTION_SWITCH_ON,                // Target the on brightness
+    ACTION_TOGGLE_MAX_BRIGHTNESS,    // Toggle between the on and the maximum brightness
+    ACTION_ALLOW_NIGHT_LIGHT,        // Allow the night light mode again
+    ACTION_FORBID_NIGHT_LIGHT,       // Disallow the night light mode
+    ACTION_INCREASE_BRIGHTNESS,      // One step up, false at the maximum
+    ACTION_INCREASE_FROM_OFF,        // Switch on at one step, false when a brighter target is set already
+    ACTION_INCREASE_NIGHT_LIGHT,     // Night light one step up, false at the maximum
+    ACTION_DECREASE_BRIGHTNESS,      // One step down, false when that reaches off
+    ACTION_DECREASE_NIGHT_LIGHT,     // Night light one step down, false at the minimum or right after switching off
+    ACTION_IGNORE_ALREADY_OFF,       // Report that the lamp is off already, never takes place
+    ACTION_SAVE_ON_BRIGHTNESS,       // Save the brightness as on brightness
+    ACTION_SAVE_NIGHT_LIGHT,         // Save the brightness as night light brightness
+    STATE_ACTION_COUNT
+};
+
+struct StateTransition
+{
+    State state;      // The state this transition starts from, must match its row
+    StateEvent event; // The event it handles, must match its column
+    StateAction action;
+    State next;      // The new state when the action returns true
+    State otherwise; // The new state when the action returns false
+};
+
+// Transitions that don't change anything
+#define STAY(state, event) {state, event, ACTION_NONE, state, state}
+
+constexpr StateTransition STATE_TABLE[STATE_COUNT][STATE_EVENT_COUNT] = {
+    // OFF
+    {
+        {OFF, STATE_EVENT_TICK, ACTION_CHECK_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, OFF},
+        {OFF, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {OFF, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        {OFF, STATE_EVENT_OFF_CLICK, ACTION_ALLOW_NIGHT_LIGHT, OFF, OFF},
+        {OFF, STATE_EVENT_PLUS, ACTION_INCREASE_FROM_OFF, START_TRANSIT_TO_ON, OFF},
+        {OFF, STATE_EVENT_MINUS, ACTION_IGNORE_ALREADY_OFF, OFF, OFF},
+        STAY(OFF, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // START_TRANSIT_TO_ON
+    {
+        {START_TRANSIT_TO_ON, STATE_EVENT_TICK, ACTION_START_FADE_ON, TRANSIT_TO_ON, TRANSIT_TO_ON},
+        {START_TRANSIT_TO_ON, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {START_TRANSIT_TO_ON, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(START_TRANSIT_TO_ON, STATE_EVENT_OFF_CLICK),
+        {START_TRANSIT_TO_ON, STATE_EVENT_PLUS, ACTION_INCREASE_BRIGHTNESS, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {START_TRANSIT_TO_ON, STATE_EVENT_MINUS, ACTION_DECREASE_BRIGHTNESS, START_TRANSIT_TO_ON, START_TRANSIT_TO_OFF},
+        STAY(START_TRANSIT_TO_ON, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // TRANSIT_TO_ON
+    {
+        {TRANSIT_TO_ON, STATE_EVENT_TICK, ACTION_REACHED_ON, ON, TRANSIT_TO_ON},
+        {TRANSIT_TO_ON, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {TRANSIT_TO_ON, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(TRANSIT_TO_ON, STATE_EVENT_OFF_CLICK),
+        {TRANSIT_TO_ON, STATE_EVENT_PLUS, ACTION_INCREASE_BRIGHTNESS, START_TRANSIT_TO_ON, TRANSIT_TO_ON},
+        {TRANSIT_TO_ON, STATE_EVENT_MINUS, ACTION_DECREASE_BRIGHTNESS, START_TRANSIT_TO_ON, START_TRANSIT_TO_OFF},
+        STAY(TRANSIT_TO_ON, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // ON
+    {
+        STAY(ON, STATE_EVENT_TICK), // nothing to do, wait for a pressed button
+        {ON, STATE_EVENT_SWITCH_ON, ACTION_TOGGLE_MAX_BRIGHTNESS, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {ON, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        // "off" means night light when it is due
+        {ON, STATE_EVENT_OFF_CLICK, ACTION_CHECK_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, START_TRANSIT_TO_OFF},
+        {ON, STATE_EVENT_PLUS, ACTION_INCREASE_BRIGHTNESS, START_TRANSIT_TO_ON, ON},
+        {ON, STATE_EVENT_MINUS, ACTION_DECREASE_BRIGHTNESS, START_TRANSIT_TO_ON, START_TRANSIT_TO_OFF},
+        {ON, STATE_EVENT_SAVE_BRIGHTNESS, ACTION_SAVE_ON_BRIGHTNESS, ON, ON},
+    },
+    // START_TRANSIT_TO_OFF
+    {
+        {START_TRANSIT_TO_OFF, STATE_EVENT_TICK, ACTION_START_FADE_OFF, TRANSIT_TO_OFF, TRANSIT_TO_OFF},
+        {START_TRANSIT_TO_OFF, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        STAY(START_TRANSIT_TO_OFF, STATE_EVENT_SWITCH_OFF),
+        STAY(START_TRANSIT_TO_OFF, STATE_EVENT_OFF_CLICK),
+        {START_TRANSIT_TO_OFF, STATE_EVENT_PLUS, ACTION_INCREASE_FROM_OFF, START_TRANSIT_TO_ON, START_TRANSIT_TO_OFF},
+        {START_TRANSIT_TO_OFF, STATE_EVENT_MINUS, ACTION_IGNORE_ALREADY_OFF, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(START_TRANSIT_TO_OFF, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // TRANSIT_TO_OFF
+    {
+        {TRANSIT_TO_OFF, STATE_EVENT_TICK, ACTION_REACHED_OFF, OFF, TRANSIT_TO_OFF},
+        {TRANSIT_TO_OFF, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {TRANSIT_TO_OFF, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(TRANSIT_TO_OFF, STATE_EVENT_OFF_CLICK),
+        {TRANSIT_TO_OFF, STATE_EVENT_PLUS, ACTION_INCREASE_FROM_OFF, START_TRANSIT_TO_ON, TRANSIT_TO_OFF},
+        {TRANSIT_TO_OFF, STATE_EVENT_MINUS, ACTION_IGNORE_ALREADY_OFF, TRANSIT_TO_OFF, TRANSIT_TO_OFF},
+        STAY(TRANSIT_TO_OFF, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // START_TRANSIT_TO_NIGHT_LIGHT
+    {
+        {START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_TICK, ACTION_START_FADE_NIGHT_LIGHT, TRANSIT_TO_NIGHT_LIGHT, TRANSIT_TO_NIGHT_LIGHT},
+        {START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_OFF_CLICK),
+        {START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_PLUS, ACTION_INCREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT},
+        {START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_MINUS, ACTION_DECREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT},
+        STAY(START_TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // TRANSIT_TO_NIGHT_LIGHT
+    {
+        {TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_TICK, ACTION_REACHED_NIGHT_LIGHT, NIGHT_LIGHT_ON, TRANSIT_TO_NIGHT_LIGHT},
+        {TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        STAY(TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_OFF_CLICK),
+        {TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_PLUS, ACTION_INCREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, TRANSIT_TO_NIGHT_LIGHT},
+        {TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_MINUS, ACTION_DECREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, TRANSIT_TO_NIGHT_LIGHT},
+        STAY(TRANSIT_TO_NIGHT_LIGHT, STATE_EVENT_SAVE_BRIGHTNESS),
+    },
+    // NIGHT_LIGHT_ON
+    {
+        {NIGHT_LIGHT_ON, STATE_EVENT_TICK, ACTION_NIGHT_LIGHT_EXPIRED, START_TRANSIT_TO_OFF, NIGHT_LIGHT_ON},
+        {NIGHT_LIGHT_ON, STATE_EVENT_SWITCH_ON, ACTION_SWITCH_ON, START_TRANSIT_TO_ON, START_TRANSIT_TO_ON},
+        {NIGHT_LIGHT_ON, STATE_EVENT_SWITCH_OFF, ACTION_NONE, START_TRANSIT_TO_OFF, START_TRANSIT_TO_OFF},
+        // the next tick switches the night light off
+        {NIGHT_LIGHT_ON, STATE_EVENT_OFF_CLICK, ACTION_FORBID_NIGHT_LIGHT, NIGHT_LIGHT_ON, NIGHT_LIGHT_ON},
+        {NIGHT_LIGHT_ON, STATE_EVENT_PLUS, ACTION_INCREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, NIGHT_LIGHT_ON},
+        {NIGHT_LIGHT_ON, STATE_EVENT_MINUS, ACTION_DECREASE_NIGHT_LIGHT, START_TRANSIT_TO_NIGHT_LIGHT, NIGHT_LIGHT_ON},
+        {NIGHT_LIGHT_ON, STATE_EVENT_SAVE_BRIGHTNESS, ACTION_SAVE_NIGHT_LIGHT, NIGHT_LIGHT_ON, NIGHT_LIGHT_ON},
+    },
+};
+
+#undef STAY
+
+// The transition for a state and an event
+constexpr const StateTransition &stateTransition(State state, StateEvent event)
+{
+    return STATE_TABLE[state][event];
+}
+
+// Whether every cell of the table is filled in at its place and only refers to existing states and actions. A cell
+// left out gets zero initialized and so claims to be {OFF, STATE_EVENT_TICK}, which gets caught here as well.
+constexpr bool stateTableComplete()
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        for (uint8_t event = 0; event < STATE_EVENT_COUNT; event++)
+        {
+            const StateTransition &transition = STATE_TABLE[state][event];
+            if (transition.state != state || transition.event != event || transition.action >= STATE_ACTION_COUNT ||
+                transition.next >= STATE_COUNT || transition.otherwise >= STATE_COUNT)
+                return false;
+        }
+    }
+    return true;
+}
+
+static_assert(stateTableComplete(), "STATE_TABLE needs one transition per state and event, in the order of the enums");
+
+#endif
@@ -4,6 +4,8 @@
 #include <Arduino.h>
 
 typedef std::function<void(uint8_t)> TouchCallbackFunction;
+// Returns the level of a button (HIGH: touched)
+typedef uint8_t (*TouchStateFunction)();
 
 enum ButtonNumber
 {
@@ -18,9 +20,18 @@ void setDoubleClickHandler(const ButtonNumber button, const TouchCallbackFunctio
 void setTripleClickHandler(const ButtonNumber button, const TouchCallbackFunction &f);
 void setLongClickHandler(const ButtonNumber button, const TouchCallbackFunction &f);
 void setReleasedHandler(const ButtonNumber button, const TouchCallbackFunction &f);
+// Take the level of a button from elsewhere (e.g. scripted touches) instead of its pin, call before touchSetup(). Such
+// a button raises no interrupts, post EVENT_TOUCH when its level changes.
+void setStateFunction(const ButtonNumber button, TouchStateFunction f);
 
 void touchDebug(Stream &terminalStream);
 
+// Whether a button is pressed or has been recently, i.e. the buttons need to be polled closely
+bool touchActive();
+// Let a touch wake the controller from light sleep. The first touch disarms this again.
+void touchArmWakeup();
+void touchDisarmWakeup();
+
 void touchSetup();
 void touchLoop();
 
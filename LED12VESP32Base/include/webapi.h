@@ -7,8 +7,6 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 
-const uint8_t MAX_USERNAME_LENGTH = 8;
-
 void webApiDebug(Stream &terminalStream);
 
 AsyncWebServer& getWebServer();
@@ -61,14 +61,14 @@ void debugPrintModeResult(Stream *stream, ModeResult result, bool addPrintln = f
 void debugPrintWifiState(Stream *stream, WifiState state, bool addPrintln = false);
 void debugPrintWifiMode(Stream *stream, WifiMode mode, bool addPrintln = false);
 
-void modifyApPassphrase(const String &value);
-void modifyApSsid(const String &value);
-void modifyApIpAddress(const String &value);
-void modifyApIpNetmask(const String &value);
+void modifyApPassphrase(const char *value);
+void modifyApSsid(const char *value);
+void modifyApIpAddress(const char *value);
+void modifyApIpNetmask(const char *value);
 
-void modifyHostname(const String &value);
-void modifyStaPassphrase(const String &value);
-void modifyStaSsid(const String &value);
+void modifyHostname(const char *value);
+void modifyStaPassphrase(const char *value);
+void modifyStaSsid(const char *value);
 
 void requestAPMode();
 
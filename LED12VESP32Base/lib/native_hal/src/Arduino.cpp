@@ -0,0 +1,82 @@
+#include <Arduino.h>
+#include <native_hal.h>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+EspClass ESP;
+
+uint64_t _nativeMicros = 0;
+uint32_t _nativeRestarts = 0;
+bool _nativeMonitorOutput = true;
+
+unsigned long millis() { return (uint32_t)(_nativeMicros / 1000); }
+unsigned long micros() { return (uint32_t)_nativeMicros; }
+void delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+void nativeSetMillis(unsigned long ms) { _nativeMicros = (uint64_t)ms * 1000; }
+void nativeAdvanceMillis(unsigned long ms) { _nativeMicros += (uint64_t)ms * 1000; }
+void nativeAdvanceMicros(unsigned long us) { _nativeMicros += us; }
+
+void EspClass::restart() { _nativeRestarts++; }
+uint32_t nativeRestartCount() { return _nativeRestarts; }
+
+void nativeSetMonitorOutput(bool enabled) { _nativeMonitorOutput = enabled; }
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t written = 0;
+    while (written < size && write(buffer[written]) == 1)
+        written++;
+    return written;
+}
+
+size_t Print::print(long value, int base)
+{
+    if (base == DEC)
+        return printf("%ld", value);
+    return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+    char buffer[8 * sizeof(value) + 1];
+    char *digit = &buffer[sizeof(buffer) - 1];
+    *digit = '\0';
+    if (base < 2)
+        base = DEC;
+    do
+    {
+        uint8_t d = value % base;
+        *--digit = d < 10 ? '0' + d : 'A' + d - 10;
+        value /= base;
+    } while (value != 0);
+    return write(digit);
+}
+
+size_t Print::print(double value, int digits) { return printf("%.*f", digits, value); }
+
+size_t Print::printf(const char *format, ...)
+{
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length < 0)
+        return 0;
+    return write((const uint8_t *)buffer, (size_t)length < sizeof(buffer) ? length : sizeof(buffer) - 1);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (_uart != 0 || !_nativeMonitorOutput)
+        return 1;
+    return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (_uart != 0 || !_nativeMonitorOutput)
+        return size;
+    return fwrite(buffer, 1, size, stdout);
+}
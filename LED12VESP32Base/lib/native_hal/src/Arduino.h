@@ -0,0 +1,189 @@
+#ifndef _NATIVE_ARDUINO_H_
+#define _NATIVE_ARDUINO_H_
+
+// The part of the Arduino core the lamp logic uses, for running it on the build host. See native_hal.h for the
+// control over the fake clock, pins and drivers. Like on the ESP32 FreeRTOS comes along.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <functional>
+#include <string>
+
+#define IRAM_ATTR
+#define ARDUINO_ISR_ATTR
+#define PROGMEM
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define LED_BUILTIN 2
+#define digitalPinToInterrupt(pin) (pin)
+
+#define SERIAL_8N1 0x800001c
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+// Blocks the calling task like vTaskDelay(): the other tasks run meanwhile, the fake clock moves on
+void delay(uint32_t ms);
+
+// Levels and interrupts of the pins, set by the tests (native_hal.h)
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t value);
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// The ADC, calibrated. The continuous mode converts one burst per analogContinuousStart(), it is done after
+// conversions / sampling frequency.
+uint32_t analogReadMilliVolts(uint8_t pin);
+typedef struct
+{
+    uint8_t pin;
+    uint8_t channel;
+    int avg_read_raw;
+    int avg_read_mvolts;
+} adc_continuous_data_t;
+bool analogContinuous(const uint8_t pins[], size_t pinsCount, uint32_t conversionsPerPin, uint32_t samplingFreqHz,
+                      void (*userFunc)(void));
+bool analogContinuousStart();
+bool analogContinuousRead(adc_continuous_data_t **buffer, uint32_t timeoutMs);
+bool analogContinuousStop();
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// Only for debug output: it allocates
+class String
+{
+public:
+    String(const char *text = "") : _text(text == nullptr ? "" : text) {}
+    String(char c) : _text(1, c) {}
+    String(int value) : _text(std::to_string(value)) {}
+    String(unsigned int value) : _text(std::to_string(value)) {}
+    String(long value) : _text(std::to_string(value)) {}
+    String(unsigned long value) : _text(std::to_string(value)) {}
+
+    const char *c_str() const { return _text.c_str(); }
+    unsigned int length() const { return _text.length(); }
+    String &operator+=(const String &other)
+    {
+        _text += other._text;
+        return *this;
+    }
+    friend String operator+(const String &left, const String &right)
+    {
+        String result(left);
+        result += right;
+        return result;
+    }
+    bool operator==(const String &other) const { return _text == other._text; }
+
+private:
+    std::string _text;
+};
+
+class Print
+{
+public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *text) { return text == nullptr ? 0 : write((const uint8_t *)text, strlen(text)); }
+
+    size_t print(const char *text) { return write(text); }
+    size_t print(const __FlashStringHelper *text) { return write((const char *)text); }
+    size_t print(const String &text) { return write(text.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(double value, int digits = 2);
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    template <typename T>
+    size_t println(T value, int format) { return print(value, format) + println(); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    virtual void flush() {}
+};
+
+// UART 0 writes to stdout, the others lead nowhere. None of them receives anything.
+class HardwareSerial : public Stream
+{
+public:
+    HardwareSerial(uint8_t uart) : _uart(uart) {}
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {}
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+private:
+    uint8_t _uart;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+// An IPv4 address, stored in network order like the one of the ESP32 core
+class IPAddress
+{
+public:
+    IPAddress() : _address(0) {}
+    IPAddress(uint32_t address) : _address(address) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+        : _address((uint32_t)a | (uint32_t)b << 8 | (uint32_t)c << 16 | (uint32_t)d << 24)
+    {
+    }
+    operator uint32_t() const { return _address; }
+
+private:
+    uint32_t _address;
+};
+
+class EspClass
+{
+public:
+    // Only counted, see nativeRestartCount()
+    void restart();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _NATIVE_ASYNCTCP_H_
+#define _NATIVE_ASYNCTCP_H_
+
+#include <Arduino.h>
+
+// Nothing of the network runs here, see native_network.cpp
+
+#endif
@@ -0,0 +1,114 @@
+#include <Button2.h>
+
+int Button2::_nextID = 0;
+
+Button2::Button2() : _id(_nextID++) {}
+
+void Button2::begin(uint8_t attachTo, uint8_t buttonMode, bool activeLow)
+{
+    _pin = attachTo;
+    _pressedState = activeLow ? LOW : HIGH;
+    _longClickCounter = 0;
+    _retriggerable = false;
+    if (attachTo != BTN_VIRTUAL_PIN)
+        pinMode(attachTo, buttonMode);
+    _begun = true;
+    _state = readState();
+    _previousState = _state;
+}
+
+uint8_t Button2::readState()
+{
+    if (_stateFunction != nullptr)
+        return _stateFunction();
+    return _pin == BTN_VIRTUAL_PIN ? !_pressedState : digitalRead(_pin);
+}
+
+void Button2::loop()
+{
+    if (!_begun)
+        return;
+    unsigned long now = millis();
+    _previousState = _state;
+    _state = readState();
+
+    if (_state == _pressedState)
+    {
+        if (_previousState != _pressedState)
+        {
+            // just pressed
+            _downMs = now;
+            _pressedTriggered = false;
+            _clickMs = now;
+        }
+        else if (!_pressedTriggered && now - _downMs >= _debounceMs)
+        {
+            _pressedTriggered = true;
+            _clickCount++;
+            if (_pressed)
+                _pressed(*this);
+        }
+        if (_longClickDetectedHandler)
+        {
+            unsigned long heldMs = now - _downMs;
+            if (_retriggerable ? heldMs >= (unsigned long)_longClickMs * (_longClickCounter + 1)
+                               : !_longClickReported && heldMs >= _longClickMs)
+            {
+                _longClickReported = true;
+                _longClickCounter++;
+                _longClickDetectedHandler(*this);
+            }
+        }
+        return;
+    }
+
+    if (_previousState == _pressedState)
+    {
+        // just released
+        unsigned long heldMs = now - _downMs;
+        if (heldMs >= _debounceMs)
+        {
+            if (_released)
+                _released(*this);
+            if (heldMs >= _longClickMs)
+                _longClick = true;
+        }
+    }
+    else if (_clickCount > 0 && now - _clickMs > _doubleClickMs)
+    {
+        // the series of clicks is over
+        _lastClickCount = _clickCount;
+        if (_longClick)
+        {
+            if (_clickCount == 1)
+            {
+                _lastClickType = long_click;
+                if (_longClickHandler)
+                    _longClickHandler(*this);
+            }
+        }
+        else if (_clickCount == 1)
+        {
+            _lastClickType = single_click;
+            if (_click)
+                _click(*this);
+        }
+        else if (_clickCount == 2)
+        {
+            _lastClickType = double_click;
+            if (_doubleClick)
+                _doubleClick(*this);
+        }
+        else if (_clickCount == 3)
+        {
+            _lastClickType = triple_click;
+            if (_tripleClick)
+                _tripleClick(*this);
+        }
+        _clickCount = 0;
+        _clickMs = 0;
+        _longClick = false;
+        _longClickReported = false;
+        _longClickCounter = 0;
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef _NATIVE_BUTTON2_H_
+#define _NATIVE_BUTTON2_H_
+
+#include <Arduino.h>
+
+// The Button2 library (2.3) as far as the lamp uses it, with its timing: debounced presses, single, double and triple
+// clicks once the double click time has passed after the last press, long clicks detected while still pressed
+// (retriggerable once per long click time) and reported on release. Buttons are polled by loop().
+
+#define BTN_VIRTUAL_PIN 254
+#define BTN_DEBOUNCE_MS 50
+#define BTN_LONGCLICK_MS 200
+#define BTN_DOUBLECLICK_MS 300
+
+enum clickType
+{
+    single_click,
+    double_click,
+    triple_click,
+    long_click,
+    empty
+};
+
+class Button2
+{
+public:
+    typedef std::function<void(Button2 &btn)> CallbackFunction;
+    typedef uint8_t (*StateCallbackFunction)();
+
+    Button2();
+    // A pin, or BTN_VIRTUAL_PIN with a state function. Pressed is LOW when activeLow.
+    void begin(uint8_t attachTo, uint8_t buttonMode = INPUT_PULLUP, bool activeLow = true);
+    void setButtonStateFunction(StateCallbackFunction function) { _stateFunction = function; }
+
+    void setDebounceTime(unsigned int ms) { _debounceMs = ms; }
+    void setLongClickTime(unsigned int ms) { _longClickMs = ms; }
+    void setDoubleClickTime(unsigned int ms) { _doubleClickMs = ms; }
+    unsigned int getDebounceTime() const { return _debounceMs; }
+    unsigned int getLongClickTime() const { return _longClickMs; }
+    unsigned int getDoubleClickTime() const { return _doubleClickMs; }
+
+    void setPressedHandler(CallbackFunction f) { _pressed = f; }
+    void setReleasedHandler(CallbackFunction f) { _released = f; }
+    void setClickHandler(CallbackFunction f) { _click = f; }
+    void setDoubleClickHandler(CallbackFunction f) { _doubleClick = f; }
+    void setTripleClickHandler(CallbackFunction f) { _tripleClick = f; }
+    void setLongClickHandler(CallbackFunction f) { _longClickHandler = f; }
+    void setLongClickDetectedHandler(CallbackFunction f) { _longClickDetectedHandler = f; }
+    void setLongClickDetectedRetriggerable(bool retriggerable) { _retriggerable = retriggerable; }
+
+    bool isPressed() const { return _state == _pressedState; }
+    uint8_t getNumberOfClicks() const { return _lastClickCount; }
+    clickType getType() const { return _lastClickType; }
+    int getID() const { return _id; }
+    void setID(int newID) { _id = newID; }
+
+    void loop();
+
+private:
+    uint8_t readState();
+
+    static int _nextID;
+
+    int _id;
+    uint8_t _pin = BTN_VIRTUAL_PIN;
+    bool _begun = false;
+    uint8_t _pressedState = LOW;
+    StateCallbackFunction _stateFunction = nullptr;
+    unsigned int _debounceMs = BTN_DEBOUNCE_MS;
+    unsigned int _longClickMs = BTN_LONGCLICK_MS;
+    unsigned int _doubleClickMs = BTN_DOUBLECLICK_MS;
+
+    uint8_t _state = HIGH;
+    uint8_t _previousState = HIGH;
+    unsigned long _downMs = 0;  // When the current press started
+    unsigned long _clickMs = 0; // When the last press of a series started
+    bool _pressedTriggered = false;
+    uint8_t _clickCount = 0;
+    bool _longClick = false;          // The current series was a long click
+    bool _longClickReported = false;
+    uint16_t _longClickCounter = 0;
+    bool _retriggerable = false;
+    uint8_t _lastClickCount = 0;
+    clickType _lastClickType = empty;
+
+    CallbackFunction _pressed;
+    CallbackFunction _released;
+    CallbackFunction _click;
+    CallbackFunction _doubleClick;
+    CallbackFunction _tripleClick;
+    CallbackFunction _longClickHandler;
+    CallbackFunction _longClickDetectedHandler;
+};
+
+#endif
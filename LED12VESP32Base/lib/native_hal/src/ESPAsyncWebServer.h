@@ -0,0 +1,9 @@
+#ifndef _NATIVE_ESPASYNCWEBSERVER_H_
+#define _NATIVE_ESPASYNCWEBSERVER_H_
+
+#include <Arduino.h>
+
+// Only named: nothing of the network runs here, see native_network.cpp
+class AsyncWebServer;
+
+#endif
@@ -0,0 +1,132 @@
+#include <Preferences.h>
+#include <nvs_flash.h>
+
+struct NativePreference
+{
+    char key[Preferences::MAX_KEY_LENGTH + 1];
+    uint8_t type; // 0: entry unused
+    uint16_t length;
+    uint8_t value[Preferences::MAX_VALUE_LENGTH];
+};
+
+NativePreference _nativePreferences[Preferences::MAX_ENTRIES];
+uint32_t _nativePreferenceWrites = 0;
+
+NativePreference *findEntry(const char *key)
+{
+    if (key == nullptr)
+        return nullptr;
+    for (uint8_t i = 0; i < Preferences::MAX_ENTRIES; i++)
+    {
+        if (_nativePreferences[i].type != 0 && strcmp(_nativePreferences[i].key, key) == 0)
+            return &_nativePreferences[i];
+    }
+    return nullptr;
+}
+
+bool Preferences::begin(const char *name, bool readOnly)
+{
+    _started = true;
+    _readOnly = readOnly;
+    return true;
+}
+
+bool Preferences::clear()
+{
+    if (!_started || _readOnly)
+        return false;
+    nvs_flash_erase();
+    return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+    NativePreference *entry = findEntry(key);
+    if (!_started || _readOnly || entry == nullptr)
+        return false;
+    entry->type = TYPE_NONE;
+    return true;
+}
+
+bool Preferences::isKey(const char *key) { return _started && findEntry(key) != nullptr; }
+
+size_t Preferences::put(const char *key, Type type, const void *value, size_t length)
+{
+    if (!_started || _readOnly || key == nullptr || strlen(key) > MAX_KEY_LENGTH || length > MAX_VALUE_LENGTH)
+        return 0;
+    NativePreference *entry = findEntry(key);
+    for (uint8_t i = 0; entry == nullptr && i < MAX_ENTRIES; i++)
+    {
+        if (_nativePreferences[i].type == TYPE_NONE)
+            entry = &_nativePreferences[i];
+    }
+    if (entry == nullptr)
+        return 0; // full, like a full NVS partition
+    strcpy(entry->key, key);
+    entry->type = type;
+    entry->length = length;
+    memcpy(entry->value, value, length);
+    _nativePreferenceWrites++;
+    return length;
+}
+
+const void *Preferences::find(const char *key, Type type, size_t &length)
+{
+    NativePreference *entry = _started ? findEntry(key) : nullptr;
+    if (entry == nullptr || entry->type != type)
+        return nullptr;
+    length = entry->length;
+    return entry->value;
+}
+
+size_t Preferences::putString(const char *key, const char *value)
+{
+    if (value == nullptr)
+        return 0;
+    size_t length = strlen(value);
+    return put(key, TYPE_STRING, value, length + 1) == 0 ? 0 : length;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length)
+{
+    if (value == nullptr || length == 0)
+        return 0;
+    return put(key, TYPE_BLOB, value, length);
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen)
+{
+    size_t length;
+    const void *stored = find(key, TYPE_STRING, length);
+    if (stored == nullptr || value == nullptr || length > maxLen)
+        return 0;
+    memcpy(value, stored, length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+    size_t length;
+    return find(key, TYPE_BLOB, length) == nullptr ? 0 : length;
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLen)
+{
+    size_t length;
+    const void *stored = find(key, TYPE_BLOB, length);
+    if (stored == nullptr || buffer == nullptr || length > maxLen)
+        return 0;
+    memcpy(buffer, stored, length);
+    return length;
+}
+
+uint32_t Preferences::writeCount() { return _nativePreferenceWrites; }
+
+esp_err_t nvs_flash_erase()
+{
+    memset(_nativePreferences, 0, sizeof(_nativePreferences));
+    _nativePreferenceWrites = 0;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_init() { return ESP_OK; }
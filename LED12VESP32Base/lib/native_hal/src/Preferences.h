@@ -0,0 +1,83 @@
+#ifndef _NATIVE_PREFERENCES_H_
+#define _NATIVE_PREFERENCES_H_
+
+#include <Arduino.h>
+
+// The preferences of the ESP32 core on a fixed table in memory, no heap. All namespaces share the table. Values keep
+// their type like in the NVS: a getter of another type than the value was put with returns its default.
+class Preferences
+{
+public:
+    static const uint8_t MAX_ENTRIES = 64;
+    static const uint8_t MAX_KEY_LENGTH = 15;
+    static const uint16_t MAX_VALUE_LENGTH = 128;
+
+    bool begin(const char *name, bool readOnly = false);
+    void end() {}
+    bool clear();
+    bool remove(const char *key);
+    bool isKey(const char *key);
+
+    size_t putChar(const char *key, int8_t value) { return put(key, TYPE_I8, &value, sizeof(value)); }
+    size_t putUChar(const char *key, uint8_t value) { return put(key, TYPE_U8, &value, sizeof(value)); }
+    size_t putShort(const char *key, int16_t value) { return put(key, TYPE_I16, &value, sizeof(value)); }
+    size_t putUShort(const char *key, uint16_t value) { return put(key, TYPE_U16, &value, sizeof(value)); }
+    size_t putInt(const char *key, int32_t value) { return put(key, TYPE_I32, &value, sizeof(value)); }
+    size_t putUInt(const char *key, uint32_t value) { return put(key, TYPE_U32, &value, sizeof(value)); }
+    size_t putLong(const char *key, int32_t value) { return putInt(key, value); }
+    size_t putULong(const char *key, uint32_t value) { return putUInt(key, value); }
+    size_t putBool(const char *key, bool value) { return putUChar(key, value ? 1 : 0); }
+    size_t putString(const char *key, const char *value);
+    size_t putBytes(const char *key, const void *value, size_t length);
+
+    int8_t getChar(const char *key, int8_t defaultValue = 0) { return get(key, TYPE_I8, defaultValue); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return get(key, TYPE_U8, defaultValue); }
+    int16_t getShort(const char *key, int16_t defaultValue = 0) { return get(key, TYPE_I16, defaultValue); }
+    uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return get(key, TYPE_U16, defaultValue); }
+    int32_t getInt(const char *key, int32_t defaultValue = 0) { return get(key, TYPE_I32, defaultValue); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0) { return get(key, TYPE_U32, defaultValue); }
+    int32_t getLong(const char *key, int32_t defaultValue = 0) { return getInt(key, defaultValue); }
+    uint32_t getULong(const char *key, uint32_t defaultValue = 0) { return getUInt(key, defaultValue); }
+    bool getBool(const char *key, bool defaultValue = false) { return getUChar(key, defaultValue ? 1 : 0) != 0; }
+    // Like the ESP32 core: the length including the terminating 0, 0 when the value does not fit maxLen
+    size_t getString(const char *key, char *value, size_t maxLen);
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buffer, size_t maxLen);
+
+    // Number of writes since the last clear, to see whether unchanged values get written again
+    static uint32_t writeCount();
+
+private:
+    enum Type : uint8_t
+    {
+        TYPE_NONE,
+        TYPE_I8,
+        TYPE_U8,
+        TYPE_I16,
+        TYPE_U16,
+        TYPE_I32,
+        TYPE_U32,
+        TYPE_STRING,
+        TYPE_BLOB
+    };
+
+    size_t put(const char *key, Type type, const void *value, size_t length);
+    const void *find(const char *key, Type type, size_t &length);
+
+    template <typename T>
+    T get(const char *key, Type type, T defaultValue)
+    {
+        size_t length;
+        const void *value = find(key, type, length);
+        if (value == nullptr || length != sizeof(T))
+            return defaultValue;
+        T result;
+        memcpy(&result, value, sizeof(T));
+        return result;
+    }
+
+    bool _started = false;
+    bool _readOnly = false;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef _NATIVE_DRIVER_GPIO_H_
+#define _NATIVE_DRIVER_GPIO_H_
+
+#include <esp_err.h>
+
+typedef int gpio_num_t;
+
+typedef enum
+{
+    GPIO_INTR_DISABLE,
+    GPIO_INTR_POSEDGE,
+    GPIO_INTR_NEGEDGE,
+    GPIO_INTR_ANYEDGE,
+    GPIO_INTR_LOW_LEVEL,
+    GPIO_INTR_HIGH_LEVEL
+} gpio_int_type_t;
+
+// The pin interrupts stay as attachInterrupt() set them: edges only, light sleep never happens
+inline esp_err_t gpio_set_intr_type(gpio_num_t gpioNum, gpio_int_type_t intrType) { return ESP_OK; }
+inline esp_err_t gpio_wakeup_enable(gpio_num_t gpioNum, gpio_int_type_t intrType) { return ESP_OK; }
+inline esp_err_t gpio_wakeup_disable(gpio_num_t gpioNum) { return ESP_OK; }
+
+#endif
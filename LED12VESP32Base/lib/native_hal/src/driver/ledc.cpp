@@ -0,0 +1,213 @@
+#include <driver/ledc.h>
+#include <native_hal.h>
+#include <native_interrupts.h>
+#include <string.h>
+
+struct NativeLedc
+{
+    NativeLedcChannel channel;
+    uint32_t pendingDuty; // Set by ledc_set_duty(), output with ledc_update_duty()
+    uint32_t fadeFrom;    // The duty the running fade started at
+    uint64_t fadeStartUs;
+    uint64_t fadeEndUs;
+    ledc_cb_t callback;
+    void *userArg;
+};
+
+NativeLedc _nativeLedc[LEDC_CHANNEL_MAX];
+bool _nativeTimerConfigured = false;
+bool _nativeFadeInstalled = false;
+
+static bool validChannel(ledc_mode_t speedMode, ledc_channel_t channel)
+{
+    return speedMode < LEDC_SPEED_MODE_MAX && channel < LEDC_CHANNEL_MAX && _nativeLedc[channel].channel.configured;
+}
+
+// The fade of a channel has ended at its duty, tell the callback (from "interrupt context")
+static void reportFadeEnd(ledc_mode_t speedMode, uint8_t channel)
+{
+    NativeLedc &ledc = _nativeLedc[channel];
+    if (!_nativeFadeInstalled || ledc.callback == nullptr)
+        return;
+    ledc_cb_param_t param = {LEDC_FADE_END_EVT, (uint32_t)speedMode, channel, ledc.channel.duty};
+    ledc.channel.fadeEndsCalled++;
+    ledc.callback(&param, ledc.userArg);
+}
+
+// The duty a channel outputs right now, part way through a running fade
+static uint32_t currentDuty(const NativeLedc &ledc)
+{
+    const NativeLedcChannel &state = ledc.channel;
+    if (!state.fading || ledc.fadeEndUs <= ledc.fadeStartUs)
+        return state.duty;
+    if (_nativeMicros >= ledc.fadeEndUs)
+        return state.fadeTarget;
+    int64_t gap = (int64_t)state.fadeTarget - (int64_t)ledc.fadeFrom;
+    return (uint32_t)((int64_t)ledc.fadeFrom + gap * (int64_t)(_nativeMicros - ledc.fadeStartUs) /
+                                                 (int64_t)(ledc.fadeEndUs - ledc.fadeStartUs));
+}
+
+// The fade of a channel has reached its target
+static void endFade(uint8_t channel)
+{
+    NativeLedcChannel &state = _nativeLedc[channel].channel;
+    state.duty = state.fadeTarget;
+    state.fading = false;
+    reportFadeEnd(LEDC_LOW_SPEED_MODE, channel);
+}
+
+esp_err_t ledc_timer_config(const ledc_timer_config_t *timer_conf)
+{
+    if (timer_conf == nullptr || timer_conf->duty_resolution < 1 || timer_conf->duty_resolution > 20 ||
+        timer_conf->freq_hz == 0)
+        return ESP_ERR_INVALID_ARG;
+    _nativeTimerConfigured = true;
+    return ESP_OK;
+}
+
+esp_err_t ledc_channel_config(const ledc_channel_config_t *ledc_conf)
+{
+    if (ledc_conf == nullptr || ledc_conf->channel >= LEDC_CHANNEL_MAX || !_nativeTimerConfigured)
+        return ESP_ERR_INVALID_ARG;
+    NativeLedc &ledc = _nativeLedc[ledc_conf->channel];
+    ledc.channel = {};
+    ledc.channel.configured = true;
+    ledc.channel.duty = ledc_conf->duty;
+    ledc.pendingDuty = ledc_conf->duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    if (_nativeFadeInstalled)
+        return ESP_ERR_INVALID_STATE;
+    _nativeFadeInstalled = true;
+    return ESP_OK;
+}
+
+esp_err_t ledc_cb_register(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_cbs_t *cbs, void *user_arg)
+{
+    if (!validChannel(speed_mode, channel) || cbs == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    _nativeLedc[channel].callback = cbs->fade_cb;
+    _nativeLedc[channel].userArg = user_arg;
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_duty(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty)
+{
+    if (!validChannel(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+    _nativeLedc[channel].pendingDuty = duty;
+    return ESP_OK;
+}
+
+esp_err_t ledc_update_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (!validChannel(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+    NativeLedc &ledc = _nativeLedc[channel];
+    ledc.channel.duty = ledc.pendingDuty;
+    ledc.channel.fading = false;
+    ledc.channel.updates++;
+    return ESP_OK;
+}
+
+uint32_t ledc_get_duty(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    return validChannel(speed_mode, channel) ? currentDuty(_nativeLedc[channel]) : 0;
+}
+
+esp_err_t ledc_set_duty_and_update(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t duty, uint32_t hpoint)
+{
+    if (!validChannel(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+    NativeLedc &ledc = _nativeLedc[channel];
+    ledc.pendingDuty = duty;
+    ledc.channel.duty = duty;
+    ledc.channel.fading = false;
+    ledc.channel.updates++;
+    // the IDF sets the duty by a fade of one step, its end gets reported as well
+    reportFadeEnd(speed_mode, channel);
+    return ESP_OK;
+}
+
+esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty,
+                                  int max_fade_time_ms)
+{
+    if (!validChannel(speed_mode, channel) || !_nativeFadeInstalled || max_fade_time_ms < 0)
+        return ESP_ERR_INVALID_ARG;
+    _nativeLedc[channel].channel.fadeTarget = target_duty;
+    _nativeLedc[channel].channel.fadeMs = max_fade_time_ms;
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode)
+{
+    if (!validChannel(speed_mode, channel) || !_nativeFadeInstalled)
+        return ESP_ERR_INVALID_ARG;
+    NativeLedc &ledc = _nativeLedc[channel];
+    ledc.fadeFrom = currentDuty(ledc);
+    ledc.channel.duty = ledc.fadeFrom;
+    ledc.fadeStartUs = _nativeMicros;
+    ledc.fadeEndUs = _nativeMicros + (uint64_t)ledc.channel.fadeMs * 1000;
+    ledc.channel.fading = true;
+    ledc.channel.fadeStarts++;
+    if (fade_mode == LEDC_FADE_WAIT_DONE)
+    {
+        ledc.channel.duty = ledc.channel.fadeTarget;
+        ledc.channel.fading = false;
+        reportFadeEnd(speed_mode, channel);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ledc_fade_stop(ledc_mode_t speed_mode, ledc_channel_t channel)
+{
+    if (!validChannel(speed_mode, channel))
+        return ESP_ERR_INVALID_ARG;
+    // the duty stays where the fade has got to
+    NativeLedc &ledc = _nativeLedc[channel];
+    ledc.channel.duty = currentDuty(ledc);
+    ledc.channel.fading = false;
+    return ESP_OK;
+}
+
+NativeLedcChannel nativeLedcChannel(uint8_t channel)
+{
+    if (channel >= LEDC_CHANNEL_MAX)
+        return NativeLedcChannel{};
+    NativeLedcChannel state = _nativeLedc[channel].channel;
+    state.duty = currentDuty(_nativeLedc[channel]);
+    return state;
+}
+
+void nativeLedcEndFades()
+{
+    for (uint8_t channel = 0; channel < LEDC_CHANNEL_MAX; channel++)
+        if (_nativeLedc[channel].channel.fading)
+            endFade(channel);
+}
+
+uint64_t nativeLedcDueUs()
+{
+    uint64_t dueUs = NATIVE_NEVER;
+    for (const NativeLedc &ledc : _nativeLedc)
+        if (ledc.channel.fading && ledc.fadeEndUs < dueUs)
+            dueUs = ledc.fadeEndUs;
+    return dueUs;
+}
+
+void nativeLedcFire()
+{
+    for (uint8_t channel = 0; channel < LEDC_CHANNEL_MAX; channel++)
+        if (_nativeLedc[channel].channel.fading && _nativeLedc[channel].fadeEndUs <= _nativeMicros)
+            endFade(channel);
+}
+
+void nativeLedcReset()
+{
+    memset(_nativeLedc, 0, sizeof(_nativeLedc));
+    _nativeTimerConfigured = false;
+    _nativeFadeInstalled = false;
+}
@@ -0,0 +1,16 @@
+#ifndef _NATIVE_DRIVER_UART_H_
+#define _NATIVE_DRIVER_UART_H_
+
+#include <esp_err.h>
+
+typedef enum
+{
+    UART_NUM_0,
+    UART_NUM_1,
+    UART_NUM_2
+} uart_port_t;
+
+// Only matters for waking up from light sleep
+inline esp_err_t uart_set_wakeup_threshold(uart_port_t uartNum, int wakeupThreshold) { return ESP_OK; }
+
+#endif
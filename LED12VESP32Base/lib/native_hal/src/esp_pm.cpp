@@ -0,0 +1,41 @@
+#include <esp_pm.h>
+
+struct NativePmLock
+{
+    esp_pm_lock_type_t type;
+    uint32_t holds;
+};
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lockType, int arg, const char *name, esp_pm_lock_handle_t *outHandle)
+{
+    if (outHandle == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    // like the IDF, the locks live until deleted, which the lamp never does
+    *outHandle = new NativePmLock{lockType, 0};
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle)
+{
+    if (handle == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    handle->holds++;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle)
+{
+    if (handle == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    if (handle->holds == 0)
+        return ESP_ERR_INVALID_STATE;
+    handle->holds--;
+    return ESP_OK;
+}
+
+esp_err_t esp_pm_configure(const void *config)
+{
+    if (config == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    return ((const esp_pm_config_t *)config)->light_sleep_enable ? ESP_ERR_NOT_SUPPORTED : ESP_OK;
+}
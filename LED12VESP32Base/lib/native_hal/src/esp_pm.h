@@ -0,0 +1,33 @@
+#ifndef _NATIVE_ESP_PM_H_
+#define _NATIVE_ESP_PM_H_
+
+#include <esp_err.h>
+#include <stdint.h>
+
+// Power management locks and configuration. The locks count their holds and do nothing else. Automatic light sleep
+// is refused as by the Arduino core, which is built without tickless idle; frequency scaling is accepted.
+
+typedef enum
+{
+    ESP_PM_CPU_FREQ_MAX,
+    ESP_PM_APB_FREQ_MAX,
+    ESP_PM_NO_LIGHT_SLEEP
+} esp_pm_lock_type_t;
+
+struct NativePmLock;
+typedef NativePmLock *esp_pm_lock_handle_t;
+
+typedef struct
+{
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_t;
+
+esp_err_t esp_pm_lock_create(esp_pm_lock_type_t lockType, int arg, const char *name, esp_pm_lock_handle_t *outHandle);
+esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t handle);
+// ESP_ERR_INVALID_STATE when not held
+esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t handle);
+esp_err_t esp_pm_configure(const void *config);
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef _NATIVE_ESP_SLEEP_H_
+#define _NATIVE_ESP_SLEEP_H_
+
+#include <esp_err.h>
+
+// The wakeup sources of light sleep, which never happens here
+inline esp_err_t esp_sleep_enable_gpio_wakeup() { return ESP_OK; }
+inline esp_err_t esp_sleep_enable_uart_wakeup(int uartNum) { return ESP_OK; }
+
+#endif
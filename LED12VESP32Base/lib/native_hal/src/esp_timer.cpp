@@ -0,0 +1,99 @@
+#include <esp_timer.h>
+#include <native_interrupts.h>
+#include <stddef.h>
+#include <vector>
+
+struct esp_timer
+{
+    esp_timer_create_args_t args;
+    bool active;
+    uint64_t periodUs; // 0: once
+    uint64_t dueUs;
+};
+
+// Deleted timers stay in the list, inactive
+static std::vector<esp_timer *> &timers()
+{
+    static std::vector<esp_timer *> *all = new std::vector<esp_timer *>;
+    return *all;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+    if (create_args == nullptr || create_args->callback == nullptr || out_handle == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    esp_timer *timer = new esp_timer{*create_args, false, 0, NATIVE_NEVER};
+    timers().push_back(timer);
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static esp_err_t start(esp_timer_handle_t timer, uint64_t timeoutUs, uint64_t periodUs)
+{
+    if (timer == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    if (timer->active)
+        return ESP_ERR_INVALID_STATE;
+    timer->active = true;
+    timer->periodUs = periodUs;
+    timer->dueUs = _nativeMicros + timeoutUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) { return start(timer, timeout_us, 0); }
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period)
+{
+    return period == 0 ? ESP_ERR_INVALID_ARG : start(timer, period, period);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (timer == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    if (!timer->active)
+        return ESP_ERR_INVALID_STATE;
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    if (timer == nullptr)
+        return ESP_ERR_INVALID_ARG;
+    if (timer->active)
+        return ESP_ERR_INVALID_STATE;
+    timer->args.callback = nullptr;
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer) { return timer != nullptr && timer->active; }
+
+int64_t esp_timer_get_time() { return (int64_t)_nativeMicros; }
+
+uint64_t nativeTimersDueUs()
+{
+    uint64_t dueUs = NATIVE_NEVER;
+    for (esp_timer *timer : timers())
+        if (timer->active && timer->dueUs < dueUs)
+            dueUs = timer->dueUs;
+    return dueUs;
+}
+
+void nativeTimersFire()
+{
+    // by index: a callback may create timers
+    for (size_t index = 0; index < timers().size(); index++)
+    {
+        esp_timer *timer = timers()[index];
+        if (!timer->active || timer->dueUs > _nativeMicros)
+            continue;
+        if (timer->periodUs == 0)
+            timer->active = false;
+        else if (timer->args.skip_unhandled_events)
+            timer->dueUs += ((_nativeMicros - timer->dueUs) / timer->periodUs + 1) * timer->periodUs;
+        else
+            timer->dueUs += timer->periodUs;
+        timer->args.callback(timer->args.arg);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef _NATIVE_ESP_TIMER_H_
+#define _NATIVE_ESP_TIMER_H_
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// The high resolution timers of the IDF, on the fake clock. A callback runs at the moment its timer is due, ahead of
+// every task (as if from the esp_timer task of the highest priority): it must not block.
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events; // A periodic timer that fell behind fires once, not once per period missed
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+// µs since the start, the fake clock without the wrap of micros()
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _NATIVE_ESP_WIFI_TYPES_H_
+#define _NATIVE_ESP_WIFI_TYPES_H_
+
+// The limits the configuration sizes its strings by, as in the IDF
+#define MAX_SSID_LEN 32
+#define MAX_PASSPHRASE_LEN 64
+
+#endif
@@ -0,0 +1,520 @@
+#include <freertos/FreeRTOS.h>
+#include <native_interrupts.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// What a blocked task waits for, the scheduler asks it
+typedef bool (*NativeReady)(NativeTask *task);
+
+struct NativeTask
+{
+    const char *name;
+    UBaseType_t priority;
+    TaskFunction_t code;
+    void *parameter;
+    std::condition_variable *wake; // Signalled when the task gets the baton
+    bool deleted;
+    NativeReady ready; // nullptr: the task is not waiting
+    void *waitObject;  // The queue or event group ready() looks at
+    EventBits_t waitBits;
+    bool waitForAll;
+    uint64_t deadlineUs; // The wait times out then, NATIVE_NEVER: no timeout
+    uint64_t order;      // Among equal priorities the task that has waited longest runs first
+    uint32_t notifyValue;
+    bool notifyPending;
+};
+
+struct NativeQueue
+{
+    enum Kind
+    {
+        QUEUE,
+        COUNTING,
+        MUTEX,
+        RECURSIVE_MUTEX
+    } kind;
+    UBaseType_t length; // Items, or the maximum count of a semaphore
+    UBaseType_t itemSize;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t *items;
+    NativeTask *holder; // The task holding a mutex
+    UBaseType_t recursion;
+};
+
+struct NativeEventGroup
+{
+    EventBits_t bits;
+};
+
+// The test thread, it calls setup() like the Arduino loop task
+static NativeTask _loopTask = {"loopTask", 1, nullptr, nullptr, nullptr, false, nullptr, nullptr, 0, false,
+                               NATIVE_NEVER, 0, 0, false};
+// Runs while an interrupt handler or timer callback runs
+static NativeTask _interruptContext = {"interrupt", configMAX_PRIORITIES, nullptr, nullptr, nullptr, false, nullptr,
+                                       nullptr, 0, false, NATIVE_NEVER, 0, 0, false};
+
+static NativeTask *_current = &_loopTask; // Whose code runs right now
+static NativeTask *_interrupted = nullptr; // The task an interrupt came in on
+static uint32_t _interruptDepth = 0;
+static NativeTask *_baton = &_loopTask; // The one task whose thread may run, guarded by batonMutex()
+static uint64_t _order = 0;
+
+// Never destroyed: threads of tasks still wait on them when the program ends
+static std::mutex &batonMutex()
+{
+    static std::mutex *mutex = new std::mutex;
+    return *mutex;
+}
+
+static std::vector<NativeTask *> &tasks()
+{
+    static std::vector<NativeTask *> *all = new std::vector<NativeTask *>{&_loopTask};
+    return *all;
+}
+
+static bool runnable(NativeTask *task)
+{
+    return !task->deleted && (task->ready == nullptr || task->deadlineUs <= _nativeMicros || task->ready(task));
+}
+
+[[noreturn]] static void deadlocked()
+{
+    fprintf(stderr, "native_hal: every task waits without a timeout and nothing is due:");
+    for (NativeTask *task : tasks())
+        if (!task->deleted)
+            fprintf(stderr, " %s", task->name);
+    fprintf(stderr, "\n");
+    abort();
+}
+
+// Let every interrupt due by now fire
+static void fireDue()
+{
+    nativeEnterInterrupt();
+    if (nativeTimersDueUs() <= _nativeMicros)
+        nativeTimersFire();
+    if (nativeLedcDueUs() <= _nativeMicros)
+        nativeLedcFire();
+    if (nativeAdcDueUs() <= _nativeMicros)
+        nativeAdcFire();
+    if (nativePinsDueUs() <= _nativeMicros)
+        nativePinsFire();
+    nativeExitInterrupt();
+}
+
+// The task to run next, moving the clock on while there is none
+static NativeTask *pickNext()
+{
+    for (;;)
+    {
+        fireDue();
+        NativeTask *next = nullptr;
+        uint64_t wakeUs = NATIVE_NEVER;
+        for (NativeTask *task : tasks())
+        {
+            if (task->deleted)
+                continue;
+            if (runnable(task))
+            {
+                if (next == nullptr || task->priority > next->priority ||
+                    (task->priority == next->priority && task->order < next->order))
+                    next = task;
+            }
+            else if (task->deadlineUs < wakeUs)
+                wakeUs = task->deadlineUs;
+        }
+        if (next != nullptr)
+            return next;
+        wakeUs = std::min({wakeUs, nativeTimersDueUs(), nativeLedcDueUs(), nativeAdcDueUs(), nativePinsDueUs()});
+        if (wakeUs == NATIVE_NEVER)
+            deadlocked();
+        if (wakeUs > _nativeMicros)
+            _nativeMicros = wakeUs;
+    }
+}
+
+// Hand the baton to the task that runs next, returns once from gets it back (never if from has been deleted)
+static void schedule(NativeTask *from)
+{
+    NativeTask *next = pickNext();
+    if (next == from)
+        return;
+    std::unique_lock<std::mutex> lock(batonMutex());
+    _baton = next;
+    next->wake->notify_one();
+    if (from->deleted)
+        from->wake->wait(lock, [] { return false; });
+    from->wake->wait(lock, [from] { return _baton == from; });
+    _current = from;
+}
+
+// Let a task of a higher priority run that the caller has just made ready, the caller stays ready
+static void preempt()
+{
+    if (_interruptDepth > 0)
+        return;
+    for (NativeTask *task : tasks())
+    {
+        if (task != _current && task->priority > _current->priority && runnable(task))
+        {
+            _current->order = ++_order;
+            schedule(_current);
+            return;
+        }
+    }
+}
+
+// Wait until ready() or the ticks have passed, returns whether ready
+static bool block(NativeReady ready, void *object, TickType_t ticks, EventBits_t bits = 0, bool all = false)
+{
+    NativeTask *task = _current;
+    task->ready = ready;
+    task->waitObject = object;
+    task->waitBits = bits;
+    task->waitForAll = all;
+    bool done = ready(task);
+    if (!done && ticks != 0 && task != &_interruptContext)
+    {
+        task->deadlineUs = ticks == portMAX_DELAY ? NATIVE_NEVER : _nativeMicros + (uint64_t)ticks * 1000;
+        task->order = ++_order;
+        schedule(task);
+        done = ready(task);
+    }
+    task->ready = nullptr;
+    task->deadlineUs = NATIVE_NEVER;
+    return done;
+}
+
+static bool never(NativeTask *task) { return false; }
+static bool notified(NativeTask *task) { return task->notifyPending; }
+static bool notifyCounted(NativeTask *task) { return task->notifyValue != 0; }
+static bool notEmpty(NativeTask *task) { return ((NativeQueue *)task->waitObject)->count > 0; }
+
+static bool notFull(NativeTask *task)
+{
+    NativeQueue *queue = (NativeQueue *)task->waitObject;
+    return queue->count < queue->length;
+}
+
+static bool mutexFree(NativeTask *task)
+{
+    NativeQueue *mutex = (NativeQueue *)task->waitObject;
+    return mutex->holder == nullptr || (mutex->kind == NativeQueue::RECURSIVE_MUTEX && mutex->holder == task);
+}
+
+static bool bitsSet(NativeTask *task)
+{
+    EventBits_t bits = ((NativeEventGroup *)task->waitObject)->bits & task->waitBits;
+    return task->waitForAll ? bits == task->waitBits : bits != 0;
+}
+
+// Whether a task blocks on the object for this reason
+static bool waitedFor(void *object, NativeReady ready)
+{
+    for (NativeTask *task : tasks())
+        if (!task->deleted && task->ready == ready && task->waitObject == object)
+            return true;
+    return false;
+}
+
+void nativeEnterInterrupt()
+{
+    if (_interruptDepth++ == 0)
+    {
+        _interrupted = _current;
+        _current = &_interruptContext;
+    }
+}
+
+void nativeExitInterrupt()
+{
+    if (--_interruptDepth == 0)
+        _current = _interrupted;
+}
+
+// ---- Tasks ----
+
+static void runTask(NativeTask *task)
+{
+    {
+        std::unique_lock<std::mutex> lock(batonMutex());
+        task->wake->wait(lock, [task] { return _baton == task; });
+        _current = task;
+    }
+    task->code(task->parameter);
+    // a FreeRTOS task must not return, take it as deleting itself
+    vTaskDelete(nullptr);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+                       UBaseType_t priority, TaskHandle_t *createdTask)
+{
+    if (_loopTask.wake == nullptr)
+        _loopTask.wake = new std::condition_variable;
+    NativeTask *task = new NativeTask{name, priority, code, parameter, new std::condition_variable, false, nullptr,
+                                      nullptr, 0, false, NATIVE_NEVER, ++_order, 0, false};
+    tasks().push_back(task);
+    std::thread(runTask, task).detach();
+    if (createdTask != nullptr)
+        *createdTask = task;
+    preempt();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId)
+{
+    return xTaskCreate(code, name, stackDepth, parameter, priority, createdTask);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr)
+        task = _current;
+    if (task == &_loopTask || task == &_interruptContext)
+    {
+        fprintf(stderr, "native_hal: the test thread can not delete itself (do not call loop())\n");
+        abort();
+    }
+    task->deleted = true;
+    if (task == _current)
+        schedule(task);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (ticks == 0)
+        taskYIELD();
+    else
+        block(never, nullptr, ticks);
+}
+
+void taskYIELD()
+{
+    if (_interruptDepth > 0)
+        return;
+    _current->order = ++_order;
+    schedule(_current);
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)(_nativeMicros / 1000); }
+TaskHandle_t xTaskGetCurrentTaskHandle() { return _current; }
+const char *pcTaskGetName(TaskHandle_t task) { return (task == nullptr ? _current : task)->name; }
+
+static BaseType_t notify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    switch (action)
+    {
+    case eSetBits:
+        task->notifyValue |= value;
+        break;
+    case eIncrement:
+        task->notifyValue++;
+        break;
+    case eSetValueWithOverwrite:
+        task->notifyValue = value;
+        break;
+    case eSetValueWithoutOverwrite:
+        if (task->notifyPending)
+            return pdFAIL;
+        task->notifyValue = value;
+        break;
+    default:
+        break;
+    }
+    task->notifyPending = true;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+    BaseType_t result = notify(task, value, action);
+    preempt();
+    return result;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+                              BaseType_t *higherPriorityTaskWoken)
+{
+    bool waiting = task->ready == notified || task->ready == notifyCounted;
+    BaseType_t result = notify(task, value, action);
+    if (higherPriorityTaskWoken != nullptr && waiting)
+        *higherPriorityTaskWoken = pdTRUE;
+    return result;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bitsToClearOnEntry, uint32_t bitsToClearOnExit, uint32_t *notificationValue,
+                           TickType_t ticksToWait)
+{
+    NativeTask *task = _current;
+    if (!task->notifyPending)
+        task->notifyValue &= ~bitsToClearOnEntry;
+    if (!block(notified, nullptr, ticksToWait))
+        return pdFALSE;
+    if (notificationValue != nullptr)
+        *notificationValue = task->notifyValue;
+    task->notifyValue &= ~bitsToClearOnExit;
+    task->notifyPending = false;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+    NativeTask *task = _current;
+    if (!block(notifyCounted, nullptr, ticksToWait))
+        return 0;
+    uint32_t value = task->notifyValue;
+    task->notifyValue = clearCountOnExit ? 0 : value - 1;
+    task->notifyPending = false;
+    return value;
+}
+
+// ---- Queues and semaphores ----
+
+static NativeQueue *createQueue(NativeQueue::Kind kind, UBaseType_t length, UBaseType_t itemSize, UBaseType_t count)
+{
+    uint8_t *items = itemSize == 0 ? nullptr : new uint8_t[length * itemSize];
+    return new NativeQueue{kind, length, itemSize, count, 0, items, nullptr, 0};
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    return createQueue(NativeQueue::QUEUE, length, itemSize, 0);
+}
+
+static void push(NativeQueue *queue, const void *item)
+{
+    if (queue->itemSize != 0 && item != nullptr)
+        memcpy(&queue->items[(queue->head + queue->count) % queue->length * queue->itemSize], item, queue->itemSize);
+    queue->count++;
+}
+
+static void pop(NativeQueue *queue, void *item)
+{
+    if (queue->itemSize != 0 && item != nullptr)
+        memcpy(item, &queue->items[queue->head * queue->itemSize], queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+    if (!block(notFull, queue, ticksToWait))
+        return errQUEUE_FULL;
+    push(queue, item);
+    preempt();
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higherPriorityTaskWoken)
+{
+    if (queue->count >= queue->length)
+        return errQUEUE_FULL;
+    bool waiting = waitedFor(queue, notEmpty);
+    push(queue, item);
+    if (higherPriorityTaskWoken != nullptr && waiting)
+        *higherPriorityTaskWoken = pdTRUE;
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+    if (!block(notEmpty, queue, ticksToWait))
+        return pdFALSE;
+    pop(queue, item);
+    preempt();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) { return queue->count; }
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete[] queue->items;
+    delete queue;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return createQueue(NativeQueue::COUNTING, 1, 0, 0); }
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    return createQueue(NativeQueue::COUNTING, maxCount, 0, initialCount);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return createQueue(NativeQueue::MUTEX, 1, 0, 0); }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return createQueue(NativeQueue::RECURSIVE_MUTEX, 1, 0, 0); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+    if (semaphore->kind == NativeQueue::COUNTING || semaphore->kind == NativeQueue::QUEUE)
+        return xQueueReceive(semaphore, nullptr, ticksToWait);
+    if (!block(mutexFree, semaphore, ticksToWait))
+        return pdFALSE;
+    semaphore->holder = _current;
+    semaphore->recursion++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+    if (semaphore->kind == NativeQueue::COUNTING || semaphore->kind == NativeQueue::QUEUE)
+        return xQueueSend(semaphore, nullptr, 0);
+    if (semaphore->holder != _current)
+        return pdFALSE;
+    if (--semaphore->recursion == 0)
+    {
+        semaphore->holder = nullptr;
+        preempt();
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higherPriorityTaskWoken)
+{
+    return xQueueSendFromISR(semaphore, nullptr, higherPriorityTaskWoken);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticksToWait)
+{
+    return xSemaphoreTake(mutex, ticksToWait);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) { return xSemaphoreGive(mutex); }
+
+// ---- Event groups ----
+
+EventGroupHandle_t xEventGroupCreate() { return new NativeEventGroup{0}; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    group->bits |= bits;
+    EventBits_t result = group->bits;
+    preempt();
+    return result;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) { return group->bits; }
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+                                BaseType_t waitForAllBits, TickType_t ticksToWait)
+{
+    bool done = block(bitsSet, group, ticksToWait, bits, waitForAllBits == pdTRUE);
+    EventBits_t result = group->bits;
+    if (done && clearOnExit == pdTRUE)
+        group->bits &= ~bits;
+    return result;
+}
@@ -0,0 +1,172 @@
+#include <ld2410.h>
+
+static const unsigned long CONNECTED_TIMEOUT_MS = 100;
+static const uint8_t DATA_HEADER[] = {0xF4, 0xF3, 0xF2, 0xF1};
+static const uint8_t DATA_FOOTER[] = {0xF8, 0xF7, 0xF6, 0xF5};
+static const uint8_t COMMAND_HEADER[] = {0xFD, 0xFC, 0xFB, 0xFA};
+static const uint8_t COMMAND_FOOTER[] = {0x04, 0x03, 0x02, 0x01};
+
+bool ld2410::begin(Stream &radarStream, bool waitForRadar)
+{
+    _radar = &radarStream;
+    if (!waitForRadar)
+        return true;
+    read();
+    return requestFirmwareVersion() || isConnected();
+}
+
+void ld2410::debug(Stream &terminalStream) { _debug = &terminalStream; }
+
+bool ld2410::isConnected()
+{
+    read();
+    return _framesSeen && millis() - _lastFrameMs < CONNECTED_TIMEOUT_MS;
+}
+
+bool ld2410::read()
+{
+    bool data = false;
+    while (_radar != nullptr && _radar->available() > 0)
+        data = readFrame() || data;
+    return data;
+}
+
+bool ld2410::presenceDetected() { return _targetType != 0; }
+bool ld2410::stationaryTargetDetected()
+{
+    return (_targetType & 0x02) != 0 && _stationaryDistance > 0 && _stationaryEnergy > 0;
+}
+uint16_t ld2410::stationaryTargetDistance() { return _stationaryDistance; }
+uint8_t ld2410::stationaryTargetEnergy() { return _stationaryEnergy; }
+bool ld2410::movingTargetDetected() { return (_targetType & 0x01) != 0 && _movingDistance > 0 && _movingEnergy > 0; }
+uint16_t ld2410::movingTargetDistance() { return _movingDistance; }
+uint8_t ld2410::movingTargetEnergy() { return _movingEnergy; }
+
+// One byte from the stream, returns whether it completed a data frame
+bool ld2410::readFrame()
+{
+    uint8_t byte = (uint8_t)_radar->read();
+    if (_framePosition < 4)
+    {
+        // in step with the header of either kind of frame
+        const uint8_t *header = _framePosition == 0 ? (byte == COMMAND_HEADER[0] ? COMMAND_HEADER : DATA_HEADER)
+                                                    : (_acknowledgement ? COMMAND_HEADER : DATA_HEADER);
+        if (byte != header[_framePosition])
+        {
+            // the byte may start the next frame
+            _framePosition = 0;
+            if (byte == DATA_HEADER[0] || byte == COMMAND_HEADER[0])
+            {
+                _acknowledgement = byte == COMMAND_HEADER[0];
+                _frame[_framePosition++] = byte;
+            }
+            return false;
+        }
+        _acknowledgement = header == COMMAND_HEADER;
+        _frame[_framePosition++] = byte;
+        return false;
+    }
+    _frame[_framePosition++] = byte;
+    if (_framePosition < 6)
+        return false;
+    uint16_t total = 4 + 2 + (_frame[4] | _frame[5] << 8) + 4;
+    if (total > FRAME_SIZE)
+    {
+        _framePosition = 0;
+        return false;
+    }
+    if (_framePosition < total)
+        return false;
+    _framePosition = 0;
+    const uint8_t *footer = _acknowledgement ? COMMAND_FOOTER : DATA_FOOTER;
+    for (uint8_t index = 0; index < 4; index++)
+        if (_frame[total - 4 + index] != footer[index])
+            return false;
+    _lastFrameMs = millis();
+    _framesSeen = true;
+    if (_acknowledgement)
+    {
+        parseAcknowledgement();
+        return false;
+    }
+    parseData();
+    return true;
+}
+
+void ld2410::parseData()
+{
+    // basic (0x02) or engineering (0x01) mode, the basic target data comes first in both
+    if ((_frame[6] != 0x02 && _frame[6] != 0x01) || _frame[7] != 0xAA)
+        return;
+    _targetType = _frame[8];
+    _movingDistance = _frame[9] | _frame[10] << 8;
+    _movingEnergy = _frame[11];
+    _stationaryDistance = _frame[12] | _frame[13] << 8;
+    _stationaryEnergy = _frame[14];
+}
+
+void ld2410::parseAcknowledgement()
+{
+    _lastAcknowledged = (_frame[6] | _frame[7] << 8) & ~0x0100;
+    _lastSucceeded = _frame[8] == 0 && _frame[9] == 0;
+    if (!_lastSucceeded)
+        return;
+    if (_lastAcknowledged == 0x00A0)
+    {
+        firmware_minor_version = _frame[12];
+        firmware_major_version = _frame[13];
+        firmware_bugfix_version = _frame[14] | _frame[15] << 8 | _frame[16] << 16 | (uint32_t)_frame[17] << 24;
+    }
+    else if (_lastAcknowledged == 0x0061)
+    {
+        max_gate = _frame[11];
+        max_moving_gate = _frame[12];
+        max_stationary_gate = _frame[13];
+        for (uint8_t gate = 0; gate < 9; gate++)
+        {
+            motion_sensitivity[gate] = _frame[14 + gate];
+            stationary_sensitivity[gate] = _frame[23 + gate];
+        }
+        sensor_idle_time = _frame[32] | _frame[33] << 8;
+    }
+}
+
+// Write a command frame and look for its acknowledgement among what the radar has sent
+bool ld2410::sendCommand(uint16_t command, const uint8_t *value, uint8_t valueLength)
+{
+    if (_radar == nullptr)
+        return false;
+    uint16_t length = 2 + valueLength;
+    _radar->write(COMMAND_HEADER, sizeof(COMMAND_HEADER));
+    _radar->write((uint8_t)length);
+    _radar->write((uint8_t)(length >> 8));
+    _radar->write((uint8_t)command);
+    _radar->write((uint8_t)(command >> 8));
+    if (valueLength > 0)
+        _radar->write(value, valueLength);
+    _radar->write(COMMAND_FOOTER, sizeof(COMMAND_FOOTER));
+    _lastAcknowledged = 0;
+    while (_radar->available() > 0)
+    {
+        readFrame();
+        if (_lastAcknowledged == command)
+            return _lastSucceeded;
+    }
+    return false;
+}
+
+// A command within configuration mode, like the library does it
+bool ld2410::configure(uint16_t command)
+{
+    const uint8_t enable[] = {0x01, 0x00};
+    if (!sendCommand(0x00FF, enable, sizeof(enable)))
+        return false;
+    bool succeeded = sendCommand(command, nullptr, 0);
+    sendCommand(0x00FE, nullptr, 0);
+    return succeeded;
+}
+
+bool ld2410::requestFirmwareVersion() { return configure(0x00A0); }
+bool ld2410::requestCurrentConfiguration() { return configure(0x0061); }
+bool ld2410::requestRestart() { return configure(0x00A3); }
+bool ld2410::requestFactoryReset() { return configure(0x00A2); }
@@ -0,0 +1,65 @@
+#ifndef _NATIVE_LD2410_H_
+#define _NATIVE_LD2410_H_
+
+#include <Arduino.h>
+
+// The ld2410 library (ncmreynolds) as far as the lamp uses it, speaking the real protocol: data frames in, command
+// frames out. Unlike the library it never waits for an answer, the clock does not move while a task runs: a command
+// succeeds when the acknowledgement is in the stream right after writing it (NativeRadar answers at once).
+class ld2410
+{
+public:
+    bool begin(Stream &radarStream, bool waitForRadar = true);
+    void debug(Stream &terminalStream);
+    // A frame came in during the last 100 ms
+    bool isConnected();
+    // Take everything the stream has, returns whether a data frame was among it
+    bool read();
+    bool presenceDetected();
+    bool stationaryTargetDetected();
+    uint16_t stationaryTargetDistance();
+    uint8_t stationaryTargetEnergy();
+    bool movingTargetDetected();
+    uint16_t movingTargetDistance();
+    uint8_t movingTargetEnergy();
+
+    bool requestFirmwareVersion();
+    uint8_t firmware_major_version = 0;
+    uint8_t firmware_minor_version = 0;
+    uint32_t firmware_bugfix_version = 0;
+    bool requestCurrentConfiguration();
+    uint8_t max_gate = 0;
+    uint8_t max_moving_gate = 0;
+    uint8_t max_stationary_gate = 0;
+    uint16_t sensor_idle_time = 0;
+    uint8_t motion_sensitivity[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    uint8_t stationary_sensitivity[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    bool requestRestart();
+    bool requestFactoryReset();
+
+private:
+    static const uint8_t FRAME_SIZE = 64;
+
+    bool readFrame();
+    void parseData();
+    void parseAcknowledgement();
+    bool sendCommand(uint16_t command, const uint8_t *value, uint8_t valueLength);
+    bool configure(uint16_t command);
+
+    Stream *_radar = nullptr;
+    Stream *_debug = nullptr;
+    uint8_t _frame[FRAME_SIZE];
+    uint8_t _framePosition = 0;
+    bool _acknowledgement = false; // The frame being read is the answer to a command
+    unsigned long _lastFrameMs = 0;
+    bool _framesSeen = false;
+    uint8_t _targetType = 0;
+    uint16_t _movingDistance = 0;
+    uint8_t _movingEnergy = 0;
+    uint16_t _stationaryDistance = 0;
+    uint8_t _stationaryEnergy = 0;
+    uint16_t _lastAcknowledged = 0; // Command word of the last acknowledgement
+    bool _lastSucceeded = false;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include <native_hal.h>
+#include <nvs_flash.h>
+
+extern uint32_t _nativeRestarts;
+void nativeLedcReset();
+void nativePinsReset();
+
+void nativeReset()
+{
+    nativeSetMillis(0);
+    nvs_flash_erase();
+    nativeLedcReset();
+    nativePinsReset();
+    _nativeRestarts = 0;
+    nativeSetMonitorOutput(true);
+}
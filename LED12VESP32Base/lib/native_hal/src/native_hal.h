@@ -0,0 +1,103 @@
+#ifndef _NATIVE_HAL_H_
+#define _NATIVE_HAL_H_
+
+#include <Arduino.h>
+
+// Control over the fake hardware of the native build, for the tests. Nothing here exists on the ESP32.
+
+// The fake clock behind millis() and micros(). It only moves when told to: delay() on the test thread lets the tasks,
+// timers, fades and scripted pins run for that long (freertos/FreeRTOS.h), nativeAdvanceMillis() just moves it. Wraps
+// at 32 bit like the one of the ESP32, but unsigned long has 64 bit on the host: take differences across the wrap as
+// uint32_t.
+void nativeSetMillis(unsigned long ms);
+void nativeAdvanceMillis(unsigned long ms);
+void nativeAdvanceMicros(unsigned long us);
+
+// Number of ESP.restart() calls
+uint32_t nativeRestartCount();
+
+// Whether Serial writes to stdout (it does from the start). Off keeps a long run of the whole lamp quiet.
+void nativeSetMonitorOutput(bool enabled);
+
+// What the fake LEDC driver knows about a channel
+struct NativeLedcChannel
+{
+    bool configured;     // ledc_channel_config() has been called
+    uint32_t duty;       // The duty output right now
+    uint32_t fadeTarget; // The duty the running fade ends at
+    uint32_t fadeMs;
+    bool fading;
+    uint32_t updates;     // Duty updates (ledc_update_duty(), ledc_set_duty_and_update())
+    uint32_t fadeStarts;  // ledc_fade_start() calls
+    uint32_t fadeEndsCalled; // Fade end callbacks called, including the one of ledc_set_duty_and_update()
+};
+NativeLedcChannel nativeLedcChannel(uint8_t channel);
+// Let every running fade reach its target, each one reports its end to the callback of its channel
+void nativeLedcEndFades();
+
+// Level of an input pin (digitalRead()), a change fires the interrupt attached to the pin
+void nativeSetPin(uint8_t pin, bool high);
+// Set the level afterMs from now, once a delay() gets there. Scripts a touch ahead of a long run.
+void nativeSchedulePin(uint8_t pin, bool high, unsigned long afterMs);
+// Hold a pin high for durationMs, starting afterMs from now
+void nativeSchedulePress(uint8_t pin, unsigned long afterMs, unsigned long durationMs);
+// The voltage at an analog pin, for analogReadMilliVolts() and the continuous ADC
+void nativeSetMillivolts(uint8_t pin, uint16_t millivolts);
+
+// What an LD2410 sees
+struct NativeRadarTarget
+{
+    bool moving;
+    uint16_t movingDistance; // cm
+    uint8_t movingEnergy;    // 0 .. 100
+    bool stationary;
+    uint16_t stationaryDistance;
+    uint8_t stationaryEnergy;
+};
+
+// A scripted LD2410 on its UART: sends a data frame (basic mode) about every 100 ms with the target last set, and
+// answers the configuration commands right when they are written. The bytes wait in a receive buffer of the size of
+// the ESP32 UART one, what does not fit gets lost.
+class NativeRadar : public Stream
+{
+public:
+    NativeRadar();
+    void setTarget(const NativeRadarTarget &target);
+    // A silent radar sends no frames and answers no commands
+    void setSilent(bool silent);
+    uint32_t framesSent() const { return _framesSent; }
+    uint32_t bytesLost() const { return _bytesLost; }
+    uint32_t commandsAnswered() const { return _commandsAnswered; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    using Print::write;
+
+private:
+    static const uint16_t BUFFER_SIZE = 256;
+    static const uint8_t COMMAND_SIZE = 64;
+
+    void send();
+    void receive(const uint8_t *bytes, uint16_t count);
+    void answer(uint16_t command);
+
+    NativeRadarTarget _target;
+    bool _silent;
+    uint64_t _nextFrameUs;
+    uint8_t _buffer[BUFFER_SIZE];
+    uint16_t _head;
+    uint16_t _count;
+    uint8_t _command[COMMAND_SIZE]; // The command being written
+    uint8_t _commandLength;
+    uint32_t _framesSent;
+    uint32_t _bytesLost;
+    uint32_t _commandsAnswered;
+};
+
+// Start over: clock at 0, preferences erased, LEDC unconfigured, pins low and unscripted, restart count 0, Serial
+// writing to stdout. Tasks and timers once created live on.
+void nativeReset();
+
+#endif
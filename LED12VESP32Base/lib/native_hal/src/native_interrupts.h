@@ -0,0 +1,28 @@
+#ifndef _NATIVE_INTERRUPTS_H_
+#define _NATIVE_INTERRUPTS_H_
+
+#include <stdint.h>
+
+// Between the fake drivers and the fake FreeRTOS, not for the tests. A driver with something due at a moment in time
+// (timer, fade end, ADC burst, scripted pin level) tells when, the scheduler moves the clock there once every task is
+// blocked and lets it fire.
+
+static const uint64_t NATIVE_NEVER = UINT64_MAX;
+
+extern uint64_t _nativeMicros;
+
+uint64_t nativeTimersDueUs();
+void nativeTimersFire();
+uint64_t nativeLedcDueUs();
+void nativeLedcFire();
+uint64_t nativeAdcDueUs();
+void nativeAdcFire();
+uint64_t nativePinsDueUs();
+void nativePinsFire();
+
+// Around the call of an interrupt handler (or timer callback): no task runs meanwhile, so it must not block. Calls
+// nest.
+void nativeEnterInterrupt();
+void nativeExitInterrupt();
+
+#endif
@@ -0,0 +1,38 @@
+#include <wifi_handler.h>
+#include <webapi.h>
+#include <webinterface.h>
+
+// The network side of the lamp (src/wifi_handler.cpp, webapi.cpp, webinterface.cpp) needs the WiFi and the web server
+// of the ESP32 and does not get built here. The network task still runs, against a WiFi that is always connected and
+// a web server without clients.
+
+void wifiSetup() {}
+
+void wifiLoop() {}
+
+void wifiDebug(Stream &terminalStream) {}
+
+WifiStateInfo wifiCurrentState()
+{
+    WifiStateInfo info = {};
+    info.mode = WifiMode_STA;
+    info.apModeResult = MODE_NOT_ATTEMPTED_YET;
+    info.staModeResult = MODE_SUCCESS;
+    info.currentState = STA_OK;
+    info.address = IPAddress(192, 168, 4, 2);
+    return info;
+}
+
+void requestAPMode() {}
+
+void webApiSetup() {}
+
+void webApiLoop() {}
+
+void webApiDebug(Stream &terminalStream) {}
+
+void webInterfaceSetup() {}
+
+void webInterfaceLoop() {}
+
+void webInterfaceDebug(Stream &terminalStream) {}
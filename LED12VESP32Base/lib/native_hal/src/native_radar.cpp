@@ -0,0 +1,203 @@
+#include <native_hal.h>
+#include <native_interrupts.h>
+
+static const uint64_t FRAME_PERIOD_US = 100000;
+static const uint8_t DATA_FRAME_SIZE = 23;
+static const uint8_t DATA_HEADER[] = {0xF4, 0xF3, 0xF2, 0xF1};
+static const uint8_t DATA_FOOTER[] = {0xF8, 0xF7, 0xF6, 0xF5};
+static const uint8_t COMMAND_HEADER[] = {0xFD, 0xFC, 0xFB, 0xFA};
+static const uint8_t COMMAND_FOOTER[] = {0x04, 0x03, 0x02, 0x01};
+
+static const uint16_t COMMAND_ENABLE_CONFIGURATION = 0x00FF;
+static const uint16_t COMMAND_END_CONFIGURATION = 0x00FE;
+static const uint16_t COMMAND_READ_PARAMETERS = 0x0061;
+static const uint16_t COMMAND_READ_FIRMWARE = 0x00A0;
+static const uint16_t COMMAND_FACTORY_RESET = 0x00A2;
+static const uint16_t COMMAND_RESTART = 0x00A3;
+
+// What the scripted radar reports about itself: firmware V1.07.22091615, factory settings
+static const uint8_t FIRMWARE_MAJOR = 1;
+static const uint8_t FIRMWARE_MINOR = 7;
+static const uint32_t FIRMWARE_BUGFIX = 0x22091615;
+static const uint8_t MAX_GATE = 8;
+static const uint8_t MOTION_SENSITIVITY[9] = {50, 50, 40, 30, 20, 15, 15, 15, 15};
+static const uint8_t STATIONARY_SENSITIVITY[9] = {0, 0, 40, 40, 30, 30, 20, 20, 20};
+static const uint16_t IDLE_TIME_S = 5;
+
+NativeRadar::NativeRadar()
+    : _target(), _silent(false), _nextFrameUs(0), _head(0), _count(0), _commandLength(0), _framesSent(0),
+      _bytesLost(0), _commandsAnswered(0)
+{
+}
+
+void NativeRadar::setTarget(const NativeRadarTarget &target) { _target = target; }
+
+void NativeRadar::setSilent(bool silent) { _silent = silent; }
+
+// Into the receive buffer, as far as there is room
+void NativeRadar::receive(const uint8_t *bytes, uint16_t count)
+{
+    for (uint16_t index = 0; index < count; index++)
+    {
+        if (_count == BUFFER_SIZE)
+        {
+            _bytesLost += count - index;
+            return;
+        }
+        _buffer[(_head + _count) % BUFFER_SIZE] = bytes[index];
+        _count++;
+    }
+}
+
+// The data frames due by now
+void NativeRadar::send()
+{
+    if (_silent)
+    {
+        // nothing gets sent meanwhile
+        if (_nextFrameUs <= _nativeMicros)
+            _nextFrameUs += ((_nativeMicros - _nextFrameUs) / FRAME_PERIOD_US + 1) * FRAME_PERIOD_US;
+        return;
+    }
+    while (_nextFrameUs <= _nativeMicros)
+    {
+        if (_count == BUFFER_SIZE)
+        {
+            // full: every frame up to now gets lost
+            uint64_t missed = (_nativeMicros - _nextFrameUs) / FRAME_PERIOD_US + 1;
+            _framesSent += missed;
+            _bytesLost += missed * DATA_FRAME_SIZE;
+            _nextFrameUs += missed * FRAME_PERIOD_US;
+            return;
+        }
+        uint8_t state = (_target.moving ? 0x01 : 0) | (_target.stationary ? 0x02 : 0);
+        uint16_t detection = _target.moving ? _target.movingDistance : _target.stationaryDistance;
+        uint8_t frame[DATA_FRAME_SIZE] = {DATA_HEADER[0], DATA_HEADER[1], DATA_HEADER[2], DATA_HEADER[3],
+                                          13, 0, 0x02, 0xAA, state,
+                                          (uint8_t)_target.movingDistance, (uint8_t)(_target.movingDistance >> 8),
+                                          _target.movingEnergy,
+                                          (uint8_t)_target.stationaryDistance,
+                                          (uint8_t)(_target.stationaryDistance >> 8), _target.stationaryEnergy,
+                                          (uint8_t)detection, (uint8_t)(detection >> 8), 0x55, 0x00,
+                                          DATA_FOOTER[0], DATA_FOOTER[1], DATA_FOOTER[2], DATA_FOOTER[3]};
+        receive(frame, DATA_FRAME_SIZE);
+        _framesSent++;
+        _nextFrameUs += FRAME_PERIOD_US;
+    }
+}
+
+// The acknowledgement of a command, with the data it asked for
+void NativeRadar::answer(uint16_t command)
+{
+    uint8_t data[32];
+    uint8_t length = 0;
+    bool known = true;
+    switch (command)
+    {
+    case COMMAND_ENABLE_CONFIGURATION:
+    {
+        const uint8_t protocol[] = {0x01, 0x00, 0x40, 0x00}; // protocol version 1, buffer of 64 bytes
+        for (uint8_t byte : protocol)
+            data[length++] = byte;
+        break;
+    }
+    case COMMAND_READ_FIRMWARE:
+        data[length++] = 0x00;
+        data[length++] = 0x01;
+        data[length++] = FIRMWARE_MINOR;
+        data[length++] = FIRMWARE_MAJOR;
+        for (uint8_t shift = 0; shift < 32; shift += 8)
+            data[length++] = (uint8_t)(FIRMWARE_BUGFIX >> shift);
+        break;
+    case COMMAND_READ_PARAMETERS:
+        data[length++] = 0xAA;
+        data[length++] = MAX_GATE;
+        data[length++] = MAX_GATE;
+        data[length++] = MAX_GATE;
+        for (uint8_t sensitivity : MOTION_SENSITIVITY)
+            data[length++] = sensitivity;
+        for (uint8_t sensitivity : STATIONARY_SENSITIVITY)
+            data[length++] = sensitivity;
+        data[length++] = (uint8_t)IDLE_TIME_S;
+        data[length++] = (uint8_t)(IDLE_TIME_S >> 8);
+        break;
+    case COMMAND_END_CONFIGURATION:
+    case COMMAND_FACTORY_RESET:
+    case COMMAND_RESTART:
+        break;
+    default:
+        known = false;
+        break;
+    }
+    uint16_t frameLength = 4 + length; // command word, status, data
+    uint16_t acknowledged = command | 0x0100;
+    uint8_t head[] = {COMMAND_HEADER[0],
+                      COMMAND_HEADER[1],
+                      COMMAND_HEADER[2],
+                      COMMAND_HEADER[3],
+                      (uint8_t)frameLength,
+                      (uint8_t)(frameLength >> 8),
+                      (uint8_t)acknowledged,
+                      (uint8_t)(acknowledged >> 8),
+                      (uint8_t)(known ? 0 : 1),
+                      0};
+    // the frames sent so far come first
+    send();
+    receive(head, sizeof(head));
+    receive(data, length);
+    receive(COMMAND_FOOTER, sizeof(COMMAND_FOOTER));
+    _commandsAnswered++;
+}
+
+int NativeRadar::available()
+{
+    send();
+    return _count;
+}
+
+int NativeRadar::read()
+{
+    send();
+    if (_count == 0)
+        return -1;
+    uint8_t byte = _buffer[_head];
+    _head = (_head + 1) % BUFFER_SIZE;
+    _count--;
+    return byte;
+}
+
+int NativeRadar::peek()
+{
+    send();
+    return _count == 0 ? -1 : _buffer[_head];
+}
+
+// Collects a command frame, a complete one gets answered
+size_t NativeRadar::write(uint8_t c)
+{
+    if (_commandLength < sizeof(COMMAND_HEADER) && c != COMMAND_HEADER[_commandLength])
+    {
+        // out of step, this may be the start of the next frame
+        _commandLength = c == COMMAND_HEADER[0] ? 1 : 0;
+        return 1;
+    }
+    _command[_commandLength++] = c;
+    if (_commandLength < 6)
+        return 1;
+    uint16_t total = 4 + 2 + (_command[4] | _command[5] << 8) + 4;
+    if (total > COMMAND_SIZE || total < 12)
+    {
+        _commandLength = 0;
+        return 1;
+    }
+    if (_commandLength < total)
+        return 1;
+    bool footer = true;
+    for (uint8_t index = 0; index < sizeof(COMMAND_FOOTER); index++)
+        footer = footer && _command[total - 4 + index] == COMMAND_FOOTER[index];
+    uint16_t command = _command[6] | _command[7] << 8;
+    _commandLength = 0;
+    if (footer && !_silent)
+        answer(command);
+    return 1;
+}
@@ -0,0 +1,10 @@
+#ifndef _NATIVE_NVS_FLASH_H_
+#define _NATIVE_NVS_FLASH_H_
+
+#include <esp_err.h>
+
+// Erases the preferences
+esp_err_t nvs_flash_erase();
+esp_err_t nvs_flash_init();
+
+#endif
@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include <native_hal.h>
+#include <native_interrupts.h>
+#include <vector>
+
+static const uint8_t PIN_COUNT = 40;
+
+struct NativePin
+{
+    uint8_t mode;
+    bool high;
+    void (*handler)(void);
+    int interruptMode;
+    uint16_t millivolts;
+};
+
+// A level a pin gets at a moment in time
+struct NativePinChange
+{
+    uint64_t atUs;
+    uint8_t pin;
+    bool high;
+};
+
+static NativePin _pins[PIN_COUNT];
+static std::vector<NativePinChange> _pinScript; // In the order of time
+
+// The continuous ADC, one burst at a time
+static uint8_t _adcPins[PIN_COUNT];
+static uint8_t _adcPinCount = 0;
+static uint32_t _adcBurstUs = 0;
+static void (*_adcDone)(void) = nullptr;
+static uint64_t _adcDueUs = NATIVE_NEVER;
+static bool _adcResultReady = false;
+static adc_continuous_data_t _adcResult[PIN_COUNT];
+
+static bool validPin(uint8_t pin) { return pin < PIN_COUNT; }
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+    if (validPin(pin))
+        _pins[pin].mode = mode;
+}
+
+int digitalRead(uint8_t pin) { return validPin(pin) && _pins[pin].high ? HIGH : LOW; }
+
+void digitalWrite(uint8_t pin, uint8_t value) { nativeSetPin(pin, value != LOW); }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+    if (!validPin(pin))
+        return;
+    _pins[pin].handler = handler;
+    _pins[pin].interruptMode = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+    if (validPin(pin))
+        _pins[pin].handler = nullptr;
+}
+
+void nativeSetPin(uint8_t pin, bool high)
+{
+    if (!validPin(pin) || _pins[pin].high == high)
+        return;
+    NativePin &state = _pins[pin];
+    state.high = high;
+    int edge = high ? RISING : FALLING;
+    if (state.handler != nullptr && (state.interruptMode & edge) != 0)
+    {
+        nativeEnterInterrupt();
+        state.handler();
+        nativeExitInterrupt();
+    }
+}
+
+void nativeSchedulePin(uint8_t pin, bool high, unsigned long afterMs)
+{
+    NativePinChange change = {_nativeMicros + (uint64_t)afterMs * 1000, pin, high};
+    auto position = _pinScript.begin();
+    while (position != _pinScript.end() && position->atUs <= change.atUs)
+        position++;
+    _pinScript.insert(position, change);
+}
+
+void nativeSchedulePress(uint8_t pin, unsigned long afterMs, unsigned long durationMs)
+{
+    nativeSchedulePin(pin, true, afterMs);
+    nativeSchedulePin(pin, false, afterMs + durationMs);
+}
+
+uint64_t nativePinsDueUs() { return _pinScript.empty() ? NATIVE_NEVER : _pinScript.front().atUs; }
+
+void nativePinsFire()
+{
+    while (!_pinScript.empty() && _pinScript.front().atUs <= _nativeMicros)
+    {
+        NativePinChange change = _pinScript.front();
+        _pinScript.erase(_pinScript.begin());
+        nativeSetPin(change.pin, change.high);
+    }
+}
+
+void nativeSetMillivolts(uint8_t pin, uint16_t millivolts)
+{
+    if (validPin(pin))
+        _pins[pin].millivolts = millivolts;
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) { return validPin(pin) ? _pins[pin].millivolts : 0; }
+
+bool analogContinuous(const uint8_t pins[], size_t pinsCount, uint32_t conversionsPerPin, uint32_t samplingFreqHz,
+                      void (*userFunc)(void))
+{
+    if (pinsCount == 0 || pinsCount > PIN_COUNT || samplingFreqHz == 0)
+        return false;
+    for (size_t index = 0; index < pinsCount; index++)
+    {
+        if (!validPin(pins[index]))
+            return false;
+        _adcPins[index] = pins[index];
+    }
+    _adcPinCount = pinsCount;
+    _adcBurstUs = (uint32_t)((uint64_t)conversionsPerPin * pinsCount * 1000000 / samplingFreqHz);
+    _adcDone = userFunc;
+    return true;
+}
+
+bool analogContinuousStart()
+{
+    if (_adcPinCount == 0 || _adcDueUs != NATIVE_NEVER)
+        return false;
+    _adcResultReady = false;
+    _adcDueUs = _nativeMicros + _adcBurstUs;
+    return true;
+}
+
+bool analogContinuousRead(adc_continuous_data_t **buffer, uint32_t timeoutMs)
+{
+    if (!_adcResultReady || buffer == nullptr)
+        return false;
+    *buffer = _adcResult;
+    _adcResultReady = false;
+    return true;
+}
+
+bool analogContinuousStop()
+{
+    _adcDueUs = NATIVE_NEVER;
+    return _adcPinCount != 0;
+}
+
+uint64_t nativeAdcDueUs() { return _adcDueUs; }
+
+void nativeAdcFire()
+{
+    _adcDueUs = NATIVE_NEVER;
+    for (uint8_t index = 0; index < _adcPinCount; index++)
+    {
+        uint8_t pin = _adcPins[index];
+        _adcResult[index] = {pin, index, (int)(_pins[pin].millivolts * 4095UL / 3300), _pins[pin].millivolts};
+    }
+    _adcResultReady = true;
+    if (_adcDone != nullptr)
+        _adcDone();
+}
+
+void nativePinsReset()
+{
+    for (NativePin &state : _pins)
+        state = {};
+    _pinScript.clear();
+    _adcPinCount = 0;
+    _adcDone = nullptr;
+    _adcDueUs = NATIVE_NEVER;
+    _adcResultReady = false;
+}
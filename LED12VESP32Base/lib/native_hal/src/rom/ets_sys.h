@@ -0,0 +1,9 @@
+#ifndef _NATIVE_ROM_ETS_SYS_H_
+#define _NATIVE_ROM_ETS_SYS_H_
+
+#include <stdint.h>
+
+// In MHz, matching esp_cpu_get_cycle_count()
+inline uint32_t ets_get_cpu_frequency() { return 240; }
+
+#endif
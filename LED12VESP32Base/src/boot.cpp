@@ -0,0 +1,95 @@
+#include <boot.h>
+#include <esp_timer.h>
+
+static const char *RUNNER_NAMES[BOOT_RUNNER_COUNT] = {"setup", "network"};
+
+const BootJob *_bootJobs = nullptr;
+uint8_t _bootJobCount = 0;
+EventGroupHandle_t _bootDone = nullptr; // One bit per job, set when the job is done
+BootTiming _bootTimings[MAX_BOOT_JOBS]; // Each one written by the runner of its job only
+
+static uint32_t nowUs() { return (uint32_t)esp_timer_get_time(); }
+static EventBits_t allJobBits() { return (EventBits_t)((1UL << _bootJobCount) - 1); }
+
+void bootSetup(const BootJob *jobs, uint8_t count)
+{
+    _bootJobs = jobs;
+    _bootJobCount = count > MAX_BOOT_JOBS ? MAX_BOOT_JOBS : count;
+    if (_bootDone == nullptr)
+        _bootDone = xEventGroupCreate();
+    for (uint8_t job = 0; job < MAX_BOOT_JOBS; job++)
+        _bootTimings[job] = {};
+}
+
+void bootRun(BootRunner runner)
+{
+    if (_bootDone == nullptr)
+        return;
+    for (uint8_t index = 0; index < _bootJobCount; index++)
+    {
+        const BootJob &job = _bootJobs[index];
+        if (job.runner != runner)
+            continue;
+        BootTiming &timing = _bootTimings[index];
+        timing.reachedUs = nowUs();
+        // wait for the jobs of the other runners, the ones of this runner are done already
+        if (job.dependsOn != 0)
+            xEventGroupWaitBits(_bootDone, job.dependsOn, pdFALSE, pdTRUE, portMAX_DELAY);
+        timing.startUs = nowUs();
+        if (job.run != nullptr)
+            job.run();
+        timing.durationUs = nowUs() - timing.startUs;
+        timing.done = true;
+        xEventGroupSetBits(_bootDone, bootBit(index));
+    }
+}
+
+void bootWait()
+{
+    if (_bootDone != nullptr && _bootJobCount > 0)
+        xEventGroupWaitBits(_bootDone, allJobBits(), pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+uint8_t bootJobCount() { return _bootJobCount; }
+const BootJob &bootJob(uint8_t job) { return _bootJobs[job < _bootJobCount ? job : 0]; }
+BootTiming bootTiming(uint8_t job) { return job < _bootJobCount ? _bootTimings[job] : BootTiming{}; }
+
+bool bootComplete()
+{
+    if (_bootDone == nullptr)
+        return false;
+    return (xEventGroupGetBits(_bootDone) & allJobBits()) == allJobBits();
+}
+
+uint32_t bootCompleteUs()
+{
+    if (!bootComplete())
+        return 0;
+    uint32_t completeUs = 0;
+    for (uint8_t job = 0; job < _bootJobCount; job++)
+        completeUs = max(completeUs, _bootTimings[job].startUs + _bootTimings[job].durationUs);
+    return completeUs;
+}
+
+const char *bootRunnerName(BootRunner runner)
+{
+    return runner < BOOT_RUNNER_COUNT ? RUNNER_NAMES[runner] : "?";
+}
+
+void bootReport(Stream &terminalStream)
+{
+    terminalStream.println(F("boot job         runner    start us  waited us  duration us"));
+    for (uint8_t job = 0; job < _bootJobCount; job++)
+    {
+        const BootTiming &timing = _bootTimings[job];
+        if (!timing.done)
+        {
+            terminalStream.printf("%-16s %-8s   not done\n", _bootJobs[job].name, bootRunnerName(_bootJobs[job].runner));
+            continue;
+        }
+        terminalStream.printf("%-16s %-8s %10lu %10lu %12lu\n", _bootJobs[job].name,
+                              bootRunnerName(_bootJobs[job].runner), (unsigned long)timing.startUs,
+                              (unsigned long)(timing.startUs - timing.reachedUs), (unsigned long)timing.durationUs);
+    }
+    terminalStream.printf("boot complete after %lu us\n", (unsigned long)bootCompleteUs());
+}
@@ -0,0 +1,13 @@
+#include <clock.h>
+
+ClockSource _clockSource = nullptr; // nullptr: millis()
+
+unsigned long clockMillis()
+{
+    return _clockSource == nullptr ? millis() : _clockSource();
+}
+
+void clockUseSource(ClockSource source)
+{
+    _clockSource = source;
+}
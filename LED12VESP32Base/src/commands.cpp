@@ -0,0 +1,178 @@
+#include <atomic>
+#include <commands.h>
+#include <config.h>
+#include <device_state.h>
+#include <events.h>
+#include <rules.h>
+
+// Must be a power of two. More commands than this in one control tick get dropped. A request to the web api posts one
+// command per parameter, room for two of those with every parameter and the light state keeps them from being dropped.
+static const uint32_t COMMAND_QUEUE_LENGTH = 64;
+static const uint32_t COMMAND_QUEUE_MASK = COMMAND_QUEUE_LENGTH - 1;
+static_assert((COMMAND_QUEUE_LENGTH & COMMAND_QUEUE_MASK) == 0, "COMMAND_QUEUE_LENGTH must be a power of two");
+static_assert(COMMAND_QUEUE_LENGTH >= 2 * (DEVICE_PARAMETER_COUNT + 1), "two full requests must fit the queue");
+static_assert(DEVICE_PARAMETER_COUNT <= 32, "the pending parameters are kept in a 32 bit mask");
+
+// How a parameter gets changed and saved, nullptr when it can't
+struct ParameterHandlers
+{
+    void (*modify)(uint16_t value);
+    void (*save)(uint16_t value);
+};
+
+// In the order of DeviceParameter
+static const ParameterHandlers PARAMETER_HANDLERS[DEVICE_PARAMETER_COUNT] = {
+    {[](uint16_t v) { modifyAllowNightLightMode(v != 0); }, [](uint16_t v) { setAllowNightLight(v != 0); }},
+    {[](uint16_t v) { modifyNightLightOnDurationSeconds(v); }, [](uint16_t v) { setNightLightOnDuration(v); }},
+    {[](uint16_t v) { modifyNightLightBrightness(v); }, [](uint16_t v) { setNightLightBrightness(v); }},
+    {[](uint16_t v) { modifyNightLightThreshold(v); }, [](uint16_t v) { setNightLightThreshold(v); }},
+    {[](uint16_t v) { modifyMaxNightLightBrightness(v); }, [](uint16_t v) { setMaxNightLightBrightness(v); }},
+    {[](uint16_t v) { modifyOnBrightness(v); }, [](uint16_t v) { setOnBrightness(v); }},
+    {[](uint16_t v) { modifyMaxBrightness(v); }, [](uint16_t v) { setMaxBrightness(v); }},
+    {[](uint16_t v) { modifyBrightnessStep(v); }, [](uint16_t v) { setBrightnessStep(v); }},
+    {[](uint16_t v) { modifyTransitionDurationMs(v); }, [](uint16_t v) { setTransitionDurationMs(v); }},
+    {[](uint16_t v) { modifyOnEasingCurve((EasingCurve)v); }, [](uint16_t v) { setOnEasingCurve((EasingCurve)v); }},
+    {[](uint16_t v) { modifyNightLightEasingCurve((EasingCurve)v); }, [](uint16_t v) { setNightLightEasingCurve((EasingCurve)v); }},
+    {[](uint16_t v) { modifyMaxMovingTargetDistance(v); }, [](uint16_t v) { setMaxMovingTargetDistance(v); }},
+    {[](uint16_t v) { modifyMinMovingTargetDistance(v); }, [](uint16_t v) { setMinMovingTargetDistance(v); }},
+    {[](uint16_t v) { modifyMaxMovingTargetEnergy(v); }, [](uint16_t v) { setMaxMovingTargetEnergy(v); }},
+    {[](uint16_t v) { modifyMinMovingTargetEnergy(v); }, [](uint16_t v) { setMinMovingTargetEnergy(v); }},
+    {[](uint16_t v) { modifyMaxStationaryTargetDistance(v); }, [](uint16_t v) { setMaxStationaryTargetDistance(v); }},
+    {[](uint16_t v) { modifyMinStationaryTargetDistance(v); }, [](uint16_t v) { setMinStationaryTargetDistance(v); }},
+    {[](uint16_t v) { modifyMaxStationaryTargetEnergy(v); }, [](uint16_t v) { setMaxStationaryTargetEnergy(v); }},
+    {[](uint16_t v) { modifyMinStationaryTargetEnergy(v); }, [](uint16_t v) { setMinStationaryTargetEnergy(v); }},
+    {nullptr, [](uint16_t v) { setStripPowerDeciWatts(v); }},
+    {[](uint16_t v) { rulesSetConditions(v); }, [](uint16_t v) { rulesSetConditions(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetLdrMin(v); }, [](uint16_t v) { rulesSetLdrMin(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetWindowStart(v); }, [](uint16_t v) { rulesSetWindowStart(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetWindowEnd(v); }, [](uint16_t v) { rulesSetWindowEnd(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetLdrHysteresis(v); }, [](uint16_t v) { rulesSetLdrHysteresis(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetDarkDwellMs(v); }, [](uint16_t v) { rulesSetDarkDwellMs(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetPresenceDebounceMs(v); }, [](uint16_t v) { rulesSetPresenceDebounceMs(v); rulesSave(); }},
+    {[](uint16_t v) { rulesSetOverride((RuleOverride)v); }, nullptr},
+    {[](uint16_t v) { rulesSetTimeOfDay(v); }, nullptr},
+    {[](uint16_t v) { modifyLdrCalibration(v != 0); }, nullptr},
+};
+
+// Bounded multi producer, single consumer queue. Each slot carries a sequence number: it equals the position when the
+// slot is free for the producer claiming that position, and position + 1 when the command in it is ready for the
+// consumer. Producers claim positions with a compare and swap, so no task ever waits for another one.
+struct CommandSlot
+{
+    std::atomic<uint32_t> sequence;
+    Command command;
+};
+
+CommandSlot _commandSlots[COMMAND_QUEUE_LENGTH];
+std::atomic<uint32_t> _enqueuePos(0);
+uint32_t _dequeuePos = 0; // Only touched by the control task
+std::atomic<uint32_t> _droppedCommands(0);
+
+bool postCommand(const Command &command)
+{
+    uint32_t pos = _enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        CommandSlot &slot = _commandSlots[pos & COMMAND_QUEUE_MASK];
+        int32_t diff = (int32_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+        if (diff == 0)
+        {
+            // the slot is free: claim it, unless another producer was faster
+            if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.command = command;
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                postEvent(EVENT_COMMAND);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            // the consumer has not taken the command a full round ago yet: the queue is full
+            _droppedCommands.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else
+        {
+            pos = _enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Take the next command from the queue, returns false when it is empty
+bool takeCommand(Command &command)
+{
+    CommandSlot &slot = _commandSlots[_dequeuePos & COMMAND_QUEUE_MASK];
+    if (slot.sequence.load(std::memory_order_acquire) != _dequeuePos + 1)
+        return false;
+    command = slot.command;
+    slot.sequence.store(_dequeuePos + COMMAND_QUEUE_LENGTH, std::memory_order_release);
+    _dequeuePos++;
+    return true;
+}
+
+bool postParameter(DeviceParameter parameter, uint16_t value, bool saveAsPreference)
+{
+    if (parameter >= DEVICE_PARAMETER_COUNT)
+        return false;
+    return postCommand({saveAsPreference ? COMMAND_SAVE_PARAMETER : COMMAND_SET_PARAMETER, parameter, value});
+}
+
+bool postLightState(bool lampOn)
+{
+    return postCommand({COMMAND_SET_LIGHT_STATE, DEVICE_PARAMETER_COUNT, lampOn});
+}
+
+uint32_t droppedCommands()
+{
+    return _droppedCommands.load(std::memory_order_relaxed);
+}
+
+void commandsSetup()
+{
+    for (uint32_t pos = 0; pos < COMMAND_QUEUE_LENGTH; pos++)
+        _commandSlots[pos].sequence.store(pos, std::memory_order_relaxed);
+    _enqueuePos.store(0, std::memory_order_relaxed);
+    _dequeuePos = 0;
+}
+
+void commandsLoop()
+{
+    uint32_t setMask = 0;                       // Parameters to change
+    uint32_t saveMask = 0;                      // Parameters to save
+    uint16_t setValue[DEVICE_PARAMETER_COUNT];  // The last value posted per parameter to change
+    uint16_t saveValue[DEVICE_PARAMETER_COUNT]; // The last value posted per parameter to save
+    int8_t lightState = -1;                     // The last light state posted, -1 when none
+
+    // collect everything first, a later command for the same parameter overrides an earlier one
+    Command command;
+    while (takeCommand(command))
+    {
+        switch (command.type)
+        {
+        case COMMAND_SET_PARAMETER:
+            setMask |= 1UL << command.parameter;
+            setValue[command.parameter] = command.value;
+            break;
+        case COMMAND_SAVE_PARAMETER:
+            saveMask |= 1UL << command.parameter;
+            saveValue[command.parameter] = command.value;
+            break;
+        case COMMAND_SET_LIGHT_STATE:
+            lightState = command.value != 0;
+            break;
+        }
+    }
+
+    for (uint8_t parameter = 0; parameter < DEVICE_PARAMETER_COUNT; parameter++)
+    {
+        const ParameterHandlers &handlers = PARAMETER_HANDLERS[parameter];
+        if ((setMask & (1UL << parameter)) && handlers.modify != nullptr)
+            handlers.modify(setValue[parameter]);
+        if ((saveMask & (1UL << parameter)) && handlers.save != nullptr)
+            handlers.save(saveValue[parameter]);
+    }
+    // switch the lamp last, so it already uses the brightness that came along
+    if (lightState >= 0)
+        modifyLightState(lightState != 0);
+}
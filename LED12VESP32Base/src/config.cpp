@@ -3,14 +3,31 @@
 #include <nvs_flash.h>
 
 #include "config.h"
+#include <scheduler.h>
 
 Preferences myPrefs;
 
 static const int16_t CURRENT_VERSION = 1;
+// Fits the longest string preference and the terminating 0
+static const size_t PREF_STRING_BUFFER_SIZE = MAX_PASSPHRASE_LEN + 1;
+static_assert(MAX_MQTT_SERVER_LENGTH < PREF_STRING_BUFFER_SIZE, "MQTT server does not fit PREF_STRING_BUFFER_SIZE");
 
 static const char *PrefsNamespace = "configuration";
 static const char *PrefInitDoneVersion = "idv";
 
+LedStripEnergy _pendingEnergy;         // Energy counters waiting to be written
+bool _energyPending = false;           // Whether _pendingEnergy needs to be written
+
+// Job: write-behind, the counters change all the time, write them in intervals only
+void saveEnergyCounters()
+{
+    if (_energyPending)
+    {
+        myPrefs.putBytes(PrefEnergyCounters, &_pendingEnergy, sizeof(_pendingEnergy));
+        _energyPending = false;
+    }
+}
+
 void configSetup()
 {
     myPrefs.begin(PrefsNamespace, false);
@@ -29,11 +46,8 @@ void configSetup()
     default:
         break;
     }
-}
 
-void configLoop()
-{
-    // do nothing (yet)
+    controlJobs.every("energySave", ENERGY_SAVE_INTERVAL_MS, saveEnergyCounters, ENERGY_SAVE_INTERVAL_MS);
 }
 
 void factoryReset()
@@ -77,10 +91,24 @@ size_t putBool(const char *key, bool value)
 /// @param key The key to write.
 /// @param value The value to write.
 /// @return if successful: the number of bytes stored; 0 otherwise.
-size_t putString(const char *key, String value)
+size_t putString(const char *key, const char *value)
 {
-    bool setValue = myPrefs.isKey(key) ? myPrefs.getString(key) != value : true;
-    return setValue ? myPrefs.putString(key, value) : strlen(value.c_str());
+    char stored[PREF_STRING_BUFFER_SIZE];
+    bool setValue = myPrefs.isKey(key) ? myPrefs.getString(key, stored, sizeof(stored)) == 0 || strcmp(stored, value) != 0 : true;
+    return setValue ? myPrefs.putString(key, value) : strlen(value);
+}
+
+/// @brief Read a string value for a given key from myPrefs into value, without using the heap.
+/// @param key The key to read.
+/// @param defaultValue Used when the key is not there or the stored value does not fit into value.
+/// @param value Receives the value.
+template <size_t N>
+void getString(const char *key, const char *defaultValue, FixedString<N> &value)
+{
+    if (myPrefs.isKey(key) && myPrefs.getString(key, value.buffer(), value.bufferSize()) > 0)
+        value.sync();
+    else
+        value.assign(defaultValue);
 }
 
 /// @brief Store a value against a given key to myPrefs. Avoid writing, when the exakt key-value-pair is already stored.
@@ -106,6 +134,74 @@ void setBrightnessStep(uint8_t value)
 uint16_t transitionDurationMs() { return myPrefs.getUShort(PrefTransitionDurationMs, DEFAULT_TRANSITION_DURATION_MS); }
 void setTransitionDurationMs(uint16_t value) { putUShort(PrefTransitionDurationMs, value); }
 
+EasingCurve onEasingCurve()
+{
+    uint8_t value = myPrefs.getUChar(PrefOnEasingCurve, DEFAULT_ON_EASING_CURVE);
+    return isEasingCurve(value) ? (EasingCurve)value : DEFAULT_ON_EASING_CURVE;
+}
+void setOnEasingCurve(EasingCurve value) { putUChar(PrefOnEasingCurve, value); }
+
+EasingCurve nightLightEasingCurve()
+{
+    uint8_t value = myPrefs.getUChar(PrefNightLightEasingCurve, DEFAULT_NIGHTLIGHT_EASING_CURVE);
+    return isEasingCurve(value) ? (EasingCurve)value : DEFAULT_NIGHTLIGHT_EASING_CURVE;
+}
+void setNightLightEasingCurve(EasingCurve value) { putUChar(PrefNightLightEasingCurve, value); }
+
+uint16_t stripPowerDeciWatts() { return myPrefs.getUShort(PrefStripPower, DEFAULT_STRIP_POWER_DW); }
+void setStripPowerDeciWatts(uint16_t value) { putUShort(PrefStripPower, value); }
+
+bool energyCounters(LedStripEnergy &value)
+{
+    if (myPrefs.getBytesLength(PrefEnergyCounters) != sizeof(value))
+        return false;
+    return myPrefs.getBytes(PrefEnergyCounters, &value, sizeof(value)) == sizeof(value);
+}
+void setEnergyCounters(const LedStripEnergy &value)
+{
+    _pendingEnergy = value;
+    _energyPending = true;
+}
+
+bool nightLightRule(NightLightRule &value)
+{
+    if (myPrefs.getBytesLength(PrefNightLightRule) != sizeof(value))
+        return false;
+    return myPrefs.getBytes(PrefNightLightRule, &value, sizeof(value)) == sizeof(value);
+}
+void setNightLightRule(const NightLightRule &value)
+{
+    NightLightRule saved;
+    if (!nightLightRule(saved) || memcmp(&saved, &value, sizeof(value)) != 0)
+        myPrefs.putBytes(PrefNightLightRule, &value, sizeof(value));
+}
+
+bool nightLightGating(NightLightGating &value)
+{
+    if (myPrefs.getBytesLength(PrefRuleGating) != sizeof(value))
+        return false;
+    return myPrefs.getBytes(PrefRuleGating, &value, sizeof(value)) == sizeof(value);
+}
+void setNightLightGating(const NightLightGating &value)
+{
+    NightLightGating saved;
+    if (!nightLightGating(saved) || memcmp(&saved, &value, sizeof(value)) != 0)
+        myPrefs.putBytes(PrefRuleGating, &value, sizeof(value));
+}
+
+bool ldrCompensationTable(LdrCompensation &value)
+{
+    if (myPrefs.getBytesLength(PrefLdrCompensation) != sizeof(value))
+        return false;
+    return myPrefs.getBytes(PrefLdrCompensation, &value, sizeof(value)) == sizeof(value);
+}
+void setLdrCompensationTable(const LdrCompensation &value)
+{
+    LdrCompensation saved;
+    if (!ldrCompensationTable(saved) || memcmp(&saved, &value, sizeof(value)) != 0)
+        myPrefs.putBytes(PrefLdrCompensation, &value, sizeof(value));
+}
+
 uint8_t maxBrightness() { return myPrefs.getUChar(PrefMaxBrightness, DEFAULT_MAX_BRIGHTNESS); }
 void setMaxBrightness(uint8_t value) { putUChar(PrefMaxBrightness, value); }
 
@@ -151,14 +247,14 @@ void setMinStationaryTargetEnergy(uint8_t value) { putUChar(PrefMinStationaryTar
 uint8_t maxStationaryTargetEnergy() { return myPrefs.getUChar(PrefMaxStationaryTargetEnergy, DEFAULT_MAX_STATIONARY_TARGET_ENERGY); }
 void setMaxStationaryTargetEnergy(uint8_t value) { putUChar(PrefMaxStationaryTargetEnergy, value); }
 
-String getWifiHostname() { return myPrefs.getString(PrefWifiHostname, DEFAULT_WIFI_HOSTNAME); }
-void setWifiHostname(const String &value) { putString(PrefWifiHostname, value); }
+void getWifiHostname(WifiHostname &value) { getString(PrefWifiHostname, DEFAULT_WIFI_HOSTNAME, value); }
+void setWifiHostname(const char *value) { putString(PrefWifiHostname, value); }
 
-String getWifiApSsid() { return myPrefs.getString(PrefWifiApSsid, DEFAULT_WIFI_AP_SSID); }
-void setWifiApSsid(const String &value) { putString(PrefWifiApSsid, value); }
+void getWifiApSsid(WifiSsid &value) { getString(PrefWifiApSsid, DEFAULT_WIFI_AP_SSID, value); }
+void setWifiApSsid(const char *value) { putString(PrefWifiApSsid, value); }
 
-String getWifiApPassphrase() { return myPrefs.getString(PrefWifiApPassphrase, DEFAULT_WIFI_AP_PASSPHRASE); }
-void setWifiApPassphrase(const String &value) { putString(PrefWifiApPassphrase, value); }
+void getWifiApPassphrase(WifiPassphrase &value) { getString(PrefWifiApPassphrase, DEFAULT_WIFI_AP_PASSPHRASE, value); }
+void setWifiApPassphrase(const char *value) { putString(PrefWifiApPassphrase, value); }
 
 uint32_t wifiApIPv4Address() { return myPrefs.getLong(PrefWifiApIpAddress, DEFAULT_WIFI_AP_IP); }
 void setWifiAPpIPv4Address(uint32_t value) { putLong(PrefWifiApIpAddress, value); }
@@ -166,23 +262,23 @@ void setWifiAPpIPv4Address(uint32_t value) { putLong(PrefWifiApIpAddress, value)
 uint32_t wifiApIPv4Netmask() { return myPrefs.getLong(PrefWifiApNetmask, DEFAULT_WIFI_AP_NETMASK); }
 void setWifiAPpIPv4Netmask(uint32_t value) { putLong(PrefWifiApNetmask, value); }
 
-String getMqttServer() { return myPrefs.getString(PrefMqttServer, DEFAULT_MQTT_SERVER); }
-void setMqttServer(const String &value) { putString(PrefMqttServer, value); }
+void getMqttServer(MqttServer &value) { getString(PrefMqttServer, DEFAULT_MQTT_SERVER, value); }
+void setMqttServer(const char *value) { putString(PrefMqttServer, value); }
 
-String getMqttUsername() { return myPrefs.getString(PrefMqttUser, DEFAULT_MQTT_USER); }
-void setMqttUsername(const String &value) { putString(PrefMqttUser, value); }
+void getMqttUsername(MqttUsername &value) { getString(PrefMqttUser, DEFAULT_MQTT_USER, value); }
+void setMqttUsername(const char *value) { putString(PrefMqttUser, value); }
 
-String getMqttPassword() { return myPrefs.getString(PrefMqttPassword, DEFAULT_MQTT_PASSWORD); }
-void setMqttPassword(const String &value) { putString(PrefMqttPassword, value); }
+void getMqttPassword(MqttPassword &value) { getString(PrefMqttPassword, DEFAULT_MQTT_PASSWORD, value); }
+void setMqttPassword(const char *value) { putString(PrefMqttPassword, value); }
 
-String getWifiStaSsid() { return myPrefs.getString(PrefWifiStaSsid, DEFAULT_WIFI_STA_SSID); }
-void setWifiStaSsid(const String &value) { putString(PrefWifiStaSsid, value); }
+void getWifiStaSsid(WifiSsid &value) { getString(PrefWifiStaSsid, DEFAULT_WIFI_STA_SSID, value); }
+void setWifiStaSsid(const char *value) { putString(PrefWifiStaSsid, value); }
 
-String getWifiStaPassphrase() { return myPrefs.getString(PrefWifiStaPassphrase, DEFAULT_WIFI_STA_PASSPHRASE); }
-void setWifiStaPassphrase(const String &value) { putString(PrefWifiStaPassphrase, value); }
+void getWifiStaPassphrase(WifiPassphrase &value) { getString(PrefWifiStaPassphrase, DEFAULT_WIFI_STA_PASSPHRASE, value); }
+void setWifiStaPassphrase(const char *value) { putString(PrefWifiStaPassphrase, value); }
 
-String getWebAuthPassword() { return myPrefs.getString(PrefWebAuthPassword, DEFAULT_WEB_AUTH_PASSWORD); }
-void setWebAuthPassword(const String &value) { putString(PrefWebAuthPassword, value); }
+void getWebAuthPassword(WebAuthPassword &value) { getString(PrefWebAuthPassword, DEFAULT_WEB_AUTH_PASSWORD, value); }
+void setWebAuthPassword(const char *value) { putString(PrefWebAuthPassword, value); }
 
-String getWebAuthUsername() { return myPrefs.getString(PrefWebAuthUsername, DEFAULT_WEB_AUTH_USERNAME); }
-void setWebAuthUsername(const String &value) { putString(PrefWebAuthUsername, value); }
+void getWebAuthUsername(WebAuthUsername &value) { getString(PrefWebAuthUsername, DEFAULT_WEB_AUTH_USERNAME, value); }
+void setWebAuthUsername(const char *value) { putString(PrefWebAuthUsername, value); }
@@ -1,5 +1,7 @@
 #include "device_state.h"
 
+#include <atomic>
+
 #include <WebServer.h>
 #include <Button2.h>
 
@@ -13,6 +15,15 @@
 #include <presence.h>
 #include <webapi.h>
 #include <webinterface.h>
+#include <events.h>
+#include <commands.h>
+#include <profiler.h>
+#include <scheduler.h>
+#include <power.h>
+#include <clock.h>
+#include <rules.h>
+#include <boot.h>
+#include <history.h>
 
 State _state = State::OFF; // initial state is always OFF -> no light
 
@@ -27,6 +38,9 @@ uint8_t _maxBrightness = 0;              // Maximum allowed brightness
 uint8_t _stepBrightness = 0;             // Brightness will be in/decreased by this step value
 uint8_t _targetBrightness = 0;           // The target brightness. When it differs from the actual brightness, the actual brightness will be gradually modified to be equal.
 bool _ignoreMinusLongClick = false;      // To avoid unintentionally decreasing the night light brightness after decreasing regular brightness.
+EasingCurve _onEasingCurve = DEFAULT_ON_EASING_CURVE;                 // Transitions of the light follow this curve
+EasingCurve _nightLightEasingCurve = DEFAULT_NIGHTLIGHT_EASING_CURVE; // Transitions of the night light follow this curve
+EasingCurve _activeEasingCurve = DEFAULT_ON_EASING_CURVE;             // The curve of the mode the lamp is in, also used for switching that mode off
 
 unsigned long _lastTripleClickTs = 0;
 uint8_t _factoryResetCount = 0;
@@ -54,6 +68,33 @@ const ButtonNumber PlusButton = ButtonNumber::THREE; // The PLUS touch button.
 const ButtonNumber MinusButton = ButtonNumber::TWO;  // The MINUS touch button.
 const ButtonNumber OffButton = ButtonNumber::ONE;    // The OFF touch button.
 
+// The control loop sleeps until an event comes in or the next job is due, but at most this long. While a button is
+// touched or the LED strip is changing the loop has to run often, otherwise the state machine only needs a look now
+// and then (e.g. for the night light duration).
+const uint32_t ActiveLoopTimeoutMs = 10;
+const uint32_t IdleLoopTimeoutMs = 1000;
+const uint32_t HistoryPeriodMs = 1000; // One history sample per second
+// While WiFi is getting set up or serves the captive portal (DNS) the network loop runs at least this often. Once the
+// station is connected it only runs for WiFi events, web requests and due jobs, so the controller may sleep.
+const uint32_t NetworkLoopTimeoutMs = 10;
+
+// The control task (touch, sensors, state machine, LED strip) runs on the application core, above the Arduino loop task.
+const BaseType_t ControlTaskCore = 1;
+const UBaseType_t ControlTaskPriority = 3;
+const uint32_t ControlTaskStackSize = 8192;
+// The network task (WiFi state machine, DNS, web server) runs on the protocol core, below the WiFi and TCP/IP tasks.
+// Anything slow there (connecting, serving pages) can never delay a button press or a fade.
+const BaseType_t NetworkTaskCore = 0;
+const UBaseType_t NetworkTaskPriority = 2;
+const uint32_t NetworkTaskStackSize = 8192;
+
+SemaphoreHandle_t _deviceStateMutex = nullptr; // Held by the control task while it runs, see lockDeviceState()
+TaskHandle_t _controlTaskHandle = nullptr;
+TaskHandle_t _networkTaskHandle = nullptr;
+
+DeviceStateInfo _snapshot;                  // What getDeviceState() returns, see publishDeviceState()
+std::atomic<uint32_t> _snapshotSequence(0); // Odd while the control task writes _snapshot
+
 /*
   -------------------------
   ---- DEBUG functions ----
@@ -260,12 +301,6 @@ bool setNightLightModeAllowed(bool value = true)
   return changed;
 }
 
-// Checks whether the ldr measurement is low enough to warrant switching the night light on.
-bool isDarkEnoughForNightLight()
-{
-  return _ldrValue <= _nightLightThreshold;
-}
-
 bool isMovingTargetDetected()
 {
   if (!_prsInfo.movingTargetDetected)
@@ -299,7 +334,7 @@ bool isPresenceDetected()
 // Checks whether the night light should actually switched on.
 bool enableNightLight()
 {
-  return _allowNightLightMode && isDarkEnoughForNightLight() && isPresenceDetected();
+  return rulesNightLight();
 }
 
 // ToDo: add a function that gives distinguishable confirmations for "on" and "off"
@@ -314,6 +349,17 @@ void confirmViaLEDStrip(bool alsoConfirmValue = false, bool value = false)
   ledStripConfirm(alsoConfirmValue, value);
 }
 
+// Let the led strip show a signal pattern
+void signalViaLEDStrip(LedSignal signal)
+{
+  if (_debugUartMain != nullptr)
+  {
+    _debugUartMain->print(F("signal via LED strip: "));
+    _debugUartMain->println(signal);
+  }
+  ledStripSignal(signal);
+}
+
 // Set a target brightness
 void setTargetBrightness(uint8_t newTargetBrightness)
 {
@@ -340,16 +386,17 @@ void setState(State newState)
   _state = newState;
 }
 
-// Set _targetBrightness as actual brightness on the led strip
+// Set _targetBrightness as actual brightness on the led strip, the transition follows the curve of the active mode
 void setLEDStripBrightness()
 {
   if (_debugUartMain != nullptr)
   {
     _debugUartMain->print(F("set target brightness "));
     _debugUartMain->print(_targetBrightness);
-    _debugUartMain->println(F(" on LED strip"));
+    _debugUartMain->print(F(" on LED strip, curve "));
+    debugPrintEasingCurve(_debugUartMain, _activeEasingCurve, true);
   }
-  ledStripSetTargetBrightness(_targetBrightness);
+  ledStripSetTargetBrightness(_targetBrightness, _activeEasingCurve);
 }
 
 // Enable or disable ignoring a long click on the MINUS button.
@@ -378,26 +425,289 @@ void transitionToOn(uint8_t brightness)
   setState(START_TRANSIT_TO_ON);
 }
 
-void transitionToOn()
+void transitionToNightLight(uint8_t brightness)
+{
+  _nightLightBrightness = brightness;
+  setState(START_TRANSIT_TO_NIGHT_LIGHT);
+}
+
+/*
+
+  Actions of the state table (see state_table.h)
+  Each returns whether its transition takes place.
+
+*/
+
+// OFF: whether the night light should be switched on
+// ON: whether "off" means night light
+bool actionCheckNightLight()
+{
+  return enableNightLight();
+}
+
+// NIGHT_LIGHT_ON: whether the night light can be switched off again
+bool actionNightLightExpired()
+{
+  auto now = clockMillis();
+  // update the timestamp of the last presence detection (debounced, a flicker at the edge of the range does not count)
+  if (rulesPresence())
+  {
+    _nightLightEnabledTs = now;
+  }
+
+  // calculate the duration with no presence detection since switching on the night light
+  _noPresenceDuration = now - _nightLightEnabledTs;
+
+  // switch off the night light when the rule does not allow it any more or no presence has been detected for long enough, otherwise leave it on
+  if (rulesOverride() == RULE_OVERRIDE_ON)
+    return false;
+  return !rulesKeepNightLight() || (_noPresenceDuration > _nightLightOnDuration);
+}
+
+// Trigger the brightness change to target brightness.
+// Hint: use setTargetBrightness(...) to modify target brightness before.
+bool actionStartFadeOn()
+{
+  _activeEasingCurve = _onEasingCurve;
+  setLEDStripBrightness();
+  return true;
+}
+
+// Trigger the brightness change to 0.
+bool actionStartFadeOff()
+{
+  setTargetBrightness(0);
+  setLEDStripBrightness();
+  return true;
+}
+
+// Trigger the brightness change to night light brightness.
+bool actionStartFadeNightLight()
+{
+  _nightLightEnabledTs = clockMillis();
+  _activeEasingCurve = _nightLightEasingCurve;
+  setTargetBrightness(_nightLightBrightness);
+  setLEDStripBrightness();
+  return true;
+}
+
+// Whether the target brightness has been reached
+bool actionReachedOn()
+{
+  bool reached = ledStripCurrentBrightness() == ledStripTargetBrightness();
+  if (reached)
+    MONITOR_SERIAL.println(F("Lamp is ON"));
+  return reached;
+}
+
+// Whether the brightness has reached 0
+bool actionReachedOff()
+{
+  bool reached = ledStripCurrentBrightness() == 0;
+  if (reached)
+    MONITOR_SERIAL.println(F("Lamp is OFF"));
+  return reached;
+}
+
+// Whether the night light brightness has been reached
+bool actionReachedNightLight()
+{
+  bool reached = ledStripCurrentBrightness() == _nightLightBrightness;
+  if (reached)
+    MONITOR_SERIAL.println(F("Night Light is ON"));
+  return reached;
+}
+
+// switch on at configured brightness
+bool actionSwitchOn()
+{
+  setTargetBrightness(_onBrightness);
+  return true;
+}
+
+// when on toggle between max brightness and configured brightness
+bool actionToggleMaxBrightness()
 {
-  uint8_t brightness;
-  if (_state == ON)
+  setTargetBrightness(_targetBrightness < _maxBrightness ? _maxBrightness : _onBrightness);
+  return true;
+}
+
+// (re-)enable night light when lamp is off
+bool actionAllowNightLight()
+{
+  bool changed = setNightLightModeAllowed(true);
+  if (changed)
   {
-    // when on toggle between max brightness and configured brightness
-    brightness = _targetBrightness < _maxBrightness ? _maxBrightness : _onBrightness;
+    confirmViaLEDStrip(true, true);
   }
-  else
+  return true;
+}
+
+// disallow night light when the night light is switched on
+bool actionForbidNightLight()
+{
+  setNightLightModeAllowed(false);
+  return true;
+}
+
+// Set a new target brightness, when it is brighter than the current one
+bool increaseTargetBrightness(uint8_t newTargetBrightness)
+{
+  if (newTargetBrightness <= _targetBrightness)
   {
-    // switch on at configured brightness
-    brightness = _onBrightness;
+    debugClickIgnored(F("brightness is already at maximum"));
+    return false;
   }
-  transitionToOn(brightness);
+  debugPlus(false, _targetBrightness, newTargetBrightness);
+  setTargetBrightness(newTargetBrightness);
+  _onBrightness = newTargetBrightness;
+  return true;
 }
 
-void transitionToNightLight(uint8_t brightness)
+// ON: increase the brightness one step (up to maxBrightness), avoid overflow
+bool actionIncreaseBrightness()
 {
-  _nightLightBrightness = brightness;
-  setState(START_TRANSIT_TO_NIGHT_LIGHT);
+  uint16_t a = (uint16_t)_targetBrightness + _stepBrightness;
+  return increaseTargetBrightness((a > _maxBrightness) ? _targetBrightness : (uint8_t)a);
+}
+
+// OFF: switch on at one step
+bool actionIncreaseFromOff()
+{
+  return increaseTargetBrightness(_stepBrightness);
+}
+
+// NIGHT_LIGHT: increase the night light brightness one step (up to maxNightLightBrightness)
+bool actionIncreaseNightLight()
+{
+  // calculate new brightness, cap at half brightness
+  uint8_t newVal = _nightLightBrightness + _stepBrightness;
+  uint8_t newNightLightBrightness = (newVal > _maxNightLightBrightness) ? _nightLightBrightness : newVal;
+  if (newNightLightBrightness <= _nightLightBrightness)
+  {
+    debugClickIgnored(F("night light brightness is already at maximum"));
+    return false;
+  }
+  debugPlus(true, _nightLightBrightness, newNightLightBrightness);
+  _nightLightBrightness = newNightLightBrightness;
+  return true;
+}
+
+// ON: Decrease the brightness one step (down to stepBrightness), returns false when that means OFF
+bool actionDecreaseBrightness()
+{
+  // calculate new brightness
+  uint8_t step = _stepBrightness;
+  int16_t a = (int16_t)_targetBrightness - step;
+
+  // avoid underflow
+  if (a < step)
+  {
+    if (_debugUartMain != nullptr)
+    {
+      _debugUartMain->print(F(" => decrease brightness to "));
+      _debugUartMain->print(a);
+      _debugUartMain->print(F(", min value is "));
+      _debugUartMain->println(step);
+    }
+    setIgnoreMinusLongClick(true); // avoid decreasing night light brightness also simply by holding MINUS too long
+    return false;
+  }
+  uint8_t newTargetBrightness = (uint8_t)a;
+  debugMinus(false, _targetBrightness, newTargetBrightness);
+  setTargetBrightness(newTargetBrightness);
+  _onBrightness = newTargetBrightness;
+  return true;
+}
+
+// NIGHT_LIGHT: Decrease the night light brightness one step (down to stepBrightness, then
+//              in single steps down to 1)
+//              Will not decrease night light brightness when immediately before
+//              the regular brightness has been decreased to OFF
+bool actionDecreaseNightLight()
+{
+  // calculate new brightness, below one step continue in single steps down to 1
+  // (the LED strip dithers these, so even the lowest ones are distinct)
+  uint8_t step = _stepBrightness;
+  uint8_t newNightLightBrightness = (_nightLightBrightness >= 2 * step) ? _nightLightBrightness - step
+                                    : (_nightLightBrightness > 1)       ? _nightLightBrightness - 1
+                                                                       : _nightLightBrightness;
+  if (_ignoreMinusLongClick)
+  {
+    debugClickIgnored(F("button still pressed after decreasing on brightness to OFF"));
+    return false;
+  }
+  if (newNightLightBrightness >= _nightLightBrightness)
+  {
+    debugClickIgnored(F("night light brightness is already at minimum"));
+    return false;
+  }
+  debugMinus(true, _nightLightBrightness, newNightLightBrightness);
+  _nightLightBrightness = newNightLightBrightness;
+  return true;
+}
+
+bool actionIgnoreAlreadyOff()
+{
+  debugClickIgnored(F("light is already off"));
+  return false;
+}
+
+// saving the current brightness gives no visual feedback => signal as confirmation
+// confirm whether or not the preference has actually changed
+bool actionSaveOnBrightness()
+{
+  if (_targetBrightness != onBrightness())
+  {
+    setOnBrightness(_targetBrightness);
+  }
+  signalViaLEDStrip(LED_SIGNAL_SAVED);
+  return true;
+}
+
+bool actionSaveNightLight()
+{
+  if (_targetBrightness != nightLightBrightness())
+  {
+    setNightLightBrightness(_targetBrightness);
+  }
+  signalViaLEDStrip(LED_SIGNAL_SAVED);
+  return true;
+}
+
+bool actionNone() { return true; }
+
+// In the order of StateAction
+bool (*const STATE_ACTIONS[])() = {
+    actionNone,
+    actionCheckNightLight,
+    actionNightLightExpired,
+    actionStartFadeOn,
+    actionStartFadeOff,
+    actionStartFadeNightLight,
+    actionReachedOn,
+    actionReachedOff,
+    actionReachedNightLight,
+    actionSwitchOn,
+    actionToggleMaxBrightness,
+    actionAllowNightLight,
+    actionForbidNightLight,
+    actionIncreaseBrightness,
+    actionIncreaseFromOff,
+    actionIncreaseNightLight,
+    actionDecreaseBrightness,
+    actionDecreaseNightLight,
+    actionIgnoreAlreadyOff,
+    actionSaveOnBrightness,
+    actionSaveNightLight,
+};
+static_assert(sizeof(STATE_ACTIONS) / sizeof(STATE_ACTIONS[0]) == STATE_ACTION_COUNT, "one function per StateAction");
+
+// Look up the transition of the current state for an event, run its action and take the next state
+void dispatchStateEvent(StateEvent event)
+{
+  const StateTransition &transition = stateTransition(_state, event);
+  setState(STATE_ACTIONS[transition.action]() ? transition.next : transition.otherwise);
 }
 
 /*
@@ -417,7 +727,7 @@ void transitionToNightLight(uint8_t brightness)
 void ctrlClickOn(uint8_t btn)
 {
   debugButtonAndState(OnButton, single_click);
-  transitionToOn();
+  dispatchStateEvent(STATE_EVENT_SWITCH_ON);
 }
 
 // Handle double click on the ON button:
@@ -445,96 +755,13 @@ void ctrlLongClickOn(int8_t btn)
 
   // either save night light brightness or on brightness
   // but only, when the final brightness has been reached
-  switch (_state)
-  {
-  case NIGHT_LIGHT_ON:
-    if (_targetBrightness != nightLightBrightness())
-    {
-      setNightLightBrightness(_targetBrightness);
-    }
-    break;
-  case ON:
-    if (_targetBrightness != onBrightness())
-    {
-      setOnBrightness(_targetBrightness);
-    }
-    break;
-  default:
-    // default brightness not saved, no confirmation required
-    return;
-  }
-  // saving the current brightness gives no visual feedback => blink as confirmation
-  // confirm whether or not the preference has actually changed
-  confirmViaLEDStrip();
+  dispatchStateEvent(STATE_EVENT_SAVE_BRIGHTNESS);
 }
 
 // ----------------------------------------------
 // ---- PLUS button, single and long click ----
 // ----------------------------------------------
 
-// Increase the brightness of the current state
-// ON or OFF: increase the brightness one step (up to maxBrightness)
-// NIGHT_LIGHT: increase the night light brightness one step (up to maxNightLightBrightness)
-void handlePlus(uint8_t btn)
-{
-  bool isOffState = false;
-
-  switch (_state)
-  {
-  case START_TRANSIT_TO_NIGHT_LIGHT:
-  case TRANSIT_TO_NIGHT_LIGHT:
-  case NIGHT_LIGHT_ON:
-  {
-    // calculate new brightness, cap at half brightness
-    uint8_t newVal = _nightLightBrightness + _stepBrightness;
-    uint8_t newNightLightBrightness = (newVal > _maxNightLightBrightness) ? _nightLightBrightness : newVal;
-    if (newNightLightBrightness > _nightLightBrightness)
-    {
-      debugPlus(true, _nightLightBrightness, newNightLightBrightness);
-      transitionToNightLight(newNightLightBrightness);
-    }
-    else
-    {
-      debugClickIgnored(F("night light brightness is already at maximum"));
-    }
-    break;
-  }
-  case START_TRANSIT_TO_OFF:
-  case TRANSIT_TO_OFF:
-  case OFF:
-    isOffState = true;
-    // fall through
-  case START_TRANSIT_TO_ON:
-  case TRANSIT_TO_ON:
-  case ON:
-  {
-    // calculate new brightness, avoid overflow
-    uint8_t newTargetBrightness;
-    if (isOffState)
-    {
-      newTargetBrightness = _stepBrightness;
-    }
-    else
-    {
-      uint16_t a = (uint16_t)_targetBrightness + _stepBrightness;
-      newTargetBrightness = (a > _maxBrightness) ? _targetBrightness : (uint8_t)a;
-    }
-
-    if (newTargetBrightness > _targetBrightness)
-    {
-      debugPlus(false, _targetBrightness, newTargetBrightness);
-      setTargetBrightness(newTargetBrightness);
-      _onBrightness = newTargetBrightness;
-      setState(START_TRANSIT_TO_ON);
-    }
-    else
-    {
-      debugClickIgnored(F("brightness is already at maximum"));
-    }
-  }
-  }
-}
-
 // Handle single click on the PLUS button:
 // Increase the brightness of the current mode one step
 // ON or OFF: increase the brightness (up to maxBrightness)
@@ -542,7 +769,7 @@ void handlePlus(uint8_t btn)
 void ctrlClickPlus(uint8_t btn)
 {
   debugButtonAndState(PlusButton, single_click);
-  handlePlus(btn);
+  dispatchStateEvent(STATE_EVENT_PLUS);
 }
 
 // Handle long click on the PLUS button:
@@ -552,7 +779,7 @@ void ctrlClickPlus(uint8_t btn)
 void ctrlLongClickPlus(uint8_t btn)
 {
   debugButtonAndState(PlusButton, long_click);
-  handlePlus(btn);
+  dispatchStateEvent(STATE_EVENT_PLUS);
 }
 
 void ctrlTripleClick(ButtonNumber btnn)
@@ -560,7 +787,7 @@ void ctrlTripleClick(ButtonNumber btnn)
   debugButtonAndState(btnn, triple_click);
 
   // reset counter when last triple click was too long ago
-  auto now = millis();
+  auto now = clockMillis();
   if (now - _lastTripleClickTs > 2000)
   {
     if ((_factoryResetCount > 0 || _forceApModeCount > 0) && _debugUartMain != nullptr)
@@ -597,6 +824,11 @@ void ctrlTripleClick(ButtonNumber btnn)
     _debugUartMain->print(_factoryResetCount);
     _debugUartMain->println(F(" of 4"));
     _forceApModeCount = 0;
+    if (_factoryResetCount == 3)
+    {
+      // one more triple click resets the device
+      signalViaLEDStrip(LED_SIGNAL_FACTORY_RESET_WARNING);
+    }
   }
 
   _forceApModeCount = isForceAp ? _forceApModeCount + 1 : 0; // advance or reset
@@ -623,7 +855,7 @@ void ctrlTripleClick(ButtonNumber btnn)
     {
       _debugUartMain->println(F("Forcing AP mode."));
     }
-    confirmViaLEDStrip();
+    signalViaLEDStrip(LED_SIGNAL_AP_MODE);
     requestAPMode();
   }
 
@@ -638,73 +870,6 @@ void ctrlTripleClickOff(uint8_t btn) { ctrlTripleClick(OffButton); }
 // ---- MINUS button ----
 // ----------------------
 
-// Decrease the brightness of the current state
-// ON: Decrease the brightness one step (down to stepBrightness, then to OFF)
-// NIGHT_LIGHT: Decrease the night light brightness one step (down to stepBrightness)
-//              Will not decrease night light brightness when immediately before
-void handleMinus(uint8_t btn)
-{
-  switch (_state)
-  {
-  case START_TRANSIT_TO_NIGHT_LIGHT:
-  case TRANSIT_TO_NIGHT_LIGHT:
-  case NIGHT_LIGHT_ON:
-  {
-    // calculate new brightness, cap at half brightness
-    uint8_t step = _stepBrightness;
-    uint8_t newVal = _nightLightBrightness - step;
-    uint8_t newNightLightBrightness = (newVal < step) ? _nightLightBrightness : newVal;
-    if (_ignoreMinusLongClick)
-    {
-      debugClickIgnored(F("button still pressed after decreasing on brightness to OFF"));
-    }
-    else if (newNightLightBrightness < _nightLightBrightness)
-    {
-      debugMinus(true, _nightLightBrightness, newNightLightBrightness);
-      transitionToNightLight(newNightLightBrightness);
-    }
-    else
-    {
-      debugClickIgnored(F("night light brightness is already at minimum"));
-    }
-    break;
-  }
-  case START_TRANSIT_TO_OFF:
-  case TRANSIT_TO_OFF:
-  case OFF:
-    debugClickIgnored(F("light is already off"));
-    break;
-  case START_TRANSIT_TO_ON:
-  case TRANSIT_TO_ON:
-  case ON:
-    // calculate new brightness
-    uint8_t step = _stepBrightness;
-    int16_t a = (int16_t)_targetBrightness - step;
-
-    // avoid underflow
-    if (a < step)
-    {
-      if (_debugUartMain != nullptr)
-      {
-        _debugUartMain->print(F(" => decrease brightness to "));
-        _debugUartMain->print(a);
-        _debugUartMain->print(F(", min value is "));
-        _debugUartMain->println(step);
-      }
-      setIgnoreMinusLongClick(true); // avoid decreasing night light brightness also simply by holding MINUS too long
-      setState(START_TRANSIT_TO_OFF);
-    }
-    else
-    {
-      uint8_t newTargetBrightness = (uint8_t)a;
-      debugMinus(false, _targetBrightness, newTargetBrightness);
-      setTargetBrightness(newTargetBrightness);
-      _onBrightness = newTargetBrightness;
-      setState(START_TRANSIT_TO_ON);
-    }
-  }
-}
-
 // ------------------------------------
 // ---- MINUS button, single click ----
 // ------------------------------------
@@ -712,11 +877,11 @@ void handleMinus(uint8_t btn)
 // Handle single click on the MINUS button:
 // Decrease the brightness of the current mode one step
 // ON: Decrease the brightness down to stepBrightness, then to OFF
-// NIGHT_LIGHT: Decrease the night light brightness down to stepBrightness
+// NIGHT_LIGHT: Decrease the night light brightness down to stepBrightness, then down to 1
 void ctrlClickMinus(uint8_t btn)
 {
   debugButtonAndState(MinusButton, single_click);
-  handleMinus(btn);
+  dispatchStateEvent(STATE_EVENT_MINUS);
 }
 
 // ----------------------------------
@@ -726,11 +891,11 @@ void ctrlClickMinus(uint8_t btn)
 // Handle long click on the MINUS button:
 // Decrease the brightness of the current mode as long as the button is pressed
 // ON: Decrease the brightness down to stepBrightness, then to OFF
-// NIGHT_LIGHT: Decrease the night light brightness down to stepBrightness
+// NIGHT_LIGHT: Decrease the night light brightness down to stepBrightness, then down to 1
 void ctrlLongClickMinus(uint8_t btn)
 {
   debugButtonAndState(MinusButton, long_click);
-  handleMinus(btn);
+  dispatchStateEvent(STATE_EVENT_MINUS);
 }
 
 // --------------------------------
@@ -761,32 +926,7 @@ void ctrlReleasedMinus(uint8_t btn)
 void ctrlClickOff(uint8_t btn)
 {
   debugButtonAndState(OffButton, single_click);
-
-  switch (_state)
-  {
-  case NIGHT_LIGHT_ON:
-    setNightLightModeAllowed(false);
-    break;
-
-  case OFF:
-  {
-    bool changed = setNightLightModeAllowed(true);
-    if (changed)
-    {
-      confirmViaLEDStrip(true, true);
-    }
-    break;
-  }
-
-  case ON:
-    // light is to be turned off
-    // check whether "off" means OFF of night light
-    setState(enableNightLight() ? START_TRANSIT_TO_NIGHT_LIGHT : START_TRANSIT_TO_OFF);
-    break;
-
-  default:
-    break;
-  }
+  dispatchStateEvent(STATE_EVENT_OFF_CLICK);
 }
 
 // ----------------------------------
@@ -815,7 +955,7 @@ void ctrlLongClickOff(int8_t btn)
     setAllowNightLight(_allowNightLightMode);
   }
   // confirm whether or not the preference has actually changed
-  confirmViaLEDStrip();
+  signalViaLEDStrip(LED_SIGNAL_SAVED);
 }
 
 /*
@@ -824,11 +964,22 @@ void ctrlLongClickOff(int8_t btn)
 
 */
 
-DeviceStateInfo getDeviceState()
+void lockDeviceState()
+{
+  xSemaphoreTakeRecursive(_deviceStateMutex, portMAX_DELAY);
+}
+
+void unlockDeviceState()
+{
+  xSemaphoreGiveRecursive(_deviceStateMutex);
+}
+
+// Copy the live values into a snapshot, control task only
+void fillDeviceState(DeviceStateInfo &info)
 {
-  DeviceStateInfo info;
   info.allowNightLightMode = _allowNightLightMode;
   info.ldrValue = _ldrValue;
+  info.ldrNoise = ldrNoise();
   info.maxBrightness = _maxBrightness;
   info.maxNightLightBrightness = _maxNightLightBrightness;
   info.movingTargetDetected = isMovingTargetDetected();
@@ -854,8 +1005,36 @@ DeviceStateInfo getDeviceState()
   info.stepBrightness = _stepBrightness;
   info.brightness = _targetBrightness;
   info.transitionDurationMs = ledStripGetTransitionDuration();
+  info.onEasingCurve = _onEasingCurve;
+  info.nightLightEasingCurve = _nightLightEasingCurve;
 
   info.presenceDetected = info.movingTargetDetected && info.stationaryTargetDetected;
+}
+
+// Publish the snapshot readers get. A seqlock: the sequence is odd while the snapshot is being written, a reader
+// retries when it has seen an odd sequence or the sequence has changed while it copied.
+void publishDeviceState()
+{
+  uint32_t sequence = _snapshotSequence.load(std::memory_order_relaxed);
+  _snapshotSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fillDeviceState(_snapshot);
+  _snapshot.generation = sequence / 2 + 1;
+  _snapshotSequence.store(sequence + 2, std::memory_order_release);
+}
+
+DeviceStateInfo getDeviceState()
+{
+  DeviceStateInfo info;
+  uint32_t before;
+  uint32_t after;
+  do
+  {
+    before = _snapshotSequence.load(std::memory_order_acquire);
+    info = _snapshot;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = _snapshotSequence.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
   return info;
 }
 
@@ -902,6 +1081,8 @@ void modifyMaxBrightness(uint8_t value)
 
 void modifyBrightnessStep(uint8_t value) { _stepBrightness = value; }
 void modifyTransitionDurationMs(uint16_t value) { ledStripSetTransitionDuration(value); }
+void modifyOnEasingCurve(EasingCurve value) { _onEasingCurve = value; }
+void modifyNightLightEasingCurve(EasingCurve value) { _nightLightEasingCurve = value; }
 void modifyMaxMovingTargetDistance(uint16_t value) { _maxMovingTargetDistance = value; }
 void modifyMinMovingTargetDistance(uint16_t value) { _minMovingTargetDistance = value; }
 void modifyMaxMovingTargetEnergy(uint8_t value) { _maxMovingTargetEnergy = value; }
@@ -913,155 +1094,115 @@ void modifyMinStationaryTargetEnergy(uint8_t value) { _minStationaryTargetEnergy
 
 void modifyLightState(bool lampOn)
 {
-  if (lampOn)
-  {
-    transitionToOn();
-  }
-  else
-  {
-    setState(START_TRANSIT_TO_OFF);
-  }
-  
+  dispatchStateEvent(lampOn ? STATE_EVENT_SWITCH_ON : STATE_EVENT_SWITCH_OFF);
 }
 
-/*
-
-  State handlers
-
-*/
+void modifyLdrCalibration(bool start)
+{
+  if (!start)
+    ldrCancelCalibration();
+  else if (_state == OFF)
+    ldrStartCalibration(_maxBrightness);
+}
 
-// When the lamp is off or turning off: check whether the night light should be switched on.
-State nightLightCheckOff()
+// Take the necessary actions for the current state.
+void handleState()
 {
-  return enableNightLight() ? State::START_TRANSIT_TO_NIGHT_LIGHT : State::OFF;
+  // hand the inputs to the night light rule, it only evaluates again what has changed. It does so in every state, so
+  // pending dwell times follow their inputs even while the night light is not asked for.
+  rulesSetAllowed(_allowNightLightMode);
+  rulesSetLdr(_ldrValue, _nightLightThreshold);
+  rulesSetPresence(isPresenceDetected());
+  rulesUpdate();
+  // the LDR calibration drives the strip, the state machine stays put until it is done or a button took over
+  if (ldrCalibrating())
+    return;
+  dispatchStateEvent(STATE_EVENT_TICK);
 }
 
-// When the night light is on: check whether the night light can be switched off again.
-State nightLightCheckOn()
+// One pass of the control task: touch, sensors, state machine and LED strip
+void controlLoop()
 {
-  auto now = millis();
-  // update the timestamp of the last presence detection
-  if (isPresenceDetected())
-  {
-    _nightLightEnabledTs = now;
-  }
+  // sleep until something happens or the next job is due instead of busy polling
+  uint32_t timeoutMs = touchActive() || !ledStripIdle() ? ActiveLoopTimeoutMs : IdleLoopTimeoutMs;
+  waitForEvents(min(timeoutMs, controlJobs.msUntilNextDue()));
+  lockDeviceState();
+  PROFILE_START(loopStart);
+
+  // read ldr and radar presence sensor, save preferences, ... as far as due
+  PROFILED(PROFILE_CONTROL_JOBS, controlJobs.run());
+  _ldrValue = averagedBrightness();
+  _prsInfo = presenceInfo();
+  // check touch buttons
+  PROFILED(PROFILE_TOUCH, touchLoop());
+  // apply what came in via web api or web interface
+  PROFILED(PROFILE_COMMANDS, commandsLoop());
+  // check whether buttons or ldr or presence sensor require a state change
+  PROFILED(PROFILE_STATE, handleState());
+  // set LED strip accordingly
+  PROFILED(PROFILE_LED_STRIP, ledStripLoop());
+  // let the controller slow down or sleep, as far as the lamp allows
+  powerUpdate(touchActive() || !ledStripIdle(), _state == OFF && ledStripIdle() && !_prsInfo.presenceDetected);
 
-  // calculate the duration with no presence detection since switching on the night light
-  _noPresenceDuration = now - _nightLightEnabledTs;
+  // hand a consistent view to the other tasks
+  publishDeviceState();
 
-  // switch off the night light when night light mode is not allowed any more or no presence has been detected for long enough, otherwise leave it on
-  return (!_allowNightLightMode || (_noPresenceDuration > _nightLightOnDuration)) ? START_TRANSIT_TO_OFF : NIGHT_LIGHT_ON;
+  PROFILE_STOP(PROFILE_LOOP, loopStart);
+  unlockDeviceState();
 }
 
-// Trigger the brightness change to target brightness.
-// Hint: use setTargetBrightness(...) to modify target brightness before calling this.
-State startTransitToOn()
+// One pass of the network task: WiFi state machine, DNS and web server
+void networkLoop()
 {
-  setLEDStripBrightness();
-  return TRANSIT_TO_ON;
-}
+  WifiState wifiState = wifiCurrentState().currentState;
+  bool polling = wifiState != STA_OK && wifiState != NO_WIFI_PERM;
+  waitForNetworkWake(polling ? min(NetworkLoopTimeoutMs, networkJobs.msUntilNextDue()) : networkJobs.msUntilNextDue());
 
-// Checks whether a target brightness has been reached. Returns onBrightnessReached when reached, current state otherwise.
-State checkTransitToBrightness(uint8_t target, State onBrightnessReached)
-{
-  uint8_t ledBrightness = ledStripCurrentBrightness();
-  bool brightnessReached = (ledBrightness == target);
-  return brightnessReached ? onBrightnessReached : _state;
-}
+  PROFILED(PROFILE_NETWORK_JOBS, networkJobs.run());
 
-// Stay in TRANSIT_TO_ON as long as the target brightness has not been reached, then switch to ON.
-State transitToOn()
-{
-  State next = checkTransitToBrightness(ledStripTargetBrightness(), ON);
-  if (next == ON)
-    MONITOR_SERIAL.println(F("Lamp is ON"));
-  return next;
-}
+  powerLoop();
 
-// Trigger the brightness change to 0.
-State startTransitToOff()
-{
-  setTargetBrightness(0);
-  setLEDStripBrightness();
-  return TRANSIT_TO_OFF;
-}
+  PROFILED(PROFILE_WIFI, wifiLoop());
 
-// Stay in TRANSIT_TO_OFF as long as the target brightness (0) has not been reached, then switch to OFF.
-State transitToOff()
-{
-  State next = checkTransitToBrightness(0, State::OFF);
-  if (next == State::OFF)
-    MONITOR_SERIAL.println(F("Lamp is OFF"));
-  return next;
+  PROFILED(PROFILE_WEB_API, webApiLoop());
+
+  PROFILED(PROFILE_WEB_INTERFACE, webInterfaceLoop());
 }
 
-// Trigger the brightness change to night light brightness.
-State startTransitToNightLight()
+void controlTask(void *parameter)
 {
-  _nightLightEnabledTs = millis();
-  setTargetBrightness(_nightLightBrightness);
-  setLEDStripBrightness();
-  return TRANSIT_TO_NIGHT_LIGHT;
+  for (;;)
+    controlLoop();
 }
 
-// Stay in TRANSIT_TO_NIGHT_LIGHT as long as the target brightness has not been reached, then switch to NIGHT_LIGHT_ON.
-State transitToNightLight()
+void networkTask(void *parameter)
 {
-  State next = (ledStripCurrentBrightness() == _nightLightBrightness) ? NIGHT_LIGHT_ON : _state;
-  if (next == NIGHT_LIGHT_ON)
-    MONITOR_SERIAL.println(F("Night Light is ON"));
-  return next;
+  // bring up WiFi and the web server while the setup task brings up the lamp
+  bootRun(BOOT_RUNNER_NETWORK);
+  for (;;)
+    networkLoop();
 }
 
-// Take the necessary actions for the current state.
-void handleState()
-{
-  State nextState;
+/*
+  -------------------------
+  Boot jobs
+  -------------------------
+*/
 
-  switch (_state)
-  {
-  case OFF:
-    nextState = nightLightCheckOff();
-    break;
-  case START_TRANSIT_TO_ON:
-    nextState = startTransitToOn();
-    break;
-  case TRANSIT_TO_ON:
-    nextState = transitToOn();
-    break;
-  case ON:
-    return; // nothing to do, wait for a pressed button
-  case START_TRANSIT_TO_OFF:
-    nextState = startTransitToOff();
-    break;
-  case TRANSIT_TO_OFF:
-    nextState = transitToOff();
-    break;
-  case START_TRANSIT_TO_NIGHT_LIGHT:
-    nextState = startTransitToNightLight();
-    break;
-  case TRANSIT_TO_NIGHT_LIGHT:
-    nextState = transitToNightLight();
-    break;
-  case NIGHT_LIGHT_ON:
-    nextState = nightLightCheckOn();
-    break;
-  default:
-    // ToDo? this should never happen -> emit an error message?
-    return;
-    break;
-  }
-  setState(nextState);
+// Things every other job relies on: events, commands, power management, profiler
+void bootCore()
+{
+  eventsSetup();
+  powerDebug(MONITOR_SERIAL);
+  powerSetup();
+  commandsSetup();
+  _deviceStateMutex = xSemaphoreCreateRecursiveMutex();
+  profilerDebug(MONITOR_SERIAL);
+  profilerSetup();
 }
 
-void deviceSetup()
+void bootConfig()
 {
-  MONITOR_SERIAL.begin(115200);
-  _debugUartMain = &MONITOR_SERIAL;
-
-  delay(500);
-  MONITOR_SERIAL.println(F("ESP32 LED Night Light initializing ..."));
-
   configSetup();
   _allowNightLightMode = allowNightLight();
   _nightLightOnDuration = nightLightOnDuration() * 1000;
@@ -1074,6 +1215,8 @@ void deviceSetup()
   _onBrightness = onBrightness();
   _maxBrightness = maxBrightness();
   _stepBrightness = brightnessStep();
+  _onEasingCurve = onEasingCurve();
+  _nightLightEasingCurve = nightLightEasingCurve();
 
   _maxMovingTargetDistance = maxMovingTargetDistance();
   _minMovingTargetDistance = minMovingTargetDistance();
@@ -1084,20 +1227,25 @@ void deviceSetup()
   _minStationaryTargetDistance = minStationaryTargetDistance();
   _maxStationaryTargetEnergy = maxStationaryTargetEnergy();
   _minStationaryTargetEnergy = minStationaryTargetEnergy();
+  rulesSetup();
+}
 
-  wifiDebug(MONITOR_SERIAL);
-  wifiSetup();
-
-  // touchDebug(MONITOR_SERIAL);
-  touchSetup();
-
-  ldrSetup();
-
-  presenceDebug(MONITOR_SERIAL);
-  presenceSetup();
+void bootNetworkTask()
+{
+  xTaskCreatePinnedToCore(networkTask, "network", NetworkTaskStackSize, nullptr, NetworkTaskPriority,
+                          &_networkTaskHandle, NetworkTaskCore);
+}
 
+void bootLedStrip()
+{
   // ledStripDebug(MONITOR_SERIAL);
   ledStripSetup();
+}
+
+void bootTouch()
+{
+  // touchDebug(MONITOR_SERIAL);
+  touchSetup();
 
   // --- ON button ---
   // normal click: switch LED strip on
@@ -1134,36 +1282,123 @@ void deviceSetup()
   setLongClickHandler(OffButton, ctrlLongClickOff);
   // triple click: detect 'force AP' and 'factory reset' command
   setTripleClickHandler(OffButton, ctrlTripleClickOff);
+}
 
+void bootPresence()
+{
+  presenceDebug(MONITOR_SERIAL);
+  presenceSetup();
+}
+
+// Job: keep a history of what the sensors saw and what the lamp did, to tune the thresholds and the presence zone
+void recordHistory()
+{
+  HistorySample sample = {};
+  sample.ldr = _ldrValue;
+  if (_prsInfo.movingTargetDetected)
+  {
+    sample.distance = _prsInfo.movingTargetDistance;
+    sample.energy = _prsInfo.movingTargetEnergy;
+  }
+  else if (_prsInfo.stationaryTargetDetected)
+  {
+    sample.distance = _prsInfo.stationaryTargetDistance;
+    sample.energy = _prsInfo.stationaryTargetEnergy;
+  }
+  sample.presence = isPresenceDetected() ? 1 : 0;
+  sample.state = _state;
+  historyAppend(sample);
+}
+
+void bootHistory()
+{
+  controlJobs.every("history", HistoryPeriodMs, recordHistory);
+}
+
+// From here on the lamp responds to the buttons
+void bootControlTask()
+{
+  publishDeviceState();
+  xTaskCreatePinnedToCore(controlTask, "control", ControlTaskStackSize, nullptr, ControlTaskPriority,
+                          &_controlTaskHandle, ControlTaskCore);
+}
+
+void bootWifi()
+{
+  wifiDebug(MONITOR_SERIAL);
+  wifiSetup();
+}
+
+void bootWebApi()
+{
   webApiDebug(MONITOR_SERIAL);
   webApiSetup();
+}
 
+void bootWebInterface()
+{
   webInterfaceDebug(MONITOR_SERIAL);
   webInterfaceSetup();
-
-  MONITOR_SERIAL.println(F("ESP32 LED Night Light initialized, light is OFF"));
 }
 
-void deviceLoop()
+// Index of a job in BOOT_JOBS
+enum DeviceBootJob : uint8_t
 {
-  wifiLoop();
+  BOOT_CORE,
+  BOOT_CONFIG,
+  BOOT_NETWORK_TASK,
+  BOOT_LED_STRIP,
+  BOOT_TOUCH,
+  BOOT_LDR,
+  BOOT_PRESENCE,
+  BOOT_HISTORY,
+  BOOT_CONTROL_TASK,
+  BOOT_WIFI,
+  BOOT_WEB_API,
+  BOOT_WEB_INTERFACE,
+  DEVICE_BOOT_JOB_COUNT
+};
+
+// The startup. The setup task brings up the control path and starts the control task as soon as that is done, the
+// network task brings up WiFi and the web server at the same time on the other core. Jobs that register scheduler
+// jobs run on the task owning that scheduler, or before it is started.
+constexpr BootJob BOOT_JOBS[DEVICE_BOOT_JOB_COUNT] = {
+    {"core", BOOT_RUNNER_SETUP, 0, bootCore},
+    {"config", BOOT_RUNNER_SETUP, bootBit(BOOT_CORE), bootConfig},
+    {"networkTask", BOOT_RUNNER_SETUP, bootBit(BOOT_CORE), bootNetworkTask},
+    {"ledStrip", BOOT_RUNNER_SETUP, bootBit(BOOT_CONFIG), bootLedStrip},
+    {"touch", BOOT_RUNNER_SETUP, bootBit(BOOT_CORE), bootTouch},
+    {"ldr", BOOT_RUNNER_SETUP, bootBit(BOOT_CONFIG), ldrSetup},
+    {"presence", BOOT_RUNNER_SETUP, bootBit(BOOT_CONFIG), bootPresence},
+    {"history", BOOT_RUNNER_SETUP, bootBit(BOOT_CORE), bootHistory},
+    {"controlTask", BOOT_RUNNER_SETUP,
+     bootBit(BOOT_CONFIG) | bootBit(BOOT_LED_STRIP) | bootBit(BOOT_TOUCH) | bootBit(BOOT_LDR) | bootBit(BOOT_PRESENCE) |
+         bootBit(BOOT_HISTORY),
+     bootControlTask},
+    {"wifi", BOOT_RUNNER_NETWORK, bootBit(BOOT_CONFIG), bootWifi},
+    {"webApi", BOOT_RUNNER_NETWORK, bootBit(BOOT_CONFIG), bootWebApi},
+    {"webInterface", BOOT_RUNNER_NETWORK, bootBit(BOOT_WEB_API), bootWebInterface},
+};
+static_assert(bootJobsValid(BOOT_JOBS, DEVICE_BOOT_JOB_COUNT), "BOOT_JOBS: a job depends on a later one");
 
-  // handle preferences
-  configLoop();
-  // read ldr
-  ldrLoop();
-  _ldrValue = averagedBrightness();
-  // read radar presence sensor
-  presenceLoop();
-  _prsInfo = presenceInfo();
-  // check touch buttons
-  touchLoop();
-  // check whether buttons or ldr or presence sensor require a state change
-  handleState();
-  // set LED strip accordingly
-  ledStripLoop();
+void deviceSetup()
+{
+  MONITOR_SERIAL.begin(115200);
+  _debugUartMain = &MONITOR_SERIAL;
+
+  MONITOR_SERIAL.println(F("ESP32 LED Night Light initializing ..."));
 
-  webApiLoop();
+  bootSetup(BOOT_JOBS, DEVICE_BOOT_JOB_COUNT);
+  bootRun(BOOT_RUNNER_SETUP);
+  // the lamp is up, the network may still be on its way
+  bootWait();
+  bootReport(MONITOR_SERIAL);
 
-  webInterfaceLoop();
-}
\ No newline at end of file
+  MONITOR_SERIAL.println(F("ESP32 LED Night Light initialized"));
+}
+
+void deviceLoop()
+{
+  // all work is done by the control and the network task, the Arduino loop task is not needed anymore
+  vTaskDelete(nullptr);
+}
@@ -0,0 +1,83 @@
+#include <easing.h>
+
+static const uint8_t STEP_SHIFT = 12;  // EASING_ONE / EASING_STEPS == 1 << STEP_SHIFT
+static_assert((EASING_ONE >> STEP_SHIFT) == EASING_STEPS,
+              "EASING_STEPS must match STEP_SHIFT");
+
+// The progress of all curves at the end of each step, calculated by the
+// compiler. At runtime a curve is a table lookup plus a linear interpolation.
+struct EasingTable {
+    uint16_t progress[EASING_CURVE_COUNT][EASING_STEPS + 1];
+
+    constexpr EasingTable() : progress() {
+        // 2^(10 / EASING_STEPS), the growth per step of the exponential curve
+        const double growth = 2.378414230005442;
+        double exponential = 1.0;
+        for (uint8_t step = 0; step <= EASING_STEPS; step++) {
+            double t = (double)step / EASING_STEPS;
+            double inOut = t * t * (3.0 - 2.0 * t);  // smoothstep
+            progress[EASE_LINEAR][step] = toFixed(t);
+            progress[EASE_IN_OUT][step] = toFixed(inOut);
+            progress[EASE_EXPONENTIAL][step] =
+                toFixed((exponential - 1.0) / 1023.0);
+            progress[EASE_PERCEPTUAL][step] = toFixed(t);
+            exponential *= growth;
+        }
+        // avoid rounding errors at the very end
+        for (uint8_t curve = 0; curve < EASING_CURVE_COUNT; curve++) {
+            progress[curve][EASING_STEPS] = EASING_ONE;
+        }
+    }
+
+    static constexpr uint16_t toFixed(double value) {
+        return (uint16_t)(value * EASING_ONE + 0.5);
+    }
+};
+
+static constexpr EasingTable EASING_TABLE;
+static_assert(EASING_TABLE.progress[EASE_EXPONENTIAL][0] == 0,
+              "curves must start at 0");
+static_assert(EASING_TABLE.progress[EASE_IN_OUT][EASING_STEPS / 2] ==
+                  EASING_ONE / 2,
+              "ease in out must be symmetric");
+
+bool isEasingCurve(uint8_t value) { return value < EASING_CURVE_COUNT; }
+
+uint16_t easingStepProgress(EasingCurve curve, uint8_t step) {
+    if (!isEasingCurve(curve)) curve = EASE_LINEAR;
+    if (step > EASING_STEPS) step = EASING_STEPS;
+    return EASING_TABLE.progress[curve][step];
+}
+
+uint16_t easingProgress(EasingCurve curve, uint16_t t) {
+    if (!isEasingCurve(curve)) curve = EASE_LINEAR;
+    if (t >= EASING_ONE) return EASING_ONE;
+    uint8_t step = t >> STEP_SHIFT;
+    uint16_t fraction = t & ((1 << STEP_SHIFT) - 1);
+    const uint16_t *p = EASING_TABLE.progress[curve];
+    int32_t delta = (int32_t)p[step + 1] - (int32_t)p[step];
+    return p[step] + (uint16_t)((delta * fraction) >> STEP_SHIFT);
+}
+
+void debugPrintEasingCurve(Stream *stream, EasingCurve curve, bool addPrintln) {
+    if (stream != nullptr) {
+        switch (curve) {
+            case EASE_LINEAR:
+                stream->print(F("EASE_LINEAR"));
+                break;
+            case EASE_IN_OUT:
+                stream->print(F("EASE_IN_OUT"));
+                break;
+            case EASE_EXPONENTIAL:
+                stream->print(F("EASE_EXPONENTIAL"));
+                break;
+            case EASE_PERCEPTUAL:
+                stream->print(F("EASE_PERCEPTUAL"));
+                break;
+            default:
+                stream->print(F("UNKNOWN EasingCurve - THIS IS A BUG"));
+                break;
+        }
+        if (addPrintln) stream->println();
+    }
+}
@@ -0,0 +1,63 @@
+#include <events.h>
+
+// Events posted faster than the loop takes them are dropped, the loop runs
+// anyway as long as the queue is not empty.
+static const UBaseType_t EVENT_QUEUE_LENGTH = 16;
+
+QueueHandle_t _eventQueue = nullptr;
+SemaphoreHandle_t _networkWake = nullptr; // Given to wake the network task, wakeups in between collapse into one
+
+void eventsSetup()
+{
+    if (_eventQueue == nullptr)
+        _eventQueue = xQueueCreate(EVENT_QUEUE_LENGTH, sizeof(DeviceEvent));
+    if (_networkWake == nullptr)
+        _networkWake = xSemaphoreCreateBinary();
+}
+
+void postEvent(DeviceEvent event)
+{
+    if (_eventQueue != nullptr)
+        xQueueSend(_eventQueue, &event, 0);
+}
+
+bool ARDUINO_ISR_ATTR postEventFromISR(DeviceEvent event)
+{
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    if (_eventQueue != nullptr)
+        xQueueSendFromISR(_eventQueue, &event, &higherPriorityTaskWoken);
+    return higherPriorityTaskWoken == pdTRUE;
+}
+
+uint32_t waitForEvents(uint32_t timeoutMs)
+{
+    if (_eventQueue == nullptr)
+    {
+        delay(timeoutMs);
+        return 0;
+    }
+    uint32_t events = 0;
+    DeviceEvent event;
+    if (xQueueReceive(_eventQueue, &event, pdMS_TO_TICKS(timeoutMs)) == pdTRUE)
+    {
+        events |= eventBit(event);
+        // take everything that has piled up, one loop pass handles it all
+        while (xQueueReceive(_eventQueue, &event, 0) == pdTRUE)
+            events |= eventBit(event);
+    }
+    return events;
+}
+
+void wakeNetworkTask()
+{
+    if (_networkWake != nullptr)
+        xSemaphoreGive(_networkWake);
+}
+
+void waitForNetworkWake(uint32_t timeoutMs)
+{
+    if (_networkWake == nullptr)
+        delay(timeoutMs);
+    else
+        xSemaphoreTake(_networkWake, timeoutMs == UINT32_MAX ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs));
+}
@@ -0,0 +1,394 @@
+#include <history.h>
+#include <clock.h>
+
+// A record: varint (duration << HISTORY_FIELD_COUNT | bit set of the changed fields), then a zigzag varint delta per
+// changed field. This is the most one can take.
+static const uint8_t MAX_RECORD_BYTES = 5 + HISTORY_FIELD_COUNT * 3;
+// Longer runs get split, the duration has to fit the varint
+static const uint32_t MAX_RECORD_SECONDS = HISTORY_SECONDS;
+
+// A field only counts as changed once it has moved further than this from the value the open record holds, in
+// HistoryField order. The filtered LDR value, the distance and the energy of a target wander by a few counts from
+// second to second, without the dead band nearly every second would make a record.
+static const uint16_t DEAD_BAND[HISTORY_FIELD_COUNT] = {16, 32, 12, 0, 0};
+
+static const char *WINDOW_NAMES[HISTORY_WINDOW_COUNT] = {"lastHour", "lastDay"};
+
+struct HistoryBlock
+{
+    uint32_t seq;         // Counts up with each block started
+    uint32_t startSecond; // Start of the first record
+    uint16_t used;
+    uint8_t data[HISTORY_BLOCK_BYTES];
+};
+
+// The aggregates of the samples within a bucket of time
+struct HistoryBucket
+{
+    uint32_t id; // second / bucket seconds
+    uint16_t count;
+    uint16_t ldrMin;
+    uint16_t ldrMax;
+    uint32_t ldrSum;
+    uint16_t presenceCount;
+    uint16_t targetCount;
+    uint16_t distanceMin;
+    uint16_t distanceMax;
+    uint32_t distanceSum;
+    uint16_t lampOnCount;
+};
+
+struct HistoryWindowConfig
+{
+    uint32_t bucketSeconds;
+    uint8_t buckets;
+    uint8_t firstBucket; // in _buckets
+};
+
+static const HistoryWindowConfig WINDOWS[HISTORY_WINDOW_COUNT] = {{5 * 60, 12, 0}, {60 * 60, 24, 12}};
+static const uint8_t BUCKET_COUNT = 12 + 24;
+
+HistoryBlock _historyBlocks[HISTORY_BLOCKS];
+uint8_t _oldestBlock = 0;
+uint8_t _blockCount = 0;
+uint32_t _nextBlockSeq = 0;
+uint16_t _blockValues[HISTORY_FIELD_COUNT] = {0}; // Values of the last record in the newest block
+uint32_t _recordCount = 0;
+
+// The record still being written: its values held since _openSecond
+bool _recordOpen = false;
+uint16_t _openValues[HISTORY_FIELD_COUNT] = {0};
+uint32_t _openSecond = 0;
+uint32_t _lastSecond = 0;
+
+HistoryBucket _buckets[BUCKET_COUNT];
+
+uint8_t putVarint(uint8_t *out, uint32_t value)
+{
+    uint8_t length = 0;
+    while (value >= 0x80)
+    {
+        out[length++] = (value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    out[length++] = value;
+    return length;
+}
+
+bool getVarint(const uint8_t *data, uint16_t used, uint16_t &pos, uint32_t &value)
+{
+    value = 0;
+    for (uint8_t shift = 0; pos < used && shift < 35; shift += 7)
+    {
+        uint8_t byte = data[pos++];
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+void toValues(const HistorySample &sample, uint16_t *values)
+{
+    values[HISTORY_LDR] = sample.ldr;
+    values[HISTORY_DISTANCE] = sample.distance;
+    values[HISTORY_ENERGY] = sample.energy;
+    values[HISTORY_PRESENCE] = sample.presence;
+    values[HISTORY_STATE] = sample.state;
+}
+
+// Whether all values are within the dead band of the values of the open record
+bool withinDeadBand(const uint16_t *values)
+{
+    for (uint8_t field = 0; field < HISTORY_FIELD_COUNT; field++)
+    {
+        uint16_t difference = values[field] > _openValues[field] ? values[field] - _openValues[field]
+                                                                 : _openValues[field] - values[field];
+        if (difference > DEAD_BAND[field])
+            return false;
+    }
+    return true;
+}
+
+HistoryBlock &blockAt(uint8_t age) { return _historyBlocks[(_oldestBlock + age) % HISTORY_BLOCKS]; }
+
+HistoryBlock *findBlock(uint32_t seq)
+{
+    if (_blockCount == 0 || seq < blockAt(0).seq || seq - blockAt(0).seq >= _blockCount)
+        return nullptr;
+    return &blockAt(seq - blockAt(0).seq);
+}
+
+void dropOldestBlock()
+{
+    _oldestBlock = (_oldestBlock + 1) % HISTORY_BLOCKS;
+    _blockCount--;
+}
+
+void startBlock(uint32_t second)
+{
+    if (_blockCount == HISTORY_BLOCKS)
+        dropOldestBlock();
+    _blockCount++;
+    HistoryBlock &block = blockAt(_blockCount - 1);
+    block.seq = _nextBlockSeq++;
+    block.startSecond = second;
+    block.used = 0;
+    memset(_blockValues, 0, sizeof(_blockValues));
+}
+
+uint8_t encodeRecord(uint8_t *out, uint32_t duration, const uint16_t *values, const uint16_t *previous)
+{
+    uint8_t changed = 0;
+    for (uint8_t field = 0; field < HISTORY_FIELD_COUNT; field++)
+    {
+        if (values[field] != previous[field])
+            changed |= 1 << field;
+    }
+    uint8_t length = putVarint(out, duration << HISTORY_FIELD_COUNT | changed);
+    for (uint8_t field = 0; field < HISTORY_FIELD_COUNT; field++)
+    {
+        if (changed & (1 << field))
+            length += putVarint(out + length, zigzag((int32_t)values[field] - previous[field]));
+    }
+    return length;
+}
+
+// Decode the record at pos, values hold the ones before and get updated. False at the end of the block.
+bool decodeRecord(const HistoryBlock &block, uint16_t &pos, uint32_t &duration, uint16_t *values)
+{
+    uint32_t header;
+    if (!getVarint(block.data, block.used, pos, header))
+        return false;
+    duration = header >> HISTORY_FIELD_COUNT;
+    for (uint8_t field = 0; field < HISTORY_FIELD_COUNT; field++)
+    {
+        uint32_t delta;
+        if (!(header & (1 << field)))
+            continue;
+        if (!getVarint(block.data, block.used, pos, delta))
+            return false;
+        values[field] += unzigzag(delta);
+    }
+    return true;
+}
+
+// Write the open record into the newest block, or a new one when it does not fit
+void closeRecord(uint32_t endSecond)
+{
+    uint8_t record[MAX_RECORD_BYTES];
+    uint32_t duration = endSecond - _openSecond;
+    uint8_t length = encodeRecord(record, duration, _openValues, _blockValues);
+    if (_blockCount == 0 || blockAt(_blockCount - 1).used + length > HISTORY_BLOCK_BYTES)
+    {
+        startBlock(_openSecond);
+        length = encodeRecord(record, duration, _openValues, _blockValues);
+    }
+    HistoryBlock &block = blockAt(_blockCount - 1);
+    memcpy(block.data + block.used, record, length);
+    block.used += length;
+    memcpy(_blockValues, _openValues, sizeof(_blockValues));
+    _recordCount++;
+}
+
+void addToBuckets(uint32_t second, const HistorySample &sample)
+{
+    for (const HistoryWindowConfig &window : WINDOWS)
+    {
+        uint32_t id = second / window.bucketSeconds;
+        HistoryBucket &bucket = _buckets[window.firstBucket + id % window.buckets];
+        if (bucket.count == 0 || bucket.id != id)
+        {
+            bucket = {};
+            bucket.id = id;
+            bucket.ldrMin = UINT16_MAX;
+            bucket.distanceMin = UINT16_MAX;
+        }
+        bucket.count++;
+        bucket.ldrMin = min(bucket.ldrMin, sample.ldr);
+        bucket.ldrMax = max(bucket.ldrMax, sample.ldr);
+        bucket.ldrSum += sample.ldr;
+        if (sample.presence)
+            bucket.presenceCount++;
+        if (sample.distance > 0)
+        {
+            bucket.targetCount++;
+            bucket.distanceMin = min(bucket.distanceMin, sample.distance);
+            bucket.distanceMax = max(bucket.distanceMax, sample.distance);
+            bucket.distanceSum += sample.distance;
+        }
+        if (sample.state != 0)
+            bucket.lampOnCount++;
+    }
+}
+
+void historyAppend(const HistorySample &sample)
+{
+    uint32_t second = clockMillis() / 1000;
+    if (_recordOpen && second == _lastSecond)
+        return;
+    _lastSecond = second;
+    addToBuckets(second, sample);
+
+    // the records older than the history are gone with their block, once the next block starts before the limit
+    while (_blockCount > 1 && second - blockAt(1).startSecond >= HISTORY_SECONDS)
+        dropOldestBlock();
+
+    uint16_t values[HISTORY_FIELD_COUNT];
+    toValues(sample, values);
+    if (_recordOpen && withinDeadBand(values) &&
+        second - _openSecond < MAX_RECORD_SECONDS)
+        return;
+    if (_recordOpen)
+        closeRecord(second);
+    memcpy(_openValues, values, sizeof(values));
+    _openSecond = second;
+    _recordOpen = true;
+}
+
+HistoryStats historyStats(HistoryWindow window)
+{
+    HistoryStats stats = {};
+    if (window >= HISTORY_WINDOW_COUNT || !_recordOpen)
+        return stats;
+    const HistoryWindowConfig &config = WINDOWS[window];
+    uint32_t currentId = _lastSecond / config.bucketSeconds;
+    uint32_t ldrSum = 0;
+    uint32_t distanceSum = 0;
+    stats.ldrMin = UINT16_MAX;
+    stats.distanceMin = UINT16_MAX;
+    for (uint8_t index = 0; index < config.buckets; index++)
+    {
+        const HistoryBucket &bucket = _buckets[config.firstBucket + index];
+        if (bucket.count == 0 || currentId - bucket.id >= config.buckets)
+            continue;
+        stats.seconds += bucket.count;
+        stats.ldrMin = min(stats.ldrMin, bucket.ldrMin);
+        stats.ldrMax = max(stats.ldrMax, bucket.ldrMax);
+        ldrSum += bucket.ldrSum;
+        stats.presenceSeconds += bucket.presenceCount;
+        stats.targetSeconds += bucket.targetCount;
+        stats.distanceMin = min(stats.distanceMin, bucket.distanceMin);
+        stats.distanceMax = max(stats.distanceMax, bucket.distanceMax);
+        distanceSum += bucket.distanceSum;
+        stats.lampOnSeconds += bucket.lampOnCount;
+    }
+    if (stats.seconds == 0)
+        stats.ldrMin = 0;
+    else
+        stats.ldrAvg = ldrSum / stats.seconds;
+    if (stats.targetSeconds == 0)
+        stats.distanceMin = 0;
+    else
+        stats.distanceAvg = distanceSum / stats.targetSeconds;
+    return stats;
+}
+
+const char *historyWindowName(HistoryWindow window)
+{
+    return window < HISTORY_WINDOW_COUNT ? WINDOW_NAMES[window] : "?";
+}
+
+uint32_t historyBytesUsed()
+{
+    uint32_t used = 0;
+    for (uint8_t age = 0; age < _blockCount; age++)
+        used += blockAt(age).used;
+    return used;
+}
+
+uint32_t historyRecords() { return _recordCount; }
+
+uint32_t historySeconds()
+{
+    if (!_recordOpen)
+        return 0;
+    uint32_t first = _blockCount > 0 ? blockAt(0).startSecond : _openSecond;
+    return _lastSecond + 1 - first;
+}
+
+void historyStartExport(HistoryCursor &cursor)
+{
+    cursor = {};
+    cursor.block = _blockCount > 0 ? blockAt(0).seq : _nextBlockSeq;
+    cursor.second = _blockCount > 0 ? blockAt(0).startSecond : _openSecond;
+}
+
+// Move the cursor to the start of a block
+void seekBlock(HistoryCursor &cursor, const HistoryBlock &block)
+{
+    cursor.block = block.seq;
+    cursor.offset = 0;
+    cursor.second = block.startSecond;
+    memset(cursor.values, 0, sizeof(cursor.values));
+}
+
+size_t formatLine(char *line, uint32_t second, uint32_t duration, const uint16_t *values)
+{
+    return snprintf(line, HISTORY_MAX_LINE, "%lu,%lu,%u,%u,%u,%u,%u\n", (unsigned long)second,
+                    (unsigned long)duration, values[HISTORY_LDR], values[HISTORY_DISTANCE], values[HISTORY_ENERGY],
+                    values[HISTORY_PRESENCE], values[HISTORY_STATE]);
+}
+
+size_t historyExport(HistoryCursor &cursor, char *buffer, size_t maxLen)
+{
+    size_t written = 0;
+    char line[HISTORY_MAX_LINE];
+    if (!cursor.headerDone)
+    {
+        written = snprintf(buffer, maxLen, "second,duration,ldr,distance,energy,presence,state\n");
+        cursor.headerDone = true;
+    }
+
+    while (!cursor.done)
+    {
+        HistoryBlock *block = findBlock(cursor.block);
+        if (block == nullptr && _blockCount > 0 && cursor.block < blockAt(0).seq)
+        {
+            // dropped while the export was going on
+            block = &blockAt(0);
+            seekBlock(cursor, *block);
+        }
+
+        if (block != nullptr)
+        {
+            uint16_t pos = cursor.offset;
+            uint32_t duration;
+            uint16_t values[HISTORY_FIELD_COUNT];
+            memcpy(values, cursor.values, sizeof(values));
+            if (decodeRecord(*block, pos, duration, values))
+            {
+                size_t length = formatLine(line, cursor.second, duration, values);
+                if (written + length > maxLen)
+                    break;
+                memcpy(buffer + written, line, length);
+                written += length;
+                cursor.offset = pos;
+                cursor.second += duration;
+                memcpy(cursor.values, values, sizeof(values));
+                continue;
+            }
+            HistoryBlock *next = findBlock(cursor.block + 1);
+            if (next != nullptr)
+            {
+                seekBlock(cursor, *next);
+                continue;
+            }
+        }
+
+        // past the newest block: the record still being written is the last line
+        if (_recordOpen)
+        {
+            size_t length = formatLine(line, _openSecond, _lastSecond + 1 - _openSecond, _openValues);
+            if (written + length > maxLen)
+                break;
+            memcpy(buffer + written, line, length);
+            written += length;
+        }
+        cursor.done = true;
+    }
+    return written;
+}
@@ -1,57 +1,388 @@
 #include <device_common.h>
 #include <ldr.h>
+#include <ldr_filter.h>
+#include <clock.h>
+#include <config.h>
+#include <led_strip.h>
+#include <scheduler.h>
+
+// Each reading is the average of a burst of conversions the ADC writes via DMA (oversampling)
+static const uint32_t CONVERSIONS_PER_READING = 64;
+// The lowest rate the continuous ADC supports, a burst takes 3.2 ms
+static const uint32_t SAMPLING_FREQ_HZ = 20000;
+// The burst is picked up this long after it has been started
+static const uint32_t BURST_READ_DELAY_MS = 5;
+// Calibrated input voltage that reads as MAX_BRIGHTNESS (default attenuation of 11 dB)
+static const uint32_t FULL_SCALE_MV = 3100;
+
+// The LED strip lights up the LDR itself. A reading only counts as ambient light when the strip has been dark for this
+// long (the LDR follows slowly) ...
+static const uint32_t DARK_SETTLE_MS = 200;
+// Other readings get the offset of the compensation table subtracted once the strip has kept its duty for
+// DARK_SETTLE_MS, without a table they are left out.
+// From this duty on, where the own light drowns the ambient light, the strip gets blanked for a reading at most once
+// per BLANK_PERIOD_MS. A blank only lasts BURST_READ_DELAY_MS, far less than the LDR takes to settle, so these
+// readings are kept out of the filter: they are a diagnostic to measure the settle time by.
+static const uint16_t BLANK_MIN_DUTY = LED_STRIP_MAX_DUTY / 4;
+static const uint32_t BLANK_PERIOD_MS = 5000;
+
+// Calibration: only starts in the dark, each point is the average of some readings taken once the strip has been
+// steady for a while
+static const uint16_t CALIBRATION_MAX_AMBIENT = MAX_BRIGHTNESS / 16;
+static const uint32_t CALIBRATION_SETTLE_MS = 1500;
+static const uint8_t CALIBRATION_READINGS = 8;
+
+static const char *SOURCE_NAMES[LDR_SOURCE_COUNT] = {"none", "adcDma", "analogRead", "sampler"};
+static const char *CALIBRATION_STATE_NAMES[LDR_CALIBRATION_STATE_COUNT] = {"idle", "running", "done", "failed"};
+
+// What the reading going on is used for
+enum ReadingKind : uint8_t
+{
+    READING_AMBIENT,     // The strip is dark
+    READING_BLANKED,     // The strip is blanked for a moment, the LDR has not settled yet
+    READING_COMPENSATED, // The strip is lit, the offset gets subtracted
+    READING_CALIBRATION  // A point of the compensation table
+};
 
 uint16_t _averageBrightness = MAX_BRIGHTNESS + 1; // impossible value -> not initialized
-uint32_t _measurementDelayMs = 500;
+uint16_t _lastBrightness = MAX_BRIGHTNESS + 1;
+uint16_t _lastMillivolts = 0;
+uint16_t _blankedBrightness = MAX_BRIGHTNESS + 1; // The last reading taken with the strip blanked
+uint32_t _measurementDelayMs = 100;
 
 unsigned long _lastMeasureTs = 0;
+JobId _measureJob = NO_JOB;
+LdrSampler _ldrSampler = nullptr; // nullptr: read LDR_PIN
+LdrSource _ldrSource = LDR_SOURCE_NONE;
+volatile bool _burstDone = false;    // Set by the ADC driver when a burst is done
+unsigned long _stripSteadySinceTs = 0; // The LED strip has kept _stripSteadyDuty since then
+uint16_t _stripSteadyDuty = 0;
+unsigned long _lastBlankTs = 0;
+bool _blanking = false;              // The LED strip is blanked for the reading going on
+uint32_t _blankCount = 0;            // Readings taken with the strip blanked
+uint32_t _skippedCount = 0;          // Readings left out because of the own light
+uint32_t _compensatedCount = 0;      // Readings the offset got subtracted from
+ReadingKind _readingKind = READING_AMBIENT;
+uint8_t _readingBrightness = 0; // Brightness of the strip when the reading was started
+
+// Compensation, the table gets expanded to every brightness: a lookup per reading
+LdrCompensation _compensation = {};
+bool _compensationValid = false;
+uint16_t _offsetByBrightness[256] = {0};
+
+// Calibration
+LdrCalibrationState _calibrationState = LDR_CALIBRATION_IDLE;
+LdrCompensation _calibrationTable = {};
+uint8_t _calibrationPoint = 0;
+uint8_t _calibrationMaxBrightness = 0;
+uint16_t _calibrationBaseline = 0;  // Ambient brightness before the strip went on
+unsigned long _calibrationSteadyTs = 0; // The strip has been at the brightness of the point since then
+uint32_t _calibrationSum = 0;
+uint8_t _calibrationReadings = 0;
+
+LdrFilter _filter; // Median of the last readings, then a moving average
+
+void filter(uint16_t brightness)
+{
+    _lastBrightness = brightness;
+    _lastMeasureTs = clockMillis();
+    _averageBrightness = _filter.add(brightness);
+}
+
+// Interpolate the table points for every brightness
+void expandCompensation()
+{
+    for (uint16_t brightness = 0; brightness < 256; brightness++)
+    {
+        uint8_t point = brightness / LDR_COMPENSATION_STEP;
+        uint8_t fraction = brightness % LDR_COMPENSATION_STEP;
+        int32_t offset = _compensation.offset[point];
+        if (fraction > 0 && point + 1 < LDR_COMPENSATION_POINTS)
+            offset += ((int32_t)_compensation.offset[point + 1] - offset) * fraction / LDR_COMPENSATION_STEP;
+        _offsetByBrightness[brightness] = offset;
+    }
+}
+
+uint8_t pointBrightness(uint8_t point) { return point * LDR_COMPENSATION_STEP; }
+
+void finishCalibration()
+{
+    _calibrationTable.offset[0] = 0;
+    _compensation = _calibrationTable;
+    _compensationValid = true;
+    expandCompensation();
+    setLdrCompensationTable(_compensation);
+    ledStripSetTargetBrightness(0);
+    _calibrationState = LDR_CALIBRATION_DONE;
+}
+
+// Light the strip for the next point. Points above the max brightness take the offset of the last one measured.
+void nextCalibrationPoint()
+{
+    _calibrationSum = 0;
+    _calibrationReadings = 0;
+    while (++_calibrationPoint < LDR_COMPENSATION_POINTS)
+    {
+        if (pointBrightness(_calibrationPoint) <= _calibrationMaxBrightness)
+        {
+            ledStripSetTargetBrightness(pointBrightness(_calibrationPoint));
+            _calibrationSteadyTs = clockMillis();
+            return;
+        }
+        _calibrationTable.offset[_calibrationPoint] = _calibrationTable.offset[_calibrationPoint - 1];
+    }
+    finishCalibration();
+}
 
-uint8_t const RINGBUFFER_SIZE = 2 << 4; // must be 2, 4, 8, 16, 32 or 64
-uint8_t const RINGPOS_MASK = RINGBUFFER_SIZE - 1;
-uint8_t _ringbuffer[RINGBUFFER_SIZE] = {0};
-uint8_t _ringfill = 0;
-uint8_t _ringpos_current = 0;
-uint16_t _ring_sum = 0;
-uint8_t _ring_avg = 0;
+void calibrationReading(uint16_t brightness)
+{
+    if (_calibrationState != LDR_CALIBRATION_RUNNING)
+        return;
+    _lastBrightness = brightness;
+    _lastMeasureTs = clockMillis();
+    _calibrationSum += brightness;
+    if (++_calibrationReadings < CALIBRATION_READINGS)
+        return;
+    uint16_t mean = _calibrationSum / CALIBRATION_READINGS;
+    _calibrationTable.offset[_calibrationPoint] = mean > _calibrationBaseline ? mean - _calibrationBaseline : 0;
+    nextCalibrationPoint();
+}
 
-void ring_add(uint8_t value)
+// Whether a calibration reading is due: the strip is steady at the brightness of the point
+bool calibrationDue()
 {
-    // calculate average
-    _ring_sum = _ring_sum - _ringbuffer[_ringpos_current] + value;
-    if (_ringfill < RINGBUFFER_SIZE) _ringfill++;
-    _ring_avg = _ring_sum / _ringfill;
+    if (ledStripTargetBrightness() != pointBrightness(_calibrationPoint))
+    {
+        // somebody else took over the strip
+        _calibrationState = LDR_CALIBRATION_FAILED;
+        return false;
+    }
+    unsigned long now = clockMillis();
+    if (!ledStripIdle())
+        _calibrationSteadyTs = now;
+    return now - _calibrationSteadyTs >= CALIBRATION_SETTLE_MS;
+}
 
-    // set value in ring
-    _ringbuffer[_ringpos_current] = value;
+// A reading is in, hand it on to what it was taken for
+void useReading(uint16_t brightness)
+{
+    switch (_readingKind)
+    {
+    case READING_CALIBRATION:
+        calibrationReading(brightness);
+        break;
+    case READING_BLANKED:
+        _blankedBrightness = brightness;
+        break;
+    case READING_COMPENSATED:
+    {
+        uint16_t offset = _offsetByBrightness[_readingBrightness];
+        _compensatedCount++;
+        filter(brightness > offset ? brightness - offset : 0);
+        break;
+    }
+    default:
+        filter(brightness);
+        break;
+    }
+}
 
-    // increment ring pointer, adjust overflows
-    _ringpos_current++;
-    _ringpos_current &= RINGPOS_MASK;
+uint16_t millivoltsToBrightness(uint32_t millivolts)
+{
+    uint32_t brightness = millivolts * MAX_BRIGHTNESS / FULL_SCALE_MV;
+    return brightness > MAX_BRIGHTNESS ? MAX_BRIGHTNESS : brightness;
 }
 
-uint8_t ring_avg() { return _ring_avg; }
+// Called by the ADC driver (interrupt) when a burst is done
+void ARDUINO_ISR_ATTR onBurstDone()
+{
+    _burstDone = true;
+}
+
+void endBlanking()
+{
+    if (!_blanking)
+        return;
+    ledStripBlank(false);
+    _blanking = false;
+}
+
+// Job (or called by measure()): take the reading. A burst of the ADC gets picked up and the ADC stopped until the next
+// one, it keeps the clock up while it runs.
+void takeReading()
+{
+    switch (_ldrSource)
+    {
+    case LDR_SOURCE_ADC_DMA:
+    {
+        adc_continuous_data_t *result = nullptr;
+        if (_burstDone && analogContinuousRead(&result, 0) && result != nullptr)
+        {
+            _lastMillivolts = result[0].avg_read_mvolts;
+            useReading(millivoltsToBrightness(_lastMillivolts));
+        }
+        _burstDone = false;
+        analogContinuousStop();
+        break;
+    }
+    case LDR_SOURCE_ANALOG_READ:
+        _lastMillivolts = analogReadMilliVolts(LDR_PIN);
+        useReading(millivoltsToBrightness(_lastMillivolts));
+        break;
+    case LDR_SOURCE_SAMPLER:
+        useReading(_ldrSampler());
+        break;
+    default:
+        break;
+    }
+    endBlanking();
+}
+
+// Whether a reading can be taken now and what for. Blanks the LED strip when that is due.
+bool readingDue()
+{
+    if (_calibrationState == LDR_CALIBRATION_RUNNING)
+    {
+        _readingKind = READING_CALIBRATION;
+        return calibrationDue();
+    }
+
+    unsigned long now = clockMillis();
+    uint16_t duty = ledStripCurrentDuty();
+    if (duty != _stripSteadyDuty || !ledStripIdle())
+    {
+        _stripSteadyDuty = duty;
+        _stripSteadySinceTs = now;
+    }
+    bool steady = now - _stripSteadySinceTs >= DARK_SETTLE_MS;
+    if (steady && duty == 0)
+    {
+        _readingKind = READING_AMBIENT;
+        return true;
+    }
+
+    if (duty >= BLANK_MIN_DUTY && now - _lastBlankTs >= BLANK_PERIOD_MS && ledStripBlank(true))
+    {
+        _readingKind = READING_BLANKED;
+        _blanking = true;
+        _lastBlankTs = now;
+        _blankCount++;
+        return true;
+    }
+
+    if (steady && _compensationValid)
+    {
+        _readingKind = READING_COMPENSATED;
+        _readingBrightness = ledStripCurrentBrightness();
+        return true;
+    }
+    return false;
+}
+
+// Job: measure and calculate the average brightness
+void measure()
+{
+    if (!readingDue())
+    {
+        if (_calibrationState != LDR_CALIBRATION_RUNNING)
+            _skippedCount++;
+        return;
+    }
+    if (_ldrSource == LDR_SOURCE_ADC_DMA)
+    {
+        _burstDone = false;
+        if (analogContinuousStart())
+            controlJobs.once("ldrBurst", BURST_READ_DELAY_MS, takeReading);
+        else
+            endBlanking();
+    }
+    else if (_blanking)
+        // the blank takes effect with the next PWM period, give the LDR a moment as well
+        controlJobs.once("ldrBlank", BURST_READ_DELAY_MS, takeReading);
+    else
+        takeReading();
+}
+
+void ldrUseSampler(LdrSampler sampler)
+{
+    _ldrSampler = sampler;
+}
 
 void ldrSetup()
 {
-    pinMode(LDR_PIN, INPUT);
-    _measurementDelayMs = 500;
-    _averageBrightness = measuredBrightness();
+    if (_ldrSampler != nullptr)
+        _ldrSource = LDR_SOURCE_SAMPLER;
+    else
+    {
+        pinMode(LDR_PIN, INPUT);
+        const uint8_t pins[] = {LDR_PIN};
+        _ldrSource = analogContinuous(pins, 1, CONVERSIONS_PER_READING, SAMPLING_FREQ_HZ, onBurstDone)
+                         ? LDR_SOURCE_ADC_DMA
+                         : LDR_SOURCE_ANALOG_READ;
+    }
+    _compensationValid = ldrCompensationTable(_compensation);
+    expandCompensation();
+    _measureJob = controlJobs.every("ldr", _measurementDelayMs, measure);
 }
 
-void ldrLoop()
+bool ldrStartCalibration(uint8_t maxBrightness)
 {
-    unsigned long timeStamp = millis();
-    if (timeStamp - _lastMeasureTs >= _measurementDelayMs)
+    if (_calibrationState == LDR_CALIBRATION_RUNNING)
+        return false;
+    if (ledStripTargetBrightness() != 0 || !ledStripIdle() || _averageBrightness > CALIBRATION_MAX_AMBIENT)
     {
-        _averageBrightness = (_averageBrightness + measuredBrightness()) / 2;
-        _lastMeasureTs = timeStamp;
+        _calibrationState = LDR_CALIBRATION_FAILED;
+        return false;
     }
+    _calibrationTable = {};
+    _calibrationBaseline = _averageBrightness;
+    _calibrationMaxBrightness = maxBrightness;
+    _calibrationPoint = 0;
+    _calibrationState = LDR_CALIBRATION_RUNNING;
+    nextCalibrationPoint();
+    return true;
+}
+
+void ldrCancelCalibration()
+{
+    if (_calibrationState != LDR_CALIBRATION_RUNNING)
+        return;
+    _calibrationState = LDR_CALIBRATION_FAILED;
+    ledStripSetTargetBrightness(0);
+}
+
+bool ldrCalibrating() { return _calibrationState == LDR_CALIBRATION_RUNNING; }
+LdrCalibrationState ldrCalibrationState() { return _calibrationState; }
+
+const char *ldrCalibrationStateName(LdrCalibrationState state)
+{
+    return state < LDR_CALIBRATION_STATE_COUNT ? CALIBRATION_STATE_NAMES[state] : "?";
 }
 
+bool ldrCompensated() { return _compensationValid; }
+LdrCompensation ldrCompensation() { return _compensation; }
+uint16_t ldrCompensationOffset(uint8_t brightness) { return _compensationValid ? _offsetByBrightness[brightness] : 0; }
+uint32_t ldrCompensatedCount() { return _compensatedCount; }
+
 uint16_t averagedBrightness() { return _averageBrightness; }
-uint16_t measuredBrightness() { return analogRead(LDR_PIN); }
+uint16_t measuredBrightness() { return _lastBrightness; }
+uint16_t ldrNoise() { return _filter.noise(); }
+uint16_t ldrMillivolts() { return _lastMillivolts; }
+LdrSource ldrSource() { return _ldrSource; }
+uint32_t ldrBlankCount() { return _blankCount; }
+uint16_t ldrBlankedBrightness() { return _blankedBrightness; }
+uint32_t ldrSkippedCount() { return _skippedCount; }
+
+const char *ldrSourceName(LdrSource source)
+{
+    return source < LDR_SOURCE_COUNT ? SOURCE_NAMES[source] : "?";
+}
 
 uint32_t measurementDelayMs() { return _measurementDelayMs; }
-void setMeasurementDelayMs(uint32_t value) { _measurementDelayMs = value; }
+void setMeasurementDelayMs(uint32_t value)
+{
+    _measurementDelayMs = value > BURST_READ_DELAY_MS ? value : BURST_READ_DELAY_MS + 1;
+    controlJobs.setPeriod(_measureJob, _measurementDelayMs);
+}
 
 unsigned long lastMeasureTs() { return _lastMeasureTs; }
@@ -0,0 +1,50 @@
+#include <ldr_filter.h>
+
+uint16_t LdrFilter::median() const
+{
+    uint16_t sorted[MEDIAN_SIZE];
+    for (uint8_t i = 0; i < _fill; i++)
+    {
+        // insertion sort, the window is tiny
+        uint16_t value = _window[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = value;
+    }
+    return sorted[_fill / 2];
+}
+
+uint16_t LdrFilter::add(uint16_t reading)
+{
+    _window[_pos] = reading;
+    _pos = (_pos + 1) % MEDIAN_SIZE;
+    if (_fill < MEDIAN_SIZE)
+        _fill++;
+    int32_t median = (int32_t)this->median() << FIXED_SHIFT;
+
+    if (!_primed)
+    {
+        _emaFixed = median;
+        _noiseFixed = 0;
+        _primed = true;
+    }
+    else
+    {
+        int32_t deviation = ((int32_t)reading << FIXED_SHIFT) - _emaFixed;
+        if (deviation < 0)
+            deviation = -deviation;
+        _emaFixed += (median - _emaFixed) / (1 << EMA_SHIFT);
+        _noiseFixed += (deviation - _noiseFixed) / (1 << EMA_SHIFT);
+    }
+    return average();
+}
+
+void LdrFilter::reset()
+{
+    _fill = 0;
+    _pos = 0;
+    _emaFixed = 0;
+    _noiseFixed = 0;
+    _primed = false;
+}
@@ -0,0 +1,217 @@
+#include <driver/ledc.h>
+#include <led_output.h>
+
+// All channels share the first timer of the first channel group.
+static const ledc_mode_t LEDC_SPEED_MODE = (ledc_mode_t)0;
+static const ledc_timer_t LEDC_TIMER = LEDC_TIMER_0;
+
+LedOutputDriver::LedOutputDriver(uint8_t channelCount)
+    : _channelCount(channelCount < LED_OUTPUT_MAX_CHANNELS
+                        ? channelCount
+                        : LED_OUTPUT_MAX_CHANNELS),
+      _referenceChannel(0) {
+    for (uint8_t channel = 0; channel < LED_OUTPUT_MAX_CHANNELS; channel++) {
+        _gain[channel] = LED_OUTPUT_GAIN_ONE;
+    }
+}
+
+void LedOutputDriver::setGain(uint8_t channel, uint16_t gain) {
+    if (channel >= _channelCount) return;
+    _gain[channel] = gain < LED_OUTPUT_GAIN_ONE ? gain : LED_OUTPUT_GAIN_ONE;
+    _referenceChannel = 0;
+    for (uint8_t ch = 1; ch < _channelCount; ch++) {
+        if (_gain[ch] > _gain[_referenceChannel]) _referenceChannel = ch;
+    }
+}
+
+uint16_t LedOutputDriver::gain(uint8_t channel) const {
+    return channel < _channelCount ? _gain[channel] : 0;
+}
+
+uint16_t LedOutputDriver::scale(uint8_t channel, uint16_t duty) const {
+    if (_gain[channel] == LED_OUTPUT_GAIN_ONE) return duty;
+    return ((uint32_t)duty * _gain[channel] + LED_OUTPUT_GAIN_ONE / 2) >>
+           LED_OUTPUT_GAIN_BITS;
+}
+
+uint16_t LedOutputDriver::unscale(uint8_t channel,
+                                  uint32_t channelDuty) const {
+    if (_gain[channel] == LED_OUTPUT_GAIN_ONE) return channelDuty;
+    if (_gain[channel] == 0) return 0;
+    return ((channelDuty << LED_OUTPUT_GAIN_BITS) + _gain[channel] / 2) /
+           _gain[channel];
+}
+
+// ---- LEDC ----
+
+LedcOutputDriver::LedcOutputDriver(const uint8_t *pins, uint8_t channelCount,
+                                   uint32_t frequencyHz,
+                                   uint8_t resolutionBits)
+    : LedOutputDriver(channelCount),
+      _pins(pins),
+      _frequencyHz(frequencyHz),
+      _resolutionBits(resolutionBits) {}
+
+// The end of a fade a channel waits for, handed to the interrupt as user
+// argument. done is only set while the fade to targetDuty runs.
+struct LedcFadeEnd {
+    volatile LedOutputDriver::FadeDoneCallback done;
+    volatile uint32_t targetDuty;
+};
+
+// Called from the LEDC interrupt for each channel whose fade has ended, only
+// the reference channel reports the end of the fade. Ends of other fades
+// (e.g. the one step fade setting the start duty) are ignored.
+static bool IRAM_ATTR onLedcFadeEnd(const ledc_cb_param_t *param,
+                                    void *userArg) {
+    LedcFadeEnd *end = (LedcFadeEnd *)userArg;
+    LedOutputDriver::FadeDoneCallback done = end->done;
+    if (param->event != LEDC_FADE_END_EVT || done == nullptr ||
+        param->duty != end->targetDuty) {
+        return false;
+    }
+    end->done = nullptr;
+    return done();
+}
+
+static LedcFadeEnd _ledcFadeEnd[LED_OUTPUT_MAX_CHANNELS] = {};
+
+bool LedcOutputDriver::begin() {
+    ledc_timer_config_t timerConfig = {};
+    timerConfig.speed_mode = LEDC_SPEED_MODE;
+    timerConfig.duty_resolution = (ledc_timer_bit_t)_resolutionBits;
+    timerConfig.timer_num = LEDC_TIMER;
+    timerConfig.freq_hz = _frequencyHz;
+    timerConfig.clk_cfg = LEDC_AUTO_CLK;
+    if (ledc_timer_config(&timerConfig) != ESP_OK) return false;
+
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        ledc_channel_config_t channelConfig = {};
+        channelConfig.gpio_num = _pins[channel];
+        channelConfig.speed_mode = LEDC_SPEED_MODE;
+        channelConfig.channel = (ledc_channel_t)channel;
+        channelConfig.intr_type = LEDC_INTR_DISABLE;
+        channelConfig.timer_sel = LEDC_TIMER;
+        channelConfig.duty = 0;
+        channelConfig.hpoint = 0;
+        if (ledc_channel_config(&channelConfig) != ESP_OK) return false;
+    }
+    // fails when already installed, which is fine
+    ledc_fade_func_install(0);
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        ledc_cbs_t callbacks = {};
+        callbacks.fade_cb = onLedcFadeEnd;
+        ledc_cb_register(LEDC_SPEED_MODE, (ledc_channel_t)channel, &callbacks,
+                         &_ledcFadeEnd[channel]);
+    }
+    return true;
+}
+
+void LedcOutputDriver::write(uint16_t duty) {
+    // set all duties first, then update the channels back to back: each one
+    // takes its new duty with the start of its next PWM period
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        ledc_set_duty(LEDC_SPEED_MODE, (ledc_channel_t)channel,
+                      scale(channel, duty));
+    }
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        ledc_update_duty(LEDC_SPEED_MODE, (ledc_channel_t)channel);
+    }
+}
+
+uint16_t LedcOutputDriver::read() {
+    return unscale(_referenceChannel,
+                   ledc_get_duty(LEDC_SPEED_MODE,
+                                 (ledc_channel_t)_referenceChannel));
+}
+
+bool LedcOutputDriver::fade(uint16_t fromDuty, uint16_t toDuty,
+                            uint16_t durationMs, FadeDoneCallback done) {
+    if (_gain[_referenceChannel] == 0) return false;  // all channels off
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        // setting the start duty runs a one step fade which ends right away,
+        // keep the callback disarmed until the real fade starts
+        _ledcFadeEnd[channel].done = nullptr;
+        ledc_channel_t ch = (ledc_channel_t)channel;
+        if (ledc_set_duty_and_update(LEDC_SPEED_MODE, ch,
+                                     scale(channel, fromDuty),
+                                     0) != ESP_OK ||
+            ledc_set_fade_with_time(LEDC_SPEED_MODE, ch,
+                                    scale(channel, toDuty),
+                                    durationMs) != ESP_OK) {
+            return false;
+        }
+    }
+    // start the fade units back to back, they step in sync with the timer
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        if (channel == _referenceChannel) {
+            _ledcFadeEnd[channel].targetDuty = scale(channel, toDuty);
+            _ledcFadeEnd[channel].done = done;
+        }
+        if (ledc_fade_start(LEDC_SPEED_MODE, (ledc_channel_t)channel,
+                            LEDC_FADE_NO_WAIT) != ESP_OK) {
+            stopFade();
+            return false;
+        }
+    }
+    return true;
+}
+
+void LedcOutputDriver::stopFade() {
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        ledc_fade_stop(LEDC_SPEED_MODE, (ledc_channel_t)channel);
+    }
+}
+
+// ---- Fake ----
+
+FakeOutputDriver::FakeOutputDriver(uint8_t channelCount)
+    : LedOutputDriver(channelCount) {}
+
+void FakeOutputDriver::write(uint16_t duty) {
+    _duty = duty;
+    _fading = false;
+    _writeCount++;
+}
+
+uint16_t FakeOutputDriver::read() { return dutyAt(_nowMs); }
+
+bool FakeOutputDriver::fade(uint16_t fromDuty, uint16_t toDuty,
+                            uint16_t durationMs, FadeDoneCallback done) {
+    _duty = fromDuty;
+    _fadeFromDuty = fromDuty;
+    _fadeToDuty = toDuty;
+    _fadeStartMs = _nowMs;
+    _fadeDurationMs = durationMs;
+    _fadeDone = done;
+    _fading = true;
+    _fadeCount++;
+    return true;
+}
+
+void FakeOutputDriver::stopFade() {
+    _duty = dutyAt(_nowMs);
+    _fading = false;
+}
+
+void FakeOutputDriver::update(unsigned long nowMs) {
+    _nowMs = nowMs;
+    if (_fading && (uint32_t)(_nowMs - _fadeStartMs) >= _fadeDurationMs) {
+        _duty = _fadeToDuty;
+        _fading = false;
+        if (_fadeDone != nullptr) _fadeDone();
+    }
+}
+
+uint16_t FakeOutputDriver::channelDuty(uint8_t channel) const {
+    return channel < _channelCount ? scale(channel, dutyAt(_nowMs)) : 0;
+}
+
+uint16_t FakeOutputDriver::dutyAt(unsigned long nowMs) const {
+    if (!_fading) return _duty;
+    // the clock wraps at 32 bit, unsigned long is wider on the build host
+    uint32_t elapsedMs = nowMs - _fadeStartMs;
+    if (elapsedMs >= _fadeDurationMs) return _fadeToDuty;
+    int32_t gap = (int32_t)_fadeToDuty - (int32_t)_fadeFromDuty;
+    return _fadeFromDuty + gap * (int32_t)elapsedMs / _fadeDurationMs;
+}
@@ -1,27 +1,159 @@
 #include <config.h>
 #include <device_common.h>
+#include <dither.h>
+#include <easing.h>
+#include <esp_timer.h>
+#include <events.h>
+#include <led_output.h>
 #include <led_strip.h>
+#include <clock.h>
+#include <scheduler.h>
 
 static const uint32_t LEDC_FREQ_HZ = 5000;
-static const uint8_t LEDC_RESOLUTION_BITS = 8;
+// 80 MHz APB / 5 kHz leaves room for 13 bits (8192 steps) of duty resolution
+static const uint8_t LEDC_RESOLUTION_BITS = LED_STRIP_RESOLUTION_BITS;
+static_assert((80000000UL >> LEDC_RESOLUTION_BITS) >= LEDC_FREQ_HZ,
+              "LEDC resolution too high for the PWM frequency");
+static_assert(LED_STRIP_CHANNEL_COUNT <= LED_OUTPUT_MAX_CHANNELS,
+              "too many LED strip channels");
+
+// A transition is split into linear segments (see easing.h), the fade task
+// starts the next one as soon as the hardware reports the end of a segment.
+static const uint8_t MAX_FADE_SEGMENTS = EASING_STEPS;
+static const uint32_t FADE_TASK_STACK_SIZE = 2048;
+static const UBaseType_t FADE_TASK_PRIORITY = configMAX_PRIORITIES - 2;
+
+// Duties between two PWM counts are shown by temporal dithering: a sigma-delta
+// stage (see dither.h) alternates between the two neighbouring counts so the
+// average matches the fractional duty. The duty carries DITHER_BITS fractional
+// bits, at the low night light levels one PWM count is a visible step
+// otherwise. With a 1 ms period the slowest pattern (1/8) repeats at only
+// 125 Hz, so duties below DITHER_MIN_DUTY, where alternating between two
+// counts is a large change in light, are rounded instead of dithered.
+static const uint64_t DITHER_PERIOD_US = 1000;
+static_assert(((uint32_t)LED_STRIP_MAX_DUTY << DITHER_BITS) <= UINT16_MAX,
+              "fine duty does not fit 16 bits");
+
+// The energy counters are handed over to config.cpp this often, it decides
+// when they actually get written to flash.
+static const unsigned long ENERGY_HANDOVER_MS = 60000;
+
+// Maps the 8 bit brightness (0..255) to a PWM duty following the CIE 1931
+// lightness curve, so each brightness step is perceived as the same change in
+// brightness. The table is calculated by the compiler, at runtime converting a
+// brightness is a single table load. fineDuty keeps DITHER_BITS fractional
+// bits, duty is the PWM count below it.
+struct BrightnessCurve {
+    uint16_t duty[256];
+    uint16_t fineDuty[256];
+
+    constexpr BrightnessCurve() : duty(), fineDuty() {
+        for (uint16_t i = 0; i < 256; i++) {
+            double lightness = 100.0 * i / 255.0;
+            double luminance = 0.0;
+            if (lightness <= 8.0) {
+                luminance = lightness / 903.3;
+            } else {
+                double l = (lightness + 16.0) / 116.0;
+                luminance = l * l * l;
+            }
+            fineDuty[i] = (uint16_t)(luminance * LED_STRIP_MAX_DUTY * DITHER_ONE +
+                                     0.5);
+            duty[i] = fineDuty[i] >> DITHER_BITS;
+        }
+    }
+};
+
+static constexpr BrightnessCurve BRIGHTNESS_CURVE;
+static_assert(BRIGHTNESS_CURVE.duty[0] == 0, "brightness 0 must be off");
+static_assert(BRIGHTNESS_CURVE.duty[1] > 0, "brightness 1 must be on");
+static_assert(BRIGHTNESS_CURVE.duty[255] == LED_STRIP_MAX_DUTY,
+              "brightness 255 must be full on");
 
 enum LEDStripState {
     TARGET_BRIGHTNESS_REACHED,
     START_TRANSITION_TO_BRIGHTNESS,
     TRANSITION_TO_BRIGHTNESS,
     TRANSITION_TO_BRIGHTNESS_DONE,
-    CONFIRM_START,
-    CONFIRM_OFF_1,
-    CONFIRM_ON_1,
-    CONFIRM_OFF_2,
-    CONFIRM_ON_2,
-    CONFIRM_STATE_START,
-    CONFIRM_STATE,
-    CONFIRM_DONE,
+    SIGNAL_PATTERN,
+};
+
+// One step of a signal pattern: fade to level within fadeMs following curve
+// (fadeMs 0: jump to it), then hold it for holdMs. The level is relative to
+// the configured maximum brightness (PATTERN_FULL is maxBrightness()).
+struct PatternStep {
+    uint8_t level;
+    uint16_t fadeMs;
+    EasingCurve curve;
+    uint16_t holdMs;
+};
+
+struct Pattern {
+    const PatternStep *steps;
+    uint8_t stepCount;
 };
 
+static const uint8_t PATTERN_FULL = 255;
+
+// two short off-on-pulses
+#define PATTERN_BLINK_TWICE                                               \
+    {0, 0, EASE_LINEAR, 200}, {PATTERN_FULL, 0, EASE_LINEAR, 200},        \
+        {0, 0, EASE_LINEAR, 200}, {PATTERN_FULL, 0, EASE_LINEAR, 200}
+
+static constexpr PatternStep PATTERN_CONFIRM[] = {PATTERN_BLINK_TWICE};
+// the blinks, then off shortly (contrast) and on for a second
+static constexpr PatternStep PATTERN_CONFIRM_ON[] = {
+    PATTERN_BLINK_TWICE,
+    {0, 0, EASE_LINEAR, 200},
+    {PATTERN_FULL, 0, EASE_LINEAR, 1000}};
+// the blinks, then off for a second
+static constexpr PatternStep PATTERN_CONFIRM_OFF[] = {
+    PATTERN_BLINK_TWICE, {0, 0, EASE_LINEAR, 1000}};
+// one soft dip
+static constexpr PatternStep PATTERN_SAVED[] = {
+    {0, 250, EASE_IN_OUT, 100}, {PATTERN_FULL, 250, EASE_IN_OUT, 200}};
+// three slow breaths
+static constexpr PatternStep PATTERN_AP_MODE[] = {
+    {0, 0, EASE_LINEAR, 200},           {PATTERN_FULL, 600, EASE_IN_OUT, 0},
+    {0, 600, EASE_IN_OUT, 0},           {PATTERN_FULL, 600, EASE_IN_OUT, 0},
+    {0, 600, EASE_IN_OUT, 0},           {PATTERN_FULL, 600, EASE_IN_OUT, 0},
+    {0, 600, EASE_IN_OUT, 200}};
+// fast flicker
+static constexpr PatternStep PATTERN_FACTORY_RESET_WARNING[] = {
+    {0, 0, EASE_LINEAR, 80}, {PATTERN_FULL, 0, EASE_LINEAR, 80},
+    {0, 0, EASE_LINEAR, 80}, {PATTERN_FULL, 0, EASE_LINEAR, 80},
+    {0, 0, EASE_LINEAR, 80}, {PATTERN_FULL, 0, EASE_LINEAR, 80},
+    {0, 0, EASE_LINEAR, 80}, {PATTERN_FULL, 0, EASE_LINEAR, 80},
+    {0, 0, EASE_LINEAR, 80}, {PATTERN_FULL, 0, EASE_LINEAR, 80}};
+// one long and two short pulses
+static constexpr PatternStep PATTERN_ERROR[] = {
+    {0, 0, EASE_LINEAR, 400},   {PATTERN_FULL, 0, EASE_LINEAR, 800},
+    {0, 0, EASE_LINEAR, 200},   {PATTERN_FULL, 0, EASE_LINEAR, 200},
+    {0, 0, EASE_LINEAR, 200},   {PATTERN_FULL, 0, EASE_LINEAR, 200},
+    {0, 0, EASE_LINEAR, 400}};
+
+#undef PATTERN_BLINK_TWICE
+
+#define PATTERN(steps) {steps, sizeof(steps) / sizeof(steps[0])}
+
+// indexed by LedSignal
+static constexpr Pattern PATTERNS[] = {
+    PATTERN(PATTERN_CONFIRM),     PATTERN(PATTERN_CONFIRM_ON),
+    PATTERN(PATTERN_CONFIRM_OFF), PATTERN(PATTERN_SAVED),
+    PATTERN(PATTERN_AP_MODE),     PATTERN(PATTERN_FACTORY_RESET_WARNING),
+    PATTERN(PATTERN_ERROR)};
+
+#undef PATTERN
+
+static_assert(sizeof(PATTERNS) / sizeof(PATTERNS[0]) == LED_SIGNAL_COUNT,
+              "each LedSignal needs a pattern");
+
 Stream *debug_uart_led_strip = nullptr;
 
+LedcOutputDriver _ledcOutput(LED_STRIP_PINS, LED_STRIP_CHANNEL_COUNT,
+                             LEDC_FREQ_HZ, LEDC_RESOLUTION_BITS);
+LedOutputDriver *_output = &_ledcOutput;  // Drives the LED strip MOSFET(s)
+
 LEDStripState _ledCurrentState =
     TARGET_BRIGHTNESS_REACHED;  // The state the LED strip hardware is currently
                                 // in
@@ -31,9 +163,22 @@ uint8_t _ledTransitionStartBrightness =
 uint8_t _ledCurrentBrightness = 0;  // The actual LED strip hardware brightness
 uint8_t _ledTargetBrightness = 0;   // The target LED strip hardware brightness
                                     // to be reached in the transition
-int16_t _ledBrightnessGap =
-    0;  // Brightness gap to bridge between brightness on transition start and
-        // desired brightness (might be negative)
+uint16_t _ledTransitionStartDuty =
+    0;  // The PWM duty the LED strip hardware was set to at the start of the
+        // transition
+uint16_t _ledCurrentDuty = 0;  // The actual LED strip hardware PWM duty
+uint16_t _ledTargetDuty = 0;   // The PWM duty to be reached in the transition
+uint16_t _ledTargetFineDuty =
+    0;  // The target duty including DITHER_BITS fractional bits
+uint16_t _ledTransitionDurationMs =
+    0;  // How much time the transition to the target is to take
+int32_t _ledDutyGap =
+    0;  // Duty gap to bridge between duty on fade start and the fade target
+        // (might be negative)
+uint16_t _fadeTargetDuty = 0;  // The PWM duty the current fade ends at
+uint8_t _fadeTargetBrightness =
+    0;  // The brightness the current fade ends at
+EasingCurve _fadeCurve = EASE_LINEAR;  // The curve the current fade follows
 unsigned long _loopTimeStamp =
     0;  // The moment in time the current loop cycle has been entered
 unsigned long _transitionStartTs =
@@ -46,35 +191,137 @@ uint16_t _maxTransitionDuration =
     0;  // How much time a transition is allowed to take
 
 LEDStripState _ledSavedState =
-    TARGET_BRIGHTNESS_REACHED;  // For storing the state when confirming
-uint8_t _ledSavedBrightness =
-    0;  // For storing the current brightness when confirming
-bool _alsoConfirmValue = false;  // Whether after confirming input a visual
-                                 // state confirmation is also required
-bool _confirmThisState =
-    false;  // When giving a visual state confirmation, visualize this state
-unsigned long _lastConfirmTs = 0;   // For delaying the led on/off cycles
-unsigned long _delayConfirmMs = 0;  // For delaying the led on/off cycles
+    TARGET_BRIGHTNESS_REACHED;  // For storing the state during a signal
+uint16_t _ledSavedDuty = 0;  // For storing the current duty during a signal
+const Pattern *_pattern = nullptr;  // The signal pattern being shown
+uint8_t _patternStepIndex = 0;      // The next step of the pattern
+esp_timer_handle_t _patternTimer =
+    nullptr;  // Marks the next pattern step as due
+volatile bool _patternStepDue =
+    false;  // Set by the pattern timer when the current step has ended
 unsigned long _savedTransitionDuration =
     0;  // The time left for the interrupted a current transition
+uint16_t _fadeDurationMs =
+    0;  // The duration handed to the hardware fade unit for the current fade
+bool _fadeRunning = false;  // Whether the hardware fade unit is currently
+                            // fading the LED strip
+volatile bool _fadeDone =
+    false;  // Set by the fade end interrupt when the hardware fade unit has
+            // reached the target duty
+EasingCurve _ledTransitionCurve =
+    EASE_LINEAR;  // The curve the transition to the target follows
+uint16_t _segmentTargetDuty[MAX_FADE_SEGMENTS] = {
+    0};  // The duty at the end of each segment of the current transition
+uint16_t _segmentDurationMs[MAX_FADE_SEGMENTS] = {
+    0};  // The duration of each segment of the current transition
+volatile uint8_t _segmentCount = 0;  // Number of segments of the transition
+volatile uint8_t _segmentIndex = 0;  // The segment currently being faded
+volatile uint32_t _fadeGeneration =
+    0;  // Incremented when a fade is stopped, so late segment end notifications
+        // of a stopped fade are ignored
+TaskHandle_t _fadeTaskHandle = nullptr;  // Starts the next fade segment
+SemaphoreHandle_t _fadeMutex =
+    nullptr;  // Guards the fade unit against the fade task and the loop
+              // starting or stopping fades at the same time
+esp_timer_handle_t _ditherTimer = nullptr;  // Runs the dithering steps
+bool _ditherRunning = false;  // Whether the duty is currently being dithered
+SigmaDelta _dither;  // Alternates between the two counts next to the duty
+uint16_t _ditherWrittenDuty = 0;  // The duty the last dithering step has set
+bool _blanked = false;  // Whether the output is switched off for a moment, see
+                        // ledStripBlank()
+LedStripEnergy _energy;  // What the LED strip has delivered so far
+unsigned long _lastEnergyTs = 0;  // The moment in time energy was last counted
 
 void setBrightness(uint8_t value);
+void setDuty(uint16_t value);
+void setFineDuty(uint16_t fineDuty);
+void setTargetFineDuty(uint16_t fineDuty, EasingCurve curve);
+void stopFade();
+void stopDither();
+void ditherStep(void *parameter);
+void fadeTask(void *parameter);
 void startTransitionToBrightness();
 void transitionToBrightness();
 void transitionToBrightnessDone();
-void doConfirm();
+void runPattern();
+void countEnergy(unsigned long nowMs);
+void handOverEnergy();
+void patternStepDue(void *parameter);
 
 uint8_t ledStripCurrentBrightness() { return _ledCurrentBrightness; }
 uint8_t ledStripTargetBrightness() { return _ledTargetBrightness; }
+uint16_t ledStripCurrentDuty() { return _ledCurrentDuty; }
+uint16_t ledStripTargetDuty() { return _ledTargetDuty; }
+bool ledStripIdle() { return _ledCurrentState == TARGET_BRIGHTNESS_REACHED; }
+LedStripEnergy ledStripEnergy() { return _energy; }
+bool ledStripBlanked() { return _blanked; }
+
+bool ledStripBlank(bool blank) {
+    if (blank == _blanked) return _blanked;
+    if (blank && (!ledStripIdle() || _fadeRunning)) return false;
+    // the time up to now counts with the state before
+    countEnergy(clockMillis());
+    xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+    _blanked = blank;
+    // dithering holds on while blanked and goes on from the duty it has shown
+    _output->write(blank ? 0 : (_ditherRunning ? _ditherWrittenDuty : _ledCurrentDuty));
+    xSemaphoreGive(_fadeMutex);
+    return _blanked;
+}
+
+double ledStripFullOnHours(const LedStripEnergy &energy) {
+    return (double)energy.fineDutyMs /
+           ((double)((uint32_t)LED_STRIP_MAX_DUTY << DITHER_BITS) * 3600000.0);
+}
+
+uint16_t ledStripBrightnessToDuty(uint8_t brightness) {
+    return BRIGHTNESS_CURVE.duty[brightness];
+}
+
+uint8_t ledStripDutyToBrightness(uint16_t duty) {
+    // binary search for the highest brightness not exceeding the duty
+    uint8_t low = 0;
+    uint8_t high = 255;
+    while (low < high) {
+        uint8_t mid = low + (high - low + 1) / 2;
+        if (BRIGHTNESS_CURVE.duty[mid] <= duty) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
 
 void ledStripDebug(Stream &terminalStream) {
     debug_uart_led_strip = &terminalStream;
 }
 
+void ledStripUseOutput(LedOutputDriver &output) { _output = &output; }
+
 void ledStripSetup() {
-    ledcAttach(LED_STRIP_PIN, LEDC_FREQ_HZ, LEDC_RESOLUTION_BITS);
-    setBrightness(_ledTargetBrightness);
+    if (!_output->begin() && debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->println(F("LED strip output setup failed"));
+    }
+    _fadeMutex = xSemaphoreCreateMutex();
+    xTaskCreate(fadeTask, "ledFade", FADE_TASK_STACK_SIZE, nullptr,
+                FADE_TASK_PRIORITY, &_fadeTaskHandle);
+    esp_timer_create_args_t ditherTimerArgs = {};
+    ditherTimerArgs.callback = ditherStep;
+    ditherTimerArgs.name = "ledDither";
+    ditherTimerArgs.skip_unhandled_events = true;
+    esp_timer_create(&ditherTimerArgs, &_ditherTimer);
+    esp_timer_create_args_t patternTimerArgs = {};
+    patternTimerArgs.callback = patternStepDue;
+    patternTimerArgs.name = "ledPattern";
+    esp_timer_create(&patternTimerArgs, &_patternTimer);
+    setFineDuty(_ledTargetFineDuty);
     _maxTransitionDuration = transitionDurationMs();
+    _ledTransitionDurationMs = _maxTransitionDuration;
+    energyCounters(_energy);
+    _lastEnergyTs = clockMillis();
+    controlJobs.every("energyHandover", ENERGY_HANDOVER_MS, handOverEnergy,
+                      ENERGY_HANDOVER_MS);
 }
 
 void ledStripSetTransitionDuration(uint16_t value) {
@@ -82,15 +329,37 @@ void ledStripSetTransitionDuration(uint16_t value) {
 }
 uint16_t ledStripGetTransitionDuration() { return _maxTransitionDuration; }
 
-void ledStripSetTargetBrightness(uint8_t brightness) {
-    if (_ledTargetBrightness != brightness) {
-        _ledTargetBrightness = brightness;
-        _ledCurrentState = START_TRANSITION_TO_BRIGHTNESS;
+void ledStripSetTargetBrightness(uint8_t brightness, EasingCurve curve) {
+    setTargetFineDuty(BRIGHTNESS_CURVE.fineDuty[brightness], curve);
+}
+
+void ledStripSetTargetDuty(uint16_t duty, EasingCurve curve) {
+    if (duty > LED_STRIP_MAX_DUTY) duty = LED_STRIP_MAX_DUTY;
+    setTargetFineDuty(duty << DITHER_BITS, curve);
+}
+
+void setTargetFineDuty(uint16_t fineDuty, EasingCurve curve) {
+    if (_ledTargetFineDuty != fineDuty) {
+        _ledTargetFineDuty = fineDuty;
+        _ledTargetDuty = fineDuty >> DITHER_BITS;
+        _ledTransitionCurve = isEasingCurve(curve) ? curve : EASE_LINEAR;
+        _ledTargetBrightness = ledStripDutyToBrightness(_ledTargetDuty);
+        _ledTransitionDurationMs = _maxTransitionDuration;
+        if (_ledCurrentState == SIGNAL_PATTERN) {
+            // transition once the signal is done
+            _ledSavedState = START_TRANSITION_TO_BRIGHTNESS;
+        } else {
+            _ledCurrentState = START_TRANSITION_TO_BRIGHTNESS;
+        }
     }
 }
 
 void ledStripLoop() {
-    _loopTimeStamp = millis();
+    _loopTimeStamp = clockMillis();
+    countEnergy(_loopTimeStamp);
+    if (_blanked && _ledCurrentState != TARGET_BRIGHTNESS_REACHED) {
+        ledStripBlank(false);
+    }
 
     switch (_ledCurrentState) {
         case START_TRANSITION_TO_BRIGHTNESS: {
@@ -105,22 +374,32 @@ void ledStripLoop() {
             transitionToBrightnessDone();
             break;
         }
-        case CONFIRM_START:
-        case CONFIRM_OFF_1:
-        case CONFIRM_OFF_2:
-        case CONFIRM_ON_1:
-        case CONFIRM_ON_2:
-        case CONFIRM_STATE_START:
-        case CONFIRM_STATE:
-        case CONFIRM_DONE: {
-            doConfirm();
+        case SIGNAL_PATTERN: {
+            runPattern();
+            break;
         }
+        default:
+            break;
     }
 }
 
 void ledStripConfirm(bool alsoConfirmValue, bool confirmThisValue) {
+    ledStripSignal(!alsoConfirmValue   ? LED_SIGNAL_CONFIRM
+                   : confirmThisValue ? LED_SIGNAL_CONFIRM_ON
+                                      : LED_SIGNAL_CONFIRM_OFF);
+}
+
+void ledStripSignal(LedSignal signal) {
     if (debug_uart_led_strip != nullptr) {
-        debug_uart_led_strip->print(F("ledStripConfirm: "));
+        debug_uart_led_strip->print(F("ledStripSignal "));
+        debug_uart_led_strip->print(signal);
+        debug_uart_led_strip->print(F(": "));
+    }
+    if (signal >= LED_SIGNAL_COUNT) {
+        if (debug_uart_led_strip != nullptr) {
+            debug_uart_led_strip->println(F("  unknown signal (ignored)"));
+        }
+        return;
     }
 
     switch (_ledCurrentState) {
@@ -138,22 +417,30 @@ void ledStripConfirm(bool alsoConfirmValue, bool confirmThisValue) {
         case TARGET_BRIGHTNESS_REACHED: {
             if (debug_uart_led_strip != nullptr) {
                 debug_uart_led_strip->println(
-                    F("  confirm while target brightness reached"));
+                    F("  signal while target brightness reached"));
             }
             break;
         }
         default: {
             if (debug_uart_led_strip != nullptr) {
                 debug_uart_led_strip->println(
-                    F("  already confirming (request ignored)"));
+                    F("  already signalling (request ignored)"));
             }
             return;
         }
     }
+    // save the current state to be restored when the pattern is done (see
+    // finishPattern()), a running fade is frozen where it is
     _ledSavedState = _ledCurrentState;
-    _alsoConfirmValue = alsoConfirmValue;
-    _confirmThisState = confirmThisValue;
-    _ledCurrentState = CONFIRM_START;
+    stopFade();
+    _ledSavedDuty = _ledCurrentDuty;
+    _savedTransitionDuration = _transitionDuration < _fadeDurationMs
+                                   ? _fadeDurationMs - _transitionDuration
+                                   : 0;
+    _pattern = &PATTERNS[signal];
+    _patternStepIndex = 0;
+    _patternStepDue = true;
+    _ledCurrentState = SIGNAL_PATTERN;
 }
 
 void debugPrintStateText(LEDStripState state, bool addPrintln = false) {
@@ -172,29 +459,8 @@ void debugPrintStateText(LEDStripState state, bool addPrintln = false) {
             case TRANSITION_TO_BRIGHTNESS_DONE:
                 debug_uart_led_strip->print(F("TRANSITION_TO_BRIGHTNESS_DONE"));
                 break;
-            case CONFIRM_START:
-                debug_uart_led_strip->print(F("CONFIRM_START"));
-                break;
-            case CONFIRM_OFF_1:
-                debug_uart_led_strip->print(F("CONFIRM_OFF_1"));
-                break;
-            case CONFIRM_ON_1:
-                debug_uart_led_strip->print(F("CONFIRM_ON_1"));
-                break;
-            case CONFIRM_OFF_2:
-                debug_uart_led_strip->print(F("CONFIRM_OFF_2"));
-                break;
-            case CONFIRM_ON_2:
-                debug_uart_led_strip->print(F("CONFIRM_ON_2"));
-                break;
-            case CONFIRM_STATE_START:
-                debug_uart_led_strip->print(F("CONFIRM_STATE_START"));
-                break;
-            case CONFIRM_STATE:
-                debug_uart_led_strip->print(F("CONFIRM_STATE"));
-                break;
-            case CONFIRM_DONE:
-                debug_uart_led_strip->print(F("CONFIRM_DONE"));
+            case SIGNAL_PATTERN:
+                debug_uart_led_strip->print(F("SIGNAL_PATTERN"));
                 break;
             default:
                 break;
@@ -203,64 +469,285 @@ void debugPrintStateText(LEDStripState state, bool addPrintln = false) {
     }
 }
 
+// Called from the fade interrupt when the hardware has reached the end of a
+// segment. Keep this short, it runs in interrupt context.
+bool ARDUINO_ISR_ATTR onSegmentDone() {
+    if (_segmentIndex + 1 < _segmentCount) {
+        BaseType_t higherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(_fadeTaskHandle, _fadeGeneration,
+                           eSetValueWithOverwrite, &higherPriorityTaskWoken);
+        return higherPriorityTaskWoken == pdTRUE;
+    }
+    _fadeDone = true;
+    return postEventFromISR(EVENT_LED_STRIP);
+}
+
+// Hand a segment over to the fade unit(s). Call with _fadeMutex taken.
+bool startSegment(uint8_t index) {
+    uint16_t from =
+        index == 0 ? _ledTransitionStartDuty : _segmentTargetDuty[index - 1];
+    return _output->fade(from, _segmentTargetDuty[index],
+                         _segmentDurationMs[index], onSegmentDone);
+}
+
+// Starts the next segment of a transition when notified by onSegmentDone().
+// Being a high priority task of its own, the segments follow each other
+// without a gap no matter how busy the loop is.
+void fadeTask(void *parameter) {
+    uint32_t generation;
+    for (;;) {
+        xTaskNotifyWait(0, 0, &generation, portMAX_DELAY);
+        xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+        if (_fadeRunning && generation == _fadeGeneration &&
+            _segmentIndex + 1 < _segmentCount) {
+            _segmentIndex++;
+            if (!startSegment(_segmentIndex)) {
+                // let the loop jump to the target
+                _fadeDone = true;
+            }
+        }
+        xSemaphoreGive(_fadeMutex);
+    }
+}
+
 void setBrightness(uint8_t value) {
-    ledcWrite(LED_STRIP_PIN, value);
+    setFineDuty(BRIGHTNESS_CURVE.fineDuty[value]);
+}
+
+void setDuty(uint16_t value) {
+    // the hardware ignores (or rather: blocks) duty changes while fading
+    stopFade();
+    _output->write(value);
     if (debug_uart_led_strip != nullptr) {
-        debug_uart_led_strip->print(F(" => set LED brightness: "));
+        debug_uart_led_strip->print(F(" => set LED duty: "));
         debug_uart_led_strip->println(value);
     }
 }
 
-void startTransitionToBrightness() {
+// Set the PWM count below fineDuty and dither the fractional bits on top.
+// Below DITHER_MIN_DUTY the nearest count is set instead, dithering there
+// would flicker.
+void setFineDuty(uint16_t fineDuty) {
+    if (!ditherable(fineDuty)) {
+        setDuty(unditheredDuty(fineDuty));
+        return;
+    }
+    uint16_t duty = fineDuty >> DITHER_BITS;
+    uint8_t fraction = fineDuty & DITHER_MASK;
+    setDuty(duty);
+    if (duty >= LED_STRIP_MAX_DUTY) return;
+    if (debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->print(F(" => dither LED duty: +"));
+        debug_uart_led_strip->print(fraction);
+        debug_uart_led_strip->print(F("/"));
+        debug_uart_led_strip->println(DITHER_ONE);
+    }
+    xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+    _dither.start(fineDuty);
+    _ditherWrittenDuty = duty;
+    _ditherRunning = true;
+    xSemaphoreGive(_fadeMutex);
+    esp_timer_start_periodic(_ditherTimer, DITHER_PERIOD_US);
+}
+
+// One sigma-delta step, called every DITHER_PERIOD_US by the dither timer.
+// Only a change of the duty gets written.
+void ditherStep(void *parameter) {
+    // skip the step rather than delay a fade being started or stopped
+    if (xSemaphoreTake(_fadeMutex, 0) != pdTRUE) return;
+    if (_ditherRunning && !_blanked) {
+        uint16_t duty = _dither.step();
+        if (duty != _ditherWrittenDuty) {
+            _output->write(duty);
+            _ditherWrittenDuty = duty;
+        }
+    }
+    xSemaphoreGive(_fadeMutex);
+}
+
+// Stop dithering, the duty is left at either of the two dithered values.
+void stopDither() {
+    if (!_ditherRunning) return;
+    esp_timer_stop(_ditherTimer);
+    xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+    _ditherRunning = false;
+    xSemaphoreGive(_fadeMutex);
+}
+
+// Take over the duty the hardware currently outputs.
+void updateCurrentDuty(uint16_t duty) {
+    _ledCurrentDuty = duty;
+    _ledCurrentBrightness = ledStripDutyToBrightness(duty);
+}
+
+// Stop a running hardware fade (or dithering). The duty stays at the value the
+// fade had reached and is reflected in _ledCurrentDuty.
+void stopFade() {
+    stopDither();
+    if (!_fadeRunning) return;
+    xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+    _fadeRunning = false;
+    _fadeGeneration++;
+    _output->stopFade();
+    updateCurrentDuty(_output->read());
+    xSemaphoreGive(_fadeMutex);
+}
+
+// The duty at the end of step (1 .. EASING_STEPS) of the current fade.
+uint16_t stepDuty(uint8_t step) {
+    if (step >= EASING_STEPS) return _fadeTargetDuty;
+    if (_fadeCurve == EASE_PERCEPTUAL &&
+        _ledTransitionStartBrightness != _fadeTargetBrightness) {
+        // linear in brightness, the brightness curve makes it perceptual
+        int32_t gap =
+            (int32_t)_fadeTargetBrightness - _ledTransitionStartBrightness;
+        return BRIGHTNESS_CURVE
+            .duty[_ledTransitionStartBrightness + gap * step / EASING_STEPS];
+    }
+    uint16_t progress = easingStepProgress(_fadeCurve, step);
+    return _ledTransitionStartDuty + (_ledDutyGap * progress) / EASING_ONE;
+}
+
+// Split the fade into linear segments following _fadeCurve.
+// Steps without a change in duty are merged into the following segment.
+void planSegments() {
+    _segmentCount = 0;
+    uint16_t previousDuty = _ledTransitionStartDuty;
+    uint32_t previousEndMs = 0;
+    for (uint8_t step = 1; step <= EASING_STEPS; step++) {
+        uint16_t duty = stepDuty(step);
+        // never move against the direction of the transition
+        if ((_ledDutyGap > 0 && duty < previousDuty) ||
+            (_ledDutyGap < 0 && duty > previousDuty)) {
+            duty = previousDuty;
+        }
+        uint32_t endMs = (uint32_t)_fadeDurationMs * step / EASING_STEPS;
+        if (duty == previousDuty) {
+            if (step == EASING_STEPS && _segmentCount > 0) {
+                // stretch the last segment to the end of the transition
+                _segmentDurationMs[_segmentCount - 1] += endMs - previousEndMs;
+            }
+            continue;
+        }
+        _segmentTargetDuty[_segmentCount] = duty;
+        _segmentDurationMs[_segmentCount] = endMs - previousEndMs;
+        _segmentCount++;
+        previousDuty = duty;
+        previousEndMs = endMs;
+    }
+}
+
+// Duration for the way from the current duty to the target at the mean speed
+// of the stopped fade (its duty gap over its duration), capped at the
+// configured transition duration. The speed of the segment it was stopped in
+// says little: near the flat ends of a curve, or low on the perceptual one,
+// it is a fraction of the mean and the new fade would crawl. 0 when the speed
+// cannot be kept (nothing was fading or a change of direction).
+uint32_t keepSpeedDurationMs() {
+    int32_t remainingGap = (int32_t)_ledTargetDuty - (int32_t)_ledCurrentDuty;
+    if (_ledDutyGap == 0 || _fadeDurationMs == 0 || remainingGap == 0 ||
+        (_ledDutyGap > 0) != (remainingGap > 0)) {
+        return 0;
+    }
+    uint32_t duration = (uint32_t)abs(remainingGap) * _fadeDurationMs /
+                        (uint32_t)abs(_ledDutyGap);
+    if (duration == 0) duration = 1;
+    return duration < _maxTransitionDuration ? duration
+                                             : _maxTransitionDuration;
+}
+
+// Let the fade unit move the duty from the current one to targetDuty within
+// durationMs following curve. Returns false when there is nothing to fade or
+// the fade could not be started, the caller then sets the target directly.
+bool startFade(uint16_t targetDuty, uint8_t targetBrightness,
+               EasingCurve curve, uint16_t durationMs) {
+    stopFade();
+    _fadeTargetDuty = targetDuty;
+    _fadeTargetBrightness = targetBrightness;
+    _fadeCurve = curve;
+    _fadeDurationMs = durationMs;
     _ledTransitionStartBrightness = _ledCurrentBrightness;
-    _ledBrightnessGap =
-        (int16_t)_ledTargetBrightness - (int16_t)_ledTransitionStartBrightness;
+    _ledTransitionStartDuty = _ledCurrentDuty;
+    _ledDutyGap = (int32_t)_fadeTargetDuty - (int32_t)_ledTransitionStartDuty;
+    planSegments();
+    if (debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->print(F("  duty gap: "));
+        debug_uart_led_strip->print(_ledDutyGap);
+        debug_uart_led_strip->print(F(", duration (ms): "));
+        debug_uart_led_strip->print(_fadeDurationMs);
+        debug_uart_led_strip->print(F(", curve: "));
+        debugPrintEasingCurve(debug_uart_led_strip, _fadeCurve);
+        debug_uart_led_strip->print(F(", segments: "));
+        debug_uart_led_strip->println(_segmentCount);
+    }
+    if (_ledDutyGap == 0 || _fadeDurationMs == 0 || _segmentCount == 0) {
+        // nothing to fade
+        return false;
+    }
+    // hand the fade over to the fade unit(s), they step the duty in hardware,
+    // the fade task chains the segments
+    xSemaphoreTake(_fadeMutex, portMAX_DELAY);
+    _fadeDone = false;
+    _segmentIndex = 0;
+    _fadeRunning = startSegment(0);
+    xSemaphoreGive(_fadeMutex);
+    if (!_fadeRunning && debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->println(
+            F("  hardware fade could not be started, jump to target"));
+    }
+    return _fadeRunning;
+}
+
+void startTransitionToBrightness() {
+    // a new target while fading: continue from where the fade is at the speed
+    // it had on average, instead of starting over (e.g. when holding
+    // PLUS/MINUS)
+    bool retarget = _fadeRunning && !_fadeDone;
+    stopFade();
+    EasingCurve curve = _ledTransitionCurve;
+    uint16_t duration = _ledTransitionDurationMs;
+    if (retarget) {
+        uint32_t keepSpeedMs = keepSpeedDurationMs();
+        if (keepSpeedMs > 0) {
+            duration = keepSpeedMs;
+            curve = EASE_LINEAR;
+        }
+        if (debug_uart_led_strip != nullptr) {
+            debug_uart_led_strip->print(F("retarget running transition"));
+            debug_uart_led_strip->println(
+                keepSpeedMs > 0 ? F(", keeping its speed") : F(""));
+        }
+    }
     _transitionStartTs = _loopTimeStamp;
-    _ledCurrentState = TRANSITION_TO_BRIGHTNESS;
+    _energy.transitions++;
     if (debug_uart_led_strip != nullptr) {
         debug_uart_led_strip->print(F("startTransitionToBrightness from "));
         debug_uart_led_strip->print((int16_t)_ledCurrentBrightness);
         debug_uart_led_strip->print(F(" to "));
         debug_uart_led_strip->println((int16_t)_ledTargetBrightness);
-        debug_uart_led_strip->print(F("  gap: "));
-        debug_uart_led_strip->println(_ledBrightnessGap);
     }
+    bool fading =
+        startFade(_ledTargetDuty, _ledTargetBrightness, curve, duration);
+    _ledCurrentState =
+        fading ? TRANSITION_TO_BRIGHTNESS : TRANSITION_TO_BRIGHTNESS_DONE;
 }
 
 void transitionToBrightness() {
-    // check time left to reach desired brightness (in ms)
     _transitionDuration = _loopTimeStamp - _transitionStartTs;
-    if (_transitionDuration > _maxTransitionDuration) {
-        // time's up
+    if (_fadeDone) {
+        // the fade unit has reached the target
         if (debug_uart_led_strip != nullptr) {
             debug_uart_led_strip->print(
                 F("transitionToBrightness, duration: "));
             debug_uart_led_strip->println(_transitionDuration);
-            debug_uart_led_strip->println(F(" => transition duration's up"));
+            debug_uart_led_strip->println(F(" => hardware fade done"));
         }
+        _fadeRunning = false;
         _transitionDuration = 0;
-        _ledCurrentBrightness = _ledTargetBrightness;
-        setBrightness(_ledCurrentBrightness);
         _ledCurrentState = TRANSITION_TO_BRIGHTNESS_DONE;
     } else {
-        // time left, make transition smooth
-        int32_t a = _ledBrightnessGap * _transitionDuration;
-        int16_t diff = a / _maxTransitionDuration;
-        int16_t newval = _ledTransitionStartBrightness + diff;
-        uint8_t newBrightness = (uint8_t)newval;
-        if (newBrightness != _ledCurrentBrightness) {
-            if (debug_uart_led_strip != nullptr) {
-                debug_uart_led_strip->println(F("transitionToBrightness"));
-                debug_uart_led_strip->print(F(" duration: "));
-                debug_uart_led_strip->println(_transitionDuration);
-                debug_uart_led_strip->print(F(" => transition from "));
-                debug_uart_led_strip->print((int16_t)_ledCurrentBrightness);
-                debug_uart_led_strip->print(F(" to "));
-                debug_uart_led_strip->println(newBrightness);
-            }
-            _ledCurrentBrightness = newBrightness;
-            setBrightness(_ledCurrentBrightness);
-        }
+        // the hardware does all the work, only keep track of where it is
+        updateCurrentDuty(_output->read());
     }
 }
 
@@ -268,105 +755,89 @@ void transitionToBrightnessDone() {
     if (debug_uart_led_strip != nullptr) {
         debug_uart_led_strip->println(F("transitionToBrightnessDone"));
     }
-    setBrightness(_ledTargetBrightness);
+    setFineDuty(_ledTargetFineDuty);
+    _ledCurrentDuty = _ledTargetDuty;
+    _ledCurrentBrightness = _ledTargetBrightness;
     _ledCurrentState = TARGET_BRIGHTNESS_REACHED;
 }
 
-void doConfirm() {
-    // delay when needed
-    if (_loopTimeStamp - _lastConfirmTs <= _delayConfirmMs) return;
-
-    LEDStripState nextState;
-
-    debugPrintStateText(_ledCurrentState, true);
-
-    switch (_ledCurrentState) {
-        case CONFIRM_START:
-            // save current state to be restored when confirmation is done (see
-            // CONFIRM_DONE)
-            _delayConfirmMs = 0;
-            _ledSavedBrightness = _ledCurrentBrightness;
-            _savedTransitionDuration = _transitionDuration;
-            nextState = CONFIRM_OFF_1;
-            break;
-
-        case CONFIRM_OFF_1:
-            // blink, phase 1: switch off light for 200ms
-            setBrightness(0);
-            _delayConfirmMs = 200;
-            nextState = CONFIRM_ON_1;
-            break;
-
-        case CONFIRM_ON_1:
-            // blink, phase 2: set light to full brightness for 200ms
-            setBrightness(maxBrightness());
-            _delayConfirmMs = 200;
-            nextState = CONFIRM_OFF_2;
-            break;
-
-        case CONFIRM_OFF_2:
-            // blink, phase 3: switch off light for 200ms
-            setBrightness(0);
-            _delayConfirmMs = 200;
-            nextState = CONFIRM_ON_2;
-            break;
-
-        case CONFIRM_ON_2:
-            // blink, phase 4: set light to full brightness for 200ms
-            setBrightness(maxBrightness());
-            _delayConfirmMs = 200;
-            // next state depends on whether a value is to be visualized also
-            nextState = _alsoConfirmValue ? CONFIRM_STATE_START : CONFIRM_DONE;
-            break;
-
-        case CONFIRM_STATE_START:
-            // visualize a bool value, phase 1: set brightness in contrast to
-            // value coming from CONFIRM_ON_2, brightness is now full on
-            if (_confirmThisState) {
-                setBrightness(0);
-            }
-            // the contrast (-> OFF) only needs to be visible (for 200ms), when
-            // _confirmThisState is true
-            _delayConfirmMs = _confirmThisState ? 200 : 0;
-            nextState = CONFIRM_STATE;
-            break;
-
-        case CONFIRM_STATE:
-            // visualize a bool value, phase 2: set brightness according to
-            // value for 1000ms
-            setBrightness(_confirmThisState ? maxBrightness() : 0);
-            _delayConfirmMs = 1000;
-            nextState = CONFIRM_DONE;
-            break;
+// Called by the pattern timer when the current pattern step has ended.
+void patternStepDue(void *parameter) {
+    _patternStepDue = true;
+    postEvent(EVENT_LED_STRIP);
+}
 
-        case CONFIRM_DONE:
-            setBrightness(_ledSavedBrightness);
-            _delayConfirmMs = 0;
-            if (debug_uart_led_strip != nullptr) {
-                debug_uart_led_strip->print(F("  restore state: "));
-                debugPrintStateText(_ledSavedState, true);
-            }
-            _transitionDuration = _savedTransitionDuration;
-            _transitionStartTs = _loopTimeStamp - _transitionDuration;
-            nextState = _ledSavedState;
-            break;
+// Restore the state saved by ledStripSignal().
+void finishPattern() {
+    setDuty(_ledSavedDuty);
+    updateCurrentDuty(_ledSavedDuty);
+    _pattern = nullptr;
+    if (debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->print(F("  restore state: "));
+        debugPrintStateText(_ledSavedState, true);
+    }
+    if (_ledSavedState == TRANSITION_TO_BRIGHTNESS) {
+        // resume the interrupted fade for the time it had left
+        _ledTransitionDurationMs = _savedTransitionDuration;
+        _ledCurrentState = START_TRANSITION_TO_BRIGHTNESS;
+    } else if (_ledSavedState == TARGET_BRIGHTNESS_REACHED) {
+        // the saved duty lacks the dithered fraction, set it again
+        _ledCurrentState = TRANSITION_TO_BRIGHTNESS_DONE;
+    } else {
+        _ledCurrentState = _ledSavedState;
+    }
+}
 
-        default:
-            if (debug_uart_led_strip != nullptr) {
-                debug_uart_led_strip->println(F("DEFAULT - THIS IS A BUG!"));
-                debug_uart_led_strip->print(F("  state: "));
-                debugPrintStateText(_ledCurrentState, true);
-            }
-            _delayConfirmMs = 0;
-            nextState = CONFIRM_DONE;
+// Start the next step of the signal pattern once the previous one has ended.
+void runPattern() {
+    if (!_patternStepDue) return;
+    _patternStepDue = false;
+    if (_patternStepIndex >= _pattern->stepCount) {
+        finishPattern();
+        return;
     }
+    const PatternStep &step = _pattern->steps[_patternStepIndex++];
+    uint8_t brightness = (uint16_t)step.level * maxBrightness() / PATTERN_FULL;
+    if (debug_uart_led_strip != nullptr) {
+        debug_uart_led_strip->print(F("pattern step "));
+        debug_uart_led_strip->print(_patternStepIndex);
+        debug_uart_led_strip->print(F(" of "));
+        debug_uart_led_strip->print(_pattern->stepCount);
+        debug_uart_led_strip->print(F(", brightness "));
+        debug_uart_led_strip->println(brightness);
+    }
+    if (step.fadeMs == 0 ||
+        !startFade(BRIGHTNESS_CURVE.duty[brightness], brightness, step.curve,
+                   step.fadeMs)) {
+        setBrightness(brightness);
+        updateCurrentDuty(BRIGHTNESS_CURVE.duty[brightness]);
+    }
+    uint32_t stepMs = (uint32_t)step.fadeMs + step.holdMs;
+    if (stepMs == 0) {
+        _patternStepDue = true;
+    } else {
+        esp_timer_start_once(_patternTimer, (uint64_t)stepMs * 1000);
+    }
+}
 
-    if (debug_uart_led_strip != nullptr && _ledCurrentState != nextState) {
-        debug_uart_led_strip->print(F("switching state from "));
-        debugPrintStateText(_ledCurrentState);
-        debug_uart_led_strip->print(F(" to "));
-        debugPrintStateText(nextState, true);
+// Add the light delivered since the last call to the energy counters. The
+// duty is taken as constant in between, the loop calls this often enough.
+void countEnergy(unsigned long nowMs) {
+    uint32_t elapsedMs = nowMs - _lastEnergyTs;
+    _lastEnergyTs = nowMs;
+    // the strip is dark while blanked
+    if (_blanked) return;
+    // at the target the dithered fraction is known exactly
+    uint32_t fineDuty = _ledCurrentState == TARGET_BRIGHTNESS_REACHED
+                            ? shownFineDuty(_ledTargetFineDuty)
+                            : (uint32_t)_ledCurrentDuty << DITHER_BITS;
+    _energy.fineDutyMs += (uint64_t)fineDuty * elapsedMs;
+    if (_ledCurrentBrightness > 0) {
+        uint8_t band = LED_ENERGY_BAND_COUNT - 1;
+        while (_ledCurrentBrightness < LED_ENERGY_BAND_START[band]) band--;
+        _energy.bandMs[band] += elapsedMs;
     }
-    _lastConfirmTs = _loopTimeStamp;
-    _ledCurrentState = nextState;
 }
+
+// Job: hand the energy counters over to config.cpp for saving.
+void handOverEnergy() { setEnergyCounters(_energy); }
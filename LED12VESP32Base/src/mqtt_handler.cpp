@@ -1,20 +1,21 @@
 #include "mqtt_handler.h"
+#include "config.h"
 
-String _mqtt_server;
-String _mqtt_user;
-String _mqtt_password;
+MqttServer _mqtt_server;
+MqttUsername _mqtt_user;
+MqttPassword _mqtt_password;
 
-void modifyMqttServer(const String &value)
+void modifyMqttServer(const char *value)
 {
-    _mqtt_server = value;
+    _mqtt_server.assign(value);
 }
 
-void modifyMqttUsername(const String &value)
+void modifyMqttUsername(const char *value)
 {
-    _mqtt_user = value;
+    _mqtt_user.assign(value);
 }
 
-void modifyMqttPassword(const String &value)
+void modifyMqttPassword(const char *value)
 {
-    _mqtt_password = value;
+    _mqtt_password.assign(value);
 }
\ No newline at end of file
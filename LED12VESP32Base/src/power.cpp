@@ -0,0 +1,210 @@
+#include <power.h>
+#include <clock.h>
+#include <device_common.h>
+#include <driver/uart.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <events.h>
+#include <scheduler.h>
+#include <touch.h>
+
+// Number of UART edges that wake up the controller when the radar sends data. The first bytes get lost, the radar
+// sends its frames over and over again anyway.
+static const int RADAR_WAKEUP_THRESHOLD = 3;
+
+static const char *POWER_STATE_NAMES[POWER_STATE_COUNT] = {"fullSpeed", "reducedSpeed", "lightSleep"};
+
+esp_pm_lock_handle_t _busyLock = nullptr;  // Keeps the CPU at full clock while the lamp is busy
+esp_pm_lock_handle_t _boostLock = nullptr; // Keeps the CPU at full clock while handling web requests
+esp_pm_lock_handle_t _awakeLock = nullptr; // Keeps the CPU from sleeping while the lamp is in use
+
+bool _scalingEnabled = false;
+bool _lightSleepEnabled = false;
+
+bool _busyHeld = false;
+bool _awakeHeld = false;
+
+portMUX_TYPE _boostMux = portMUX_INITIALIZER_UNLOCKED;
+bool _boostHeld = false;        // Guarded by _boostMux
+unsigned long _boostUntilTs = 0; // Guarded by _boostMux
+JobId _endBoostJob = NO_JOB;     // Network task only
+
+// Guards the power state and the time spent in each: the control task changes them, any task reads
+portMUX_TYPE _powerStateMux = portMUX_INITIALIZER_UNLOCKED;
+PowerState _powerState = POWER_FULL_SPEED;
+unsigned long _powerStateTs = 0; // The moment in time the current power state was entered
+uint64_t _powerAllowedMs[POWER_STATE_COUNT] = {0};
+
+Stream *debug_uart_power = nullptr; // The stream used for the debugging
+
+// Acquire or release a lock, if needed
+void holdLock(esp_pm_lock_handle_t lock, bool &held, bool hold)
+{
+    if (lock == nullptr || held == hold)
+        return;
+    if (hold)
+        esp_pm_lock_acquire(lock);
+    else
+        esp_pm_lock_release(lock);
+    held = hold;
+}
+
+void setPowerState(PowerState state)
+{
+    // only the control task changes the state, it reads it without the lock
+    if (state == _powerState)
+        return;
+    PowerState previous = _powerState;
+    unsigned long now = clockMillis();
+    portENTER_CRITICAL(&_powerStateMux);
+    _powerAllowedMs[previous] += now - _powerStateTs;
+    _powerStateTs = now;
+    _powerState = state;
+    portEXIT_CRITICAL(&_powerStateMux);
+    if (debug_uart_power != nullptr)
+    {
+        debug_uart_power->print(F("[Power] "));
+        debug_uart_power->print(POWER_STATE_NAMES[previous]);
+        debug_uart_power->print(F(" -> "));
+        debug_uart_power->println(POWER_STATE_NAMES[state]);
+    }
+}
+
+void powerUpdate(bool busy, bool idle)
+{
+    holdLock(_busyLock, _busyHeld, busy);
+    holdLock(_awakeLock, _awakeHeld, !idle);
+    // the touch buttons have to wake the controller, radar data does by the UART
+    if (busy || !idle)
+        touchDisarmWakeup();
+    else
+        touchArmWakeup();
+    setPowerState(busy ? POWER_FULL_SPEED : idle ? POWER_LIGHT_SLEEP : POWER_REDUCED_SPEED);
+}
+
+void powerBoost()
+{
+    portENTER_CRITICAL(&_boostMux);
+    bool acquire = !_boostHeld;
+    _boostHeld = true;
+    _boostUntilTs = clockMillis() + POWER_BOOST_MS;
+    portEXIT_CRITICAL(&_boostMux);
+    if (acquire)
+    {
+        if (_boostLock != nullptr)
+            esp_pm_lock_acquire(_boostLock);
+        // let the network task schedule the end
+        wakeNetworkTask();
+    }
+}
+
+// Job: let the CPU slow down again once the web requests are done, look again later while they go on
+void endBoost()
+{
+    _endBoostJob = NO_JOB;
+    portENTER_CRITICAL(&_boostMux);
+    long leftMs = (long)(_boostUntilTs - clockMillis());
+    bool release = _boostHeld && leftMs <= 0;
+    if (release)
+        _boostHeld = false;
+    portEXIT_CRITICAL(&_boostMux);
+    if (release && _boostLock != nullptr)
+        esp_pm_lock_release(_boostLock);
+    else if (!release && leftMs > 0)
+        _endBoostJob = networkJobs.once("powerBoost", leftMs, endBoost);
+}
+
+void powerLoop()
+{
+    if (_endBoostJob != NO_JOB)
+        return;
+    portENTER_CRITICAL(&_boostMux);
+    bool held = _boostHeld;
+    portEXIT_CRITICAL(&_boostMux);
+    if (held)
+        _endBoostJob = networkJobs.once("powerBoost", POWER_BOOST_MS, endBoost);
+}
+
+PowerState powerState()
+{
+    portENTER_CRITICAL(&_powerStateMux);
+    PowerState state = _powerState;
+    portEXIT_CRITICAL(&_powerStateMux);
+    return state;
+}
+
+const char *powerStateName(PowerState state)
+{
+    return state < POWER_STATE_COUNT ? POWER_STATE_NAMES[state] : "?";
+}
+
+uint64_t powerAllowedMs(PowerState state)
+{
+    if (state >= POWER_STATE_COUNT)
+        return 0;
+    unsigned long now = clockMillis();
+    portENTER_CRITICAL(&_powerStateMux);
+    uint64_t ms = _powerAllowedMs[state];
+    if (state == _powerState)
+        ms += now - _powerStateTs;
+    portEXIT_CRITICAL(&_powerStateMux);
+    return ms;
+}
+
+bool powerScalingEnabled() { return _scalingEnabled; }
+bool powerLightSleepEnabled() { return _lightSleepEnabled; }
+
+void powerDebug(Stream &terminalStream)
+{
+    debug_uart_power = &terminalStream;
+}
+
+void powerSetup()
+{
+    unsigned long now = clockMillis();
+    portENTER_CRITICAL(&_powerStateMux);
+    _powerStateTs = now;
+    portEXIT_CRITICAL(&_powerStateMux);
+
+    // the locks get created first: nobody may slow down the CPU before they are in place
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "lampBusy", &_busyLock) != ESP_OK)
+        _busyLock = nullptr;
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "webBoost", &_boostLock) != ESP_OK)
+        _boostLock = nullptr;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "lampAwake", &_awakeLock) != ESP_OK)
+        _awakeLock = nullptr;
+    // start awake and at full speed, the first powerUpdate() tells what the lamp allows
+    holdLock(_busyLock, _busyHeld, true);
+    holdLock(_awakeLock, _awakeHeld, true);
+
+    esp_pm_config_t pmConfig = {};
+    pmConfig.max_freq_mhz = POWER_MAX_FREQ_MHZ;
+    pmConfig.min_freq_mhz = POWER_MIN_FREQ_MHZ;
+    pmConfig.light_sleep_enable = true;
+    _lightSleepEnabled = esp_pm_configure(&pmConfig) == ESP_OK;
+    if (!_lightSleepEnabled)
+    {
+        // automatic light sleep needs tickless idle in the SDK, frequency scaling alone may still work
+        pmConfig.light_sleep_enable = false;
+        _scalingEnabled = esp_pm_configure(&pmConfig) == ESP_OK;
+    }
+    else
+    {
+        _scalingEnabled = true;
+    }
+
+    if (_lightSleepEnabled)
+    {
+        esp_sleep_enable_gpio_wakeup();
+        uart_set_wakeup_threshold(UART_NUM_1, RADAR_WAKEUP_THRESHOLD);
+        esp_sleep_enable_uart_wakeup(UART_NUM_1);
+    }
+
+    if (debug_uart_power != nullptr)
+    {
+        debug_uart_power->print(F("[Power] frequency scaling "));
+        debug_uart_power->print(_scalingEnabled ? F("on") : F("off"));
+        debug_uart_power->print(F(", light sleep "));
+        debug_uart_power->println(_lightSleepEnabled ? F("on") : F("off"));
+    }
+}
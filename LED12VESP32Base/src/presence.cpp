@@ -1,15 +1,16 @@
 #include <ld2410.h>
 #include <device_common.h>
 #include <presence.h>
+#include <scheduler.h>
 
 ld2410 radar;
+Stream *_radarStream = nullptr; // Where the radar data comes from, nullptr: RADAR_SERIAL
 
 unsigned long const SETUP_DELAY_MS = 1500;
+// The radar job drains the UART buffer at this period, the frames in between wait there (no wakeup per frame)
 unsigned long const READ_DELAY_MS = 300;
 
-unsigned long _lastReading = 0;
 bool radarConnected = false;
-unsigned long _setupTs = 0;
 bool _setupDone = false;
 
 Stream *debug_uart_presence = nullptr;
@@ -80,38 +81,37 @@ void presenceDebug(Stream &terminalStream)
   debug_uart_presence = &terminalStream;
 }
 
-void presenceSetup()
+// Job: read what the radar has sent
+void readRadar()
 {
-  // radar.debug(MONITOR_SERIAL);                                     // Uncomment to show debug information from the library on the Serial Monitor. By default this does not show sensor reads as they are very frequent.
-  RADAR_SERIAL.begin(256000, SERIAL_8N1, RADAR_RX_PIN, RADAR_TX_PIN); // UART for monitoring the radar
-  _setupTs = millis();
+  radar.read();
 }
 
-void presenceLoop()
+// Job: start talking to the radar once it is up
+void beginRadar()
 {
-  unsigned long now = millis();
-  if (_setupDone)
+  if (debug_uart_presence != nullptr)
   {
-    if ((now - _lastReading) > READ_DELAY_MS)
-    {
-      radar.read();
-      _lastReading = now;
-    }
+    debug_uart_presence->println(F("start radar.begin"));
   }
-  else // delay reading the sensor for a few milliseconds
+  radar.begin(_radarStream == nullptr ? RADAR_SERIAL : *_radarStream, true);
+  if (debug_uart_presence != nullptr)
   {
-    _setupDone = ((now - _setupTs) > SETUP_DELAY_MS);
-    if (_setupDone)
-    {
-      if (debug_uart_presence != nullptr)
-      {
-        debug_uart_presence->println(F("start radar.begin"));
-      }
-      radar.begin(RADAR_SERIAL, true);
-      if (debug_uart_presence != nullptr)
-      {
-        debug_uart_presence->println(F("radar.begin done"));
-      }
-    }
+    debug_uart_presence->println(F("radar.begin done"));
+  }
+  _setupDone = true;
+  controlJobs.every("radar", READ_DELAY_MS, readRadar);
+}
+
+void presenceUseStream(Stream &radarStream) { _radarStream = &radarStream; }
+
+void presenceSetup()
+{
+  // radar.debug(MONITOR_SERIAL);                                     // Uncomment to show debug information from the library on the Serial Monitor. By default this does not show sensor reads as they are very frequent.
+  if (_radarStream == nullptr)
+  {
+    RADAR_SERIAL.begin(256000, SERIAL_8N1, RADAR_RX_PIN, RADAR_TX_PIN); // UART for monitoring the radar
   }
+  // delay reading the sensor for a few milliseconds
+  controlJobs.once("radarBegin", SETUP_DELAY_MS, beginRadar);
 }
@@ -0,0 +1,159 @@
+#include <profiler.h>
+#include <esp_cpu.h>
+#include <rom/ets_sys.h>
+#include <scheduler.h>
+
+// Loop rate and load are measured over this interval, a report is printed at the same pace
+static const unsigned long PROFILER_WINDOW_MS = 60000;
+
+static const char *SECTION_NAMES[PROFILE_SECTION_COUNT] = {
+    "wifi", "controlJobs", "networkJobs", "touch", "commands", "state", "ledStrip", "webApi", "webInterface", "loop"};
+
+ProfileStats _profileStats[PROFILE_SECTION_COUNT] = {};
+
+unsigned long _windowStartTs = 0;  // Start of the current measuring interval
+uint32_t _windowStartLoops = 0;    // Loop passes counted when the interval started
+uint64_t _windowStartUs = 0;       // Busy time counted when the interval started
+float _loopRateHz = 0;             // Loop passes per second during the last interval
+float _load = 0;                   // Busy share during the last interval
+// Guards the statistics, the loop rate and the load: the control and the network task record, any task reads
+portMUX_TYPE _profileMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool _resetRequested = false; // Set by profilerReset() from any task, the control task does the reset
+
+Stream *debug_uart_profiler = nullptr; // The stream used for the debugging
+
+#if DEVICE_PROFILER
+
+uint32_t profilerCycles()
+{
+    return esp_cpu_get_cycle_count();
+}
+
+void profilerRecord(ProfiledSection section, uint32_t startCycles)
+{
+    // unsigned arithmetic copes with the counter wrapping around once
+    uint32_t cycles = esp_cpu_get_cycle_count() - startCycles;
+    // the clock changes with the power state, a run spanning a change gets a little off
+    uint32_t us = cycles / ets_get_cpu_frequency();
+    uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= PROFILE_HISTOGRAM_BUCKETS)
+        bucket = PROFILE_HISTOGRAM_BUCKETS - 1;
+
+    portENTER_CRITICAL(&_profileMux);
+    ProfileStats &stats = _profileStats[section];
+    stats.count++;
+    stats.totalUs += us;
+    if (us > stats.maxUs)
+        stats.maxUs = us;
+    stats.histogram[bucket]++;
+    portEXIT_CRITICAL(&_profileMux);
+}
+
+#endif
+
+const char *profiledSectionName(ProfiledSection section)
+{
+    return section < PROFILE_SECTION_COUNT ? SECTION_NAMES[section] : "?";
+}
+
+ProfileStats profilerStats(ProfiledSection section)
+{
+    portENTER_CRITICAL(&_profileMux);
+    ProfileStats stats = _profileStats[section];
+    portEXIT_CRITICAL(&_profileMux);
+    return stats;
+}
+
+float profilerLoopRateHz()
+{
+    portENTER_CRITICAL(&_profileMux);
+    float loopRateHz = _loopRateHz;
+    portEXIT_CRITICAL(&_profileMux);
+    return loopRateHz;
+}
+
+float profilerLoad()
+{
+    portENTER_CRITICAL(&_profileMux);
+    float load = _load;
+    portEXIT_CRITICAL(&_profileMux);
+    return load;
+}
+
+void resetStats()
+{
+    portENTER_CRITICAL(&_profileMux);
+    for (uint8_t section = 0; section < PROFILE_SECTION_COUNT; section++)
+        _profileStats[section] = {};
+    portEXIT_CRITICAL(&_profileMux);
+    _windowStartTs = millis();
+    _windowStartLoops = 0;
+    _windowStartUs = 0;
+}
+
+void profilerReset()
+{
+    _resetRequested = true;
+}
+
+void profilerReport(Stream &terminalStream)
+{
+    terminalStream.printf("Profiler: %.1f loops/s, load %.2f%%\n", profilerLoopRateHz(), profilerLoad() * 100);
+    terminalStream.println(F("section       count      avg us  max us  histogram (bucket:count, bucket b = below 2^b us)"));
+    for (uint8_t section = 0; section < PROFILE_SECTION_COUNT; section++)
+    {
+        ProfileStats stats = profilerStats((ProfiledSection)section);
+        terminalStream.printf("%-12s %10lu %8lu %8lu ", SECTION_NAMES[section], (unsigned long)stats.count,
+                              (unsigned long)(stats.count == 0 ? 0 : stats.totalUs / stats.count),
+                              (unsigned long)stats.maxUs);
+        for (uint8_t bucket = 0; bucket < PROFILE_HISTOGRAM_BUCKETS; bucket++)
+        {
+            if (stats.histogram[bucket] != 0)
+                terminalStream.printf(" %u:%lu", bucket, (unsigned long)stats.histogram[bucket]);
+        }
+        terminalStream.println();
+    }
+}
+
+void profilerDebug(Stream &terminalStream)
+{
+    debug_uart_profiler = &terminalStream;
+}
+
+// Job: close the measuring interval
+void profilerWindow()
+{
+    if (_resetRequested)
+    {
+        _resetRequested = false;
+        resetStats();
+        return;
+    }
+    unsigned long elapsedMs = millis() - _windowStartTs;
+    if (elapsedMs == 0)
+        return;
+
+    ProfileStats loop = profilerStats(PROFILE_LOOP);
+    float loopRateHz = (loop.count - _windowStartLoops) * 1000.0f / elapsedMs;
+    float load = (loop.totalUs - _windowStartUs) / (elapsedMs * 1000.0f);
+    portENTER_CRITICAL(&_profileMux);
+    _loopRateHz = loopRateHz;
+    _load = load;
+    portEXIT_CRITICAL(&_profileMux);
+    _windowStartTs += elapsedMs;
+    _windowStartLoops = loop.count;
+    _windowStartUs = loop.totalUs;
+
+    if (debug_uart_profiler != nullptr)
+    {
+        profilerReport(*debug_uart_profiler);
+        controlJobs.report(*debug_uart_profiler);
+        networkJobs.report(*debug_uart_profiler);
+    }
+}
+
+void profilerSetup()
+{
+    resetStats();
+    controlJobs.every("profiler", PROFILER_WINDOW_MS, profilerWindow, PROFILER_WINDOW_MS);
+}
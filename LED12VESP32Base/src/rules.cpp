@@ -0,0 +1,331 @@
+#include <rules.h>
+#include <clock.h>
+#include <config.h>
+#include <scheduler.h>
+
+static const uint8_t ALL_CONDITIONS = (1 << RULE_CONDITION_COUNT) - 1;
+// The time window is checked this often, so its edges are met within this time
+static const uint32_t TIME_OF_DAY_PERIOD_MS = 10000;
+static const unsigned long MS_PER_MINUTE = 60000;
+
+static const char *CONDITION_NAMES[RULE_CONDITION_COUNT] = {"allowed", "dark", "presence", "timeWindow"};
+static const char *OVERRIDE_NAMES[RULE_OVERRIDE_COUNT] = {"none", "on", "off"};
+
+NightLightRule _rule = DEFAULT_NIGHT_LIGHT_RULE;
+NightLightGating _gating = DEFAULT_NIGHT_LIGHT_GATING;
+RuleOverride _override = RULE_OVERRIDE_NONE;
+
+// Inputs
+bool _inAllowed = false;
+uint16_t _inLdrValue = 0;
+uint16_t _inThreshold = 0;
+bool _inPresence = false;
+int16_t _inMinuteOfDay = -1;         // -1: not known
+unsigned long _timeOfDayBaseTs = 0;  // The moment in time the time of day was told
+uint16_t _timeOfDayBaseMinute = 0;   // The time of day told then
+
+// Nodes
+bool _conditionValue[RULE_CONDITION_COUNT] = {false};
+uint8_t _dirtyConditions = ALL_CONDITIONS; // Nodes to evaluate again
+bool _resultDirty = true;                   // The result has to be combined again
+bool _nightLight = false;
+uint32_t _evaluations = 0;
+
+// A change of a condition that waits for its dwell time
+struct PendingChange
+{
+    bool pending;
+    unsigned long sinceTs;
+    JobId wakeJob; // Wakes the control task when the dwell time is up, NO_JOB when none is scheduled
+};
+
+PendingChange _darkChange = {false, 0, NO_JOB};
+PendingChange _presenceChange = {false, 0, NO_JOB};
+bool _darkPlain = false; // Dark without the hysteresis
+RuleSuppressed _suppressed = {};
+
+void markDirty(RuleCondition condition)
+{
+    _dirtyConditions |= ruleBit(condition);
+}
+
+// Jobs: the dwell time is up. Running the job is enough, the control loop evaluates the pending change right after.
+void darkDwellDone() { _darkChange.wakeJob = NO_JOB; }
+void presenceDwellDone() { _presenceChange.wakeJob = NO_JOB; }
+
+void endPending(PendingChange &change)
+{
+    change.pending = false;
+    if (change.wakeJob != NO_JOB)
+    {
+        controlJobs.cancel(change.wakeJob);
+        change.wakeJob = NO_JOB;
+    }
+}
+
+// The value a condition takes: the new one once it has been wanted for dwellMs, the current one until then
+bool dwell(PendingChange &change, bool wanted, bool current, uint16_t dwellMs, uint32_t &suppressed,
+           JobCallback wake)
+{
+    if (wanted == current)
+    {
+        if (change.pending)
+        {
+            // it went back in time
+            endPending(change);
+            suppressed++;
+        }
+        return current;
+    }
+    unsigned long now = clockMillis();
+    if (!change.pending)
+    {
+        change.pending = true;
+        change.sinceTs = now;
+        if (dwellMs > 0)
+            change.wakeJob = controlJobs.once("ruleDwell", dwellMs, wake);
+    }
+    if (now - change.sinceTs < dwellMs)
+        return current;
+    endPending(change);
+    return wanted;
+}
+
+bool inDarkBand(uint32_t threshold)
+{
+    return _inLdrValue >= _rule.ldrMin && _inLdrValue <= threshold;
+}
+
+bool evaluateDark()
+{
+    bool current = _conditionValue[RULE_DARK];
+    bool plain = inDarkBand(_inThreshold);
+    bool dark = current ? inDarkBand((uint32_t)_inThreshold + _gating.ldrHysteresis) : plain;
+    if (plain != _darkPlain)
+    {
+        _darkPlain = plain;
+        if (plain != dark)
+            _suppressed.hysteresis++;
+    }
+    return dwell(_darkChange, dark, current, _gating.darkDwellMs, _suppressed.darkDwell, darkDwellDone);
+}
+
+bool evaluate(RuleCondition condition)
+{
+    switch (condition)
+    {
+    case RULE_ALLOWED:
+        return _inAllowed;
+    case RULE_DARK:
+        return evaluateDark();
+    case RULE_PRESENCE:
+        return dwell(_presenceChange, _inPresence, _conditionValue[RULE_PRESENCE], _gating.presenceDebounceMs,
+                     _suppressed.presenceDebounce, presenceDwellDone);
+    case RULE_TIME_WINDOW:
+        if (_inMinuteOfDay < 0)
+            return true;
+        if (_rule.windowStartMin <= _rule.windowEndMin)
+            return _inMinuteOfDay >= _rule.windowStartMin && _inMinuteOfDay < _rule.windowEndMin;
+        return _inMinuteOfDay >= _rule.windowStartMin || _inMinuteOfDay < _rule.windowEndMin; // spans midnight
+    default:
+        return false;
+    }
+}
+
+// Evaluate the nodes whose inputs have changed, the result only needs combining when a node changed its value
+void evaluateDirty()
+{
+    // a pending change has to be looked at again when its time is up, even though no input changed
+    if (_darkChange.pending)
+        markDirty(RULE_DARK);
+    if (_presenceChange.pending)
+        markDirty(RULE_PRESENCE);
+    if (_dirtyConditions == 0)
+        return;
+    for (uint8_t condition = 0; condition < RULE_CONDITION_COUNT; condition++)
+    {
+        if (!(_dirtyConditions & ruleBit((RuleCondition)condition)))
+            continue;
+        bool value = evaluate((RuleCondition)condition);
+        _evaluations++;
+        if (value != _conditionValue[condition])
+        {
+            _conditionValue[condition] = value;
+            _resultDirty = true;
+        }
+    }
+    _dirtyConditions = 0;
+}
+
+// Whether all conditions of the rule within mask hold
+bool conditionsHold(uint8_t mask)
+{
+    for (uint8_t condition = 0; condition < RULE_CONDITION_COUNT; condition++)
+    {
+        if ((_rule.conditions & mask & ruleBit((RuleCondition)condition)) && !_conditionValue[condition])
+            return false;
+    }
+    return true;
+}
+
+void rulesSetAllowed(bool allowed)
+{
+    if (allowed == _inAllowed)
+        return;
+    _inAllowed = allowed;
+    markDirty(RULE_ALLOWED);
+}
+
+void rulesSetLdr(uint16_t ldrValue, uint16_t nightLightThreshold)
+{
+    if (ldrValue == _inLdrValue && nightLightThreshold == _inThreshold)
+        return;
+    _inLdrValue = ldrValue;
+    _inThreshold = nightLightThreshold;
+    markDirty(RULE_DARK);
+}
+
+void rulesSetPresence(bool presenceDetected)
+{
+    if (presenceDetected == _inPresence)
+        return;
+    _inPresence = presenceDetected;
+    markDirty(RULE_PRESENCE);
+}
+
+void rulesSetOverride(RuleOverride value)
+{
+    if (value >= RULE_OVERRIDE_COUNT || value == _override)
+        return;
+    _override = value;
+    _resultDirty = true;
+}
+
+// Job: let the time of day advance
+void updateTimeOfDay()
+{
+    if (_inMinuteOfDay < 0)
+        return;
+    int16_t minute = (_timeOfDayBaseMinute + (clockMillis() - _timeOfDayBaseTs) / MS_PER_MINUTE) % MINUTES_PER_DAY;
+    if (minute == _inMinuteOfDay)
+        return;
+    _inMinuteOfDay = minute;
+    markDirty(RULE_TIME_WINDOW);
+}
+
+void rulesSetTimeOfDay(uint16_t minuteOfDay)
+{
+    _timeOfDayBaseTs = clockMillis();
+    _timeOfDayBaseMinute = minuteOfDay % MINUTES_PER_DAY;
+    _inMinuteOfDay = _timeOfDayBaseMinute;
+    markDirty(RULE_TIME_WINDOW);
+}
+
+void rulesSetConditions(uint8_t conditions)
+{
+    _rule.conditions = conditions & ALL_CONDITIONS;
+    _resultDirty = true;
+}
+
+void rulesSetLdrMin(uint16_t value)
+{
+    _rule.ldrMin = value;
+    markDirty(RULE_DARK);
+}
+
+void rulesSetWindowStart(uint16_t minuteOfDay)
+{
+    _rule.windowStartMin = minuteOfDay % MINUTES_PER_DAY;
+    markDirty(RULE_TIME_WINDOW);
+}
+
+void rulesSetWindowEnd(uint16_t minuteOfDay)
+{
+    _rule.windowEndMin = minuteOfDay > MINUTES_PER_DAY ? MINUTES_PER_DAY : minuteOfDay;
+    markDirty(RULE_TIME_WINDOW);
+}
+
+void rulesSetLdrHysteresis(uint16_t value)
+{
+    _gating.ldrHysteresis = value;
+    markDirty(RULE_DARK);
+}
+
+void rulesSetDarkDwellMs(uint16_t value)
+{
+    _gating.darkDwellMs = value;
+    // a pending change starts over with the new dwell time
+    endPending(_darkChange);
+    markDirty(RULE_DARK);
+}
+
+void rulesSetPresenceDebounceMs(uint16_t value)
+{
+    _gating.presenceDebounceMs = value;
+    endPending(_presenceChange);
+    markDirty(RULE_PRESENCE);
+}
+
+void rulesSave()
+{
+    setNightLightRule(_rule);
+    setNightLightGating(_gating);
+}
+
+void rulesUpdate() { evaluateDirty(); }
+
+bool rulesNightLight()
+{
+    evaluateDirty();
+    if (_resultDirty)
+    {
+        _nightLight = _override == RULE_OVERRIDE_NONE ? conditionsHold(ALL_CONDITIONS) : _override == RULE_OVERRIDE_ON;
+        _resultDirty = false;
+    }
+    return _nightLight;
+}
+
+bool rulesKeepNightLight()
+{
+    if (_override != RULE_OVERRIDE_NONE)
+        return _override == RULE_OVERRIDE_ON;
+    evaluateDirty();
+    return conditionsHold(ALL_CONDITIONS & ~(ruleBit(RULE_DARK) | ruleBit(RULE_PRESENCE)));
+}
+
+bool rulesPresence()
+{
+    evaluateDirty();
+    return _conditionValue[RULE_PRESENCE];
+}
+
+NightLightRule rulesConfig() { return _rule; }
+NightLightGating rulesGating() { return _gating; }
+RuleSuppressed rulesSuppressed() { return _suppressed; }
+RuleOverride rulesOverride() { return _override; }
+bool rulesCondition(RuleCondition condition) { return condition < RULE_CONDITION_COUNT && _conditionValue[condition]; }
+
+const char *ruleConditionName(RuleCondition condition)
+{
+    return condition < RULE_CONDITION_COUNT ? CONDITION_NAMES[condition] : "?";
+}
+
+const char *ruleOverrideName(RuleOverride value)
+{
+    return value < RULE_OVERRIDE_COUNT ? OVERRIDE_NAMES[value] : "?";
+}
+
+int16_t rulesTimeOfDay() { return _inMinuteOfDay; }
+uint32_t rulesEvaluations() { return _evaluations; }
+
+void rulesSetup()
+{
+    if (!nightLightRule(_rule))
+        _rule = DEFAULT_NIGHT_LIGHT_RULE;
+    _rule.conditions &= ALL_CONDITIONS;
+    if (!nightLightGating(_gating))
+        _gating = DEFAULT_NIGHT_LIGHT_GATING;
+    _dirtyConditions = ALL_CONDITIONS;
+    _resultDirty = true;
+    controlJobs.every("timeOfDay", TIME_OF_DAY_PERIOD_MS, updateTimeOfDay);
+}
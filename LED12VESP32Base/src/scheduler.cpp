@@ -0,0 +1,335 @@
+#include <clock.h>
+#include <scheduler.h>
+
+static const uint32_t WHEEL_SLOT_MASK = WHEEL_SLOTS - 1;
+// Jobs due this far out or more get placed at the end of the last level
+static const uint32_t WHEEL_SPAN_MS = 1UL << (WHEEL_SLOT_BITS * WHEEL_LEVELS);
+
+Scheduler controlJobs("control");
+Scheduler networkJobs("network");
+
+Scheduler::Scheduler(const char *name) : _name(name)
+{
+    for (uint8_t job = 0; job < MAX_JOBS; job++)
+    {
+        _jobs[job] = {};
+        _jobs[job].level = -1;
+        _jobs[job].next = NO_JOB;
+    }
+    for (uint8_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        for (uint8_t slot = 0; slot < WHEEL_SLOTS; slot++)
+            _slots[level][slot] = NO_JOB;
+    }
+}
+
+JobId Scheduler::every(const char *name, uint32_t periodMs, JobCallback callback, uint32_t firstDelayMs)
+{
+    return add(name, periodMs == 0 ? 1 : periodMs, firstDelayMs, callback);
+}
+
+JobId Scheduler::once(const char *name, uint32_t delayMs, JobCallback callback)
+{
+    return add(name, 0, delayMs, callback);
+}
+
+JobId Scheduler::add(const char *name, uint32_t periodMs, uint32_t delayMs, JobCallback callback)
+{
+    if (!_started)
+    {
+        _now = clockMillis();
+        _started = true;
+    }
+    for (JobId job = 0; job < MAX_JOBS; job++)
+    {
+        if (_jobs[job].stats.active)
+            continue;
+        _jobs[job].callback = callback;
+        _jobs[job].dueMs = clockMillis() + delayMs;
+        portENTER_CRITICAL(&_statsMux);
+        _jobs[job].stats = {};
+        _jobs[job].stats.name = name;
+        _jobs[job].stats.active = true;
+        _jobs[job].stats.periodMs = periodMs;
+        portEXIT_CRITICAL(&_statsMux);
+        place(job);
+        return job;
+    }
+    return NO_JOB;
+}
+
+void Scheduler::setPeriod(JobId job, uint32_t periodMs)
+{
+    if (job < 0 || job >= MAX_JOBS || !_jobs[job].stats.active || _jobs[job].stats.periodMs == 0)
+        return;
+    portENTER_CRITICAL(&_statsMux);
+    _jobs[job].stats.periodMs = periodMs == 0 ? 1 : periodMs;
+    portEXIT_CRITICAL(&_statsMux);
+    unlink(job);
+    _jobs[job].dueMs = clockMillis() + _jobs[job].stats.periodMs;
+    place(job);
+}
+
+void Scheduler::cancel(JobId job)
+{
+    if (job < 0 || job >= MAX_JOBS)
+        return;
+    unlink(job);
+    portENTER_CRITICAL(&_statsMux);
+    _jobs[job].stats.active = false;
+    portEXIT_CRITICAL(&_statsMux);
+}
+
+// Link a job into the slot its due time falls into, on the finest level that reaches that far
+void Scheduler::place(JobId job)
+{
+    Job &j = _jobs[job];
+    uint32_t dueMs = j.dueMs;
+    uint32_t delta = dueMs - _now;
+    if ((int32_t)delta <= 0)
+    {
+        // overdue: handle it with the next tick
+        delta = 1;
+        dueMs = _now + 1;
+        j.dueMs = dueMs;
+    }
+    if (delta >= WHEEL_SPAN_MS)
+        dueMs = _now + WHEEL_SPAN_MS - 1; // move on from the end of the wheel later
+    uint8_t level = 0;
+    while (level < WHEEL_LEVELS - 1 && (dueMs - _now) >= (1UL << (WHEEL_SLOT_BITS * (level + 1))))
+        level++;
+    j.level = level;
+    j.slot = (dueMs >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    j.next = _slots[level][j.slot];
+    _slots[level][j.slot] = job;
+    _occupied[level] |= 1ULL << j.slot;
+}
+
+void Scheduler::unlink(JobId job)
+{
+    Job &j = _jobs[job];
+    if (j.level < 0)
+        return;
+    int8_t *link = &_slots[j.level][j.slot];
+    while (*link != NO_JOB && *link != job)
+        link = &_jobs[*link].next;
+    if (*link == job)
+        *link = j.next;
+    if (_slots[j.level][j.slot] == NO_JOB)
+        _occupied[j.level] &= ~(1ULL << j.slot);
+    j.level = -1;
+    j.next = NO_JOB;
+}
+
+// Move all jobs of the current slot of a level down to the finer levels
+void Scheduler::cascade(uint8_t level)
+{
+    uint8_t slot = (_now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    JobId job = _slots[level][slot];
+    _slots[level][slot] = NO_JOB;
+    _occupied[level] &= ~(1ULL << slot);
+    while (job != NO_JOB)
+    {
+        JobId next = _jobs[job].next;
+        _jobs[job].level = -1;
+        if (_jobs[job].dueMs == _now)
+        {
+            // due right now: into the slot tick() handles next
+            _jobs[job].level = 0;
+            _jobs[job].slot = _now & WHEEL_SLOT_MASK;
+            _jobs[job].next = _slots[0][_jobs[job].slot];
+            _slots[0][_jobs[job].slot] = job;
+            _occupied[0] |= 1ULL << _jobs[job].slot;
+        }
+        else
+        {
+            place(job);
+        }
+        job = next;
+    }
+}
+
+void Scheduler::fire(JobId job)
+{
+    Job &j = _jobs[job];
+    if (!j.stats.active || j.level >= 0)
+        return; // cancelled (or cancelled and scheduled anew) by a job run before
+    unsigned long startMs = clockMillis();
+    uint32_t lateMs = startMs - j.dueMs;
+    portENTER_CRITICAL(&_statsMux);
+    j.stats.runs++;
+    j.stats.totalLateMs += lateMs;
+    if (lateMs > j.stats.maxLateMs)
+        j.stats.maxLateMs = lateMs;
+    portEXIT_CRITICAL(&_statsMux);
+
+    unsigned long startUs = micros();
+    j.callback();
+    uint32_t runUs = micros() - startUs;
+    if (runUs > j.stats.maxRunUs)
+    {
+        portENTER_CRITICAL(&_statsMux);
+        j.stats.maxRunUs = runUs;
+        portEXIT_CRITICAL(&_statsMux);
+    }
+
+    if (!j.stats.active || j.level >= 0)
+        return; // cancelled or rescheduled by itself
+    if (j.stats.periodMs == 0)
+    {
+        portENTER_CRITICAL(&_statsMux);
+        j.stats.active = false;
+        portEXIT_CRITICAL(&_statsMux);
+        return;
+    }
+    // keep the phase, skip the periods that have passed meanwhile
+    uint32_t overruns = 0;
+    j.dueMs += j.stats.periodMs;
+    while ((int32_t)(j.dueMs - clockMillis()) < 0)
+    {
+        j.dueMs += j.stats.periodMs;
+        overruns++;
+    }
+    if (overruns > 0)
+    {
+        portENTER_CRITICAL(&_statsMux);
+        j.stats.overruns += overruns;
+        portEXIT_CRITICAL(&_statsMux);
+    }
+    place(job);
+}
+
+// Advance the wheel by one ms: cascade the levels that come due and run the jobs of the slot
+void Scheduler::tick()
+{
+    _now++;
+    uint8_t slot = _now & WHEEL_SLOT_MASK;
+    for (uint8_t level = 1; level < WHEEL_LEVELS && slot == 0; level++)
+    {
+        // a finer level has wrapped around: the next slot of this level comes due
+        cascade(level);
+        slot = (_now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    }
+
+    // detach the due jobs first, so they may schedule and cancel jobs freely
+    JobId due[MAX_JOBS];
+    uint8_t dueCount = 0;
+    slot = _now & WHEEL_SLOT_MASK;
+    JobId job = _slots[0][slot];
+    _slots[0][slot] = NO_JOB;
+    _occupied[0] &= ~(1ULL << slot);
+    while (job != NO_JOB)
+    {
+        JobId next = _jobs[job].next;
+        _jobs[job].level = -1;
+        _jobs[job].next = NO_JOB;
+        if (_jobs[job].dueMs == _now)
+            due[dueCount++] = job;
+        else
+            place(job);
+        job = next;
+    }
+    for (uint8_t i = 0; i < dueCount; i++)
+        fire(due[i]);
+}
+
+// Slots from the current slot of a level to its next occupied one (1 .. WHEEL_SLOTS), 0 when the level is empty
+uint8_t Scheduler::nextOccupied(uint8_t level) const
+{
+    uint64_t occupied = _occupied[level];
+    if (occupied == 0)
+        return 0;
+    uint8_t current = (_now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+    uint8_t shift = (current + 1) & WHEEL_SLOT_MASK;
+    uint64_t rotated = shift == 0 ? occupied : (occupied >> shift) | (occupied << (WHEEL_SLOTS - shift));
+    return __builtin_ctzll(rotated) + 1;
+}
+
+// Wheel time of the next tick with something to do: the next occupied slot of level 0, or the start of the next
+// occupied slot of a higher level (it cascades then). False when the wheel is empty.
+bool Scheduler::nextEvent(uint32_t &eventMs) const
+{
+    bool found = false;
+    for (uint8_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        uint8_t distance = nextOccupied(level);
+        if (distance == 0)
+            continue;
+        uint8_t shift = WHEEL_SLOT_BITS * level;
+        uint32_t atMs = (((_now >> shift) + distance) << shift);
+        if (!found || (int32_t)(atMs - eventMs) < 0)
+            eventMs = atMs;
+        found = true;
+    }
+    return found;
+}
+
+uint32_t Scheduler::run()
+{
+    if (!_started)
+        return UINT32_MAX;
+    uint32_t nowMs = clockMillis();
+    while ((int32_t)(nowMs - _now) > 0)
+    {
+        // skip the ticks with nothing to do in one go
+        uint32_t eventMs;
+        if (!nextEvent(eventMs) || (int32_t)(eventMs - nowMs) > 0)
+        {
+            _now = nowMs;
+            break;
+        }
+        _now = eventMs - 1;
+        tick();
+    }
+    return msUntilNextDue();
+}
+
+// The earliest job of each level is in its next occupied slot: the slots of a level follow each other in time
+uint32_t Scheduler::msUntilNextDue() const
+{
+    uint32_t nowMs = clockMillis();
+    uint32_t untilMs = UINT32_MAX;
+    for (uint8_t level = 0; level < WHEEL_LEVELS; level++)
+    {
+        uint8_t distance = nextOccupied(level);
+        if (distance == 0)
+            continue;
+        uint8_t current = (_now >> (WHEEL_SLOT_BITS * level)) & WHEEL_SLOT_MASK;
+        for (JobId job = _slots[level][(current + distance) & WHEEL_SLOT_MASK]; job != NO_JOB; job = _jobs[job].next)
+        {
+            int32_t delta = _jobs[job].dueMs - nowMs;
+            if (delta <= 0)
+                return 0;
+            if ((uint32_t)delta < untilMs)
+                untilMs = delta;
+        }
+    }
+    return untilMs;
+}
+
+JobStats Scheduler::stats(JobId job) const
+{
+    if (job < 0 || job >= MAX_JOBS)
+        return {};
+    portENTER_CRITICAL(&_statsMux);
+    JobStats stats = _jobs[job].stats;
+    portEXIT_CRITICAL(&_statsMux);
+    return stats;
+}
+
+void Scheduler::report(Stream &terminalStream) const
+{
+    terminalStream.printf("Jobs of %s:\n", _name);
+    terminalStream.println(F("job              period ms     runs  avg late ms  max late ms  overruns  max run us"));
+    for (uint8_t job = 0; job < MAX_JOBS; job++)
+    {
+        JobStats stats = this->stats(job);
+        if (!stats.active)
+            continue;
+        terminalStream.printf("%-16s %9lu %8lu %12lu %12lu %9lu %11lu\n", stats.name, (unsigned long)stats.periodMs,
+                              (unsigned long)stats.runs,
+                              (unsigned long)(stats.runs == 0 ? 0 : stats.totalLateMs / stats.runs),
+                              (unsigned long)stats.maxLateMs, (unsigned long)stats.overruns,
+                              (unsigned long)stats.maxRunUs);
+    }
+}
@@ -2,6 +2,9 @@
 
 #include <touch.h>
 #include <device_common.h>
+#include <events.h>
+#include <clock.h>
+#include <driver/gpio.h>
 
 Button2 touch1, touch2, touch3, touch4;
 
@@ -10,10 +13,20 @@ TouchCallbackFunction doubleClicked_cb[4] = {NULL};
 TouchCallbackFunction tripleClicked_cb[4] = {NULL};
 TouchCallbackFunction longClicked_cb[4] = {NULL};
 TouchCallbackFunction released_cb[4] = {NULL};
+TouchStateFunction state_fn[4] = {NULL}; // NULL: read the touch pin
 
 Stream *debug_uart_touch = nullptr; // The stream used for the debugging
 
 static const uint8_t LAST_BUTTON = 3;
+// After a touch the buttons are polled closely for this long, so multi clicks are detected in time.
+static const unsigned long TOUCH_ACTIVE_MS = 1000;
+
+volatile bool _touchEdge = false; // Set by the interrupt when a touch pin changes its level
+unsigned long _lastTouchTs = 0;   // The moment in time a touch pin last changed its level
+
+static const uint8_t TOUCH_PINS[] = {TOUCH1_PIN, TOUCH2_PIN, TOUCH3_PIN, TOUCH4_PIN};
+volatile bool _touchWakeArmed = false; // Whether a touch wakes the controller from light sleep
+portMUX_TYPE _touchWakeMux = portMUX_INITIALIZER_UNLOCKED;
 
 uint8_t buttonNumber(const Button2 &btn)
 {
@@ -96,16 +109,70 @@ void released(const Button2 &btn)
   }
 }
 
+// Back to interrupts on both edges. Call with _touchWakeMux taken.
+void disarmWakeup()
+{
+  _touchWakeArmed = false;
+  for (uint8_t pin : TOUCH_PINS)
+  {
+    gpio_wakeup_disable((gpio_num_t)pin);
+    gpio_set_intr_type((gpio_num_t)pin, GPIO_INTR_ANYEDGE);
+  }
+}
+
+void touchArmWakeup()
+{
+  portENTER_CRITICAL(&_touchWakeMux);
+  if (!_touchWakeArmed)
+  {
+    // light sleep only wakes up on a level: the interrupt fires once for it and switches back to edges
+    _touchWakeArmed = true;
+    for (uint8_t pin : TOUCH_PINS)
+      gpio_wakeup_enable((gpio_num_t)pin, GPIO_INTR_HIGH_LEVEL);
+  }
+  portEXIT_CRITICAL(&_touchWakeMux);
+}
+
+void touchDisarmWakeup()
+{
+  portENTER_CRITICAL(&_touchWakeMux);
+  if (_touchWakeArmed)
+    disarmWakeup();
+  portEXIT_CRITICAL(&_touchWakeMux);
+}
+
+// Called when a touch pin changes its level (or is high while armed for wake up), wakes up the control loop
+void ARDUINO_ISR_ATTR touchEdge()
+{
+  portENTER_CRITICAL_ISR(&_touchWakeMux);
+  if (_touchWakeArmed)
+    disarmWakeup();
+  portEXIT_CRITICAL_ISR(&_touchWakeMux);
+  _touchEdge = true;
+  postEventFromISR(EVENT_TOUCH);
+}
+
 void setupButton(const uint8_t pin, Button2 &btn)
 {
-  // the touch buttons are active high
-  btn.begin(pin, INPUT_PULLDOWN, false);
+  TouchStateFunction stateFunction = state_fn[btn.getID()];
+  if (stateFunction != NULL)
+  {
+    btn.setButtonStateFunction(stateFunction);
+    btn.begin(BTN_VIRTUAL_PIN);
+  }
+  else
+  {
+    // the touch buttons are active high
+    btn.begin(pin, INPUT_PULLDOWN, false);
+  }
   btn.setClickHandler(clicked);
   btn.setDoubleClickHandler(doubleClicked);
   btn.setLongClickDetectedHandler(longClicked);
   btn.setLongClickDetectedRetriggerable(true);
   btn.setTripleClickHandler(tripleClicked);
   btn.setReleasedHandler(released);
+  if (stateFunction == NULL)
+    attachInterrupt(digitalPinToInterrupt(pin), touchEdge, CHANGE);
   if (debug_uart_touch != nullptr)
   {
 
@@ -121,6 +188,7 @@ void setDoubleClickHandler(const ButtonNumber button, const TouchCallbackFunctio
 void setLongClickHandler(const ButtonNumber button, const TouchCallbackFunction &f) { longClicked_cb[button] = f; }
 void setTripleClickHandler(const ButtonNumber button, const TouchCallbackFunction &f) { tripleClicked_cb[button] = f; }
 void setReleasedHandler(const ButtonNumber button, const TouchCallbackFunction &f) { released_cb[button] = f; }
+void setStateFunction(const ButtonNumber button, TouchStateFunction f) { state_fn[button] = f; }
 
 void touchDebug(Stream &terminalStream) { debug_uart_touch = &terminalStream; }
 
@@ -161,8 +229,19 @@ void touchSetup()
   touch4.setLongClickDetectedRetriggerable(false);
 }
 
+bool touchActive()
+{
+  return clockMillis() - _lastTouchTs < TOUCH_ACTIVE_MS || touch1.isPressed() || touch2.isPressed() ||
+         touch3.isPressed() || touch4.isPressed();
+}
+
 void touchLoop()
 {
+  if (_touchEdge)
+  {
+    _touchEdge = false;
+    _lastTouchTs = clockMillis();
+  }
   touch1.loop();
   touch2.loop();
   touch3.loop();
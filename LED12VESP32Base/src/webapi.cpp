@@ -1,29 +1,93 @@
+#include <memory>
+
 #include <webapi.h>
 #include <wifi_handler.h>
 #include <webinterface.h>
 #include <config.h>
 #include <device_state.h>
 #include <ldr.h>
+#include <led_strip.h>
 
 #include <Update.h>
 #include <ESPmDNS.h>
 #include <mqtt_handler.h>
+#include <commands.h>
+#include <profiler.h>
+#include <scheduler.h>
+#include <power.h>
+#include <rules.h>
+#include <boot.h>
+#include <history.h>
+#include <events.h>
 
 #define U_PART U_SPIFFS
 
 static const char *PrefSaveAsPreference = "sapr";
 static const char *PrefSetLampState = "slst";
+static const char *PrefRuleOverride = "nlov";
+static const char *PrefTimeOfDay = "tod";
+static const char *PrefLdrCalibration = "ldca";
 
 static unsigned long const REPORT_DELAY_MS = 5000;
 
+// Fits the longest value a parameter may have (passphrases, MQTT server), longer values get ignored
+static const size_t MAX_PARAM_LENGTH = MAX_PASSPHRASE_LEN;
+typedef FixedString<MAX_PARAM_LENGTH> ParamString;
+static_assert(MAX_MQTT_SERVER_LENGTH <= MAX_PARAM_LENGTH, "MQTT server does not fit ParamString");
+
 Stream *debug_uart_web_interface = nullptr;
 
 AsyncWebServer _server(80);
 bool _serverStarted = false;
-String _http_username;
-String _http_password;
+WebAuthUsername _http_username;
+WebAuthPassword _http_password;
+
+JobId _reportJob = NO_JOB;
 
-unsigned long _lastReport = 0;
+// Settings the network task uses (WiFi, MQTT, web authentication). The web handlers run in the AsyncTCP task, they
+// leave the value here (under the device state lock) and webApiLoop() applies it within the network task.
+enum NetworkSetting : uint8_t
+{
+  NETWORK_WEB_AUTH_PASSWORD,
+  NETWORK_WEB_AUTH_USERNAME,
+  NETWORK_AP_PASSPHRASE,
+  NETWORK_AP_IP_ADDRESS,
+  NETWORK_AP_NETMASK,
+  NETWORK_AP_SSID,
+  NETWORK_HOSTNAME,
+  NETWORK_STA_PASSPHRASE,
+  NETWORK_STA_SSID,
+  NETWORK_MQTT_SERVER,
+  NETWORK_MQTT_USER,
+  NETWORK_MQTT_PASSWORD,
+  NETWORK_SETTING_COUNT
+};
+
+struct PendingNetworkSetting
+{
+  bool pending;
+  FixedString<MAX_PASSPHRASE_LEN> value;
+};
+
+PendingNetworkSetting _pendingNetworkSettings[NETWORK_SETTING_COUNT];
+volatile bool _networkSettingsPosted = false; // Some setting is pending, saves taking the lock on each pass
+
+// How a setting gets applied, in NetworkSetting order. Wifi settings get saved as preference when they have proved to
+// work, the others right away (only written when they differ from the saved ones).
+static void (*const NETWORK_SETTING_APPLY[NETWORK_SETTING_COUNT])(const char *) = {
+    [](const char *v) { _http_password.assign(v); setWebAuthPassword(v); },
+    [](const char *v) { _http_username.assign(v); setWebAuthUsername(v); },
+    [](const char *v) { modifyApPassphrase(v); },
+    [](const char *v) { modifyApIpAddress(v); },
+    [](const char *v) { modifyApIpNetmask(v); },
+    [](const char *v) { modifyApSsid(v); },
+    [](const char *v) { modifyHostname(v); },
+    [](const char *v) { modifyStaPassphrase(v); setWifiStaPassphrase(v); },
+    [](const char *v) { modifyStaSsid(v); setWifiStaSsid(v); },
+    [](const char *v) { modifyMqttServer(v); setMqttServer(v); },
+    [](const char *v) { modifyMqttUsername(v); setMqttUsername(v); },
+    [](const char *v) { modifyMqttPassword(v); },
+};
 
 AsyncWebServer &getWebServer() { return _server; }
 
@@ -55,19 +119,26 @@ struct convertedBool
 
 void webApiDebug(Stream &terminalStream) { debug_uart_web_interface = &terminalStream; }
 
-bool tryGetParam(AsyncWebServerRequest *request, const char *paramName, bool post, String &value)
+bool tryGetParam(AsyncWebServerRequest *request, const char *paramName, bool post, ParamString &value)
 {
-  if (!request->hasParam(paramName, post))
+  const AsyncWebParameter *param = request->getParam(paramName, post);
+  if (param == nullptr)
     return false;
-  value = request->getParam(paramName, post)->value();
+  const String &paramValue = param->value();
+  bool fits = value.assign(paramValue.c_str(), paramValue.length());
   if (debug_uart_web_interface != nullptr)
   {
     debug_uart_web_interface->print(F("[API] found param "));
     debug_uart_web_interface->print(paramName);
-    debug_uart_web_interface->print(F(" = "));
-    debug_uart_web_interface->println(value);
+    if (fits)
+    {
+      debug_uart_web_interface->print(F(" = "));
+      debug_uart_web_interface->println(value.c_str());
+    }
+    else
+      debug_uart_web_interface->println(F(", too long, ignored"));
   }
-  return true;
+  return fits;
 }
 
 /*
@@ -79,13 +150,13 @@ bool tryGetParam(AsyncWebServerRequest *request, const char *paramName, bool pos
 /// @brief Bounds a value to a value between 0 and a maximum value
 /// @param rawValue The value to bound
 /// @param maxVal The allowed maximum value
-// void boundValue(const String &rawValue, long maxVal, boundL_t &convertInfo) { boundValue(rawValue, maxVal, 0, convertInfo); }
+// void boundValue(const ParamString &rawValue, long maxVal, boundL_t &convertInfo) { boundValue(rawValue, maxVal, 0, convertInfo); }
 
 /// @brief Bounds a value to a value between a minimum and a maximum value
 /// @param rawValue The value to bound
 /// @param maxVal The allowed maximum value
 /// @param minVal The allowed minimum value
-void boundValue(const String &rawValue, long minVal, long maxVal, boundL_t &convertInfo)
+void boundValue(const ParamString &rawValue, long minVal, long maxVal, boundL_t &convertInfo)
 {
   char *p;
   convertInfo.rawValueD = strtod(rawValue.c_str(), &p);
@@ -104,7 +175,7 @@ void boundValue(const String &rawValue, long minVal, long maxVal, boundL_t &conv
 /// @param min
 /// @param max
 /// @param result The result of conversion and bounding
-void boundValue8_t(const String &rawValue, uint8_t min, uint8_t max, bound8_t &result)
+void boundValue8_t(const ParamString &rawValue, uint8_t min, uint8_t max, bound8_t &result)
 {
   boundValue(rawValue, min, max, result);
   result.value = (uint8_t)result.boundValueL;
@@ -113,14 +184,14 @@ void boundValue8_t(const String &rawValue, uint8_t min, uint8_t max, bound8_t &r
 /// @brief Converts and bounds a number contained in a String to the uint8_t range 0..UINT8_MAX
 /// @param rawValue The String containing a number
 /// @param result The result of conversion and bounding
-void boundValue8_t(const String &rawValue, bound8_t &result) { boundValue8_t(rawValue, 0, UINT8_MAX, result); }
+void boundValue8_t(const ParamString &rawValue, bound8_t &result) { boundValue8_t(rawValue, 0, UINT8_MAX, result); }
 
 /// @brief Converts and bounds a number contained in a String to the uint16_t range min..max
 /// @param rawValue The String containing a number
 /// @param min
 /// @param max
 /// @param result The result of conversion and bounding
-void boundValue16_t(const String &rawValue, uint16_t min, uint16_t max, bound16_t &result)
+void boundValue16_t(const ParamString &rawValue, uint16_t min, uint16_t max, bound16_t &result)
 {
   boundValue(rawValue, min, max, result);
   result.value = (uint16_t)result.boundValueL;
@@ -129,14 +200,14 @@ void boundValue16_t(const String &rawValue, uint16_t min, uint16_t max, bound16_
 /// @brief Converts and bounds a number contained in a String to the uint16_t 0..UINT16_MAX
 /// @param rawValue The String containing a number
 /// @param result The result of conversion and bounding
-void boundValue16_t(const String &rawValue, bound16_t &result) { boundValue16_t(rawValue, 0, UINT16_MAX, result); }
+void boundValue16_t(const ParamString &rawValue, bound16_t &result) { boundValue16_t(rawValue, 0, UINT16_MAX, result); }
 
 /// @brief checks whether a String is within length boundaries
 /// @param rawValue The String to check
 /// @param min minimum length (inclusive)
 /// @param max maximum length (inclusive)
 /// @return whether the rawValues length is in between min (>=) and max (<=)
-bool withinLength(const String &rawValue, size_t min, size_t max)
+bool withinLength(const ParamString &rawValue, size_t min, size_t max)
 {
   uint len = rawValue.length();
   return len >= min && len <= max;
@@ -145,250 +216,371 @@ bool withinLength(const String &rawValue, size_t min, size_t max)
 /// @brief Converts a boolean value contained in a String
 /// @param rawValue The String containing a boolean value
 /// @param convInfo The result of the conversion
-void toBool(const String &rawValue, convertedBool &convInfo)
+void toBool(const ParamString &rawValue, convertedBool &convInfo)
 {
-  convInfo.value = rawValue.equalsIgnoreCase(F("true"));
-  convInfo.isBool = convInfo.value || rawValue.equalsIgnoreCase(F("false"));
+  convInfo.value = rawValue.equalsIgnoreCase("true");
+  convInfo.isBool = convInfo.value || rawValue.equalsIgnoreCase("false");
 }
 
-void parAllowNightLightMode(const String &rawValue, bool setAsPreference)
+void parAllowNightLightMode(const ParamString &rawValue, bool setAsPreference)
 {
   convertedBool cb;
   toBool(rawValue, cb);
   if (cb.isBool)
-    (setAsPreference ? setAllowNightLight : modifyAllowNightLightMode)(cb.value);
+    postParameter(PARAM_ALLOW_NIGHT_LIGHT, cb.value, setAsPreference);
 }
 
-void parMaxBrightness(const String &rawValue, bool setAsPreference)
+void parMaxBrightness(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxBrightness : modifyMaxBrightness)(bv.value);
+    postParameter(PARAM_MAX_BRIGHTNESS, bv.value, setAsPreference);
 }
 
-void parMaxMovingTargetDistance(const String &rawValue, bool setAsPreference)
+void parMaxMovingTargetDistance(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxMovingTargetDistance : modifyMaxMovingTargetDistance)(bv.value);
+    postParameter(PARAM_MAX_MOVING_TARGET_DISTANCE, bv.value, setAsPreference);
 }
 
-void parMaxMovingTargetEnergy(const String &rawValue, bool setAsPreference)
+void parMaxMovingTargetEnergy(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxMovingTargetEnergy : modifyMaxMovingTargetEnergy)(bv.value);
+    postParameter(PARAM_MAX_MOVING_TARGET_ENERGY, bv.value, setAsPreference);
 }
 
-void parMaxNightLightBrightness(const String &rawValue, bool setAsPreference)
+void parMaxNightLightBrightness(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxNightLightBrightness : modifyMaxNightLightBrightness)(bv.value);
+    postParameter(PARAM_MAX_NIGHT_LIGHT_BRIGHTNESS, bv.value, setAsPreference);
 }
 
-void parMaxStationaryTargetDistance(const String &rawValue, bool setAsPreference)
+void parMaxStationaryTargetDistance(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxStationaryTargetDistance : modifyMaxStationaryTargetDistance)(bv.value);
+    postParameter(PARAM_MAX_STATIONARY_TARGET_DISTANCE, bv.value, setAsPreference);
 }
 
-void parMaxStationaryTargetEnergy(const String &rawValue, bool setAsPreference)
+void parMaxStationaryTargetEnergy(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMaxStationaryTargetEnergy : modifyMaxStationaryTargetEnergy)(bv.value);
+    postParameter(PARAM_MAX_STATIONARY_TARGET_ENERGY, bv.value, setAsPreference);
 }
 
-void parMinMovingTargetDistance(const String &rawValue, bool setAsPreference)
+void parMinMovingTargetDistance(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMinMovingTargetDistance : modifyMinMovingTargetDistance)(bv.value);
+    postParameter(PARAM_MIN_MOVING_TARGET_DISTANCE, bv.value, setAsPreference);
 }
 
-void parMinMovingTargetEnergy(const String &rawValue, bool setAsPreference)
+void parMinMovingTargetEnergy(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMinStationaryTargetEnergy : modifyMinStationaryTargetEnergy)(bv.value);
+    postParameter(PARAM_MIN_MOVING_TARGET_ENERGY, bv.value, setAsPreference);
 }
 
-void parMinStationaryTargetDistance(const String &rawValue, bool setAsPreference)
+void parMinStationaryTargetDistance(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMinStationaryTargetDistance : modifyMinStationaryTargetDistance)(bv.value);
+    postParameter(PARAM_MIN_STATIONARY_TARGET_DISTANCE, bv.value, setAsPreference);
 }
 
-void parMinStationaryTargetEnergy(const String &rawValue, bool setAsPreference)
+void parMinStationaryTargetEnergy(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setMinStationaryTargetEnergy : modifyMinStationaryTargetEnergy)(bv.value);
+    postParameter(PARAM_MIN_STATIONARY_TARGET_ENERGY, bv.value, setAsPreference);
 }
 
-void parNightLightBrightness(const String &rawValue, bool setAsPreference)
+void parNightLightBrightness(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setNightLightBrightness : modifyNightLightBrightness)(bv.value);
+    postParameter(PARAM_NIGHT_LIGHT_BRIGHTNESS, bv.value, setAsPreference);
 }
 
-void parNightLightLdrThreshold(const String &rawValue, bool setAsPreference)
+void parNightLightLdrThreshold(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, 0, MAX_BRIGHTNESS, bv);
   if (bv.isNumber)
-    (setAsPreference ? setNightLightThreshold : modifyNightLightThreshold)(bv.value);
+    postParameter(PARAM_NIGHT_LIGHT_THRESHOLD, bv.value, setAsPreference);
 }
 
-void parOnBrightness(const String &rawValue, bool setAsPreference)
+void parOnBrightness(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue8_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setOnBrightness : modifyOnBrightness)(bv.value);
+    postParameter(PARAM_ON_BRIGHTNESS, bv.value, setAsPreference);
 }
 
-void parNightLightOnDuration(const String &rawValue, bool setAsPreference)
+void parNightLightOnDuration(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setNightLightOnDuration : modifyNightLightOnDurationSeconds)(bv.value);
+    postParameter(PARAM_NIGHT_LIGHT_ON_DURATION, bv.value, setAsPreference);
 }
 
-void parBrightnessStep(const String &rawValue, bool setAsPreference)
+void parBrightnessStep(const ParamString &rawValue, bool setAsPreference)
 {
   bound8_t bv;
   boundValue(rawValue, 1, UINT8_MAX, bv);
   if (bv.isNumber)
-    (setAsPreference ? setBrightnessStep : modifyBrightnessStep)(bv.value);
+    postParameter(PARAM_BRIGHTNESS_STEP, bv.value, setAsPreference);
 }
 
-void parTransitionDurationMs(const String &rawValue, bool setAsPreference)
+void parTransitionDurationMs(const ParamString &rawValue, bool setAsPreference)
 {
   bound16_t bv;
   boundValue16_t(rawValue, bv);
   if (bv.isNumber)
-    (setAsPreference ? setTransitionDurationMs : modifyTransitionDurationMs)(bv.value);
+    postParameter(PARAM_TRANSITION_DURATION, bv.value, setAsPreference);
 }
 
-void parWebAuthPassword(const String &rawValue)
+void parOnEasingCurve(const ParamString &rawValue, bool setAsPreference)
 {
-  if (!withinLength(rawValue, 8, MAX_PASSPHRASE_LEN))
-    return;
-  _http_password = rawValue;
-  setWebAuthPassword(rawValue); // also save as preference
+  bound8_t bv;
+  boundValue8_t(rawValue, 0, EASING_CURVE_COUNT - 1, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_ON_EASING_CURVE, bv.value, setAsPreference);
+}
+
+void parNightLightEasingCurve(const ParamString &rawValue, bool setAsPreference)
+{
+  bound8_t bv;
+  boundValue8_t(rawValue, 0, EASING_CURVE_COUNT - 1, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_NIGHT_LIGHT_EASING_CURVE, bv.value, setAsPreference);
+}
+
+void parStripPower(const ParamString &rawValue)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_STRIP_POWER, bv.value, true); // only used for reporting, always saved as preference
+}
+
+void parRuleConditions(const ParamString &rawValue, bool setAsPreference)
+{
+  bound8_t bv;
+  boundValue8_t(rawValue, 0, (1 << RULE_CONDITION_COUNT) - 1, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_CONDITIONS, bv.value, setAsPreference);
+}
+
+void parRuleLdrMin(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, MAX_BRIGHTNESS, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_LDR_MIN, bv.value, setAsPreference);
+}
+
+void parRuleWindowStart(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, MINUTES_PER_DAY - 1, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_WINDOW_START, bv.value, setAsPreference);
+}
+
+void parRuleWindowEnd(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, MINUTES_PER_DAY, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_WINDOW_END, bv.value, setAsPreference);
+}
+
+void parRuleLdrHysteresis(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, MAX_BRIGHTNESS, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_LDR_HYSTERESIS, bv.value, setAsPreference);
+}
+
+void parRuleDarkDwell(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, 60000, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_DARK_DWELL, bv.value, setAsPreference);
+}
+
+void parRulePresenceDebounce(const ParamString &rawValue, bool setAsPreference)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, 60000, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_RULE_PRESENCE_DEBOUNCE, bv.value, setAsPreference);
+}
+
+// "none", "on" or "off"
+void parRuleOverride(const ParamString &rawValue)
+{
+  for (uint8_t value = 0; value < RULE_OVERRIDE_COUNT; value++)
+  {
+    if (rawValue.equalsIgnoreCase(ruleOverrideName((RuleOverride)value)))
+      postParameter(PARAM_RULE_OVERRIDE, value, false);
+  }
+}
+
+// Minutes after midnight, e.g. sent along by the web interface from the time of the browser
+void parTimeOfDay(const ParamString &rawValue)
+{
+  bound16_t bv;
+  boundValue16_t(rawValue, 0, MINUTES_PER_DAY - 1, bv);
+  if (bv.isNumber)
+    postParameter(PARAM_TIME_OF_DAY, bv.value, false);
+}
+
+// Leave a setting for the network task and wake it up, a value not yet applied gets replaced
+void postNetworkSetting(NetworkSetting setting, const ParamString &rawValue)
+{
+  lockDeviceState();
+  _pendingNetworkSettings[setting].value.assign(rawValue.c_str());
+  _pendingNetworkSettings[setting].pending = true;
+  _networkSettingsPosted = true;
+  unlockDeviceState();
+  wakeNetworkTask();
 }
 
-void parWebAuthUsername(const String &rawValue)
+// Apply the settings the web handlers have left, call from the network task
+void applyNetworkSettings()
 {
-  if (!withinLength(rawValue, 4, MAX_USERNAME_LENGTH))
+  if (!_networkSettingsPosted)
     return;
-  _http_username = rawValue;
-  setWebAuthUsername(rawValue); // also save as preference
+  for (uint8_t setting = 0; setting < NETWORK_SETTING_COUNT; setting++)
+  {
+    ParamString value;
+    lockDeviceState();
+    _networkSettingsPosted = false;
+    bool pending = _pendingNetworkSettings[setting].pending;
+    value = _pendingNetworkSettings[setting].value;
+    _pendingNetworkSettings[setting].pending = false;
+    unlockDeviceState();
+    if (pending)
+      NETWORK_SETTING_APPLY[setting](value.c_str());
+  }
 }
 
-void parWifiApPassphrase(const String &rawValue)
+void parWebAuthPassword(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 8, MAX_PASSPHRASE_LEN))
-    modifyApPassphrase(rawValue); // gets saved as preference when it has proved to work
+    postNetworkSetting(NETWORK_WEB_AUTH_PASSWORD, rawValue); // also saved as preference
+}
+
+void parWebAuthUsername(const ParamString &rawValue)
+{
+  if (withinLength(rawValue, 4, MAX_USERNAME_LENGTH))
+    postNetworkSetting(NETWORK_WEB_AUTH_USERNAME, rawValue); // also saved as preference
 }
 
-void parWifiApIpAddress(const String &rawValue)
+void parWifiApPassphrase(const ParamString &rawValue)
+{
+  if (withinLength(rawValue, 8, MAX_PASSPHRASE_LEN))
+    postNetworkSetting(NETWORK_AP_PASSPHRASE, rawValue); // gets saved as preference when it has proved to work
+}
+
+void parWifiApIpAddress(const ParamString &rawValue)
 {
   if (withinLength(rawValue, IP_LENGTH_MIN, IP_LENGTH_MAX))
-    modifyApIpAddress(rawValue); // gets saved as preference when it has proved to work
+    postNetworkSetting(NETWORK_AP_IP_ADDRESS, rawValue); // gets saved as preference when it has proved to work
 }
 
-void parWifiApNetmask(const String &rawValue)
+void parWifiApNetmask(const ParamString &rawValue)
 {
   if (withinLength(rawValue, IP_LENGTH_MIN, IP_LENGTH_MAX))
-    modifyApIpNetmask(rawValue); // gets saved as preference when it has proved to work
+    postNetworkSetting(NETWORK_AP_NETMASK, rawValue); // gets saved as preference when it has proved to work
 }
 
-void parWifiApSsid(const String &rawValue)
+void parWifiApSsid(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 4, MAX_SSID_LEN))
-    modifyApSsid(rawValue); // gets saved as preference when it has proved to work
+    postNetworkSetting(NETWORK_AP_SSID, rawValue); // gets saved as preference when it has proved to work
 }
 
-void parWifiHostname(const String &rawValue)
+void parWifiHostname(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 2, MAX_HOSTNAME_LEN))
-    modifyHostname(rawValue); // gets saved as preference when it has proved to work
+    postNetworkSetting(NETWORK_HOSTNAME, rawValue); // gets saved as preference when it has proved to work
 }
 
-void parWifiStaPassphrase(const String &rawValue)
+void parWifiStaPassphrase(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 8, MAX_PASSPHRASE_LEN))
-  {
-    modifyStaPassphrase(rawValue);
-    if (rawValue != getWifiStaPassphrase())
-      setWifiStaPassphrase(rawValue);
-  }
+    postNetworkSetting(NETWORK_STA_PASSPHRASE, rawValue); // only gets written when it differs from the saved one
 }
 
-void parWifiStaSsid(const String &rawValue)
+void parWifiStaSsid(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 4, MAX_SSID_LEN))
-  {
-    modifyStaSsid(rawValue);
-    if (rawValue != getWifiStaSsid())
-      setWifiStaSsid(rawValue);
-  }
+    postNetworkSetting(NETWORK_STA_SSID, rawValue); // only gets written when it differs from the saved one
 }
 
-void parMqttServer(const String &rawValue)
+void parMqttServer(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 4, MAX_MQTT_SERVER_LENGTH))
-  {
-    modifyMqttServer(rawValue);
-    if (rawValue != getMqttServer())
-      setMqttServer(rawValue);
-  }
+    postNetworkSetting(NETWORK_MQTT_SERVER, rawValue); // only gets written when it differs from the saved one
 }
 
-void parMqttUser(const String &rawValue)
+void parMqttUser(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 0, MAX_MQTT_USERNAME_LENGTH))
-  {
-    modifyMqttUsername(rawValue);
-    if (rawValue != getMqttUsername())
-      setMqttUsername(rawValue);
-  }
+    postNetworkSetting(NETWORK_MQTT_USER, rawValue); // only gets written when it differs from the saved one
 }
 
-void parMqttPassword(const String &rawValue)
+void parMqttPassword(const ParamString &rawValue)
 {
   if (withinLength(rawValue, 0, MAX_MQTT_PASSWORD_LENGTH))
-    modifyMqttPassword(rawValue);
+    postNetworkSetting(NETWORK_MQTT_PASSWORD, rawValue);
+}
+
+void parSetLampState(const ParamString &rawValue)
+{
+  convertedBool cb;
+  toBool(rawValue, cb);
+  if (cb.isBool)
+    postLightState(cb.value);
 }
 
-void parSetLampState(const String &rawValue)
+// Start (true) or cancel learning the LDR compensation table
+void parLdrCalibration(const ParamString &rawValue)
 {
   convertedBool cb;
   toBool(rawValue, cb);
   if (cb.isBool)
-    modifyLightState(cb.value);
+    postParameter(PARAM_LDR_CALIBRATION, cb.value, false);
 }
 
-void toApiV1(AsyncWebServerRequest *request, bool isPost)
+// Hand the parameters of a request over. Returns false when the command queue was full and some of them got dropped.
+bool toApiV1(AsyncWebServerRequest *request, bool isPost)
 {
+  // the web handlers are the only ones posting commands, and they all run in the AsyncTCP task
+  uint32_t droppedBefore = droppedCommands();
   Serial.println(isPost ? F("POST") : F("GET"));
   int params = request->params();
   for (int i = 0; i < params; i++)
@@ -400,7 +592,7 @@ void toApiV1(AsyncWebServerRequest *request, bool isPost)
   if(!request->authenticate(_http_username.c_str(), _http_password.c_str()))
       return request->requestAuthentication();
   */
-  String rawValue;
+  ParamString rawValue;
   bool saveAsPreference = tryGetParam(request, PrefSaveAsPreference, isPost, rawValue) && rawValue.equals("true");
 
   /*
@@ -424,6 +616,22 @@ void toApiV1(AsyncWebServerRequest *request, bool isPost)
     parNightLightOnDuration(rawValue, saveAsPreference);
   if (tryGetParam(request, PrefNightLightLdrThreshold, isPost, rawValue))
     parNightLightLdrThreshold(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleConditions, isPost, rawValue))
+    parRuleConditions(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleLdrMin, isPost, rawValue))
+    parRuleLdrMin(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleWindowStart, isPost, rawValue))
+    parRuleWindowStart(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleWindowEnd, isPost, rawValue))
+    parRuleWindowEnd(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleLdrHysteresis, isPost, rawValue))
+    parRuleLdrHysteresis(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleDarkDwell, isPost, rawValue))
+    parRuleDarkDwell(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRulePresenceDebounce, isPost, rawValue))
+    parRulePresenceDebounce(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefRuleOverride, isPost, rawValue))
+    parRuleOverride(rawValue);
 
   /*
   Presence
@@ -488,25 +696,241 @@ void toApiV1(AsyncWebServerRequest *request, bool isPost)
     parTransitionDurationMs(rawValue, saveAsPreference);
   if (tryGetParam(request, PrefBrightnessStep, isPost, rawValue))
     parBrightnessStep(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefOnEasingCurve, isPost, rawValue))
+    parOnEasingCurve(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefNightLightEasingCurve, isPost, rawValue))
+    parNightLightEasingCurve(rawValue, saveAsPreference);
+  if (tryGetParam(request, PrefStripPower, isPost, rawValue))
+    parStripPower(rawValue);
+  if (tryGetParam(request, PrefTimeOfDay, isPost, rawValue))
+    parTimeOfDay(rawValue);
 
   /*
   Actions
   */
   if (tryGetParam(request, PrefSetLampState, isPost, rawValue))
     parSetLampState(rawValue);
+  if (tryGetParam(request, PrefLdrCalibration, isPost, rawValue))
+    parLdrCalibration(rawValue);
   // PrefSaveAsPreference
+  return droppedCommands() == droppedBefore;
 }
 
 void toApiV1Post(AsyncWebServerRequest *request)
 {
-  toApiV1(request, true);
-  request->send(200, "text/plain", "Hello, POST: ");
+  if (!toApiV1(request, true))
+    request->send(503, "text/plain", "Busy, not all settings were taken: try again");
+  else
+    request->send(200, "text/plain", "Hello, POST: ");
 }
 
 void toApiV1Get(AsyncWebServerRequest *request)
 {
-  toApiV1(request, false);
-  request->send(200, "text/plain", "Hello, GET: ");
+  if (!toApiV1(request, false))
+    request->send(503, "text/plain", "Busy, not all settings were taken: try again");
+  else
+    request->send(200, "text/plain", "Hello, GET: ");
+}
+
+// Report what the LED strip has delivered so far (as JSON)
+void toApiV1Energy(AsyncWebServerRequest *request)
+{
+  lockDeviceState(); // the control task updates the counters
+  LedStripEnergy energy = ledStripEnergy();
+  unlockDeviceState();
+  double fullOnHours = ledStripFullOnHours(energy);
+  double stripWatts = stripPowerDeciWatts() / 10.0;
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"stripPowerW\":%.1f,\"fullOnHours\":%.3f,\"energyWh\":%.1f,\"transitions\":%lu,\"bands\":[",
+                   stripWatts, fullOnHours, fullOnHours * stripWatts, (unsigned long)energy.transitions);
+  for (uint8_t band = 0; band < LED_ENERGY_BAND_COUNT; band++)
+  {
+    response->printf("%s{\"minBrightness\":%u,\"onHours\":%.3f}", band == 0 ? "" : ",",
+                     LED_ENERGY_BAND_START[band], energy.bandMs[band] / 3600000.0);
+  }
+  response->print("]}");
+  request->send(response);
+}
+
+void toApiV1Ldr(AsyncWebServerRequest *request)
+{
+  DeviceStateInfo info = getDeviceState();
+  lockDeviceState();
+  LdrCalibrationState calibration = ldrCalibrationState();
+  bool compensated = ldrCompensated();
+  LdrCompensation compensation = ldrCompensation();
+  uint32_t compensatedCount = ldrCompensatedCount();
+  unlockDeviceState();
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"source\":\"%s\",\"brightness\":%u,\"noise\":%u,\"lastBrightness\":%u,\"lastMillivolts\":%u,\"periodMs\":%lu,\"blanked\":%lu,\"blankedBrightness\":%u,\"skipped\":%lu,\"compensated\":%lu,\"%s\":\"%s\",\"compensation\":",
+                   ldrSourceName(ldrSource()), info.ldrValue, info.ldrNoise, measuredBrightness(), ldrMillivolts(),
+                   (unsigned long)measurementDelayMs(), (unsigned long)ldrBlankCount(), ldrBlankedBrightness(),
+                   (unsigned long)ldrSkippedCount(),
+                   (unsigned long)compensatedCount, PrefLdrCalibration, ldrCalibrationStateName(calibration));
+  if (!compensated)
+    response->print("null}");
+  else
+  {
+    // offset by brightness of the strip, at the points of the table
+    response->printf("{\"step\":%u,\"offsets\":[", LDR_COMPENSATION_STEP);
+    for (uint8_t point = 0; point < LDR_COMPENSATION_POINTS; point++)
+      response->printf("%s%u", point == 0 ? "" : ",", compensation.offset[point]);
+    response->print("]}}");
+  }
+  request->send(response);
+}
+
+// Report the aggregates of the history and how much of it is kept (as JSON)
+void toApiV1History(AsyncWebServerRequest *request)
+{
+  lockDeviceState();
+  HistoryStats stats[HISTORY_WINDOW_COUNT];
+  for (uint8_t window = 0; window < HISTORY_WINDOW_COUNT; window++)
+    stats[window] = historyStats((HistoryWindow)window);
+  uint32_t bytesUsed = historyBytesUsed();
+  uint32_t records = historyRecords();
+  uint32_t seconds = historySeconds();
+  unlockDeviceState();
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"retentionSeconds\":%lu,\"records\":%lu,\"bytesUsed\":%lu,\"bytesTotal\":%lu",
+                   (unsigned long)seconds, (unsigned long)records, (unsigned long)bytesUsed,
+                   (unsigned long)HISTORY_BLOCKS * HISTORY_BLOCK_BYTES);
+  for (uint8_t window = 0; window < HISTORY_WINDOW_COUNT; window++)
+  {
+    const HistoryStats &s = stats[window];
+    response->printf(",\"%s\":{\"seconds\":%lu,\"ldr\":{\"min\":%u,\"max\":%u,\"avg\":%u},\"presenceSeconds\":%lu,"
+                     "\"targetSeconds\":%lu,\"distance\":{\"min\":%u,\"max\":%u,\"avg\":%u},\"lampOnSeconds\":%lu}",
+                     historyWindowName((HistoryWindow)window), (unsigned long)s.seconds, s.ldrMin, s.ldrMax, s.ldrAvg,
+                     (unsigned long)s.presenceSeconds, (unsigned long)s.targetSeconds, s.distanceMin, s.distanceMax,
+                     s.distanceAvg, (unsigned long)s.lampOnSeconds);
+  }
+  response->print("}");
+  request->send(response);
+}
+
+// Stream the history as CSV, a chunk at a time: the records are decoded straight into the buffer of the response
+void toApiV1HistoryCsv(AsyncWebServerRequest *request)
+{
+  std::shared_ptr<HistoryCursor> cursor = std::make_shared<HistoryCursor>();
+  lockDeviceState();
+  historyStartExport(*cursor);
+  unlockDeviceState();
+  request->send(request->beginChunkedResponse("text/csv", [cursor](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    if (maxLen < HISTORY_MAX_LINE)
+      return RESPONSE_TRY_AGAIN;
+    lockDeviceState();
+    size_t written = historyExport(*cursor, (char *)buffer, maxLen);
+    unlockDeviceState();
+    return written;
+  }));
+}
+
+// Report the night light rule and the state of its conditions (as JSON)
+void toApiV1Rules(AsyncWebServerRequest *request)
+{
+  lockDeviceState();
+  NightLightRule rule = rulesConfig();
+  NightLightGating gating = rulesGating();
+  RuleSuppressed suppressed = rulesSuppressed();
+  RuleOverride ruleOverride = rulesOverride();
+  int16_t timeOfDay = rulesTimeOfDay();
+  uint32_t evaluations = rulesEvaluations();
+  bool conditions[RULE_CONDITION_COUNT];
+  for (uint8_t condition = 0; condition < RULE_CONDITION_COUNT; condition++)
+    conditions[condition] = rulesCondition((RuleCondition)condition);
+  unlockDeviceState();
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"%s\":%u,\"%s\":%u,\"%s\":%u,\"%s\":%u,\"%s\":\"%s\",\"%s\":%d,\"evaluations\":%lu,",
+                   PrefRuleConditions, rule.conditions, PrefRuleLdrMin, rule.ldrMin, PrefRuleWindowStart,
+                   rule.windowStartMin, PrefRuleWindowEnd, rule.windowEndMin, PrefRuleOverride,
+                   ruleOverrideName(ruleOverride), PrefTimeOfDay, timeOfDay, (unsigned long)evaluations);
+  response->printf("\"%s\":%u,\"%s\":%u,\"%s\":%u,\"suppressed\":{\"hysteresis\":%lu,\"darkDwell\":%lu,\"presenceDebounce\":%lu},",
+                   PrefRuleLdrHysteresis, gating.ldrHysteresis, PrefRuleDarkDwell, gating.darkDwellMs,
+                   PrefRulePresenceDebounce, gating.presenceDebounceMs, (unsigned long)suppressed.hysteresis,
+                   (unsigned long)suppressed.darkDwell, (unsigned long)suppressed.presenceDebounce);
+  response->print("\"conditions\":{");
+  for (uint8_t condition = 0; condition < RULE_CONDITION_COUNT; condition++)
+  {
+    response->printf("%s\"%s\":{\"bit\":%u,\"required\":%s,\"holds\":%s}", condition == 0 ? "" : ",",
+                     ruleConditionName((RuleCondition)condition), ruleBit((RuleCondition)condition),
+                     (rule.conditions & ruleBit((RuleCondition)condition)) ? "true" : "false",
+                     conditions[condition] ? "true" : "false");
+  }
+  response->print("}}");
+  request->send(response);
+}
+
+void toApiV1Boot(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"complete\":%s,\"completeUs\":%lu,\"jobs\":[", bootComplete() ? "true" : "false",
+                   (unsigned long)bootCompleteUs());
+  for (uint8_t job = 0; job < bootJobCount(); job++)
+  {
+    const BootJob &bootJobInfo = bootJob(job);
+    BootTiming timing = bootTiming(job);
+    response->printf("%s{\"name\":\"%s\",\"runner\":\"%s\",\"dependsOn\":%u,\"done\":%s,\"startUs\":%lu,\"waitedUs\":%lu,\"durationUs\":%lu}",
+                     job == 0 ? "" : ",", bootJobInfo.name, bootRunnerName(bootJobInfo.runner), bootJobInfo.dependsOn,
+                     timing.done ? "true" : "false", (unsigned long)timing.startUs,
+                     (unsigned long)(timing.done ? timing.startUs - timing.reachedUs : 0), (unsigned long)timing.durationUs);
+  }
+  response->print("]}");
+  request->send(response);
+}
+
+void toApiV1Metrics(AsyncWebServerRequest *request)
+{
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->printf("{\"enabled\":%s,\"loopRateHz\":%.1f,\"load\":%.4f,\"droppedCommands\":%lu,\"histogramUnit\":\"log2 us\",\"sections\":{",
+                   DEVICE_PROFILER ? "true" : "false", profilerLoopRateHz(), profilerLoad(), (unsigned long)droppedCommands());
+  for (uint8_t section = 0; section < PROFILE_SECTION_COUNT; section++)
+  {
+    ProfileStats stats = profilerStats((ProfiledSection)section);
+    response->printf("%s\"%s\":{\"count\":%lu,\"avgUs\":%lu,\"maxUs\":%lu,\"histogram\":[", section == 0 ? "" : ",",
+                     profiledSectionName((ProfiledSection)section), (unsigned long)stats.count,
+                     (unsigned long)(stats.count == 0 ? 0 : stats.totalUs / stats.count),
+                     (unsigned long)stats.maxUs);
+    for (uint8_t bucket = 0; bucket < PROFILE_HISTOGRAM_BUCKETS; bucket++)
+    {
+      response->printf("%s%lu", bucket == 0 ? "" : ",", (unsigned long)stats.histogram[bucket]);
+    }
+    response->print("]}");
+  }
+  response->printf("},\"power\":{\"state\":\"%s\",\"scaling\":%s,\"lightSleep\":%s", powerStateName(powerState()),
+                   powerScalingEnabled() ? "true" : "false", powerLightSleepEnabled() ? "true" : "false");
+  for (uint8_t state = 0; state < POWER_STATE_COUNT; state++)
+  {
+    response->printf(",\"%sAllowedMs\":%llu", powerStateName((PowerState)state), powerAllowedMs((PowerState)state));
+  }
+  response->print("},\"jobs\":[");
+  bool first = true;
+  for (Scheduler *scheduler : {&controlJobs, &networkJobs})
+  {
+    for (JobId job = 0; job < MAX_JOBS; job++)
+    {
+      JobStats stats = scheduler->stats(job);
+      if (!stats.active)
+        continue;
+      response->printf("%s{\"task\":\"%s\",\"name\":\"%s\",\"periodMs\":%lu,\"runs\":%lu,\"avgLateMs\":%lu,"
+                       "\"maxLateMs\":%lu,\"overruns\":%lu,\"maxRunUs\":%lu}",
+                       first ? "" : ",", scheduler->name(), stats.name, (unsigned long)stats.periodMs,
+                       (unsigned long)stats.runs, (unsigned long)(stats.runs == 0 ? 0 : stats.totalLateMs / stats.runs),
+                       (unsigned long)stats.maxLateMs, (unsigned long)stats.overruns, (unsigned long)stats.maxRunUs);
+      first = false;
+    }
+  }
+  response->print("]}");
+  request->send(response);
+}
+
+void toApiV1MetricsReset(AsyncWebServerRequest *request)
+{
+  profilerReset();
+  request->send(200);
 }
 
 void handleUpdate(AsyncWebServerRequest *request)
@@ -564,6 +988,20 @@ void addWebApiHandlers(AsyncWebServer &server)
   server.on("/v1/get", HTTP_GET, toApiV1Get);
   // Send a POST request to <IP>/post with a form field message set to <message>
   server.on("/v1/post", HTTP_POST, toApiV1Post);
+  // Energy and on time statistics of the LED strip
+  server.on("/v1/energy", HTTP_GET, toApiV1Energy);
+  // The filtered LDR brightness and its noise
+  server.on("/v1/ldr", HTTP_GET, toApiV1Ldr);
+  // The night light rule, changed via /v1/get or /v1/post
+  server.on("/v1/rules", HTTP_GET, toApiV1Rules);
+  // Aggregates of the sensor and lamp history, and the history itself as CSV
+  server.on("/v1/history", HTTP_GET, toApiV1History);
+  server.on("/v1/history.csv", HTTP_GET, toApiV1HistoryCsv);
+  // Timeline of the startup: when each boot job ran and how long it took
+  server.on("/v1/boot", HTTP_GET, toApiV1Boot);
+  // Run time statistics of the main loop, DELETE starts them over (at the end of the current minute)
+  server.on("/v1/metrics", HTTP_GET, toApiV1Metrics);
+  server.on("/v1/metrics", HTTP_DELETE, toApiV1MetricsReset);
 
   // OTA
   server.on("/update", HTTP_GET, handleUpdate);
@@ -572,16 +1010,48 @@ void addWebApiHandlers(AsyncWebServer &server)
   Update.onProgress(printProgress);
 }
 
+// Job: report why the web server has not been started yet
+void reportServerState()
+{
+  if (_serverStarted)
+  {
+    networkJobs.cancel(_reportJob);
+    return;
+  }
+  WifiStateInfo wifiInfo = wifiCurrentState();
+  if (debug_uart_web_interface != nullptr)
+  {
+    debug_uart_web_interface->println(F("[API] AsyncWebServer not started yet"));
+    debug_uart_web_interface->println(F("WifiStateInfo:"));
+    debug_uart_web_interface->print(F(" WifiMode: "));
+    debugPrintWifiMode(debug_uart_web_interface, wifiInfo.mode, true);
+    debug_uart_web_interface->print(F(" AP ModeResult: "));
+    debugPrintModeResult(debug_uart_web_interface, wifiInfo.apModeResult, true);
+    debug_uart_web_interface->print(F(" STA ModeResult: "));
+    debugPrintModeResult(debug_uart_web_interface, wifiInfo.staModeResult, true);
+    debug_uart_web_interface->print(F(" WifiState: "));
+    debugPrintWifiState(debug_uart_web_interface, wifiInfo.currentState, true);
+  }
+}
+
 void webApiSetup()
 {
+  // handle every request at full clock
+  _server.addMiddleware([](AsyncWebServerRequest *request, ArMiddlewareNext next)
+                        {
+                          powerBoost();
+                          next();
+                        });
   addWebApiHandlers(_server);
   addWebInterfaceHandlers(_server);
-  _http_password = getWebAuthPassword();
-  _http_username = getWebAuthUsername();
+  getWebAuthPassword(_http_password);
+  getWebAuthUsername(_http_username);
+  _reportJob = networkJobs.every("apiReport", REPORT_DELAY_MS, reportServerState, REPORT_DELAY_MS);
 }
 
 void webApiLoop()
 {
+  applyNetworkSettings();
   WifiStateInfo wifiInfo = wifiCurrentState();
   if (!_serverStarted && wifiInfo.mode == WifiMode::WifiMode_AP && wifiInfo.currentState == WifiState::AP_OK)
   {
@@ -596,18 +1066,4 @@ void webApiLoop()
     }
     _serverStarted = true;
   }
-  if (!_serverStarted && millis() - _lastReport >= REPORT_DELAY_MS)
-  {
-    debug_uart_web_interface->println(F("[API] AsyncWebServer not started yet"));
-    debug_uart_web_interface->println(F("WifiStateInfo:"));
-    debug_uart_web_interface->print(F(" WifiMode: "));
-    debugPrintWifiMode(debug_uart_web_interface, wifiInfo.mode, true);
-    debug_uart_web_interface->print(F(" AP ModeResult: "));
-    debugPrintModeResult(debug_uart_web_interface, wifiInfo.apModeResult, true);
-    debug_uart_web_interface->print(F(" STA ModeResult: "));
-    debugPrintModeResult(debug_uart_web_interface, wifiInfo.staModeResult, true);
-    debug_uart_web_interface->print(F(" WifiState: "));
-    debugPrintWifiState(debug_uart_web_interface, wifiInfo.currentState, true);
-    _lastReport = millis();
-  }
 }
@@ -34,10 +34,9 @@ String processorConfig(const String &var)
   return String();
 }
 
-// replaces placeholders in index_html
-String processorIndex(const String &var)
+// replaces placeholders in index_html with the device state info taken for the page being served
+String processorIndex(const DeviceStateInfo &info, const String &var)
 {
-  DeviceStateInfo info = getDeviceState();
   bool isOn = info.state == State::START_TRANSIT_TO_ON || info.state == State::TRANSIT_TO_ON || info.state == State::ON;
   bool isNightLightOn = !isOn && (info.state == State::START_TRANSIT_TO_NIGHT_LIGHT || info.state == State::TRANSIT_TO_NIGHT_LIGHT || info.state == State::NIGHT_LIGHT_ON);
 
@@ -174,7 +173,10 @@ void toPortal(AsyncWebServerRequest *request)
 void toMainPage(AsyncWebServerRequest *request)
 {
   Serial.println(F("Serve Basic HTML Page: start"));
-  AsyncWebServerResponse *response = request->beginResponse(200, "text/html", index_html, processorIndex);
+  // the response owns its copy of the state, so requests served at the same time do not share one
+  DeviceStateInfo info = getDeviceState();
+  AsyncWebServerResponse *response = request->beginResponse(200, "text/html", index_html,
+                                                            [info](const String &var) { return processorIndex(info, var); });
   response->addHeader("Cache-Control", "public,max-age=2000"); // cache the site this duration (refreshing overrides this, 1 year = 31536000)
   request->send(response);
   Serial.println(F("Serve Basic HTML Page: done"));
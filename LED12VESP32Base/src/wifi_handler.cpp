@@ -9,32 +9,25 @@ Learned lots from https://randomnerdtutorials.com/esp32-useful-wi-fi-functions-a
 #include "wifi_handler.h"
 #include "config.h"
 #include <DNSServer.h>
+#include <events.h>
 
 WifiState _wifiState = NO_WIFI_YET; // The state the wifi finite state machine is currently in.
 unsigned long _wifiStateTs = 0;     // The moment in time when the finite state machine entered the current _state.
 WifiMode _wifiMode = WifiMode::WifiMode_OFF;
 
-// char _hostname[MAX_HOSTNAME_LEN] = {0};
-// char _ap_ssid[MAX_SSID_LEN] = {0}; // The currently used SSID of the AP
-// char _ap_ssid_working[MAX_SSID_LEN] = {0}; // For reverting bad changes to the AP configuration
-// char _ap_passphrase[MAX_PASSPHRASE_LEN] = {0};
-// char _ap_passphrase_working[MAX_PASSPHRASE_LEN] = {0}; // For reverting bad changes to the AP configuration
-// char _sta_ssid[MAX_SSID_LEN] = {0};             // STA will try to connect to the WiFi with this ssid
-// char _sta_passphrase[MAX_PASSPHRASE_LEN] = {0}; // STA will try to connect to the WiFi with this passphrase
-
-String _hostname;
-String _ap_ssid;                     // The currently used SSID of the AP
-String _ap_ssid_working;             // For reverting bad changes to the AP configuration
-String _ap_passphrase;               // The currently used passphrase for connecting to the AP
-String _ap_passphrase_working;       // For reverting bad changes to the AP configuration
+WifiHostname _hostname;
+WifiSsid _ap_ssid;                     // The currently used SSID of the AP
+WifiSsid _ap_ssid_working;             // For reverting bad changes to the AP configuration
+WifiPassphrase _ap_passphrase;         // The currently used passphrase for connecting to the AP
+WifiPassphrase _ap_passphrase_working; // For reverting bad changes to the AP configuration
 uint32_t _ap_ip = 0;                 // The currently used IP address of the AP
 uint32_t _ap_netmask = 0;            // The currently used netmask of the AP
 uint32_t _ap_ip_working = 0;         // For reverting bad changes to the AP configuration
 uint32_t _ap_netmask_working = 0;    // For reverting bad changes to the AP configuration
 bool _apTestChangedSettings = false; // Whether we have a changed AP configuration that is not tested yet. Set to true, when ssid, ip or netmask change!
 
-String _sta_ssid;       // STA will try to connect to the WiFi with this ssid
-String _sta_passphrase; // STA will try to connect to the WiFi with this passphrase
+WifiSsid _sta_ssid;             // STA will try to connect to the WiFi with this ssid
+WifiPassphrase _sta_passphrase; // STA will try to connect to the WiFi with this passphrase
 IPAddress _sta_ipAddress = IPAddress((uint32_t)0);
 
 Stream *debug_uart_wifi = nullptr;
@@ -59,6 +52,7 @@ ModeResult _staModeResult = ModeResult::MODE_NOT_ATTEMPTED_YET; // Result of sta
 
 // info about AP
 bool _forceAPMode = false; // Requested by user: start in AP mode although there is a configuration for STA that worked at least once.
+volatile bool _apModeRequested = false; // Set by requestAPMode() from another task, handled by wifiLoop()
 
 DNSServer dnsServer; // for providing a captive portal in AP mode
 
@@ -247,6 +241,13 @@ void setState(WifiState newState)
 }
 
 void requestAPMode()
+{
+  _apModeRequested = true;
+  wakeNetworkTask();
+}
+
+// switch to AP mode as requested by requestAPMode(), if this makes sense in the current state
+void handleAPModeRequest()
 {
   switch (_wifiState)
   {
@@ -278,13 +279,13 @@ void requestAPMode()
   }
 }
 
-void modifyApPassphrase(const String &value) { _ap_passphrase = value; }
-void modifyApSsid(const String &value) { _ap_ssid = value; }
-void modifyHostname(const String &value) { _hostname = value; }
-void modifyStaPassphrase(const String &value) { _sta_passphrase = value; }
-void modifyStaSsid(const String &value) { _sta_ssid = value; }
+void modifyApPassphrase(const char *value) { _ap_passphrase.assign(value); }
+void modifyApSsid(const char *value) { _ap_ssid.assign(value); }
+void modifyHostname(const char *value) { _hostname.assign(value); }
+void modifyStaPassphrase(const char *value) { _sta_passphrase.assign(value); }
+void modifyStaSsid(const char *value) { _sta_ssid.assign(value); }
 
-void modifyApIpAddress(const String &value) {
+void modifyApIpAddress(const char *value) {
   IPAddress new_ip;
   if (new_ip.fromString(value))
   {
@@ -292,7 +293,7 @@ void modifyApIpAddress(const String &value) {
   }
 }
 
-void modifyApIpNetmask(const String &value) {
+void modifyApIpNetmask(const char *value) {
   IPAddress new_mask;
   if (new_mask.fromString(value))
   {
@@ -432,6 +433,12 @@ void wifiEventApStaIpAssigned(const WiFiEvent_t &event, const WiFiEventInfo_t &i
   debugPrintln(IPAddress(info.wifi_ap_staipassigned.ip.addr));
 }
 
+// any event: let the network task run wifiLoop() right away
+void wifiEventAny(const WiFiEvent_t &event, const WiFiEventInfo_t &info)
+{
+  wakeNetworkTask();
+}
+
 // ARDUINO_EVENT_WIFI_AP_PROBEREQRECVED
 void wifiEventApProbeReqRecved(const WiFiEvent_t &event, const WiFiEventInfo_t &info)
 {
@@ -528,7 +535,7 @@ WifiState handleStaStart()
 {
   printWifi();
   Serial.print(F("Started connecting to WiFi "));
-  Serial.print(_sta_ssid);
+  Serial.print(_sta_ssid.c_str());
   Serial.print(F(" and "));
   if (_sta_passphrase.isEmpty())
     Serial.print(F("no "));
@@ -541,7 +548,7 @@ WifiState handleStaStart()
     Serial.println(F("Connecting to WiFi failed: could not start WIFI_STA mode."));
     return STA_FAIL;
   }
-  if (!WiFi.begin(_sta_ssid, _sta_passphrase))
+  if (!WiFi.begin(_sta_ssid.c_str(), _sta_passphrase.c_str()))
   {
     printWifi();
     Serial.println(F("Connecting to WiFi failed: WiFi.begin failed"));
@@ -672,9 +679,9 @@ WifiState handleApStart()
 {
   printWifi();
   Serial.print(F("Starting the AP, ssid: '"));
-  Serial.print(_ap_ssid);
+  Serial.print(_ap_ssid.c_str());
   Serial.print(F("', passphrase: '"));
-  Serial.print(_ap_passphrase);
+  Serial.print(_ap_passphrase.c_str());
   Serial.println(F("'"));
 
   _wifiMode = WifiMode::WifiMode_AP;
@@ -683,13 +690,13 @@ WifiState handleApStart()
   if (modeResult)
   {
     bool startResult;
-    if (_ap_passphrase.length() == 0)
+    if (_ap_passphrase.isEmpty())
     {
-      startResult = WiFi.softAP(_ap_ssid);
+      startResult = WiFi.softAP(_ap_ssid.c_str());
     }
     else
     {
-      startResult = WiFi.softAP(_ap_ssid, _ap_passphrase);
+      startResult = WiFi.softAP(_ap_ssid.c_str(), _ap_passphrase.c_str());
     }
     if (startResult)
     {
@@ -741,10 +748,7 @@ WifiState handleApStartWait()
           setWifiAPpIPv4Netmask(_ap_netmask);
         }
         _ap_ssid_working = _ap_ssid;
-        if (getWifiApSsid() != _ap_ssid)
-        {
-          setWifiApSsid(_ap_ssid);
-        }
+        setWifiApSsid(_ap_ssid.c_str()); // only gets written when it differs from the saved one
         _apTestChangedSettings = false;
       }
       printWifi();
@@ -814,11 +818,11 @@ void wifiSetup()
 {
   _wifiStateTs = millis();
 
-  _ap_ssid = getWifiApSsid();
+  getWifiApSsid(_ap_ssid);
   _ap_ssid_working = _ap_ssid;
-  _hostname = getWifiHostname();
+  getWifiHostname(_hostname);
 
-  _ap_passphrase = getWifiApPassphrase();
+  getWifiApPassphrase(_ap_passphrase);
   _ap_passphrase_working = _ap_passphrase;
 
   _ap_ip = wifiApIPv4Address();
@@ -826,8 +830,8 @@ void wifiSetup()
   _ap_netmask = wifiApIPv4Netmask();
   _ap_netmask_working = _ap_netmask;
 
-  _sta_ssid = getWifiStaSsid();
-  _sta_passphrase = getWifiStaPassphrase();
+  getWifiStaSsid(_sta_ssid);
+  getWifiStaPassphrase(_sta_passphrase);
 
   // register wifi event handlers
 
@@ -847,6 +851,7 @@ void wifiSetup()
   WiFi.onEvent(wifiEventApStaDisconnected, ARDUINO_EVENT_WIFI_AP_STADISCONNECTED);
   WiFi.onEvent(wifiEventApStaIpAssigned, ARDUINO_EVENT_WIFI_AP_STAIPASSIGNED);
   WiFi.onEvent(wifiEventApProbeReqRecved, ARDUINO_EVENT_WIFI_AP_PROBEREQRECVED);
+  WiFi.onEvent(wifiEventAny);
 
   // ignoring all ethernet and WPS events on purpose
 
@@ -857,6 +862,11 @@ void wifiSetup()
 
 void wifiLoop()
 {
+  if (_apModeRequested)
+  {
+    _apModeRequested = false;
+    handleAPModeRequest();
+  }
 
   WifiState nextState = _wifiState;
 
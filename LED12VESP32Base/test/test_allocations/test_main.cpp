@@ -0,0 +1,268 @@
+#include <config.h>
+#include <dither.h>
+#include <easing.h>
+#include <fixed_string.h>
+#include <history.h>
+#include <ldr_filter.h>
+#include <led_output.h>
+#include <native_hal.h>
+#include <new>
+#include <rules.h>
+#include <scheduler.h>
+#include <stdlib.h>
+#include <unity.h>
+
+// Once set up, the lamp logic must not touch the heap: months of uptime would fragment it. Every allocation is
+// counted while a test has the counter armed: operator new everywhere, malloc() and friends where glibc lets them be
+// replaced. The String of lib/native_hal is only there for debug output and allocates like the real one: a counted
+// path using it fails here.
+
+static bool _counting = false;
+static uint32_t _allocations = 0;
+
+static void countAllocation()
+{
+    if (_counting)
+        _allocations++;
+}
+
+#ifdef __GLIBC__
+extern "C"
+{
+    void *__libc_malloc(size_t size);
+    void *__libc_calloc(size_t count, size_t size);
+    void *__libc_realloc(void *memory, size_t size);
+    void __libc_free(void *memory);
+
+    void *malloc(size_t size)
+    {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void *calloc(size_t count, size_t size)
+    {
+        countAllocation();
+        return __libc_calloc(count, size);
+    }
+
+    void *realloc(void *memory, size_t size)
+    {
+        countAllocation();
+        return __libc_realloc(memory, size);
+    }
+}
+
+// operator new counts for itself, past the malloc() above
+static void *allocate(size_t size) { return __libc_malloc(size == 0 ? 1 : size); }
+static void release(void *memory) { __libc_free(memory); }
+#else
+static void *allocate(size_t size) { return malloc(size == 0 ? 1 : size); }
+static void release(void *memory) { free(memory); }
+#endif
+
+void *operator new(size_t size)
+{
+    countAllocation();
+    void *memory = allocate(size);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    countAllocation();
+    return allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+void operator delete(void *memory) noexcept { release(memory); }
+void operator delete[](void *memory) noexcept { release(memory); }
+void operator delete(void *memory, size_t) noexcept { release(memory); }
+void operator delete[](void *memory, size_t) noexcept { release(memory); }
+
+// Allocations made by calls of body
+template <typename Body>
+uint32_t allocationsOf(uint32_t calls, Body body)
+{
+    _allocations = 0;
+    _counting = true;
+    for (uint32_t call = 0; call < calls; call++)
+        body(call);
+    _counting = false;
+    return _allocations;
+}
+
+bool fadeDone() { return false; }
+
+void job() {}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_counter_sees_allocations()
+{
+    uint32_t allocations = allocationsOf(1, [](uint32_t) {
+        int *value = new int(1);
+        delete value;
+    });
+    TEST_ASSERT_GREATER_THAN(0, allocations);
+}
+
+void test_scheduler()
+{
+    Scheduler jobs("test");
+    jobs.every("fast", 1, job);
+    jobs.every("slow", 1000, job);
+    uint32_t allocations = allocationsOf(10000, [&](uint32_t call) {
+        nativeAdvanceMillis(1);
+        jobs.run();
+        if (call % 100 == 0)
+            jobs.cancel(jobs.once("once", 50, job));
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_rules()
+{
+    rulesSetDarkDwellMs(500);
+    rulesSetPresenceDebounceMs(200);
+    uint32_t allocations = allocationsOf(10000, [](uint32_t call) {
+        nativeAdvanceMillis(10);
+        controlJobs.run();
+        rulesSetLdr(call % 200 < 100 ? 500 : 2000, 1000);
+        rulesSetPresence(call % 50 < 25);
+        rulesUpdate();
+        rulesNightLight();
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_history()
+{
+    HistorySample sample = {};
+    char buffer[256];
+    uint32_t allocations = allocationsOf(20000, [&](uint32_t call) {
+        nativeAdvanceMillis(1000);
+        sample.ldr = call % 4096;
+        historyAppend(sample);
+        historyStats(HISTORY_LAST_DAY);
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+    allocations = allocationsOf(1, [&](uint32_t) {
+        HistoryCursor cursor;
+        historyStartExport(cursor);
+        while (historyExport(cursor, buffer, sizeof(buffer)) > 0)
+        {
+        }
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_sensors_and_output()
+{
+    LdrFilter filter;
+    SigmaDelta dither;
+    static const uint8_t pins[] = {16, 17};
+    LedcOutputDriver output(pins, 2, 5000, 13);
+    output.begin();
+    uint32_t allocations = allocationsOf(10000, [&](uint32_t call) {
+        filter.add(call % 4096);
+        dither.start(call);
+        dither.step();
+        easingProgress((EasingCurve)(call % EASING_CURVE_COUNT), call % EASING_ONE);
+        output.write(call % 8192);
+        output.fade(0, call % 8192, 100, fadeDone);
+        nativeLedcEndFades();
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+// Values that change, stay for a call and do not fit any string preference
+static const char *const VALUES[] = {
+    "porch", "hall", "a value far too long for any of the string preferences of the lamp, even the MQTT server"};
+
+const char *valueOf(uint32_t call) { return VALUES[call / 2 % 3]; }
+
+void test_wifi_settings()
+{
+    WifiSsid ssid;
+    WifiPassphrase passphrase;
+    WifiHostname hostname;
+    uint32_t allocations = allocationsOf(1000, [&](uint32_t call) {
+        setWifiStaSsid(valueOf(call));
+        getWifiStaSsid(ssid);
+        setWifiStaPassphrase(valueOf(call));
+        getWifiStaPassphrase(passphrase);
+        setWifiApSsid(valueOf(call));
+        getWifiApSsid(ssid);
+        setWifiApPassphrase(valueOf(call));
+        getWifiApPassphrase(passphrase);
+        setWifiHostname(valueOf(call));
+        getWifiHostname(hostname);
+        hostname.assign(valueOf(call));
+        hostname.equalsIgnoreCase("HALL");
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_mqtt_settings()
+{
+    MqttServer server;
+    MqttUsername username;
+    MqttPassword password;
+    uint32_t allocations = allocationsOf(1000, [&](uint32_t call) {
+        setMqttServer(valueOf(call));
+        getMqttServer(server);
+        setMqttUsername(valueOf(call));
+        getMqttUsername(username);
+        setMqttPassword(valueOf(call));
+        getMqttPassword(password);
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_web_auth_settings()
+{
+    WebAuthUsername username;
+    WebAuthPassword password;
+    uint32_t allocations = allocationsOf(1000, [&](uint32_t call) {
+        setWebAuthUsername(valueOf(call));
+        getWebAuthUsername(username);
+        setWebAuthPassword(valueOf(call));
+        getWebAuthPassword(password);
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+void test_other_preferences()
+{
+    uint32_t allocations = allocationsOf(1000, [&](uint32_t call) {
+        setMaxBrightness(call % 256);
+        maxBrightness();
+        NightLightRule rule;
+        nightLightRule(rule);
+    });
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+}
+
+int main(int argc, char **argv)
+{
+    // setup may allocate, only what follows has to do without
+    nativeReset();
+    configSetup();
+    rulesSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_counter_sees_allocations);
+    RUN_TEST(test_scheduler);
+    RUN_TEST(test_rules);
+    RUN_TEST(test_history);
+    RUN_TEST(test_sensors_and_output);
+    RUN_TEST(test_wifi_settings);
+    RUN_TEST(test_mqtt_settings);
+    RUN_TEST(test_web_auth_settings);
+    RUN_TEST(test_other_preferences);
+    return UNITY_END();
+}
@@ -0,0 +1,199 @@
+#include <chrono>
+#include <config.h>
+#include <device_common.h>
+#include <device_state.h>
+#include <easing.h>
+#include <history.h>
+#include <ldr_filter.h>
+#include <native_hal.h>
+#include <presence.h>
+#include <rules.h>
+#include <scheduler.h>
+#include <stdio.h>
+#include <unity.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cost per call of the hot paths of the control task, on the host. The numbers only compare against each other and
+// against earlier runs on the same machine, they say little about the ESP32. The timings are not asserted.
+
+struct BenchmarkResult
+{
+    double nsPerCall;
+    double cyclesPerCall; // 0 where there is no cycle counter
+};
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Call body calls times, body gets the number of the call
+template <typename Body>
+BenchmarkResult measure(uint32_t calls, Body body)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    uint64_t startCycles = cycles();
+    for (uint32_t call = 0; call < calls; call++)
+        body(call);
+    uint64_t endCycles = cycles();
+    auto endTime = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(endTime - startTime).count();
+    return {ns / calls, (double)(endCycles - startCycles) / calls};
+}
+
+void report(const char *name, const BenchmarkResult &result)
+{
+    char line[120];
+    snprintf(line, sizeof(line), "%-32s %9.1f ns %9.1f cycles", name, result.nsPerCall, result.cyclesPerCall);
+    TEST_MESSAGE(line);
+}
+
+void reportRate(const char *name, double perSecond, const char *unit)
+{
+    char line[120];
+    snprintf(line, sizeof(line), "%-32s %12.1f %s/s", name, perSecond, unit);
+    TEST_MESSAGE(line);
+}
+
+// Keeps the compiler from dropping the measured calls
+volatile uint32_t _sink = 0;
+
+void job() { _sink = _sink + 1; }
+
+void setUp() {}
+
+void tearDown() {}
+
+void benchmark_scheduler()
+{
+    Scheduler jobs("benchmark");
+    const uint32_t periods[] = {1, 10, 20, 50, 100, 1000, 5000, 60000};
+    for (uint32_t period : periods)
+        jobs.every("job", period, job);
+    report("scheduler run, every ms", measure(200000, [&](uint32_t) {
+               nativeAdvanceMillis(1);
+               jobs.run();
+           }));
+
+    Scheduler sparse("sparse");
+    sparse.every("job", 60000, job);
+    sparse.every("job", 250000, job);
+    report("scheduler run, idle jumps", measure(200000, [&](uint32_t) {
+               nativeAdvanceMillis(997);
+               sparse.run();
+           }));
+    TEST_ASSERT_GREATER_THAN(0, _sink);
+}
+
+// One step of a transition: the LED strip eases every update
+void benchmark_easing()
+{
+    for (uint8_t curve = 0; curve < EASING_CURVE_COUNT; curve++)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "easing step, curve %u", curve);
+        report(name, measure(1000000, [&](uint32_t call) {
+                   _sink = easingProgress((EasingCurve)curve, (call * 40503u) & (EASING_ONE - 1));
+               }));
+    }
+}
+
+void benchmark_history()
+{
+    HistorySample sample = {};
+    report("history append, steady", measure(100000, [&](uint32_t call) {
+               nativeAdvanceMillis(1000);
+               sample.ldr = 500 + call % 8;
+               historyAppend(sample);
+           }));
+    report("history append, busy", measure(100000, [&](uint32_t call) {
+               nativeAdvanceMillis(1000);
+               sample.ldr = call % 4096;
+               sample.presence = call % 3 == 0;
+               historyAppend(sample);
+           }));
+    TEST_ASSERT_GREATER_THAN(0, historySeconds());
+}
+
+void benchmark_ldr_filter()
+{
+    LdrFilter filter;
+    report("LDR filter add", measure(1000000, [&](uint32_t call) { _sink = filter.add((call * 2654435761u) >> 20); }));
+}
+
+void benchmark_rules()
+{
+    report("rules, unchanged inputs", measure(1000000, [&](uint32_t) {
+               rulesSetLdr(2000, 1000);
+               rulesSetPresence(false);
+               _sink = rulesNightLight();
+           }));
+    report("rules, changing inputs", measure(1000000, [&](uint32_t call) {
+               rulesSetLdr(call % 2 == 0 ? 500 : 2000, 1000);
+               rulesSetPresence(call % 3 == 0);
+               _sink = rulesNightLight();
+           }));
+}
+
+// The whole lamp (tasks, timers, fades) through a night in the dark, someone passing by for 2 minutes of every 20. Starts
+// the lamp, which can not be stopped again: comes last.
+void benchmark_night()
+{
+    const uint32_t NIGHT_MINUTES = 8 * 60;
+    static NativeRadar radar;
+    NativeRadarTarget passing = {};
+    passing.moving = true;
+    passing.movingDistance = 150;
+    passing.movingEnergy = 60;
+
+    nativeSetMonitorOutput(false);
+    nativeSetMillivolts(LDR_PIN, 10);
+    presenceUseStream(radar);
+    deviceSetup();
+    uint32_t nightLightMinutes = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint32_t minute = 0; minute < NIGHT_MINUTES; minute++)
+    {
+        radar.setTarget(minute % 20 < 2 ? passing : NativeRadarTarget());
+        delay(60000);
+        if (getDeviceState().state == NIGHT_LIGHT_ON)
+            nightLightMinutes++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    reportRate("night, simulated", NIGHT_MINUTES / 60.0 / seconds, "hours");
+    TEST_ASSERT_GREATER_THAN(0, nightLightMinutes);
+    TEST_ASSERT_LESS_THAN(NIGHT_MINUTES, nightLightMinutes);
+}
+
+// Events through the state table of the running lamp, from the test thread while its tasks wait. The lamp only moves
+// on from the start states at the next pass of the control loop: this is the table and its actions, not the fades.
+void benchmark_dispatch()
+{
+    BenchmarkResult result = measure(100000, [&](uint32_t call) { modifyLightState(call % 2 == 0); });
+    report("state dispatch, on/off", result);
+    reportRate("state dispatch, on/off", 1e9 / result.nsPerCall, "dispatches");
+    delay(10000);
+    TEST_ASSERT_EQUAL(OFF, getDeviceState().state);
+}
+
+int main(int argc, char **argv)
+{
+    nativeReset();
+    configSetup();
+    rulesSetup();
+    UNITY_BEGIN();
+    RUN_TEST(benchmark_scheduler);
+    RUN_TEST(benchmark_easing);
+    RUN_TEST(benchmark_history);
+    RUN_TEST(benchmark_ldr_filter);
+    RUN_TEST(benchmark_rules);
+    RUN_TEST(benchmark_night);
+    RUN_TEST(benchmark_dispatch);
+    return UNITY_END();
+}
@@ -0,0 +1,58 @@
+#include <clock.h>
+#include <native_hal.h>
+#include <unity.h>
+
+unsigned long _virtualMs = 0;
+
+unsigned long virtualClock() { return _virtualMs; }
+
+void setUp()
+{
+    nativeReset();
+    clockUseSource(nullptr);
+}
+
+void tearDown() { clockUseSource(nullptr); }
+
+void test_runs_on_millis()
+{
+    TEST_ASSERT_EQUAL_UINT32(0, clockMillis());
+    nativeAdvanceMillis(1500);
+    TEST_ASSERT_EQUAL_UINT32(1500, clockMillis());
+    delay(250);
+    TEST_ASSERT_EQUAL_UINT32(1750, clockMillis());
+    nativeAdvanceMicros(999);
+    TEST_ASSERT_EQUAL_UINT32(1750, clockMillis());
+    nativeAdvanceMicros(1);
+    TEST_ASSERT_EQUAL_UINT32(1751, clockMillis());
+}
+
+void test_millis_wraps_at_32_bit()
+{
+    nativeSetMillis(UINT32_MAX);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, clockMillis());
+    nativeAdvanceMillis(2);
+    TEST_ASSERT_EQUAL_UINT32(1, clockMillis());
+    // differences across the wrap, taken as on the ESP32
+    TEST_ASSERT_EQUAL_UINT32(2, (uint32_t)clockMillis() - UINT32_MAX);
+}
+
+void test_other_source()
+{
+    _virtualMs = 12345678;
+    clockUseSource(virtualClock);
+    TEST_ASSERT_EQUAL_UINT32(12345678, clockMillis());
+    nativeAdvanceMillis(1000);
+    TEST_ASSERT_EQUAL_UINT32(12345678, clockMillis());
+    clockUseSource(nullptr);
+    TEST_ASSERT_EQUAL_UINT32(1000, clockMillis());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_runs_on_millis);
+    RUN_TEST(test_millis_wraps_at_32_bit);
+    RUN_TEST(test_other_source);
+    return UNITY_END();
+}
@@ -0,0 +1,103 @@
+#include <Preferences.h>
+#include <config.h>
+#include <native_hal.h>
+#include <scheduler.h>
+#include <unity.h>
+
+// The preferences live in the fake NVS of lib/native_hal, erased once before the tests
+void setUp() {}
+
+void tearDown() {}
+
+void test_defaults()
+{
+    TEST_ASSERT_EQUAL_UINT8(DEFAULT_BRIGHTNESS_STEP, brightnessStep());
+    TEST_ASSERT_EQUAL_UINT8(DEFAULT_MAX_BRIGHTNESS, maxBrightness());
+    TEST_ASSERT_EQUAL_UINT32(DEFAULT_WIFI_AP_IP, wifiApIPv4Address());
+    WifiHostname hostname;
+    getWifiHostname(hostname);
+    TEST_ASSERT_EQUAL_STRING(DEFAULT_WIFI_HOSTNAME, hostname.c_str());
+    NightLightRule rule;
+    TEST_ASSERT_FALSE(nightLightRule(rule));
+    LedStripEnergy energy;
+    TEST_ASSERT_FALSE(energyCounters(energy));
+}
+
+void test_round_trip()
+{
+    setMaxBrightness(123);
+    setNightLightThreshold(2345);
+    setAllowNightLight(!DEFAULT_ALLOW_NIGHTLIGHT);
+    setWifiAPpIPv4Address(IPAddress(10, 0, 0, 1));
+    setWifiHostname("hall");
+    TEST_ASSERT_EQUAL_UINT8(123, maxBrightness());
+    TEST_ASSERT_EQUAL_UINT16(2345, nightLightThreshold());
+    TEST_ASSERT_EQUAL(!DEFAULT_ALLOW_NIGHTLIGHT, allowNightLight());
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)IPAddress(10, 0, 0, 1), wifiApIPv4Address());
+    WifiHostname hostname;
+    getWifiHostname(hostname);
+    TEST_ASSERT_EQUAL_STRING("hall", hostname.c_str());
+}
+
+void test_unchanged_values_are_not_written()
+{
+    setMaxBrightness(99);
+    setWifiHostname("porch");
+    NightLightRule rule = {ruleBit(RULE_DARK), 10, 20, 30};
+    setNightLightRule(rule);
+    uint32_t writes = Preferences::writeCount();
+    setMaxBrightness(99);
+    setWifiHostname("porch");
+    setNightLightRule(rule);
+    TEST_ASSERT_EQUAL_UINT32(writes, Preferences::writeCount());
+    setMaxBrightness(100);
+    TEST_ASSERT_EQUAL_UINT32(writes + 1, Preferences::writeCount());
+}
+
+void test_sanity_checks()
+{
+    setBrightnessStep(0);
+    TEST_ASSERT_EQUAL_UINT8(1, brightnessStep());
+}
+
+void test_energy_counters_are_written_behind()
+{
+    LedStripEnergy energy;
+    energy.fineDutyMs = 123456789012ULL;
+    energy.transitions = 42;
+    setEnergyCounters(energy);
+    LedStripEnergy saved;
+    TEST_ASSERT_FALSE(energyCounters(saved));
+    nativeAdvanceMillis(ENERGY_SAVE_INTERVAL_MS);
+    controlJobs.run();
+    TEST_ASSERT_TRUE(energyCounters(saved));
+    TEST_ASSERT_TRUE(saved.fineDutyMs == energy.fineDutyMs);
+    TEST_ASSERT_EQUAL_UINT32(42, saved.transitions);
+    // nothing new: the next interval writes nothing
+    uint32_t writes = Preferences::writeCount();
+    nativeAdvanceMillis(ENERGY_SAVE_INTERVAL_MS);
+    controlJobs.run();
+    TEST_ASSERT_EQUAL_UINT32(writes, Preferences::writeCount());
+}
+
+void test_factory_reset()
+{
+    setMaxBrightness(77);
+    factoryReset();
+    TEST_ASSERT_EQUAL_UINT32(1, nativeRestartCount());
+    TEST_ASSERT_EQUAL_UINT8(DEFAULT_MAX_BRIGHTNESS, maxBrightness());
+}
+
+int main(int argc, char **argv)
+{
+    nativeReset();
+    configSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_unchanged_values_are_not_written);
+    RUN_TEST(test_sanity_checks);
+    RUN_TEST(test_energy_counters_are_written_behind);
+    RUN_TEST(test_factory_reset);
+    return UNITY_END();
+}
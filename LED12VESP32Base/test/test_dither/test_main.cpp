@@ -0,0 +1,143 @@
+#include <dither.h>
+#include <unity.h>
+
+// Fine duties to try: every fraction around the bottom, the middle and the top of the range of a 13 bit PWM
+static const uint16_t BASES[] = {0, 1, 2, 3, 100, 4095, 8190};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_start_splits_the_fine_duty()
+{
+    SigmaDelta dither;
+    dither.start((123 << DITHER_BITS) | 5);
+    TEST_ASSERT_EQUAL_UINT16(123, dither.baseDuty());
+    TEST_ASSERT_EQUAL_UINT8(5, dither.fraction());
+}
+
+void test_only_the_two_neighbouring_counts_are_shown()
+{
+    for (uint16_t base : BASES)
+    {
+        for (uint8_t fraction = 0; fraction < DITHER_ONE; fraction++)
+        {
+            SigmaDelta dither;
+            dither.start((base << DITHER_BITS) | fraction);
+            for (uint16_t period = 0; period < 100; period++)
+            {
+                uint16_t duty = dither.step();
+                TEST_ASSERT_TRUE(duty == base || (fraction > 0 && duty == base + 1));
+            }
+        }
+    }
+}
+
+void test_average_is_exact_over_any_window()
+{
+    for (uint16_t base : BASES)
+    {
+        for (uint8_t fraction = 0; fraction < DITHER_ONE; fraction++)
+        {
+            uint16_t fineDuty = (base << DITHER_BITS) | fraction;
+            SigmaDelta dither;
+            dither.start(fineDuty);
+            // the duties of 10 windows in a row, each window of DITHER_ONE periods may start at any of them
+            uint16_t duties[11 * DITHER_ONE];
+            for (uint16_t &duty : duties)
+                duty = dither.step();
+            for (uint16_t start = 0; start < 10 * DITHER_ONE; start++)
+            {
+                uint32_t sum = 0;
+                for (uint8_t period = 0; period < DITHER_ONE; period++)
+                    sum += duties[start + period];
+                TEST_ASSERT_EQUAL_UINT32(fineDuty, sum);
+            }
+        }
+    }
+}
+
+void test_error_stays_below_one_count()
+{
+    // short of a whole window the shown duty deviates less than one count from the fine duty
+    for (uint8_t fraction = 0; fraction < DITHER_ONE; fraction++)
+    {
+        uint16_t fineDuty = (10 << DITHER_BITS) | fraction;
+        SigmaDelta dither;
+        dither.start(fineDuty);
+        int32_t sum = 0;
+        for (uint16_t period = 1; period <= 1000; period++)
+        {
+            sum += dither.step() << DITHER_BITS;
+            int32_t error = sum - (int32_t)period * fineDuty;
+            TEST_ASSERT_TRUE(error > -DITHER_ONE && error < DITHER_ONE);
+        }
+    }
+}
+
+void test_higher_counts_are_spread()
+{
+    // half way: the counts take turns rather than forming runs
+    SigmaDelta dither;
+    dither.start((50 << DITHER_BITS) | (DITHER_ONE / 2));
+    uint16_t previous = dither.step();
+    for (uint8_t period = 0; period < 4 * DITHER_ONE; period++)
+    {
+        uint16_t duty = dither.step();
+        TEST_ASSERT_NOT_EQUAL(previous, duty);
+        previous = duty;
+    }
+}
+
+void test_start_over()
+{
+    SigmaDelta dither;
+    dither.start((7 << DITHER_BITS) | 3);
+    for (uint8_t period = 0; period < 5; period++)
+        dither.step();
+    // a new duty starts from an empty accumulator: its first window is exact as well
+    dither.start((7 << DITHER_BITS) | 1);
+    uint32_t sum = 0;
+    for (uint8_t period = 0; period < DITHER_ONE; period++)
+        sum += dither.step();
+    TEST_ASSERT_EQUAL_UINT32((7 << DITHER_BITS) | 1, sum);
+}
+
+void test_low_duties_are_rounded_instead()
+{
+    for (uint16_t fineDuty = 1; fineDuty < DITHER_MIN_DUTY << DITHER_BITS; fineDuty++)
+    {
+        TEST_ASSERT_FALSE(ditherable(fineDuty));
+        // the nearest count, never off
+        uint16_t nearest = (fineDuty >> DITHER_BITS) + ((fineDuty & DITHER_MASK) >= DITHER_ONE / 2 ? 1 : 0);
+        uint16_t duty = nearest == 0 ? 1 : nearest;
+        TEST_ASSERT_EQUAL_UINT16(duty, unditheredDuty(fineDuty));
+        TEST_ASSERT_EQUAL_UINT16(duty << DITHER_BITS, shownFineDuty(fineDuty));
+    }
+    TEST_ASSERT_EQUAL_UINT16(0, unditheredDuty(0));
+    TEST_ASSERT_EQUAL_UINT16(0, shownFineDuty(0));
+}
+
+void test_duties_from_the_minimum_are_dithered()
+{
+    for (uint16_t fineDuty = DITHER_MIN_DUTY << DITHER_BITS; fineDuty < (DITHER_MIN_DUTY + 4) << DITHER_BITS; fineDuty++)
+    {
+        // whole counts need no dithering
+        TEST_ASSERT_EQUAL((fineDuty & DITHER_MASK) != 0, ditherable(fineDuty));
+        TEST_ASSERT_EQUAL_UINT16(fineDuty, shownFineDuty(fineDuty));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_start_splits_the_fine_duty);
+    RUN_TEST(test_only_the_two_neighbouring_counts_are_shown);
+    RUN_TEST(test_average_is_exact_over_any_window);
+    RUN_TEST(test_error_stays_below_one_count);
+    RUN_TEST(test_higher_counts_are_spread);
+    RUN_TEST(test_start_over);
+    RUN_TEST(test_low_duties_are_rounded_instead);
+    RUN_TEST(test_duties_from_the_minimum_are_dithered);
+    return UNITY_END();
+}
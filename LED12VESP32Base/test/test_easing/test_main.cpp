@@ -0,0 +1,125 @@
+#include <easing.h>
+#include <string>
+#include <unity.h>
+
+// Collects what gets printed
+class StringStream : public Stream
+{
+public:
+    size_t write(uint8_t c) override
+    {
+        text += (char)c;
+        return 1;
+    }
+    std::string text;
+};
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_curves_start_at_zero_and_end_at_one()
+{
+    for (uint8_t curve = 0; curve < EASING_CURVE_COUNT; curve++)
+    {
+        TEST_ASSERT_EQUAL_UINT16(0, easingProgress((EasingCurve)curve, 0));
+        TEST_ASSERT_EQUAL_UINT16(EASING_ONE, easingProgress((EasingCurve)curve, EASING_ONE));
+        TEST_ASSERT_EQUAL_UINT16(0, easingStepProgress((EasingCurve)curve, 0));
+        TEST_ASSERT_EQUAL_UINT16(EASING_ONE, easingStepProgress((EasingCurve)curve, EASING_STEPS));
+    }
+}
+
+void test_curves_are_monotonic()
+{
+    for (uint8_t curve = 0; curve < EASING_CURVE_COUNT; curve++)
+    {
+        uint16_t previous = 0;
+        for (uint32_t t = 0; t <= EASING_ONE; t++)
+        {
+            uint16_t progress = easingProgress((EasingCurve)curve, t);
+            TEST_ASSERT_GREATER_OR_EQUAL(previous, progress);
+            TEST_ASSERT_LESS_OR_EQUAL(EASING_ONE, progress);
+            previous = progress;
+        }
+    }
+}
+
+void test_linear_and_perceptual_are_the_identity()
+{
+    for (uint32_t t = 0; t <= EASING_ONE; t += 7)
+    {
+        TEST_ASSERT_EQUAL_UINT16(t, easingProgress(EASE_LINEAR, t));
+        TEST_ASSERT_EQUAL_UINT16(t, easingProgress(EASE_PERCEPTUAL, t));
+    }
+}
+
+void test_in_out_is_symmetric()
+{
+    for (uint32_t t = 0; t <= EASING_ONE; t += 5)
+    {
+        uint32_t sum = easingProgress(EASE_IN_OUT, t) + easingProgress(EASE_IN_OUT, EASING_ONE - t);
+        TEST_ASSERT_UINT32_WITHIN(2, EASING_ONE, sum);
+    }
+    TEST_ASSERT_EQUAL_UINT16(EASING_ONE / 2, easingProgress(EASE_IN_OUT, EASING_ONE / 2));
+    // slow at both ends
+    TEST_ASSERT_LESS_THAN(EASING_ONE / EASING_STEPS, easingStepProgress(EASE_IN_OUT, 1));
+}
+
+void test_exponential_starts_slow()
+{
+    for (uint8_t step = 1; step < EASING_STEPS; step++)
+        TEST_ASSERT_LESS_THAN(easingStepProgress(EASE_LINEAR, step), easingStepProgress(EASE_EXPONENTIAL, step));
+    // 2^5 - 1 of 2^10 - 1 at half time
+    uint32_t expected = (31UL * EASING_ONE + 511) / 1023;
+    TEST_ASSERT_UINT32_WITHIN(1, expected, easingStepProgress(EASE_EXPONENTIAL, EASING_STEPS / 2));
+}
+
+void test_steps_match_the_curve()
+{
+    for (uint8_t curve = 0; curve < EASING_CURVE_COUNT; curve++)
+    {
+        for (uint8_t step = 0; step <= EASING_STEPS; step++)
+        {
+            uint16_t t = (uint32_t)step * EASING_ONE / EASING_STEPS;
+            uint16_t expected = easingStepProgress((EasingCurve)curve, step);
+            TEST_ASSERT_EQUAL_UINT16(expected, easingProgress((EasingCurve)curve, t));
+        }
+    }
+}
+
+void test_out_of_range()
+{
+    // an invalid curve (e.g. a stale preference) is linear
+    TEST_ASSERT_FALSE(isEasingCurve(EASING_CURVE_COUNT));
+    TEST_ASSERT_TRUE(isEasingCurve(EASE_PERCEPTUAL));
+    TEST_ASSERT_EQUAL_UINT16(1234, easingProgress((EasingCurve)200, 1234));
+    TEST_ASSERT_EQUAL_UINT16(easingStepProgress(EASE_LINEAR, 3), easingStepProgress((EasingCurve)200, 3));
+    // past the end stays at the end
+    TEST_ASSERT_EQUAL_UINT16(EASING_ONE, easingProgress(EASE_IN_OUT, UINT16_MAX));
+    TEST_ASSERT_EQUAL_UINT16(EASING_ONE, easingStepProgress(EASE_EXPONENTIAL, EASING_STEPS + 5));
+}
+
+void test_debug_print()
+{
+    StringStream stream;
+    debugPrintEasingCurve(&stream, EASE_IN_OUT);
+    TEST_ASSERT_EQUAL_STRING("EASE_IN_OUT", stream.text.c_str());
+    stream.text.clear();
+    debugPrintEasingCurve(&stream, EASE_LINEAR, true);
+    TEST_ASSERT_EQUAL_STRING("EASE_LINEAR\r\n", stream.text.c_str());
+    debugPrintEasingCurve(nullptr, EASE_LINEAR);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_curves_start_at_zero_and_end_at_one);
+    RUN_TEST(test_curves_are_monotonic);
+    RUN_TEST(test_linear_and_perceptual_are_the_identity);
+    RUN_TEST(test_in_out_is_symmetric);
+    RUN_TEST(test_exponential_starts_slow);
+    RUN_TEST(test_steps_match_the_curve);
+    RUN_TEST(test_out_of_range);
+    RUN_TEST(test_debug_print);
+    return UNITY_END();
+}
@@ -0,0 +1,183 @@
+#include <history.h>
+#include <native_hal.h>
+#include <stdio.h>
+#include <string>
+#include <unity.h>
+
+// The history has no reset: the tests run one after the other on the same history, each one going on from the second
+// the one before stopped at.
+uint32_t _second = 0;
+
+HistorySample sample(uint16_t ldr, uint16_t distance = 0, uint8_t state = 0)
+{
+    HistorySample sample = {};
+    sample.ldr = ldr;
+    sample.distance = distance;
+    sample.energy = distance > 0 ? 40 : 0;
+    sample.presence = distance > 0 && distance < 200 ? 1 : 0;
+    sample.state = state;
+    return sample;
+}
+
+void appendSecond(const HistorySample &value)
+{
+    nativeSetMillis((unsigned long)_second * 1000);
+    historyAppend(value);
+    _second++;
+}
+
+std::string exportAll(size_t chunk = 200)
+{
+    std::string csv;
+    HistoryCursor cursor;
+    historyStartExport(cursor);
+    char buffer[2048];
+    size_t length;
+    while ((length = historyExport(cursor, buffer, chunk)) > 0)
+        csv.append(buffer, length);
+    return csv;
+}
+
+struct ExportLine
+{
+    unsigned long second;
+    unsigned long duration;
+    unsigned ldr;
+    unsigned distance;
+    unsigned energy;
+    unsigned presence;
+    unsigned state;
+};
+
+// Parse the lines of an export after the header, returns the number of lines
+size_t parseExport(const std::string &csv, ExportLine *lines, size_t maxLines)
+{
+    size_t count = 0;
+    size_t pos = csv.find('\n');
+    while (pos != std::string::npos && pos + 1 < csv.size() && count < maxLines)
+    {
+        ExportLine &line = lines[count];
+        if (sscanf(csv.c_str() + pos + 1, "%lu,%lu,%u,%u,%u,%u,%u", &line.second, &line.duration, &line.ldr,
+                   &line.distance, &line.energy, &line.presence, &line.state) != 7)
+            break;
+        count++;
+        pos = csv.find('\n', pos + 1);
+    }
+    return count;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_empty_history()
+{
+    TEST_ASSERT_EQUAL_UINT32(0, historySeconds());
+    TEST_ASSERT_EQUAL_UINT32(0, historyRecords());
+    TEST_ASSERT_EQUAL_UINT32(0, historyBytesUsed());
+    TEST_ASSERT_EQUAL_UINT32(0, historyStats(HISTORY_LAST_HOUR).seconds);
+    TEST_ASSERT_TRUE(exportAll() == "second,duration,ldr,distance,energy,presence,state\n");
+}
+
+void test_steady_signal_is_one_record()
+{
+    for (uint16_t i = 0; i < 100; i++)
+        appendSecond(sample(500));
+    TEST_ASSERT_EQUAL_UINT32(100, historySeconds());
+    TEST_ASSERT_EQUAL_UINT32(0, historyRecords()); // still open
+    ExportLine lines[4];
+    TEST_ASSERT_EQUAL(1, parseExport(exportAll(), lines, 4));
+    TEST_ASSERT_EQUAL_UINT32(0, lines[0].second);
+    TEST_ASSERT_EQUAL_UINT32(100, lines[0].duration);
+    TEST_ASSERT_EQUAL_UINT32(500, lines[0].ldr);
+}
+
+void test_samples_within_a_second_are_ignored()
+{
+    uint32_t seconds = historyStats(HISTORY_LAST_HOUR).seconds;
+    appendSecond(sample(500));
+    nativeAdvanceMillis(500);
+    historyAppend(sample(3000, 100, 8));
+    TEST_ASSERT_EQUAL_UINT32(seconds + 1, historyStats(HISTORY_LAST_HOUR).seconds);
+    TEST_ASSERT_EQUAL_UINT16(500, historyStats(HISTORY_LAST_HOUR).ldrMax);
+}
+
+void test_dead_band()
+{
+    uint32_t records = historyRecords();
+    // the LDR wanders within its dead band: the record goes on
+    for (uint16_t i = 0; i < 50; i++)
+        appendSecond(sample(500 + i % 10));
+    TEST_ASSERT_EQUAL_UINT32(records, historyRecords());
+    // a step beyond the dead band starts a new record, so does any change of the presence or state
+    appendSecond(sample(600));
+    TEST_ASSERT_EQUAL_UINT32(records + 1, historyRecords());
+    appendSecond(sample(600, 100, 8));
+    TEST_ASSERT_EQUAL_UINT32(records + 2, historyRecords());
+    appendSecond(sample(600, 100, 9));
+    TEST_ASSERT_EQUAL_UINT32(records + 3, historyRecords());
+}
+
+void test_stats_of_the_last_hour()
+{
+    // an hour and a bit of a known signal pushes everything before out of the window
+    for (uint32_t i = 0; i < 3900; i++)
+        appendSecond(i % 2 == 0 ? sample(100, 150, 8) : sample(300));
+    HistoryStats stats = historyStats(HISTORY_LAST_HOUR);
+    // 11 whole buckets of 5 minutes and the current one
+    TEST_ASSERT_GREATER_OR_EQUAL(11 * 300, stats.seconds);
+    TEST_ASSERT_LESS_OR_EQUAL(12 * 300, stats.seconds);
+    TEST_ASSERT_EQUAL_UINT16(100, stats.ldrMin);
+    TEST_ASSERT_EQUAL_UINT16(300, stats.ldrMax);
+    TEST_ASSERT_UINT32_WITHIN(1, 200, stats.ldrAvg);
+    TEST_ASSERT_UINT32_WITHIN(1, stats.seconds / 2, stats.presenceSeconds);
+    TEST_ASSERT_EQUAL_UINT32(stats.presenceSeconds, stats.targetSeconds);
+    TEST_ASSERT_EQUAL_UINT16(150, stats.distanceMin);
+    TEST_ASSERT_EQUAL_UINT16(150, stats.distanceAvg);
+    TEST_ASSERT_EQUAL_UINT32(stats.presenceSeconds, stats.lampOnSeconds);
+    TEST_ASSERT_EQUAL_STRING("lastHour", historyWindowName(HISTORY_LAST_HOUR));
+}
+
+void test_export_is_continuous()
+{
+    for (uint32_t i = 0; i < 2000; i++)
+        appendSecond(sample((i / 60) * 40 % 4096, i % 300 < 30 ? 120 : 0, i % 300 < 30 ? 8 : 0));
+    static ExportLine lines[6000];
+    // small chunks: the lines must not get cut
+    std::string csv = exportAll(HISTORY_MAX_LINE);
+    size_t count = parseExport(csv, lines, 6000);
+    TEST_ASSERT_GREATER_THAN(2, count);
+    TEST_ASSERT_EQUAL_UINT32(_second - historySeconds(), lines[0].second);
+    for (size_t i = 1; i < count; i++)
+        TEST_ASSERT_EQUAL_UINT32(lines[i - 1].second + lines[i - 1].duration, lines[i].second);
+    TEST_ASSERT_EQUAL_UINT32(_second, lines[count - 1].second + lines[count - 1].duration);
+    TEST_ASSERT_TRUE(csv == exportAll(2000));
+}
+
+void test_retention_of_a_busy_signal()
+{
+    // a day and a half of a signal changing every few seconds: the oldest blocks make room, the history still covers
+    // what it reports
+    for (uint32_t i = 0; i < 36UL * 60 * 60; i++)
+        appendSecond(sample((i / 5) % 2 == 0 ? 200 : 900, i % 7 == 0 ? 100 : 0, 0));
+    TEST_ASSERT_LESS_OR_EQUAL((uint32_t)HISTORY_BLOCKS * HISTORY_BLOCK_BYTES, historyBytesUsed());
+    TEST_ASSERT_GREATER_THAN(0, historySeconds());
+    TEST_ASSERT_LESS_THAN(HISTORY_SECONDS, historySeconds());
+    static ExportLine lines[20000];
+    size_t count = parseExport(exportAll(), lines, 20000);
+    TEST_ASSERT_EQUAL_UINT32(_second - historySeconds(), lines[0].second);
+    TEST_ASSERT_EQUAL_UINT32(_second, lines[count - 1].second + lines[count - 1].duration);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_history);
+    RUN_TEST(test_steady_signal_is_one_record);
+    RUN_TEST(test_samples_within_a_second_are_ignored);
+    RUN_TEST(test_dead_band);
+    RUN_TEST(test_stats_of_the_last_hour);
+    RUN_TEST(test_export_is_continuous);
+    RUN_TEST(test_retention_of_a_busy_signal);
+    return UNITY_END();
+}
@@ -0,0 +1,93 @@
+#include <ldr_filter.h>
+#include <unity.h>
+
+static LdrFilter _filter;
+
+void setUp() { _filter.reset(); }
+
+void tearDown() {}
+
+void test_first_reading_primes_the_filter()
+{
+    TEST_ASSERT_FALSE(_filter.primed());
+    TEST_ASSERT_EQUAL_UINT16(0, _filter.average());
+    TEST_ASSERT_EQUAL_UINT16(1234, _filter.add(1234));
+    TEST_ASSERT_TRUE(_filter.primed());
+    TEST_ASSERT_EQUAL_UINT16(0, _filter.noise());
+}
+
+void test_steady_readings()
+{
+    for (uint8_t i = 0; i < 50; i++)
+        _filter.add(800);
+    TEST_ASSERT_EQUAL_UINT16(800, _filter.average());
+    TEST_ASSERT_EQUAL_UINT16(0, _filter.noise());
+}
+
+void test_single_outlier_is_dropped()
+{
+    for (uint8_t i = 0; i < 10; i++)
+        _filter.add(800);
+    // a car passing by
+    TEST_ASSERT_EQUAL_UINT16(800, _filter.add(4095));
+    TEST_ASSERT_EQUAL_UINT16(800, _filter.add(800));
+    TEST_ASSERT_EQUAL_UINT16(800, _filter.add(0));
+    TEST_ASSERT_EQUAL_UINT16(800, _filter.add(800));
+}
+
+void test_step_is_followed()
+{
+    for (uint8_t i = 0; i < 10; i++)
+        _filter.add(100);
+    uint16_t previous = _filter.average();
+    for (uint8_t i = 0; i < 40; i++)
+    {
+        uint16_t average = _filter.add(2100);
+        TEST_ASSERT_GREATER_OR_EQUAL(previous, average);
+        TEST_ASSERT_LESS_OR_EQUAL(2100, average);
+        previous = average;
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, 2100, _filter.average());
+}
+
+void test_noise()
+{
+    for (uint8_t i = 0; i < 100; i++)
+        _filter.add(i % 2 == 0 ? 1000 : 1040);
+    // the median of alternating readings flips between both, the deviation stays about half the distance
+    TEST_ASSERT_UINT32_WITHIN(20, 1020, _filter.average());
+    TEST_ASSERT_GREATER_THAN(5, _filter.noise());
+    TEST_ASSERT_LESS_OR_EQUAL(40, _filter.noise());
+}
+
+void test_reset()
+{
+    _filter.add(3000);
+    _filter.add(3000);
+    _filter.reset();
+    TEST_ASSERT_FALSE(_filter.primed());
+    TEST_ASSERT_EQUAL_UINT16(10, _filter.add(10));
+}
+
+void test_full_scale()
+{
+    for (uint8_t i = 0; i < 50; i++)
+        _filter.add(4095);
+    TEST_ASSERT_EQUAL_UINT16(4095, _filter.average());
+    for (uint8_t i = 0; i < 50; i++)
+        _filter.add(0);
+    TEST_ASSERT_EQUAL_UINT16(0, _filter.average());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_first_reading_primes_the_filter);
+    RUN_TEST(test_steady_readings);
+    RUN_TEST(test_single_outlier_is_dropped);
+    RUN_TEST(test_step_is_followed);
+    RUN_TEST(test_noise);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_full_scale);
+    return UNITY_END();
+}
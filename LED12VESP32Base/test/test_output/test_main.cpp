@@ -0,0 +1,241 @@
+#include <led_output.h>
+#include <native_hal.h>
+#include <unity.h>
+
+static const uint8_t PINS[] = {16, 17, 18};
+static const uint8_t RESOLUTION_BITS = 13;
+
+uint32_t _doneCalls = 0;
+
+bool fadeDone()
+{
+    _doneCalls++;
+    return false;
+}
+
+void setUp()
+{
+    nativeReset();
+    _doneCalls = 0;
+}
+
+void tearDown() {}
+
+// ---- Fake ----
+
+void test_fake_write()
+{
+    FakeOutputDriver output(2);
+    TEST_ASSERT_TRUE(output.begin());
+    output.write(1000);
+    TEST_ASSERT_EQUAL_UINT16(1000, output.read());
+    TEST_ASSERT_EQUAL_UINT16(1000, output.channelDuty(0));
+    TEST_ASSERT_EQUAL_UINT16(1000, output.channelDuty(1));
+    TEST_ASSERT_EQUAL_UINT16(0, output.channelDuty(2));
+    TEST_ASSERT_EQUAL_UINT32(1, output.writeCount());
+    TEST_ASSERT_EQUAL_UINT32(0, output.fadeCount());
+}
+
+void test_fake_fade()
+{
+    FakeOutputDriver output(1);
+    output.update(5000);
+    TEST_ASSERT_TRUE(output.fade(0, 1000, 500, fadeDone));
+    TEST_ASSERT_EQUAL_UINT16(0, output.read());
+    output.update(5250);
+    TEST_ASSERT_EQUAL_UINT16(500, output.read());
+    output.update(5499);
+    TEST_ASSERT_EQUAL_UINT16(998, output.read());
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+    output.update(5500);
+    TEST_ASSERT_EQUAL_UINT16(1000, output.read());
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+    output.update(6000);
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+    TEST_ASSERT_EQUAL_UINT32(1, output.fadeCount());
+
+    // downwards
+    output.fade(1000, 200, 100, fadeDone);
+    output.update(6050);
+    TEST_ASSERT_EQUAL_UINT16(600, output.read());
+    output.update(6100);
+    TEST_ASSERT_EQUAL_UINT16(200, output.read());
+    TEST_ASSERT_EQUAL_UINT32(2, _doneCalls);
+}
+
+void test_fake_stop_fade_holds_the_duty()
+{
+    FakeOutputDriver output(1);
+    output.fade(0, 800, 400, fadeDone);
+    output.update(100);
+    output.stopFade();
+    TEST_ASSERT_EQUAL_UINT16(200, output.read());
+    output.update(1000);
+    TEST_ASSERT_EQUAL_UINT16(200, output.read());
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+}
+
+void test_fake_write_ends_a_fade()
+{
+    FakeOutputDriver output(1);
+    output.fade(0, 800, 400, fadeDone);
+    output.update(100);
+    output.write(50);
+    output.update(1000);
+    TEST_ASSERT_EQUAL_UINT16(50, output.read());
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+}
+
+void test_fake_clock_wraps_around()
+{
+    FakeOutputDriver output(1);
+    output.update(UINT32_MAX - 99);
+    output.fade(0, 1000, 200, fadeDone);
+    output.update(0);
+    TEST_ASSERT_EQUAL_UINT16(500, output.read());
+    output.update(100);
+    TEST_ASSERT_EQUAL_UINT16(1000, output.read());
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+}
+
+void test_gains()
+{
+    FakeOutputDriver output(3);
+    output.setGain(1, LED_OUTPUT_GAIN_ONE / 2);
+    output.setGain(2, 0);
+    output.setGain(0, UINT16_MAX); // clamped
+    output.setGain(5, 123);        // no such channel
+    TEST_ASSERT_EQUAL_UINT16(LED_OUTPUT_GAIN_ONE, output.gain(0));
+    TEST_ASSERT_EQUAL_UINT16(LED_OUTPUT_GAIN_ONE / 2, output.gain(1));
+    TEST_ASSERT_EQUAL_UINT16(0, output.gain(5));
+    output.write(1001);
+    TEST_ASSERT_EQUAL_UINT16(1001, output.channelDuty(0));
+    TEST_ASSERT_EQUAL_UINT16(501, output.channelDuty(1));
+    TEST_ASSERT_EQUAL_UINT16(0, output.channelDuty(2));
+    TEST_ASSERT_EQUAL_UINT16(1001, output.read());
+}
+
+void test_channel_count_is_limited()
+{
+    FakeOutputDriver output(LED_OUTPUT_MAX_CHANNELS + 3);
+    TEST_ASSERT_EQUAL_UINT8(LED_OUTPUT_MAX_CHANNELS, output.channelCount());
+}
+
+// ---- LEDC ----
+
+void test_ledc_begin()
+{
+    LedcOutputDriver output(PINS, 3, 5000, RESOLUTION_BITS);
+    TEST_ASSERT_TRUE(output.begin());
+    for (uint8_t channel = 0; channel < 3; channel++)
+    {
+        TEST_ASSERT_TRUE(nativeLedcChannel(channel).configured);
+        TEST_ASSERT_EQUAL_UINT32(0, nativeLedcChannel(channel).duty);
+    }
+    TEST_ASSERT_FALSE(nativeLedcChannel(3).configured);
+    // begin() again (e.g. after a restart of the strip) is fine with the fade function installed already
+    TEST_ASSERT_TRUE(output.begin());
+}
+
+void test_ledc_write_scales_each_channel()
+{
+    LedcOutputDriver output(PINS, 3, 5000, RESOLUTION_BITS);
+    output.begin();
+    output.setGain(0, LED_OUTPUT_GAIN_ONE / 4);
+    output.setGain(2, LED_OUTPUT_GAIN_ONE / 2);
+    output.write(4000);
+    TEST_ASSERT_EQUAL_UINT32(1000, nativeLedcChannel(0).duty);
+    TEST_ASSERT_EQUAL_UINT32(4000, nativeLedcChannel(1).duty);
+    TEST_ASSERT_EQUAL_UINT32(2000, nativeLedcChannel(2).duty);
+    TEST_ASSERT_EQUAL_UINT16(4000, output.read());
+}
+
+void test_ledc_fade_reports_its_end_once()
+{
+    LedcOutputDriver output(PINS, 3, 5000, RESOLUTION_BITS);
+    output.begin();
+    TEST_ASSERT_TRUE(output.fade(100, 3000, 800, fadeDone));
+    // setting the start duty is a one step fade of its own, its end must not count
+    for (uint8_t channel = 0; channel < 3; channel++)
+    {
+        TEST_ASSERT_EQUAL_UINT32(1, nativeLedcChannel(channel).fadeEndsCalled);
+        TEST_ASSERT_TRUE(nativeLedcChannel(channel).fading);
+        TEST_ASSERT_EQUAL_UINT32(3000, nativeLedcChannel(channel).fadeTarget);
+        TEST_ASSERT_EQUAL_UINT32(800, nativeLedcChannel(channel).fadeMs);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+    // all channels end, only the reference channel reports
+    nativeLedcEndFades();
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+    TEST_ASSERT_EQUAL_UINT16(3000, output.read());
+    nativeLedcEndFades();
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+}
+
+void test_ledc_fade_to_the_start_duty()
+{
+    // the start duty already equals the target: the end of the one step fade still must not count
+    LedcOutputDriver output(PINS, 1, 5000, RESOLUTION_BITS);
+    output.begin();
+    output.fade(500, 500, 100, fadeDone);
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+    nativeLedcEndFades();
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+}
+
+void test_ledc_fade_reference_channel()
+{
+    LedcOutputDriver output(PINS, 3, 5000, RESOLUTION_BITS);
+    output.begin();
+    output.setGain(0, LED_OUTPUT_GAIN_ONE / 3);
+    output.setGain(1, LED_OUTPUT_GAIN_ONE / 5);
+    output.setGain(2, LED_OUTPUT_GAIN_ONE / 2);
+    output.fade(0, 6000, 100, fadeDone);
+    nativeLedcEndFades();
+    TEST_ASSERT_EQUAL_UINT32(1, _doneCalls);
+    TEST_ASSERT_EQUAL_UINT32(3000, nativeLedcChannel(2).duty);
+    // the duty read back comes from the most precise channel
+    TEST_ASSERT_EQUAL_UINT16(6000, output.read());
+}
+
+void test_ledc_stopped_fade_does_not_report()
+{
+    LedcOutputDriver output(PINS, 2, 5000, RESOLUTION_BITS);
+    output.begin();
+    output.fade(0, 1000, 100, fadeDone);
+    output.stopFade();
+    nativeLedcEndFades();
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+    // a write in between does not report either
+    output.write(10);
+    TEST_ASSERT_EQUAL_UINT32(0, _doneCalls);
+}
+
+void test_ledc_no_fade_with_all_channels_off()
+{
+    LedcOutputDriver output(PINS, 2, 5000, RESOLUTION_BITS);
+    output.begin();
+    output.setGain(0, 0);
+    output.setGain(1, 0);
+    TEST_ASSERT_FALSE(output.fade(0, 1000, 100, fadeDone));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_fake_write);
+    RUN_TEST(test_fake_fade);
+    RUN_TEST(test_fake_stop_fade_holds_the_duty);
+    RUN_TEST(test_fake_write_ends_a_fade);
+    RUN_TEST(test_fake_clock_wraps_around);
+    RUN_TEST(test_gains);
+    RUN_TEST(test_channel_count_is_limited);
+    RUN_TEST(test_ledc_begin);
+    RUN_TEST(test_ledc_write_scales_each_channel);
+    RUN_TEST(test_ledc_fade_reports_its_end_once);
+    RUN_TEST(test_ledc_fade_to_the_start_duty);
+    RUN_TEST(test_ledc_fade_reference_channel);
+    RUN_TEST(test_ledc_stopped_fade_does_not_report);
+    RUN_TEST(test_ledc_no_fade_with_all_channels_off);
+    return UNITY_END();
+}
@@ -0,0 +1,219 @@
+#include <config.h>
+#include <native_hal.h>
+#include <rules.h>
+#include <scheduler.h>
+#include <unity.h>
+
+// The rule keeps its state across the tests, setUp() brings it back to a known one. The clock only moves forward, the
+// control jobs (time of day, dwell wake ups) keep running on it.
+static const uint16_t THRESHOLD = 1000;
+static const uint16_t DARK = 500;
+static const uint16_t BRIGHT = 2000;
+
+// Let time pass like the control task does: run the jobs, then evaluate
+void pass(unsigned long ms)
+{
+    nativeAdvanceMillis(ms);
+    controlJobs.run();
+    rulesUpdate();
+}
+
+void setUp()
+{
+    rulesSetOverride(RULE_OVERRIDE_NONE);
+    rulesSetConditions(DEFAULT_NIGHT_LIGHT_RULE.conditions);
+    rulesSetLdrMin(0);
+    rulesSetWindowStart(0);
+    rulesSetWindowEnd(MINUTES_PER_DAY);
+    rulesSetLdrHysteresis(0);
+    rulesSetDarkDwellMs(0);
+    rulesSetPresenceDebounceMs(0);
+    rulesSetAllowed(true);
+    rulesSetLdr(BRIGHT, THRESHOLD);
+    rulesSetPresence(false);
+    pass(1000);
+}
+
+void tearDown() {}
+
+void test_all_conditions_have_to_hold()
+{
+    TEST_ASSERT_FALSE(rulesNightLight());
+    rulesSetLdr(DARK, THRESHOLD);
+    TEST_ASSERT_FALSE(rulesNightLight());
+    rulesSetPresence(true);
+    TEST_ASSERT_TRUE(rulesNightLight());
+    TEST_ASSERT_TRUE(rulesPresence());
+    rulesSetAllowed(false);
+    TEST_ASSERT_FALSE(rulesNightLight());
+    TEST_ASSERT_FALSE(rulesKeepNightLight());
+    rulesSetAllowed(true);
+    // a lit room does not switch the night light off, neither does the end of presence
+    rulesSetLdr(BRIGHT, THRESHOLD);
+    rulesSetPresence(false);
+    TEST_ASSERT_FALSE(rulesNightLight());
+    TEST_ASSERT_TRUE(rulesKeepNightLight());
+}
+
+void test_conditions_not_in_the_rule_do_not_count()
+{
+    rulesSetConditions(ruleBit(RULE_ALLOWED) | ruleBit(RULE_DARK));
+    rulesSetLdr(DARK, THRESHOLD);
+    TEST_ASSERT_TRUE(rulesNightLight());
+    TEST_ASSERT_FALSE(rulesPresence());
+}
+
+void test_ldr_min()
+{
+    rulesSetPresence(true);
+    rulesSetLdrMin(100);
+    rulesSetLdr(50, THRESHOLD); // covered sensor
+    TEST_ASSERT_FALSE(rulesNightLight());
+    rulesSetLdr(100, THRESHOLD);
+    TEST_ASSERT_TRUE(rulesNightLight());
+}
+
+void test_override()
+{
+    rulesSetOverride(RULE_OVERRIDE_ON);
+    TEST_ASSERT_TRUE(rulesNightLight());
+    TEST_ASSERT_TRUE(rulesKeepNightLight());
+    rulesSetLdr(DARK, THRESHOLD);
+    rulesSetPresence(true);
+    rulesSetOverride(RULE_OVERRIDE_OFF);
+    TEST_ASSERT_FALSE(rulesNightLight());
+    TEST_ASSERT_FALSE(rulesKeepNightLight());
+    rulesSetOverride(RULE_OVERRIDE_NONE);
+    TEST_ASSERT_TRUE(rulesNightLight());
+    TEST_ASSERT_EQUAL_STRING("off", ruleOverrideName(RULE_OVERRIDE_OFF));
+}
+
+void test_unchanged_inputs_are_not_evaluated_again()
+{
+    rulesNightLight();
+    uint32_t evaluations = rulesEvaluations();
+    for (uint8_t i = 0; i < 10; i++)
+    {
+        rulesSetLdr(BRIGHT, THRESHOLD);
+        rulesSetPresence(false);
+        rulesNightLight();
+    }
+    TEST_ASSERT_EQUAL_UINT32(evaluations, rulesEvaluations());
+    rulesSetPresence(true);
+    rulesNightLight();
+    TEST_ASSERT_EQUAL_UINT32(evaluations + 1, rulesEvaluations());
+}
+
+void test_hysteresis()
+{
+    rulesSetLdrHysteresis(100);
+    rulesSetLdr(THRESHOLD, THRESHOLD);
+    rulesUpdate();
+    TEST_ASSERT_TRUE(rulesCondition(RULE_DARK));
+    uint32_t suppressed = rulesSuppressed().hysteresis;
+    // above the threshold, within the hysteresis: stays dark
+    rulesSetLdr(THRESHOLD + 50, THRESHOLD);
+    rulesUpdate();
+    TEST_ASSERT_TRUE(rulesCondition(RULE_DARK));
+    TEST_ASSERT_EQUAL_UINT32(suppressed + 1, rulesSuppressed().hysteresis);
+    rulesSetLdr(THRESHOLD + 101, THRESHOLD);
+    rulesUpdate();
+    TEST_ASSERT_FALSE(rulesCondition(RULE_DARK));
+    // getting dark again takes the plain threshold
+    rulesSetLdr(THRESHOLD + 50, THRESHOLD);
+    rulesUpdate();
+    TEST_ASSERT_FALSE(rulesCondition(RULE_DARK));
+}
+
+void test_dark_dwell()
+{
+    rulesSetDarkDwellMs(2000);
+    rulesSetLdr(DARK, THRESHOLD);
+    rulesUpdate();
+    pass(1000);
+    TEST_ASSERT_FALSE(rulesCondition(RULE_DARK));
+    // the wake up job is due when the dwell time is up
+    TEST_ASSERT_EQUAL_UINT32(1000, controlJobs.msUntilNextDue());
+    pass(1000);
+    TEST_ASSERT_TRUE(rulesCondition(RULE_DARK));
+    // a short flash of light does not count
+    uint32_t suppressed = rulesSuppressed().darkDwell;
+    rulesSetLdr(BRIGHT, THRESHOLD);
+    rulesUpdate();
+    pass(500);
+    rulesSetLdr(DARK, THRESHOLD);
+    pass(5000);
+    TEST_ASSERT_TRUE(rulesCondition(RULE_DARK));
+    TEST_ASSERT_EQUAL_UINT32(suppressed + 1, rulesSuppressed().darkDwell);
+}
+
+void test_presence_debounce()
+{
+    rulesSetPresenceDebounceMs(300);
+    rulesSetPresence(true);
+    rulesUpdate();
+    pass(299);
+    TEST_ASSERT_FALSE(rulesPresence());
+    pass(1);
+    TEST_ASSERT_TRUE(rulesPresence());
+    uint32_t suppressed = rulesSuppressed().presenceDebounce;
+    rulesSetPresence(false);
+    rulesUpdate();
+    pass(100);
+    rulesSetPresence(true);
+    pass(1000);
+    TEST_ASSERT_TRUE(rulesPresence());
+    TEST_ASSERT_EQUAL_UINT32(suppressed + 1, rulesSuppressed().presenceDebounce);
+}
+
+void test_time_window_across_midnight()
+{
+    rulesSetConditions(ruleBit(RULE_ALLOWED) | ruleBit(RULE_TIME_WINDOW));
+    rulesSetWindowStart(22 * 60);
+    rulesSetWindowEnd(6 * 60);
+    // unknown time of day: the window holds
+    TEST_ASSERT_TRUE(rulesNightLight());
+    rulesSetTimeOfDay(21 * 60 + 59);
+    TEST_ASSERT_FALSE(rulesNightLight());
+    pass(60000);
+    TEST_ASSERT_EQUAL_INT16(22 * 60, rulesTimeOfDay());
+    TEST_ASSERT_TRUE(rulesNightLight());
+    rulesSetTimeOfDay(5 * 60 + 59);
+    TEST_ASSERT_TRUE(rulesNightLight());
+    pass(60000);
+    TEST_ASSERT_FALSE(rulesNightLight());
+}
+
+void test_save_and_load()
+{
+    rulesSetConditions(ruleBit(RULE_ALLOWED) | ruleBit(RULE_PRESENCE));
+    rulesSetLdrMin(42);
+    rulesSetLdrHysteresis(77);
+    rulesSave();
+    NightLightRule rule;
+    TEST_ASSERT_TRUE(nightLightRule(rule));
+    TEST_ASSERT_EQUAL_UINT8(ruleBit(RULE_ALLOWED) | ruleBit(RULE_PRESENCE), rule.conditions);
+    TEST_ASSERT_EQUAL_UINT16(42, rule.ldrMin);
+    NightLightGating gating;
+    TEST_ASSERT_TRUE(nightLightGating(gating));
+    TEST_ASSERT_EQUAL_UINT16(77, gating.ldrHysteresis);
+}
+
+int main(int argc, char **argv)
+{
+    nativeReset();
+    configSetup();
+    rulesSetup();
+    UNITY_BEGIN();
+    RUN_TEST(test_all_conditions_have_to_hold);
+    RUN_TEST(test_conditions_not_in_the_rule_do_not_count);
+    RUN_TEST(test_ldr_min);
+    RUN_TEST(test_override);
+    RUN_TEST(test_unchanged_inputs_are_not_evaluated_again);
+    RUN_TEST(test_hysteresis);
+    RUN_TEST(test_dark_dwell);
+    RUN_TEST(test_presence_debounce);
+    RUN_TEST(test_time_window_across_midnight);
+    RUN_TEST(test_save_and_load);
+    return UNITY_END();
+}
@@ -0,0 +1,187 @@
+#include <native_hal.h>
+#include <scheduler.h>
+#include <unity.h>
+
+uint32_t _runs = 0;
+uint32_t _otherRuns = 0;
+unsigned long _lastRunMs = 0;
+Scheduler *_jobs = nullptr;
+JobId _selfCancelling = NO_JOB;
+
+void countRun()
+{
+    _runs++;
+    _lastRunMs = millis();
+}
+
+void countOtherRun() { _otherRuns++; }
+
+void cancelSelf()
+{
+    _runs++;
+    _jobs->cancel(_selfCancelling);
+}
+
+// Let the clock run ms by ms up to toMs, running the jobs on the way like the task loop does
+void runUntil(Scheduler &jobs, unsigned long toMs)
+{
+    while ((int32_t)((uint32_t)toMs - (uint32_t)millis()) > 0)
+    {
+        nativeAdvanceMillis(1);
+        jobs.run();
+    }
+}
+
+void setUp()
+{
+    nativeReset();
+    _runs = 0;
+    _otherRuns = 0;
+    _lastRunMs = 0;
+    _selfCancelling = NO_JOB;
+}
+
+void tearDown() {}
+
+void test_empty_scheduler_has_nothing_due()
+{
+    Scheduler jobs("test");
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, jobs.run());
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, jobs.msUntilNextDue());
+}
+
+void test_periodic_job_keeps_its_period()
+{
+    Scheduler jobs("test");
+    JobId job = jobs.every("count", 10, countRun);
+    runUntil(jobs, 1000);
+    // an overdue first run goes with the next tick: 1, 11, 21 .. 991
+    TEST_ASSERT_EQUAL_UINT32(100, _runs);
+    JobStats stats = jobs.stats(job);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.maxLateMs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(1, jobs.msUntilNextDue());
+}
+
+void test_first_delay()
+{
+    Scheduler jobs("test");
+    jobs.every("count", 100, countRun, 250);
+    runUntil(jobs, 249);
+    TEST_ASSERT_EQUAL_UINT32(0, _runs);
+    runUntil(jobs, 250);
+    TEST_ASSERT_EQUAL_UINT32(1, _runs);
+    runUntil(jobs, 450);
+    TEST_ASSERT_EQUAL_UINT32(3, _runs);
+}
+
+void test_one_shot_job_runs_once_and_frees_its_slot()
+{
+    Scheduler jobs("test");
+    JobId job = jobs.once("once", 50, countRun);
+    runUntil(jobs, 500);
+    TEST_ASSERT_EQUAL_UINT32(1, _runs);
+    TEST_ASSERT_EQUAL_UINT32(50, _lastRunMs);
+    TEST_ASSERT_FALSE(jobs.stats(job).active);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, jobs.msUntilNextDue());
+    TEST_ASSERT_EQUAL_INT8(job, jobs.once("again", 10, countRun));
+}
+
+void test_cancel()
+{
+    Scheduler jobs("test");
+    JobId job = jobs.every("count", 10, countRun);
+    jobs.every("other", 10, countOtherRun);
+    runUntil(jobs, 100);
+    jobs.cancel(job);
+    runUntil(jobs, 200);
+    TEST_ASSERT_EQUAL_UINT32(10, _runs);
+    TEST_ASSERT_EQUAL_UINT32(20, _otherRuns);
+}
+
+void test_job_cancels_itself()
+{
+    Scheduler jobs("test");
+    _jobs = &jobs;
+    _selfCancelling = jobs.every("self", 10, cancelSelf);
+    runUntil(jobs, 100);
+    TEST_ASSERT_EQUAL_UINT32(1, _runs);
+    TEST_ASSERT_FALSE(jobs.stats(_selfCancelling).active);
+}
+
+void test_set_period()
+{
+    Scheduler jobs("test");
+    JobId job = jobs.every("count", 10, countRun);
+    runUntil(jobs, 100);
+    TEST_ASSERT_EQUAL_UINT32(10, _runs);
+    jobs.setPeriod(job, 100);
+    runUntil(jobs, 1000);
+    TEST_ASSERT_EQUAL_UINT32(19, _runs);
+    TEST_ASSERT_EQUAL_UINT32(100, jobs.stats(job).periodMs);
+}
+
+void test_job_beyond_the_wheel()
+{
+    // further out than the last level reaches: the job moves on from the end of the wheel
+    Scheduler jobs("test");
+    jobs.once("far", 10UL * 60 * 1000, countRun);
+    nativeSetMillis(10UL * 60 * 1000 - 1);
+    jobs.run();
+    TEST_ASSERT_EQUAL_UINT32(0, _runs);
+    TEST_ASSERT_EQUAL_UINT32(1, jobs.msUntilNextDue());
+    nativeAdvanceMillis(1);
+    jobs.run();
+    TEST_ASSERT_EQUAL_UINT32(1, _runs);
+}
+
+void test_jump_runs_each_job_once_and_counts_overruns()
+{
+    Scheduler jobs("test");
+    JobId job = jobs.every("count", 10, countRun);
+    nativeSetMillis(36);
+    jobs.run();
+    // due at 1, skipped 11, 21 and 31, next at 41
+    TEST_ASSERT_EQUAL_UINT32(1, _runs);
+    JobStats stats = jobs.stats(job);
+    TEST_ASSERT_EQUAL_UINT32(35, stats.maxLateMs);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.overruns);
+    TEST_ASSERT_EQUAL_UINT32(5, jobs.msUntilNextDue());
+}
+
+void test_clock_wraps_around()
+{
+    nativeSetMillis(UINT32_MAX - 50);
+    Scheduler jobs("test");
+    jobs.every("count", 20, countRun);
+    runUntil(jobs, 150);
+    // 50, 30 and 10 ms before the wrap, then every 20 ms up to 150 after it
+    TEST_ASSERT_EQUAL_UINT32(11, _runs);
+    TEST_ASSERT_EQUAL_UINT32(150, _lastRunMs);
+}
+
+void test_no_room_left()
+{
+    Scheduler jobs("test");
+    for (uint8_t i = 0; i < MAX_JOBS; i++)
+        TEST_ASSERT_NOT_EQUAL(NO_JOB, jobs.every("count", 10 + i, countRun));
+    TEST_ASSERT_EQUAL_INT8(NO_JOB, jobs.once("one too many", 10, countRun));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_scheduler_has_nothing_due);
+    RUN_TEST(test_periodic_job_keeps_its_period);
+    RUN_TEST(test_first_delay);
+    RUN_TEST(test_one_shot_job_runs_once_and_frees_its_slot);
+    RUN_TEST(test_cancel);
+    RUN_TEST(test_job_cancels_itself);
+    RUN_TEST(test_set_period);
+    RUN_TEST(test_job_beyond_the_wheel);
+    RUN_TEST(test_jump_runs_each_job_once_and_counts_overruns);
+    RUN_TEST(test_clock_wraps_around);
+    RUN_TEST(test_no_room_left);
+    return UNITY_END();
+}
@@ -0,0 +1,132 @@
+#include <device_common.h>
+#include <device_state.h>
+#include <native_hal.h>
+#include <presence.h>
+#include <unity.h>
+
+// The whole lamp on the fake hardware: its tasks, timers and fades run while delay() lets the fake clock pass. The
+// radar sends its frames, the LDR pin gets a voltage, the buttons get pressed by script. The lamp starts only once,
+// the tests build on each other.
+
+static const uint16_t DARK_MV = 10;
+static const uint16_t BRIGHT_MV = 2000;
+static const unsigned long CLICK_MS = 100;
+static const unsigned long SETTLE_MS = 10000; // Long enough for the LDR filter, the fades and the double click time
+
+static NativeRadar _radar;
+
+static void someoneMoving()
+{
+    NativeRadarTarget target = {};
+    target.moving = true;
+    target.movingDistance = 120;
+    target.movingEnergy = 60;
+    _radar.setTarget(target);
+}
+
+static void nobodyThere() { _radar.setTarget(NativeRadarTarget()); }
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_boots_off()
+{
+    nativeSetMillivolts(LDR_PIN, BRIGHT_MV);
+    presenceUseStream(_radar);
+    deviceSetup();
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_EQUAL(OFF, info.state);
+    TEST_ASSERT_EQUAL_UINT8(0, info.brightness);
+    TEST_ASSERT_GREATER_THAN(1000, info.ldrValue);
+    TEST_ASSERT_TRUE(isConnected());
+}
+
+void test_radar_answers_configuration()
+{
+    LD2410Firmware firmware = firmwareInfo();
+    TEST_ASSERT_TRUE(firmware.Valid);
+    TEST_ASSERT_EQUAL_UINT8(1, firmware.Major);
+    TEST_ASSERT_EQUAL_UINT8(7, firmware.Minor);
+    LD2410Config config = currentConfig();
+    TEST_ASSERT_TRUE(config.Valid);
+    TEST_ASSERT_EQUAL_UINT8(8, config.max_gate);
+    TEST_ASSERT_EQUAL_UINT16(5, config.sensor_idle_time);
+}
+
+void test_presence_in_bright_room_keeps_lamp_off()
+{
+    someoneMoving();
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_TRUE(info.movingTargetDetected);
+    TEST_ASSERT_EQUAL_UINT16(120, info.movingTargetDistance);
+    TEST_ASSERT_EQUAL(OFF, info.state);
+}
+
+void test_presence_in_the_dark_turns_night_light_on()
+{
+    nativeSetMillivolts(LDR_PIN, DARK_MV);
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_LESS_OR_EQUAL(info.nightLightThreshold, info.ldrValue);
+    TEST_ASSERT_EQUAL(NIGHT_LIGHT_ON, info.state);
+    TEST_ASSERT_EQUAL_UINT8(info.nightLightBrightness, info.brightness);
+}
+
+void test_night_light_goes_off_after_its_duration()
+{
+    nobodyThere();
+    unsigned long durationMs = getDeviceState().nightLightOnDuration;
+    delay(durationMs / 2);
+    TEST_ASSERT_EQUAL(NIGHT_LIGHT_ON, getDeviceState().state);
+    delay(durationMs / 2 + SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_FALSE(info.movingTargetDetected);
+    TEST_ASSERT_EQUAL(OFF, info.state);
+    TEST_ASSERT_EQUAL_UINT8(0, info.brightness);
+}
+
+void test_on_button_switches_on()
+{
+    nativeSchedulePress(TOUCH4_PIN, 0, CLICK_MS);
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_EQUAL(ON, info.state);
+    TEST_ASSERT_EQUAL_UINT8(info.onBrightness, info.brightness);
+}
+
+void test_minus_button_steps_down()
+{
+    uint8_t before = getDeviceState().brightness;
+    nativeSchedulePress(TOUCH2_PIN, 0, CLICK_MS);
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_EQUAL(ON, info.state);
+    TEST_ASSERT_EQUAL_UINT8(before - info.stepBrightness, info.brightness);
+}
+
+void test_off_button_switches_off()
+{
+    nativeSchedulePress(TOUCH1_PIN, 0, CLICK_MS);
+    delay(SETTLE_MS);
+    DeviceStateInfo info = getDeviceState();
+    TEST_ASSERT_EQUAL(OFF, info.state);
+    TEST_ASSERT_EQUAL_UINT8(0, info.brightness);
+}
+
+int main(int argc, char **argv)
+{
+    nativeReset();
+    UNITY_BEGIN();
+    RUN_TEST(test_boots_off);
+    RUN_TEST(test_radar_answers_configuration);
+    RUN_TEST(test_presence_in_bright_room_keeps_lamp_off);
+    RUN_TEST(test_presence_in_the_dark_turns_night_light_on);
+    RUN_TEST(test_night_light_goes_off_after_its_duration);
+    RUN_TEST(test_on_button_switches_on);
+    RUN_TEST(test_minus_button_steps_down);
+    RUN_TEST(test_off_button_switches_off);
+    return UNITY_END();
+}
@@ -0,0 +1,193 @@
+#include <state_table.h>
+#include <stdio.h>
+#include <unity.h>
+
+// Walks every cell of the state table. stateTableComplete() already checks the layout at compile time, these tests
+// check what the lamp does with it.
+
+static const State START_STATES[] = {START_TRANSIT_TO_ON, START_TRANSIT_TO_OFF, START_TRANSIT_TO_NIGHT_LIGHT};
+static const State TRANSIT_STATES[] = {TRANSIT_TO_ON, TRANSIT_TO_OFF, TRANSIT_TO_NIGHT_LIGHT};
+
+// Names the cell in a failure message
+const char *cellName(uint8_t state, uint8_t event)
+{
+    static char name[40];
+    snprintf(name, sizeof(name), "state %u, event %u", state, event);
+    return name;
+}
+
+bool isStartState(State state)
+{
+    return state == START_TRANSIT_TO_ON || state == START_TRANSIT_TO_OFF || state == START_TRANSIT_TO_NIGHT_LIGHT;
+}
+
+// The states reachable from a state, by any event and either outcome of the action. forward = false walks the table
+// backwards: the states a state can be reached from.
+void reachable(State from, bool forward, bool *seen)
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+        seen[state] = false;
+    seen[from] = true;
+    bool grown = true;
+    while (grown)
+    {
+        grown = false;
+        for (uint8_t state = 0; state < STATE_COUNT; state++)
+        {
+            for (uint8_t event = 0; event < STATE_EVENT_COUNT; event++)
+            {
+                const StateTransition &transition = stateTransition((State)state, (StateEvent)event);
+                const State targets[] = {transition.next, transition.otherwise};
+                for (State target : targets)
+                {
+                    uint8_t source = forward ? state : target;
+                    uint8_t reached = forward ? target : state;
+                    if (seen[source] && !seen[reached])
+                    {
+                        seen[reached] = true;
+                        grown = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_every_cell_is_in_its_place()
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        for (uint8_t event = 0; event < STATE_EVENT_COUNT; event++)
+        {
+            const StateTransition &transition = stateTransition((State)state, (StateEvent)event);
+            const char *cell = cellName(state, event);
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(state, transition.state, cell);
+            TEST_ASSERT_EQUAL_UINT8_MESSAGE(event, transition.event, cell);
+            TEST_ASSERT_TRUE_MESSAGE(transition.action < STATE_ACTION_COUNT, cell);
+            TEST_ASSERT_TRUE_MESSAGE(transition.next < STATE_COUNT, cell);
+            TEST_ASSERT_TRUE_MESSAGE(transition.otherwise < STATE_COUNT, cell);
+            TEST_ASSERT_TRUE_MESSAGE(&transition == &STATE_TABLE[state][event], cell);
+        }
+    }
+}
+
+void test_actions_that_always_or_never_take_place()
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        for (uint8_t event = 0; event < STATE_EVENT_COUNT; event++)
+        {
+            const StateTransition &transition = stateTransition((State)state, (StateEvent)event);
+            const char *cell = cellName(state, event);
+            // no action: its outcome must not matter
+            if (transition.action == ACTION_NONE)
+                TEST_ASSERT_EQUAL_UINT8_MESSAGE(transition.next, transition.otherwise, cell);
+            // the lamp is off already: nothing changes
+            if (transition.action == ACTION_IGNORE_ALREADY_OFF)
+            {
+                TEST_ASSERT_EQUAL_UINT8_MESSAGE(state, transition.next, cell);
+                TEST_ASSERT_EQUAL_UINT8_MESSAGE(state, transition.otherwise, cell);
+            }
+        }
+    }
+}
+
+void test_every_state_is_reachable_from_off()
+{
+    bool seen[STATE_COUNT];
+    reachable(OFF, true, seen);
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+        TEST_ASSERT_TRUE_MESSAGE(seen[state], cellName(state, 0));
+}
+
+void test_off_is_reachable_from_every_state()
+{
+    bool seen[STATE_COUNT];
+    reachable(OFF, false, seen);
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+        TEST_ASSERT_TRUE_MESSAGE(seen[state], cellName(state, 0));
+}
+
+void test_switch_off_always_heads_for_off()
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        const StateTransition &transition = stateTransition((State)state, STATE_EVENT_SWITCH_OFF);
+        const char *cell = cellName(state, STATE_EVENT_SWITCH_OFF);
+        // while already on the way off, going on that way is fine as well
+        bool offward = transition.next == START_TRANSIT_TO_OFF ||
+                       (state == START_TRANSIT_TO_OFF && transition.next == state);
+        TEST_ASSERT_TRUE_MESSAGE(offward, cell);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(transition.next, transition.otherwise, cell);
+    }
+}
+
+void test_switch_on_always_heads_for_on()
+{
+    for (uint8_t state = 0; state < STATE_COUNT; state++)
+    {
+        const StateTransition &transition = stateTransition((State)state, STATE_EVENT_SWITCH_ON);
+        const char *cell = cellName(state, STATE_EVENT_SWITCH_ON);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(START_TRANSIT_TO_ON, transition.next, cell);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(START_TRANSIT_TO_ON, transition.otherwise, cell);
+    }
+}
+
+void test_start_states_are_left_with_the_next_tick()
+{
+    for (State state : START_STATES)
+    {
+        const StateTransition &transition = stateTransition(state, STATE_EVENT_TICK);
+        const char *cell = cellName(state, STATE_EVENT_TICK);
+        TEST_ASSERT_NOT_EQUAL(state, transition.next);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(transition.next, transition.otherwise, cell);
+        TEST_ASSERT_FALSE_MESSAGE(isStartState(transition.next), cell);
+    }
+}
+
+void test_transitions_wait_for_their_end()
+{
+    const State ends[] = {ON, OFF, NIGHT_LIGHT_ON};
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        const StateTransition &transition = stateTransition(TRANSIT_STATES[i], STATE_EVENT_TICK);
+        const char *cell = cellName(TRANSIT_STATES[i], STATE_EVENT_TICK);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(ends[i], transition.next, cell);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(TRANSIT_STATES[i], transition.otherwise, cell);
+    }
+}
+
+void test_ticks_alone_settle()
+{
+    // with every action taking place, ticking leads from any state to a steady one within a few steps
+    for (uint8_t start = 0; start < STATE_COUNT; start++)
+    {
+        State state = (State)start;
+        uint8_t ticks = 0;
+        while (!(state == ON || state == OFF || state == NIGHT_LIGHT_ON) && ticks < STATE_COUNT)
+        {
+            state = stateTransition(state, STATE_EVENT_TICK).next;
+            ticks++;
+        }
+        TEST_ASSERT_TRUE_MESSAGE(ticks <= 2, cellName(start, STATE_EVENT_TICK));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_every_cell_is_in_its_place);
+    RUN_TEST(test_actions_that_always_or_never_take_place);
+    RUN_TEST(test_every_state_is_reachable_from_off);
+    RUN_TEST(test_off_is_reachable_from_every_state);
+    RUN_TEST(test_switch_off_always_heads_for_off);
+    RUN_TEST(test_switch_on_always_heads_for_on);
+    RUN_TEST(test_start_states_are_left_with_the_next_tick);
+    RUN_TEST(test_transitions_wait_for_their_end);
+    RUN_TEST(test_ticks_alone_settle);
+    return UNITY_END();
+}